@@ -0,0 +1,159 @@
+/**
+ * Compteurs matériels de performance pour les benchmarks (Linux perf_event)
+ *
+ * Les compteurs sont ouverts pour le thread courant, en mode utilisateur seulement : c'est permis jusqu'à
+ * perf_event_paranoid = 2. Ils forment deux groupes, comptés chacun sur les mêmes intervalles : cycles, instructions et
+ * branches d'une part, défauts de cache L1 données et de dernier niveau d'autre part. Un groupe unique de six compteurs
+ * dépasse le nombre de compteurs programmables de certains processeurs et n'est alors jamais compté ; séparés, les
+ * groupes sont multiplexés par le noyau si besoin et leurs valeurs extrapolées.
+ * Un compteur que le processeur (ou la machine virtuelle) ne fournit pas est ignoré ; sans compteur de cycles, les
+ * benchmarks n'affichent que les durées. Hors Linux, aucun compteur n'est disponible.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_PERF_COUNTERS_H_
+#define TELEINFO_PERF_COUNTERS_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#define TELEINFO_COUNTER_CYCLES          0
+#define TELEINFO_COUNTER_INSTRUCTIONS    1
+#define TELEINFO_COUNTER_BRANCHES        2
+#define TELEINFO_COUNTER_BRANCH_MISSES   3
+#define TELEINFO_COUNTER_L1D_MISSES      4
+#define TELEINFO_COUNTER_LLC_MISSES      5
+#define TELEINFO_COUNTERS                6
+
+class TeleinfoPerfCounters {
+  private:
+    int fds[TELEINFO_COUNTERS];
+    uint64_t values[TELEINFO_COUNTERS];
+    bool measured[TELEINFO_COUNTERS];
+    int cacheLeader; // Premier compteur ouvert du groupe des défauts de cache, -1 si aucun
+
+#ifdef __linux__
+    static int open(uint32_t type, uint64_t config, int leader) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = type;
+      attr.config = config;
+      attr.disabled = leader < 0 ? 1 : 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      return (int) syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+    }
+
+    static uint64_t cache(uint64_t cache, uint64_t operation, uint64_t result) {
+      return cache | (operation << 8) | (result << 16);
+    }
+#endif
+
+  public:
+    TeleinfoPerfCounters() {
+      for (int counter = 0; counter < TELEINFO_COUNTERS; counter++) {
+        fds[counter] = -1;
+        values[counter] = 0;
+        measured[counter] = false;
+      }
+      cacheLeader = -1;
+#ifdef __linux__
+      fds[TELEINFO_COUNTER_CYCLES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+      int leader = fds[TELEINFO_COUNTER_CYCLES];
+      if (leader < 0) {
+        return;
+      }
+      fds[TELEINFO_COUNTER_INSTRUCTIONS] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader);
+      fds[TELEINFO_COUNTER_BRANCHES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, leader);
+      fds[TELEINFO_COUNTER_BRANCH_MISSES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, leader);
+
+      // Second groupe : le premier défaut de cache disponible en est le meneur
+      fds[TELEINFO_COUNTER_L1D_MISSES] = open(PERF_TYPE_HW_CACHE,
+          cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), -1);
+      cacheLeader = fds[TELEINFO_COUNTER_L1D_MISSES];
+      fds[TELEINFO_COUNTER_LLC_MISSES] = open(PERF_TYPE_HW_CACHE,
+          cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), cacheLeader);
+      if (cacheLeader < 0) {
+        cacheLeader = fds[TELEINFO_COUNTER_LLC_MISSES];
+      }
+#endif
+    }
+
+    ~TeleinfoPerfCounters() {
+      for (int counter = 0; counter < TELEINFO_COUNTERS; counter++) {
+        if (fds[counter] >= 0) {
+          close(fds[counter]);
+        }
+      }
+    }
+
+    /**
+     * Indique si les cycles peuvent être comptés (sinon aucun compteur n'est disponible)
+     */
+    bool isAvailable() {
+      return fds[TELEINFO_COUNTER_CYCLES] >= 0;
+    }
+
+    /**
+     * Remet les compteurs à zéro et commence le comptage
+     */
+    void start() {
+#ifdef __linux__
+      if (isAvailable()) {
+        if (cacheLeader >= 0) {
+          ioctl(cacheLeader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+          ioctl(cacheLeader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+        ioctl(fds[TELEINFO_COUNTER_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[TELEINFO_COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+      }
+#endif
+    }
+
+    /**
+     * Arrête le comptage et lit les compteurs. Une valeur comptée sur une partie de la mesure seulement (compteurs
+     * partagés avec d'autres programmes) est extrapolée à toute la mesure.
+     */
+    void stop() {
+#ifdef __linux__
+      if (!isAvailable()) {
+        return;
+      }
+      ioctl(fds[TELEINFO_COUNTER_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+      if (cacheLeader >= 0) {
+        ioctl(cacheLeader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+      }
+      for (int counter = 0; counter < TELEINFO_COUNTERS; counter++) {
+        uint64_t data[3]; // Valeur, durée d'activation, durée de comptage
+        measured[counter] = fds[counter] >= 0 && read(fds[counter], data, sizeof(data)) == sizeof(data) && data[2] > 0;
+        values[counter] = measured[counter] ? (uint64_t) ((double) data[0] * data[1] / data[2]) : 0;
+      }
+#endif
+    }
+
+    /**
+     * Indique si un compteur (TELEINFO_COUNTER_*) a été lu lors de la dernière mesure
+     */
+    bool has(int counter) {
+      return measured[counter];
+    }
+
+    /**
+     * Donne la valeur d'un compteur (TELEINFO_COUNTER_*) lors de la dernière mesure
+     */
+    uint64_t get(int counter) {
+      return values[counter];
+    }
+};
+
+#endif  // TELEINFO_PERF_COUNTERS_H_
@@ -0,0 +1,82 @@
+/**
+ * Générateur de flux Téléinfo synthétique pour les benchmarks
+ *
+ * Produit des trames d'un compteur en option Heures Creuses dont les index et l'intensité évoluent d'une trame à l'autre.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_STREAM_GENERATOR_H_
+#define TELEINFO_STREAM_GENERATOR_H_
+
+#include <stdio.h>
+#include <string>
+
+class TeleinfoStreamGenerator {
+  private:
+    unsigned long hchc;
+    unsigned long hchp;
+    unsigned int frame;
+
+  public:
+    TeleinfoStreamGenerator() {
+      hchc = 12345678;
+      hchp = 23456789;
+      frame = 0;
+    }
+
+    /**
+     * Ajoute une trame complète (STX ... ETX) au flux
+     */
+    void appendFrame(std::string& stream) {
+      char value[16];
+      int iinst = 3 + (frame * 7) % 25;
+      bool heuresCreuses = (frame / 500) % 2 == 0;
+      if (heuresCreuses) {
+        hchc += iinst / 3 + 1;
+      } else {
+        hchp += iinst / 3 + 1;
+      }
+
+      stream += '\x02';
+      appendGroupe(stream, "ADCO", "026489026467");
+      appendGroupe(stream, "OPTARIF", "HC..");
+      appendGroupe(stream, "ISOUSC", "30");
+      snprintf(value, sizeof(value), "%09lu", hchc);
+      appendGroupe(stream, "HCHC", value);
+      snprintf(value, sizeof(value), "%09lu", hchp);
+      appendGroupe(stream, "HCHP", value);
+      appendGroupe(stream, "PTEC", heuresCreuses ? "HC.." : "HP..");
+      snprintf(value, sizeof(value), "%03d", iinst);
+      appendGroupe(stream, "IINST", value);
+      appendGroupe(stream, "IMAX", "045");
+      snprintf(value, sizeof(value), "%05d", iinst * 230);
+      appendGroupe(stream, "PAPP", value);
+      appendGroupe(stream, "HHPHC", "D");
+      appendGroupe(stream, "MOTDETAT", "000000");
+      stream += '\x03';
+      frame++;
+    }
+
+    /**
+     * Ajoute un groupe étiquette/donnée avec son checksum (LF étiquette SP donnée SP checksum CR)
+     */
+    static void appendGroupe(std::string& stream, const char* etiquette, const char* donnee) {
+      unsigned int sum = 0x20;
+      for (const char* ptr = etiquette; *ptr; ptr++) {
+        sum += *ptr;
+      }
+      for (const char* ptr = donnee; *ptr; ptr++) {
+        sum += *ptr;
+      }
+      stream += '\x0A';
+      stream += etiquette;
+      stream += ' ';
+      stream += donnee;
+      stream += ' ';
+      stream += (char) ((sum & 0x3F) + 0x20);
+      stream += '\x0D';
+    }
+};
+
+#endif  // TELEINFO_STREAM_GENERATOR_H_
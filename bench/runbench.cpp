@@ -0,0 +1,832 @@
+/**
+ * Benchmarks du décodeur Téléinfo
+ *
+ * Chaque scénario décode le même flux synthétique et donne le débit obtenu.
+ * Option -p : lit aussi les compteurs matériels de chaque scénario (cycles/octet, IPC, branches mal prédites, défauts de cache).
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoInternal.h" // Classes internes mesurées : TeleinfoGroupe::check(), TeleinfoImpl::store()
+#include "TeleinfoCoroutine.h"
+#include "TeleinfoCodec.h"
+#include "TeleinfoAggregator.h"
+#include "TeleinfoRegistry.h"
+#include "TeleinfoCheckpoint.h"
+#include "TeleinfoSerializer.h"
+#include "TeleinfoSnapshot.h"
+#include "TeleinfoConflator.h"
+#include "TeleinfoMetrics.h"
+#include "TeleinfoRollup.h"
+#include "TeleinfoFleet.h"
+#include "TeleinfoStreamGenerator.h"
+#include "TeleinfoPerfCounters.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <chrono>
+#include <vector>
+
+#define BENCH_FRAMES       20000
+#define BENCH_ITERATIONS   10
+#define BENCH_METERS       10000
+#define BENCH_REGISTRY     100000
+#define BENCH_CHECKPOINT   "/tmp/teleinfo-bench-checkpoint"
+#define BENCH_ROLLUP_DAYS  30
+#define BENCH_ROLLUP_STEP  2000ULL  // Une trame toutes les 2 secondes
+#define BENCH_GROUPES      1000
+#define BENCH_FLEET        100000
+#define BENCH_FLEET_TOP    100
+
+/**
+ * Empêche le compilateur d'éliminer les lectures des trames
+ */
+static volatile unsigned long sink;
+
+/**
+ * Compteurs matériels (option -p), NULL si non demandés ou indisponibles
+ */
+static TeleinfoPerfCounters* counters = NULL;
+
+static void startCounters() {
+	if (counters != NULL) {
+		counters->start();
+	}
+}
+
+static void stopCounters() {
+	if (counters != NULL) {
+		counters->stop();
+	}
+}
+
+/**
+ * Affiche les compteurs matériels de la dernière mesure
+ * @param units le nombre d'unités traitées pendant la mesure
+ * @param unit le nom de l'unité
+ */
+static void reportCounters(double units, const char* unit) {
+	if (counters == NULL) {
+		return;
+	}
+	if (!counters->has(TELEINFO_COUNTER_CYCLES)) {
+		printf("%-28s compteurs non lus\n", "");
+		return;
+	}
+	double cycles = counters->get(TELEINFO_COUNTER_CYCLES);
+	printf("%-28s %10.2f cycles/%s", "", cycles / units, unit);
+	if (counters->has(TELEINFO_COUNTER_INSTRUCTIONS) && cycles > 0) {
+		printf("  IPC %.2f", counters->get(TELEINFO_COUNTER_INSTRUCTIONS) / cycles);
+	}
+	if (counters->has(TELEINFO_COUNTER_BRANCHES) && counters->has(TELEINFO_COUNTER_BRANCH_MISSES) && counters->get(TELEINFO_COUNTER_BRANCHES) > 0) {
+		printf("  branches mal prédites %.2f %%", 100.0 * counters->get(TELEINFO_COUNTER_BRANCH_MISSES) / counters->get(TELEINFO_COUNTER_BRANCHES));
+	}
+	if (counters->has(TELEINFO_COUNTER_L1D_MISSES)) {
+		printf("  défauts L1d %.3f/%s", counters->get(TELEINFO_COUNTER_L1D_MISSES) / units, unit);
+	}
+	if (counters->has(TELEINFO_COUNTER_LLC_MISSES)) {
+		printf("  défauts LLC %.4f/%s", counters->get(TELEINFO_COUNTER_LLC_MISSES) / units, unit);
+	}
+	printf("\n");
+}
+
+/**
+ * Source synchrone lisant le flux en mémoire : ses lectures ne suspendent jamais
+ */
+class MemorySource {
+private:
+	const std::string* stream;
+	unsigned int position;
+
+public:
+	struct ReadAwaiter {
+		unsigned int length;
+		bool await_ready() noexcept {
+			return true;
+		}
+		void await_suspend(std::coroutine_handle<>) noexcept {
+		}
+		unsigned int await_resume() noexcept {
+			return length;
+		}
+	};
+
+	MemorySource(const std::string* stream) {
+		this->stream = stream;
+		this->position = 0;
+	}
+
+	ReadAwaiter read(unsigned char* buffer, unsigned int size) {
+		unsigned int length = stream->size() - position;
+		if (length > size) {
+			length = size;
+		}
+		stream->copy((char*) buffer, length, position);
+		position += length;
+		return ReadAwaiter{length};
+	}
+};
+
+/**
+ * Affiche le résultat d'un scénario
+ */
+static void report(const char* name, const std::string& stream, unsigned long frames, std::chrono::steady_clock::duration duration) {
+	stopCounters();
+	double seconds = std::chrono::duration<double>(duration).count();
+	double bytes = (double) stream.size() * BENCH_ITERATIONS;
+	printf("%-28s %10.1f Mo/s %12.0f trames/s %8.2f ns/octet (%lu trames)\n", name, bytes / seconds / 1e6, frames / seconds, seconds * 1e9 / bytes, frames);
+	reportCounters(bytes, "octet");
+}
+
+/**
+ * Boucle écrite à la main : un appel à decode(int) par octet
+ */
+static void benchDecodeByte(const std::string& stream) {
+	TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+	unsigned long frames = 0;
+	unsigned long checksum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	startCounters();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		for (unsigned int i = 0; i < stream.size(); i++) {
+			Teleinfo* teleinfo = teleinfoDecoder->decode((unsigned char) stream[i]);
+			if (teleinfo != NULL) {
+				checksum += teleinfo->getTotalIndex();
+				frames++;
+			}
+		}
+	}
+	sink = checksum;
+	report("decode(int)", stream, frames, std::chrono::steady_clock::now() - start);
+}
+
+/**
+ * Boucle écrite à la main : décodage par blocs
+ */
+static void benchDecodeBuffer(const std::string& stream) {
+	TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+	const unsigned char* buffer = (const unsigned char*) stream.data();
+	unsigned long frames = 0;
+	unsigned long checksum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	startCounters();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		unsigned int index = 0;
+		while (index < stream.size()) {
+			unsigned int consumed;
+			Teleinfo* teleinfo = teleinfoDecoder->decode(buffer + index, stream.size() - index, &consumed);
+			index += consumed;
+			if (teleinfo != NULL) {
+				checksum += teleinfo->getTotalIndex();
+				frames++;
+			}
+		}
+	}
+	sink = checksum;
+	report("decode(buffer)", stream, frames, std::chrono::steady_clock::now() - start);
+}
+
+/**
+ * Coroutine asyncFrames sur une source synchrone
+ */
+static void benchAsyncFrames(const std::string& stream) {
+	TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+	unsigned long frames = 0;
+	unsigned long checksum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	startCounters();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		MemorySource source(&stream);
+		TeleinfoAsyncFrames asyncTeleinfo = asyncFrames(teleinfoDecoder, source);
+		while (Teleinfo* teleinfo = asyncTeleinfo.pull()) {
+			checksum += teleinfo->getTotalIndex();
+			frames++;
+		}
+	}
+	sink = checksum;
+	report("asyncFrames()", stream, frames, std::chrono::steady_clock::now() - start);
+}
+
+/**
+ * Remplit des groupes avec ceux du flux, caractère par caractère comme le décodeur
+ * @param bytes reçoit le nombre d'octets des groupes lus (LF ... CR)
+ * @return le nombre de groupes lus
+ */
+static unsigned int readGroupes(const std::string& stream, TeleinfoGroupe* groupes, unsigned int size, unsigned long* bytes) {
+	unsigned int count = 0;
+	*bytes = 0;
+	for (unsigned int i = 0; i < stream.size() && count < size; i++) {
+		if (stream[i] != TELEINFO_CHAR_LF) {
+			continue;
+		}
+		unsigned int position = i + 1;
+		TeleinfoGroupe* teleinfoGroupe = &groupes[count];
+		teleinfoGroupe->reset();
+		for (; position < stream.size() && stream[position] != TELEINFO_CHAR_SPACE; position++) {
+			teleinfoGroupe->appendToEtiquette(stream[position]);
+		}
+		for (position++; position < stream.size() && stream[position] != TELEINFO_CHAR_SPACE; position++) {
+			teleinfoGroupe->appendToDonnee(stream[position]);
+		}
+		if (position + 2 < stream.size() && stream[position + 2] == TELEINFO_CHAR_CR) {
+			teleinfoGroupe->setChecksum(stream[position + 1]);
+			*bytes += position + 3 - i;
+			count++;
+		}
+	}
+	return count;
+}
+
+/**
+ * Vérification du checksum d'un groupe (TeleinfoGroupe::check()) et transfert de sa donnée dans la trame (TeleinfoImpl::store()),
+ * sur les groupes du début du flux
+ */
+static void benchGroupes(const std::string& stream) {
+	TeleinfoGroupe* groupes = new TeleinfoGroupe[BENCH_GROUPES];
+	unsigned long bytes;
+	unsigned int count = readGroupes(stream, groupes, BENCH_GROUPES, &bytes);
+	TeleinfoImpl* teleinfoImpl = new TeleinfoImpl(TELEINFO_TOTAL_OFFSET_NONE);
+	const char* names[] = { "TeleinfoGroupe::check()", "TeleinfoImpl::store()" };
+	for (int variant = 0; variant < 2; variant++) {
+		unsigned long valid = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		startCounters();
+		for (int iteration = 0; iteration < BENCH_ITERATIONS * 100; iteration++) {
+			for (unsigned int i = 0; i < count; i++) {
+				if (variant == 0) {
+					valid += groupes[i].check() ? 1 : 0;
+				} else {
+					teleinfoImpl->store(&groupes[i]);
+				}
+			}
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		stopCounters();
+		sink = variant == 0 ? valid : teleinfoImpl->getFrame()->getValidFields();
+		unsigned long calls = (unsigned long) count * BENCH_ITERATIONS * 100;
+		printf("%-28s %12.0f groupes/s %7.1f ns/groupe (%u groupes, %lu octets)\n", names[variant], calls / seconds, seconds * 1e9 / calls, count, bytes);
+		reportCounters((double) bytes * BENCH_ITERATIONS * 100, "octet");
+	}
+	delete teleinfoImpl;
+	delete[] groupes;
+}
+
+/**
+ * Compression puis décompression du flux brut : taux de compression et débits
+ */
+static void benchCodec(const std::string& stream) {
+	const unsigned char* buffer = (const unsigned char*) stream.data();
+	std::string compressed;
+	unsigned char output[4096];
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	startCounters();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		TeleinfoCompressor compressor;
+		compressed.clear();
+		unsigned int index = 0;
+		unsigned int consumed;
+		unsigned int written;
+		do {
+			written = compressor.compress(buffer + index, stream.size() - index, &consumed, output, sizeof(output), true);
+			compressed.append((const char*) output, written);
+			index += consumed;
+		} while (consumed > 0 || written > 0);
+	}
+	report("compress()", stream, BENCH_FRAMES * BENCH_ITERATIONS, std::chrono::steady_clock::now() - start);
+
+	unsigned long checksum = 0;
+	start = std::chrono::steady_clock::now();
+	startCounters();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		TeleinfoDecompressor decompressor;
+		unsigned int index = 0;
+		unsigned int consumed;
+		int written;
+		do {
+			written = decompressor.decompress((const unsigned char*) compressed.data() + index, compressed.size() - index, &consumed, output, sizeof(output));
+			checksum += written > 0 ? output[written - 1] : 0;
+			index += consumed;
+		} while (consumed > 0 || written > 0);
+	}
+	sink = checksum;
+	report("decompress()", stream, BENCH_FRAMES * BENCH_ITERATIONS, std::chrono::steady_clock::now() - start);
+	printf("%-28s %10lu octets, taux %.1f:1\n", "flux compressé", (unsigned long) compressed.size(), (double) stream.size() / compressed.size());
+}
+
+/**
+ * Agrégation des trames décodées sur fenêtres glissantes, réparties sur BENCH_METERS compteurs
+ */
+static void benchAggregator(const std::string& stream) {
+	TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+	TeleinfoAggregator aggregator(BENCH_METERS);
+	const unsigned char* buffer = (const unsigned char*) stream.data();
+	unsigned long frames = 0;
+	unsigned long checksum = 0;
+	std::chrono::steady_clock::duration duration = std::chrono::steady_clock::duration::zero();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		unsigned int index = 0;
+		while (index < stream.size()) {
+			unsigned int consumed;
+			Teleinfo* teleinfo = teleinfoDecoder->decode(buffer + index, stream.size() - index, &consumed);
+			index += consumed;
+			if (teleinfo != NULL) {
+				// Chaque compteur reçoit une trame toutes les 1,5 s environ
+				uint64_t timestamp = (uint64_t) frames * 1500 / BENCH_METERS;
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				aggregator.update(frames % BENCH_METERS, teleinfo, timestamp);
+				duration += std::chrono::steady_clock::now() - start;
+				frames++;
+			}
+		}
+	}
+	TeleinfoWindow window;
+	for (unsigned int meter = 0; meter < BENCH_METERS; meter++) {
+		aggregator.getWindow(meter, TELEINFO_WINDOW_15MIN, (uint64_t) frames * 1500 / BENCH_METERS, &window);
+		checksum += window.energy;
+	}
+	sink = checksum;
+	double seconds = std::chrono::duration<double>(duration).count();
+	printf("%-28s %12.0f trames/s %8.1f ns/trame (%d compteurs)\n", "TeleinfoAggregator::update()", frames / seconds, seconds * 1e9 / frames, BENCH_METERS);
+}
+
+/**
+ * Registre des compteurs : ajout puis recherche de BENCH_REGISTRY adresses, dans un ordre différent
+ */
+static void benchRegistry() {
+	TeleinfoRegistry registry(BENCH_REGISTRY, 1);
+	unsigned long checksum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < BENCH_REGISTRY; i++) {
+		checksum += registry.add(20000000000ULL + i * 104729);
+	}
+	std::chrono::steady_clock::duration addDuration = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	startCounters();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		for (uint64_t i = 0; i < BENCH_REGISTRY; i++) {
+			checksum += registry.find(20000000000ULL + ((i * 7919) % BENCH_REGISTRY) * 104729);
+		}
+	}
+	std::chrono::steady_clock::duration findDuration = std::chrono::steady_clock::now() - start;
+	stopCounters();
+	sink = checksum;
+
+	double seconds = std::chrono::duration<double>(addDuration).count();
+	printf("%-28s %12.0f ops/s    %8.1f ns/op    (%d compteurs)\n", "TeleinfoRegistry::add()", BENCH_REGISTRY / seconds, seconds * 1e9 / BENCH_REGISTRY, BENCH_REGISTRY);
+	seconds = std::chrono::duration<double>(findDuration).count();
+	unsigned long lookups = (unsigned long) BENCH_REGISTRY * BENCH_ITERATIONS;
+	printf("%-28s %12.0f ops/s    %8.1f ns/op    (%d compteurs)\n", "TeleinfoRegistry::find()", lookups / seconds, seconds * 1e9 / lookups, BENCH_REGISTRY);
+	reportCounters(lookups, "op");
+}
+
+/**
+ * Points de reprise d'une passerelle de BENCH_METERS compteurs : écriture, puis restauration dans une passerelle neuve
+ */
+static void benchCheckpoint(const std::string& stream) {
+	TeleinfoDecoder** decoders[2];
+	TeleinfoAggregator* aggregators[2];
+	TeleinfoTariff* tariffs[2];
+	TeleinfoRegistry* registries[2];
+	TeleinfoCheckpoint* checkpoints[2];
+	unlink(BENCH_CHECKPOINT);
+	for (int gateway = 0; gateway < 2; gateway++) {
+		decoders[gateway] = new TeleinfoDecoder*[BENCH_METERS];
+		for (int meter = 0; meter < BENCH_METERS; meter++) {
+			decoders[gateway][meter] = new TeleinfoDecoder(TELEINFO_TOTAL_OFFSET_AUTO);
+		}
+		aggregators[gateway] = new TeleinfoAggregator(BENCH_METERS);
+		tariffs[gateway] = new TeleinfoTariff(BENCH_METERS);
+		registries[gateway] = new TeleinfoRegistry(BENCH_METERS, BENCH_METERS);
+		checkpoints[gateway] = new TeleinfoCheckpoint(BENCH_CHECKPOINT, 0);
+		checkpoints[gateway]->addDecoders(decoders[gateway], BENCH_METERS);
+		checkpoints[gateway]->addAggregator(aggregators[gateway]);
+		checkpoints[gateway]->addTariff(tariffs[gateway]);
+		checkpoints[gateway]->addRegistry(registries[gateway]);
+	}
+
+	// Une trame par compteur
+	const unsigned char* buffer = (const unsigned char*) stream.data();
+	unsigned int length = stream.size();
+	for (int meter = 0; meter < BENCH_METERS; meter++) {
+		Teleinfo* teleinfo = NULL;
+		while (teleinfo == NULL && length > 0) {
+			unsigned int consumed;
+			teleinfo = decoders[0][meter]->decode(buffer, length, &consumed);
+			buffer += consumed;
+			length -= consumed;
+		}
+		registries[0]->add(20000000000ULL + meter);
+		aggregators[0]->update(meter, teleinfo, meter);
+		tariffs[0]->update(meter, teleinfo, meter, NULL);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		checkpoints[0]->save();
+	}
+	std::chrono::steady_clock::duration saveDuration = std::chrono::steady_clock::now() - start;
+
+	start = std::chrono::steady_clock::now();
+	bool restored = checkpoints[1]->restore();
+	std::chrono::steady_clock::duration restoreDuration = std::chrono::steady_clock::now() - start;
+	sink = restored ? registries[1]->getMeterCount() : 0;
+
+	double seconds = std::chrono::duration<double>(saveDuration).count();
+	printf("%-28s %12.2f ms/point  %8s (%d compteurs)\n", "TeleinfoCheckpoint::save()", seconds * 1e3 / BENCH_ITERATIONS, "", BENCH_METERS);
+	seconds = std::chrono::duration<double>(restoreDuration).count();
+	printf("%-28s %12.2f ms/point  %8s (%d compteurs%s)\n", "TeleinfoCheckpoint::restore()", seconds * 1e3, "", BENCH_METERS, restored ? "" : ", ECHEC");
+
+	for (int gateway = 0; gateway < 2; gateway++) {
+		delete checkpoints[gateway];
+		delete registries[gateway];
+		delete tariffs[gateway];
+		delete aggregators[gateway];
+		for (int meter = 0; meter < BENCH_METERS; meter++) {
+			delete decoders[gateway][meter];
+		}
+		delete[] decoders[gateway];
+	}
+	unlink(BENCH_CHECKPOINT);
+}
+
+/**
+ * Affiche le résultat d'un scénario de sérialisation
+ */
+static void reportSerializer(const char* name, unsigned long frames, unsigned long bytes, std::chrono::steady_clock::duration duration) {
+	double seconds = std::chrono::duration<double>(duration).count();
+	printf("%-28s %10.1f Mo/s %12.0f trames/s %8.1f ns/trame (%lu octets/trame)\n", name, bytes / seconds / 1e6, frames / seconds, seconds * 1e9 / frames, bytes / frames);
+}
+
+/**
+ * Sérialisation en line protocol : snprintf() et concaténation de std::string, champ par champ
+ */
+static unsigned long serializeSnprintf(Teleinfo* teleinfo, uint64_t timestamp, std::string& output) {
+	unsigned int count;
+	const TeleinfoLabel* schema = TeleinfoDecoder::getSchema(&count);
+	unsigned long long present = teleinfo->getValidFields() | teleinfo->getCarriedFields();
+	char value[64];
+	std::string line = "teleinfo,ADCO=";
+	line += teleinfo->getAdco();
+	char separator = ' ';
+	for (unsigned int field = 1; field < count; field++) {
+		if (!(present & schema[field].field)) {
+			continue;
+		}
+		const char* name = schema[field].etiquette;
+		switch (field) {
+			case 1 : snprintf(value, sizeof(value), "%c%s=\"%s\"", separator, name, teleinfo->getOptarif()); break;
+			case 15 : snprintf(value, sizeof(value), "%c%s=\"%s\"", separator, name, teleinfo->getPtec()); break;
+			case 16 : snprintf(value, sizeof(value), "%c%s=\"%s\"", separator, name, teleinfo->getDemain()); break;
+			case 21 : snprintf(value, sizeof(value), "%c%s=\"%c\"", separator, name, teleinfo->getHhphc()); break;
+			case 22 : snprintf(value, sizeof(value), "%c%s=\"%s\"", separator, name, teleinfo->getMotdetat()); break;
+			case 2 : snprintf(value, sizeof(value), "%c%s=%di", separator, name, teleinfo->getIsousc()); break;
+			case 4 : snprintf(value, sizeof(value), "%c%s=%lui", separator, name, teleinfo->getHchc()); break;
+			case 5 : snprintf(value, sizeof(value), "%c%s=%lui", separator, name, teleinfo->getHchp()); break;
+			case 17 : snprintf(value, sizeof(value), "%c%s=%di", separator, name, teleinfo->getIinst()); break;
+			case 19 : snprintf(value, sizeof(value), "%c%s=%di", separator, name, teleinfo->getImax()); break;
+			case 20 : snprintf(value, sizeof(value), "%c%s=%di", separator, name, teleinfo->getPapp()); break;
+			default : value[0] = '\0'; break; // Champs absents du flux synthétique
+		}
+		line += value;
+		separator = ',';
+	}
+	snprintf(value, sizeof(value), " %llu\n", (unsigned long long) timestamp);
+	line += value;
+	output += line;
+	return line.size();
+}
+
+/**
+ * Sérialisation des trames décodées : TeleinfoSerializer dans chaque format, comparé à snprintf()
+ */
+static void benchSerializer(const std::string& stream) {
+	TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+	TeleinfoSnapshot* snapshots = new TeleinfoSnapshot[BENCH_FRAMES];
+	unsigned int count = 0;
+	const unsigned char* buffer = (const unsigned char*) stream.data();
+	unsigned int length = stream.size();
+	while (length > 0 && count < BENCH_FRAMES) {
+		unsigned int consumed;
+		Teleinfo* teleinfo = teleinfoDecoder->decode(buffer, length, &consumed);
+		buffer += consumed;
+		length -= consumed;
+		if (teleinfo != NULL) {
+			snapshots[count++].copy(teleinfo);
+		}
+	}
+
+	static char output[1 << 16];
+	const char* names[] = { "TeleinfoSerializer LINE", "TeleinfoSerializer CSV", "TeleinfoSerializer JSON" };
+	for (int format = TELEINFO_FORMAT_LINE; format <= TELEINFO_FORMAT_JSON; format++) {
+		TeleinfoSerializer serializer(output, sizeof(output), format);
+		unsigned long bytes = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		startCounters();
+		for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+			for (unsigned int i = 0; i < count; i++) {
+				if (!serializer.append(&snapshots[i], 1700000000000ULL + i)) {
+					bytes += serializer.getLength();
+					sink = output[serializer.getLength() - 1];
+					serializer.clear();
+					serializer.append(&snapshots[i], 1700000000000ULL + i);
+				}
+			}
+		}
+		bytes += serializer.getLength();
+		std::chrono::steady_clock::duration duration = std::chrono::steady_clock::now() - start;
+		stopCounters();
+		reportSerializer(names[format], (unsigned long) count * BENCH_ITERATIONS, bytes, duration);
+		reportCounters((double) count * BENCH_ITERATIONS, "trame");
+	}
+
+	std::string lines;
+	unsigned long bytes = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		for (unsigned int i = 0; i < count; i++) {
+			bytes += serializeSnprintf(&snapshots[i], 1700000000000ULL + i, lines);
+			if (lines.size() > sizeof(output)) {
+				sink = lines[lines.size() - 1];
+				lines.clear();
+			}
+		}
+	}
+	reportSerializer("snprintf() LINE", (unsigned long) count * BENCH_ITERATIONS, bytes, std::chrono::steady_clock::now() - start);
+	delete[] snapshots;
+	delete teleinfoDecoder;
+}
+
+/**
+ * Lecture de 15 champs par trame, pour BENCH_METERS trames
+ */
+template<class Frame> static unsigned long readFields(Frame* const* frames) {
+	unsigned long checksum = 0;
+	for (int meter = 0; meter < BENCH_METERS; meter++) {
+		Frame* frame = frames[meter];
+		checksum += frame->getTotalIndex() + frame->getBase() + frame->getHchc() + frame->getHchp() + frame->getIsousc() + frame->getIinst()
+				+ frame->getImax() + frame->getPapp() + frame->getAdps() + frame->getPejp() + frame->getInstPower() + frame->getHhphc()
+				+ frame->getPtec()[0] + frame->getValidFields() + frame->getCarriedFields();
+	}
+	return checksum;
+}
+
+/**
+ * Lecture des champs de BENCH_METERS trames : par l'interface Teleinfo (appels virtuels) et par TeleinfoFrame (accesseurs en ligne)
+ */
+static void benchAccessors(const std::string& stream) {
+	TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+	std::vector<TeleinfoFrame> copies;
+	const unsigned char* buffer = (const unsigned char*) stream.data();
+	unsigned int length = stream.size();
+	while (length > 0 && copies.size() < BENCH_METERS) {
+		unsigned int consumed;
+		TeleinfoFrame* frame = teleinfoDecoder->decode(buffer, length, &consumed);
+		buffer += consumed;
+		length -= consumed;
+		if (frame != NULL) {
+			copies.push_back(*frame);
+		}
+	}
+	std::vector<Teleinfo*> teleinfos;
+	std::vector<TeleinfoFrame*> frames;
+	for (int meter = 0; meter < BENCH_METERS; meter++) {
+		teleinfos.push_back(&copies[meter % copies.size()]);
+		frames.push_back(&copies[meter % copies.size()]);
+	}
+
+	const char* names[] = { "Teleinfo* (virtuel)", "TeleinfoFrame* (en ligne)" };
+	for (int variant = 0; variant < 2; variant++) {
+		unsigned long checksum = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int iteration = 0; iteration < BENCH_ITERATIONS * 100; iteration++) {
+			checksum += variant == 0 ? readFields(teleinfos.data()) : readFields(frames.data());
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		sink = checksum;
+		unsigned long reads = (unsigned long) BENCH_METERS * BENCH_ITERATIONS * 100;
+		printf("%-28s %12.0f trames/s %8.1f ns/trame   (15 champs, %d compteurs)\n", names[variant], reads / seconds, seconds * 1e9 / reads, BENCH_METERS);
+	}
+	delete teleinfoDecoder;
+}
+
+/**
+ * Collecte OpenMetrics d'une passerelle de BENCH_METERS compteurs
+ */
+static void benchMetrics(const std::string& stream) {
+	TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+	TeleinfoConflator* conflator = new TeleinfoConflator(BENCH_METERS, 1);
+	TeleinfoMetrics* metrics = new TeleinfoMetrics(conflator, TELEINFO_METRICS_BASE_SIZE + (BENCH_METERS + 1) * TELEINFO_METRICS_METER_SIZE);
+	metrics->addDecoder(teleinfoDecoder, "bench");
+	const unsigned char* buffer = (const unsigned char*) stream.data();
+	unsigned int length = stream.size();
+	unsigned int count = 0;
+	while (length > 0) {
+		unsigned int consumed;
+		Teleinfo* teleinfo = teleinfoDecoder->decode(buffer, length, &consumed);
+		buffer += consumed;
+		length -= consumed;
+		if (teleinfo != NULL) {
+			conflator->publish(count++ % BENCH_METERS, teleinfo);
+		}
+	}
+
+	metrics->render(); // Construction des étiquettes
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		metrics->render();
+		sink = metrics->getBuffer()[metrics->getLength() - 1];
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%-28s %12.2f ms/collecte %8.1f Mo/s     (%d compteurs, %u octets)\n", "TeleinfoMetrics::render()", seconds * 1e3 / BENCH_ITERATIONS,
+			(double) metrics->getLength() * BENCH_ITERATIONS / seconds / 1e6, BENCH_METERS, metrics->getLength());
+	delete metrics;
+	delete conflator;
+	delete teleinfoDecoder;
+}
+
+/**
+ * Historique d'un mois d'un compteur : ajout des trames, puis courbe à 10 minutes lue au niveau 1 minute
+ * ou au niveau des trames (bornes non alignées), énergie journalière lue au niveau 1 jour
+ */
+static void benchRollup(const std::string& stream) {
+	TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+	std::vector<TeleinfoSnapshot> snapshots(BENCH_FRAMES);
+	const unsigned char* buffer = (const unsigned char*) stream.data();
+	unsigned int length = stream.size();
+	unsigned int count = 0;
+	while (length > 0 && count < BENCH_FRAMES) {
+		unsigned int consumed;
+		Teleinfo* teleinfo = teleinfoDecoder->decode(buffer, length, &consumed);
+		buffer += consumed;
+		length -= consumed;
+		if (teleinfo != NULL) {
+			snapshots[count++].copy(teleinfo);
+		}
+	}
+
+	TeleinfoRollup* rollup = new TeleinfoRollup(1);
+	uint64_t end = BENCH_ROLLUP_DAYS * 86400000ULL;
+	unsigned long frames = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint64_t timestamp = 0; timestamp < end; timestamp += BENCH_ROLLUP_STEP) {
+		rollup->update(0, &snapshots[frames++ % count], timestamp);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%-28s %12.0f trames/s   %8.1f ns/trame (%lu trames, %d jours)\n", "TeleinfoRollup::update()", frames / seconds,
+			seconds * 1e9 / frames, frames, BENCH_ROLLUP_DAYS);
+
+	static TeleinfoRollupRow results[BENCH_ROLLUP_DAYS * 144];
+	const char* names[3] = { "query() 10 min, 1 min", "query() 10 min, trames", "query() 1 jour, 1 jour" };
+	uint64_t froms[3] = { 0, 1, 0 };
+	uint64_t resolutions[3] = { 600000ULL, 600000ULL, 86400000ULL };
+	for (int i = 0; i < 3; i++) {
+		start = std::chrono::steady_clock::now();
+		for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+			sink = rollup->query(0, froms[i], end, resolutions[i], results, BENCH_ROLLUP_DAYS * 144);
+		}
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("%-28s %12.3f ms/requête  %10lu lignes lues\n", names[i], seconds * 1e3 / BENCH_ITERATIONS, rollup->getLastScanned());
+	}
+	delete rollup;
+	delete teleinfoDecoder;
+}
+
+/**
+ * Surveillance d'un parc de BENCH_FLEET compteurs : dépassements, avertissements et BENCH_FLEET_TOP plus fortes puissances,
+ * par un parcours des trames (appels virtuels) puis par la table des dernières valeurs
+ */
+static void benchFleet(const std::string& stream) {
+	TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+	std::vector<TeleinfoFrame> copies;
+	const unsigned char* buffer = (const unsigned char*) stream.data();
+	unsigned int length = stream.size();
+	while (length > 0) {
+		unsigned int consumed;
+		TeleinfoFrame* frame = teleinfoDecoder->decode(buffer, length, &consumed);
+		buffer += consumed;
+		length -= consumed;
+		if (frame != NULL) {
+			copies.push_back(*frame);
+		}
+	}
+	std::vector<TeleinfoFrame> frames;
+	for (unsigned int meter = 0; meter < BENCH_FLEET; meter++) {
+		frames.push_back(copies[meter % copies.size()]);
+	}
+	std::vector<Teleinfo*> teleinfos;
+	for (unsigned int meter = 0; meter < BENCH_FLEET; meter++) {
+		teleinfos.push_back(&frames[meter]);
+	}
+
+	TeleinfoFleet* fleet = new TeleinfoFleet(BENCH_FLEET);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		for (unsigned int meter = 0; meter < BENCH_FLEET; meter++) {
+			fleet->update(meter, teleinfos[meter], iteration);
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	unsigned long updates = (unsigned long) BENCH_FLEET * BENCH_ITERATIONS;
+	printf("%-28s %12.0f trames/s %8.1f ns/trame (%d compteurs)\n", "TeleinfoFleet::update()", updates / seconds, seconds * 1e9 / updates, BENCH_FLEET);
+
+	// Parcours des trames : les trois réponses en un seul passage, plus fortes puissances par insertion
+	static uint32_t meters[BENCH_FLEET];
+	int32_t powers[BENCH_FLEET_TOP];
+	unsigned long checksum = 0;
+	start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		unsigned int overloads = 0;
+		unsigned int adps = 0;
+		unsigned int top = 0;
+		for (unsigned int meter = 0; meter < BENCH_FLEET; meter++) {
+			Teleinfo* teleinfo = teleinfos[meter];
+			if (teleinfo->getIsousc() > 0 && teleinfo->getIinst() > teleinfo->getIsousc()) {
+				overloads++;
+			}
+			if (teleinfo->getAdps() > 0) {
+				adps++;
+			}
+			int32_t power = teleinfo->getInstPower();
+			if (top < BENCH_FLEET_TOP || power > powers[top - 1]) {
+				unsigned int index = top < BENCH_FLEET_TOP ? top++ : top - 1;
+				while (index > 0 && powers[index - 1] < power) {
+					powers[index] = powers[index - 1];
+					meters[index] = meters[index - 1];
+					index--;
+				}
+				powers[index] = power;
+				meters[index] = meter;
+			}
+		}
+		checksum += overloads + adps + meters[0];
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%-28s %12.3f ms/parcours (3 requêtes, %d compteurs)\n", "parcours Teleinfo*", seconds * 1e3 / BENCH_ITERATIONS, BENCH_FLEET);
+
+	// Table des dernières valeurs : une requête par parcours
+	const char* names[3] = { "findOverloads()", "findAdps()", "findTopPower()" };
+	for (int query = 0; query < 3; query++) {
+		unsigned int found = 0;
+		start = std::chrono::steady_clock::now();
+		startCounters();
+		for (int iteration = 0; iteration < BENCH_ITERATIONS * 10; iteration++) {
+			if (query == 0) {
+				found = fleet->findOverloads(meters, BENCH_FLEET);
+			} else if (query == 1) {
+				found = fleet->findAdps(meters, BENCH_FLEET);
+			} else {
+				found = fleet->findTopPower(BENCH_FLEET_TOP, meters, powers);
+			}
+			checksum += found + meters[0];
+		}
+		stopCounters();
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("%-28s %12.3f ms/requête  %10u compteurs retenus\n", names[query], seconds * 1e3 / (BENCH_ITERATIONS * 10), found);
+		reportCounters((double) BENCH_FLEET * BENCH_ITERATIONS * 10, "compteur");
+	}
+	sink = checksum;
+	delete fleet;
+	delete teleinfoDecoder;
+}
+
+int main(int argc, char** argv) {
+	int option;
+	while ((option = getopt(argc, argv, "p")) != -1) {
+		if (option == 'p') {
+			counters = new TeleinfoPerfCounters();
+		} else {
+			fprintf(stderr, "Usage : %s [-p]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (counters != NULL && !counters->isAvailable()) {
+		printf("Compteurs matériels indisponibles (perf_event_paranoid, machine virtuelle...) : durées seules\n");
+		delete counters;
+		counters = NULL;
+	}
+
+	std::string stream;
+	TeleinfoStreamGenerator generator;
+	for (int i = 0; i < BENCH_FRAMES; i++) {
+		generator.appendFrame(stream);
+	}
+	printf("Flux : %d trames, %lu octets, %d itérations\n", BENCH_FRAMES, (unsigned long) stream.size(), BENCH_ITERATIONS);
+
+	benchDecodeByte(stream);
+	benchDecodeBuffer(stream);
+	benchAccessors(stream);
+	benchAsyncFrames(stream);
+	benchGroupes(stream);
+	benchCodec(stream);
+	benchAggregator(stream);
+	benchRegistry();
+	benchCheckpoint(stream);
+	benchSerializer(stream);
+	benchMetrics(stream);
+	benchRollup(stream);
+	benchFleet(stream);
+	delete counters;
+	return 0;
+}
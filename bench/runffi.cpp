@@ -0,0 +1,120 @@
+/**
+ * Benchmark de l'interface C chargée dynamiquement, comme par une interface de fonctions (ctypes, cgo...)
+ *
+ * Usage : runffi <bibliothèque>   (lib/libteleinfodecoder.so)
+ *
+ * La bibliothèque partagée est ouverte par dlopen(...) et ses fonctions appelées par pointeur : aucun appel n'est
+ * intégré par le compilateur. Le flux est décodé octet par octet (teleinfoDecodeByte(...)), puis par tampons de tailles
+ * croissantes (teleinfoDecode(...)). Les durées ne comprennent que le coût de l'appel en C : depuis Python ou Go, chaque
+ * passage de langage coûte en plus de 100 ns à quelques µs, payé une fois par octet ou une fois par tampon.
+ * @author LK
+ */
+
+#include "TeleinfoC.h"
+#include "TeleinfoStreamGenerator.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string>
+#include <chrono>
+
+#define BENCH_FRAMES       20000
+#define BENCH_ITERATIONS   10
+
+typedef TeleinfoHandle* (*CreateFunction)(unsigned int);
+typedef void (*DestroyFunction)(TeleinfoHandle*);
+typedef int (*DecodeFunction)(TeleinfoHandle*, const unsigned char*, unsigned int, TeleinfoFlatFrame*, unsigned int, unsigned int*);
+typedef int (*DecodeByteFunction)(TeleinfoHandle*, int, TeleinfoFlatFrame*);
+typedef unsigned int (*FrameSizeFunction)(void);
+
+static volatile unsigned long sink;
+
+/**
+ * Affiche le résultat d'un scénario
+ */
+static void report(const char* name, const std::string& stream, unsigned long frames, unsigned long calls, std::chrono::steady_clock::duration duration) {
+	double seconds = std::chrono::duration<double>(duration).count();
+	double bytes = (double) stream.size() * BENCH_ITERATIONS;
+	printf("%-28s %10.1f Mo/s %12.0f trames/s %8.2f ns/octet %12lu appels (%lu trames)\n", name, bytes / seconds / 1e6, frames / seconds,
+			seconds * 1e9 / bytes, calls, frames);
+}
+
+int main(int argc, char** argv) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage : %s <bibliothèque>\n", argv[0]);
+		return 1;
+	}
+	void* library = dlopen(argv[1], RTLD_NOW | RTLD_LOCAL);
+	if (library == NULL) {
+		fprintf(stderr, "Impossible de charger %s : %s\n", argv[1], dlerror());
+		return 1;
+	}
+	CreateFunction create = (CreateFunction) dlsym(library, "teleinfoCreate");
+	DestroyFunction destroy = (DestroyFunction) dlsym(library, "teleinfoDestroy");
+	DecodeFunction decode = (DecodeFunction) dlsym(library, "teleinfoDecode");
+	DecodeByteFunction decodeByte = (DecodeByteFunction) dlsym(library, "teleinfoDecodeByte");
+	FrameSizeFunction frameSize = (FrameSizeFunction) dlsym(library, "teleinfoFrameSize");
+	if (create == NULL || destroy == NULL || decode == NULL || decodeByte == NULL || frameSize == NULL) {
+		fprintf(stderr, "Interface C incomplète : %s\n", dlerror());
+		return 1;
+	}
+	if (frameSize() != sizeof(TeleinfoFlatFrame)) {
+		fprintf(stderr, "Taille de trame différente : %u octets dans la bibliothèque, %lu ici\n", frameSize(), (unsigned long) sizeof(TeleinfoFlatFrame));
+		return 1;
+	}
+
+	std::string stream;
+	TeleinfoStreamGenerator generator;
+	for (int i = 0; i < BENCH_FRAMES; i++) {
+		generator.appendFrame(stream);
+	}
+	printf("Flux : %d trames, %lu octets, %d itérations\n", BENCH_FRAMES, (unsigned long) stream.size(), BENCH_ITERATIONS);
+	const unsigned char* buffer = (const unsigned char*) stream.data();
+
+	// Un appel par octet
+	TeleinfoHandle* handle = create(0);
+	TeleinfoFlatFrame frames[64];
+	unsigned long count = 0;
+	unsigned long checksum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+		for (unsigned int i = 0; i < stream.size(); i++) {
+			if (decodeByte(handle, buffer[i], &frames[0]) == 1) {
+				checksum += frames[0].totalIndex;
+				count++;
+			}
+		}
+	}
+	report("teleinfoDecodeByte()", stream, count, (unsigned long) stream.size() * BENCH_ITERATIONS, std::chrono::steady_clock::now() - start);
+	destroy(handle);
+
+	// Un appel par tampon, comme une lecture de port série ou de socket
+	unsigned int sizes[] = { 64, 512, 4096, 65536 };
+	for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		handle = create(0);
+		count = 0;
+		unsigned long calls = 0;
+		start = std::chrono::steady_clock::now();
+		for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+			unsigned int index = 0;
+			while (index < stream.size()) {
+				unsigned int length = stream.size() - index < sizes[s] ? stream.size() - index : sizes[s];
+				unsigned int consumed;
+				int decoded = decode(handle, buffer + index, length, frames, sizeof(frames) / sizeof(frames[0]), &consumed);
+				for (int frame = 0; frame < decoded; frame++) {
+					checksum += frames[frame].totalIndex;
+				}
+				count += decoded;
+				index += consumed;
+				calls++;
+			}
+		}
+		char name[64];
+		snprintf(name, sizeof(name), "teleinfoDecode() %u octets", sizes[s]);
+		report(name, stream, count, calls, std::chrono::steady_clock::now() - start);
+		destroy(handle);
+	}
+	sink = checksum;
+	dlclose(library);
+	return 0;
+}
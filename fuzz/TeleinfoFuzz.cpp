@@ -0,0 +1,300 @@
+/**
+ * Fuzzing différentiel du décodeur Téléinfo (point d'entrée compatible libFuzzer)
+ *
+ * Un même flux d'octets quelconque est décodé par la machine d'état de référence (decode(int), octet par octet)
+ * puis par chacun des chemins optimisés. Chaque chemin doit donner exactement les mêmes trames : même fin de trame
+ * (position du ETX dans le flux), mêmes champs reçus et reportés, mêmes valeurs, même index total, mêmes compteurs
+ * d'activité (trames perdues, groupes écartés, réparations...) et même dernière trame valide. Au premier écart,
+ * le programme s'arrête par abort() après avoir décrit l'écart.
+ *
+ * Chemins comparés à la référence :
+ *   - bloc     : decode(buffer, length, consumed) sur tout le flux
+ *   - morceaux : decode(buffer, length, consumed) sur des morceaux de 1 à TELEINFO_FUZZ_CHUNK_MAX octets
+ *   - reprise  : après chaque trame, l'état est sauvegardé (saveState) et le décodage se poursuit dans un nouveau décodeur (restoreState)
+ * Le flux est aussi compressé puis décompressé (TeleinfoCompressor, TeleinfoDecompressor) : il doit être restitué à l'identique.
+ *
+ * Format d'une entrée : un octet d'options (bits 0 à 2 : TELEINFO_OPTION_*, bit 3 : TELEINFO_TOTAL_OFFSET_AUTO),
+ * un octet d'initialisation du découpage en morceaux, puis le flux.
+ *
+ * @author LK
+ */
+#include "TeleinfoDecoder.h"
+#include "TeleinfoCodec.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************************************************************************************************************************************************************
+  CONSTANTES
+ *********************************************************************************************************************************************************************/
+
+/* Chemins de décodage */
+#define TELEINFO_FUZZ_REFERENCE      0
+#define TELEINFO_FUZZ_BLOCK          1
+#define TELEINFO_FUZZ_CHUNKS         2
+#define TELEINFO_FUZZ_RESUME         3
+#define TELEINFO_FUZZ_ENGINES        4
+
+/* Taille maximale d'un morceau du chemin "morceaux" */
+#define TELEINFO_FUZZ_CHUNK_MAX      32
+
+/* Bit de l'octet d'options demandant le calcul automatique de l'offset de l'index total */
+#define TELEINFO_FUZZ_OFFSET_AUTO    0x08
+
+static const char* const TELEINFO_FUZZ_NAMES[TELEINFO_FUZZ_ENGINES] = { "reference", "bloc", "morceaux", "reprise" };
+
+/**
+ * Trame décodée par un chemin
+ */
+struct TeleinfoFuzzFrame {
+	unsigned long position;   // Position, dans le flux, de l'octet qui termine la trame
+	unsigned long long validFields;
+	unsigned long long carriedFields;
+	unsigned long totalIndex;
+	unsigned long totalOffset;
+	TeleinfoRecord record;
+};
+
+/**
+ * Résultat du décodage d'un flux par un chemin
+ */
+struct TeleinfoFuzzRun {
+	TeleinfoFuzzFrame* frames;
+	unsigned long framesCount;
+	TeleinfoStats stats;
+	bool hasLastFrame;
+	TeleinfoFuzzFrame lastFrame;
+};
+
+/*********************************************************************************************************************************************************************
+  DECODAGE
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Copie d'une trame
+ */
+static void copyFrame(TeleinfoFrame* frame, unsigned long position, TeleinfoFuzzFrame* copy) {
+	memset(copy, 0, sizeof(TeleinfoFuzzFrame));
+	copy->position = position;
+	copy->validFields = frame->getValidFields();
+	copy->carriedFields = frame->getCarriedFields();
+	copy->totalIndex = frame->getTotalIndex();
+	copy->totalOffset = frame->getTotalOffset();
+	copy->record = *frame->getRecord();
+}
+
+/**
+ * Générateur pseudo-aléatoire (xorshift) du découpage en morceaux
+ */
+static unsigned int nextChunk(uint32_t* seed) {
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return 1 + *seed % TELEINFO_FUZZ_CHUNK_MAX;
+}
+
+/**
+ * Décode le flux par un chemin
+ */
+static void run(int engine, const unsigned char* stream, unsigned long length, unsigned int options, unsigned long totalOffset, uint32_t seed, TeleinfoFuzzRun* result) {
+	// La dernière trame valide est comparée en fin de flux, éventuellement au milieu d'une trame : copiée à chaque ETX
+	options |= TELEINFO_OPTION_KEEP_LAST_FRAME;
+	TeleinfoDecoder* decoder = new TeleinfoDecoder(totalOffset);
+	decoder->setOptions(options);
+	result->framesCount = 0;
+	unsigned long index = 0;
+	while (index < length) {
+		TeleinfoFrame* frame;
+		if (engine == TELEINFO_FUZZ_BLOCK || engine == TELEINFO_FUZZ_CHUNKS) {
+			unsigned long size = length - index;
+			if (engine == TELEINFO_FUZZ_CHUNKS) {
+				unsigned int chunk = nextChunk(&seed);
+				size = chunk < size ? chunk : size;
+			}
+			unsigned int consumed = 0;
+			frame = decoder->decode(stream + index, size, &consumed);
+			index += consumed;
+		} else {
+			frame = decoder->decode(stream[index++]);
+		}
+		if (frame != NULL) {
+			copyFrame(frame, index - 1, &result->frames[result->framesCount++]);
+			if (engine == TELEINFO_FUZZ_RESUME) {
+				// Reprise dans un nouveau décodeur, comme après un redémarrage
+				unsigned long size = decoder->getStateSize();
+				void* state = malloc(size);
+				decoder->saveState(state);
+				delete decoder;
+				decoder = new TeleinfoDecoder(totalOffset);
+				decoder->setOptions(options);
+				if (!decoder->restoreState(state, size)) {
+					fprintf(stderr, "Ecart : la reprise refuse l'état sauvegardé après la trame %lu\n", result->framesCount);
+					abort();
+				}
+				free(state);
+			}
+		}
+	}
+	decoder->getStats(&result->stats);
+	TeleinfoFrame* lastFrame = decoder->getLastFrame();
+	result->hasLastFrame = lastFrame != NULL;
+	if (lastFrame != NULL) {
+		copyFrame(lastFrame, 0, &result->lastFrame);
+	}
+	delete decoder;
+}
+
+/**
+ * Compare deux trames
+ * @return la description du premier écart, NULL si les trames sont identiques
+ */
+static const char* compareFrames(TeleinfoFuzzFrame* expected, TeleinfoFuzzFrame* actual) {
+	if (expected->position != actual->position) {
+		return "fin de trame";
+	} else if (expected->validFields != actual->validFields) {
+		return "champs reçus";
+	} else if (expected->carriedFields != actual->carriedFields) {
+		return "champs reportés";
+	} else if (expected->totalIndex != actual->totalIndex) {
+		return "index total";
+	} else if (expected->totalOffset != actual->totalOffset) {
+		return "offset de l'index total";
+	} else if (memcmp(&expected->record, &actual->record, sizeof(TeleinfoRecord)) != 0) {
+		return "valeurs des champs";
+	}
+	return NULL;
+}
+
+/**
+ * Compare le résultat d'un chemin à celui de la référence, abort() au premier écart
+ */
+static void check(int engine, TeleinfoFuzzRun* expected, TeleinfoFuzzRun* actual) {
+	const char* difference = NULL;
+	unsigned long frame = 0;
+	for (; frame < expected->framesCount && frame < actual->framesCount && difference == NULL; frame++) {
+		difference = compareFrames(&expected->frames[frame], &actual->frames[frame]);
+	}
+	if (difference != NULL) {
+		fprintf(stderr, "Ecart du chemin %s, trame %lu (octet %lu) : %s\n", TELEINFO_FUZZ_NAMES[engine], frame - 1,
+				expected->frames[frame - 1].position, difference);
+		abort();
+	}
+	if (expected->framesCount != actual->framesCount) {
+		fprintf(stderr, "Ecart du chemin %s : %lu trames au lieu de %lu\n", TELEINFO_FUZZ_NAMES[engine], actual->framesCount, expected->framesCount);
+		abort();
+	}
+	if (memcmp(&expected->stats, &actual->stats, sizeof(TeleinfoStats)) != 0) {
+		fprintf(stderr, "Ecart du chemin %s : compteurs d'activité (perdues %lu/%lu, écartés %lu/%lu, réparations %lu/%lu)\n",
+				TELEINFO_FUZZ_NAMES[engine], actual->stats.lostFrames, expected->stats.lostFrames, actual->stats.droppedGroupes,
+				expected->stats.droppedGroupes, actual->stats.repairs, expected->stats.repairs);
+		abort();
+	}
+	if (expected->hasLastFrame != actual->hasLastFrame
+			|| (expected->hasLastFrame && compareFrames(&expected->lastFrame, &actual->lastFrame) != NULL)) {
+		fprintf(stderr, "Ecart du chemin %s : dernière trame valide\n", TELEINFO_FUZZ_NAMES[engine]);
+		abort();
+	}
+}
+
+/*********************************************************************************************************************************************************************
+  CODEC
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Compresse puis décompresse le flux, par morceaux, abort() si le flux n'est pas restitué à l'identique
+ */
+static void checkCodec(const unsigned char* stream, unsigned long length, uint32_t seed) {
+	// Au pire, chaque octet brut coûte un octet de code et la décompression rend le flux d'origine
+	unsigned long capacity = 2 * length + 1024;
+	unsigned char* compressed = (unsigned char*) malloc(capacity);
+	unsigned char* restored = (unsigned char*) malloc(length + TELEINFO_CODEC_OPERATION_MAX);
+	unsigned char output[TELEINFO_CODEC_OPERATION_MAX];
+	unsigned long compressedLength = 0;
+	unsigned long restoredLength = 0;
+
+	TeleinfoCompressor* compressor = new TeleinfoCompressor();
+	unsigned long index = 0;
+	unsigned long available = 0; // Octets du flux fournis au compresseur
+	while (true) {
+		bool end = available == length;
+		if (!end) {
+			available += nextChunk(&seed);
+			available = available < length ? available : length;
+			end = available == length;
+		}
+		unsigned int consumed = 0;
+		unsigned int written = compressor->compress(stream + index, available - index, &consumed, output, sizeof(output), end);
+		if (compressedLength + written > capacity) {
+			fprintf(stderr, "Ecart du codec : compression de plus de %lu octets\n", capacity);
+			abort();
+		}
+		memcpy(compressed + compressedLength, output, written);
+		compressedLength += written;
+		index += consumed;
+		if (end && consumed == 0 && written == 0) {
+			break;
+		}
+	}
+	delete compressor;
+	if (index != length) {
+		fprintf(stderr, "Ecart du codec : %lu octets compressés sur %lu\n", index, length);
+		abort();
+	}
+
+	TeleinfoDecompressor* decompressor = new TeleinfoDecompressor();
+	index = 0;
+	while (true) {
+		unsigned int consumed = 0;
+		int written = decompressor->decompress(compressed + index, compressedLength - index, &consumed, output, sizeof(output));
+		if (written < 0 || restoredLength + written > length) {
+			fprintf(stderr, "Ecart du codec : décompression invalide à l'octet %lu\n", index);
+			abort();
+		}
+		memcpy(restored + restoredLength, output, written);
+		restoredLength += written;
+		index += consumed;
+		if (consumed == 0 && written == 0) {
+			break;
+		}
+	}
+	delete decompressor;
+	if (restoredLength != length || memcmp(stream, restored, length) != 0) {
+		fprintf(stderr, "Ecart du codec : flux restitué différent (%lu octets sur %lu)\n", restoredLength, length);
+		abort();
+	}
+	free(restored);
+	free(compressed);
+}
+
+/*********************************************************************************************************************************************************************
+  POINT D'ENTREE
+ *********************************************************************************************************************************************************************/
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	if (size < 2) {
+		return 0;
+	}
+	unsigned int options = data[0] & (TELEINFO_OPTION_SALVAGE | TELEINFO_OPTION_CARRY_FORWARD | TELEINFO_OPTION_REPAIR);
+	unsigned long totalOffset = data[0] & TELEINFO_FUZZ_OFFSET_AUTO ? TELEINFO_TOTAL_OFFSET_AUTO : TELEINFO_TOTAL_OFFSET_NONE;
+	uint32_t seed = 0x9E3779B9u ^ data[1];
+	const unsigned char* stream = data + 2;
+	unsigned long length = size - 2;
+
+	// Une trame compte au moins deux octets (STX ETX)
+	TeleinfoFuzzRun runs[TELEINFO_FUZZ_ENGINES];
+	for (int engine = 0; engine < TELEINFO_FUZZ_ENGINES; engine++) {
+		runs[engine].frames = (TeleinfoFuzzFrame*) malloc((length / 2 + 1) * sizeof(TeleinfoFuzzFrame));
+		run(engine, stream, length, options, totalOffset, seed, &runs[engine]);
+		if (engine != TELEINFO_FUZZ_REFERENCE) {
+			check(engine, &runs[TELEINFO_FUZZ_REFERENCE], &runs[engine]);
+		}
+	}
+	for (int engine = 0; engine < TELEINFO_FUZZ_ENGINES; engine++) {
+		free(runs[engine].frames);
+	}
+
+	checkCodec(stream, length, seed);
+	return 0;
+}
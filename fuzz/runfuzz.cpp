@@ -0,0 +1,234 @@
+/**
+ * Rejeu d'un corpus du fuzzing différentiel, sans libFuzzer
+ *
+ * Usage : runfuzz [--seed <répertoire>] [--mutate <n>] <fichiers ou répertoires du corpus>...
+ *   --seed <répertoire> : écrit le corpus initial (trames des tests unitaires et flux du générateur synthétique) puis le rejoue
+ *   --mutate <n>        : rejoue aussi n variantes de chaque entrée (octets remplacés, insérés ou supprimés, flux tronqué)
+ *
+ * Chaque entrée est passée à LLVMFuzzerTestOneInput(...) : un écart entre les chemins de décodage arrête le programme.
+ * Un crash trouvé par libFuzzer se rejoue de la même manière : runfuzz crash-<hash>
+ *
+ * @author LK
+ */
+#include "TeleinfoDecoder.h"
+#include "TeleinfoStreamGenerator.h"
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <string>
+
+using namespace std;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+/* Octet d'options des entrées (voir TeleinfoFuzz.cpp) */
+#define OFFSET_AUTO   0x08
+
+static unsigned long inputs = 0;
+static unsigned long mutations = 0;
+static uint32_t seed = 0x2545F491u;
+
+/*********************************************************************************************************************************************************************
+  CORPUS INITIAL
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Construit un groupe étiquette/donnée avec son checksum
+ */
+static string buildGroupe(const char* etiquette, const char* donnee) {
+	string groupe;
+	TeleinfoStreamGenerator::appendGroupe(groupe, etiquette, donnee);
+	return groupe;
+}
+
+/**
+ * Ajoute le bit de parité paire à chaque caractère
+ */
+static string withParity(string text) {
+	for (unsigned int i = 0; i < text.length(); i++) {
+		if (__builtin_parity((unsigned char) text[i])) {
+			text[i] ^= 0x80;
+		}
+	}
+	return text;
+}
+
+/**
+ * Ecrit une entrée du corpus : octet d'options, octet de découpage, flux
+ */
+static bool writeSeed(const char* directory, const char* name, unsigned char options, const string& stream) {
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/%s", directory, name);
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Impossible d'écrire %s\n", path);
+		return false;
+	}
+	unsigned char header[2] = { options, (unsigned char) stream.length() };
+	bool written = fwrite(header, 1, 2, file) == 2 && fwrite(stream.data(), 1, stream.length(), file) == stream.length();
+	fclose(file);
+	return written;
+}
+
+/**
+ * Ecrit le corpus initial : trames des tests unitaires (TeleinfoDecoderTest) et flux du générateur des benchmarks
+ */
+static bool writeSeeds(const char* directory) {
+	mkdir(directory, 0755);
+	string heuresCreuses = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "HC..") + buildGroupe("HCHC", "000056990")
+			+ buildGroupe("HCHP", "000012010") + buildGroupe("IINST", "004") + "\x03";
+	string base = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "BASE") + buildGroupe("BASE", "000056990") + "\x03";
+	string triphase = "\x02" + buildGroupe("ADCO", "031428097115") + buildGroupe("OPTARIF", "BASE") + buildGroupe("ISOUSC", "20")
+			+ buildGroupe("BASE", "006157184") + buildGroupe("PTEC", "TH..") + buildGroupe("IINST1", "001") + buildGroupe("IINST2", "012")
+			+ buildGroupe("IINST3", "003") + buildGroupe("IMAX1", "029") + buildGroupe("IMAX2", "030") + buildGroupe("IMAX3", "027")
+			+ buildGroupe("PMAX", "09680") + buildGroupe("PAPP", "03560") + buildGroupe("HHPHC", "A") + buildGroupe("MOTDETAT", "000000")
+			+ buildGroupe("PPOT", "00") + "\x03";
+	string inconnu = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("INCONNU", "12345") + buildGroupe("PTEC", "HC..XXXXXXXX")
+			+ buildGroupe("IINST", "005") + "\x03";
+	string resynchro = "\x0A" "BASE 0" "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000056990") + "\x03"
+			+ "\x02" + buildGroupe("ADCO", "200638824480") + buildGroupe("BASE", "000059000") + "\x03" + "\x02";
+	string corrompue = "\x02" + buildGroupe("ADCO", "026489026467") + "\x0A" "BASE 000056990 X\x0D" + buildGroupe("IINST", "005")
+			+ "\x0A" "PAPP 01" + buildGroupe("HHPHC", "A") + "\x03";
+	string interrompue = "\x02" + buildGroupe("ADCO", "026489026467") + "\x0A" "BASE 0000\x04" + base;
+	string report = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000056990") + buildGroupe("PAPP", "01110")
+			+ buildGroupe("ADPS", "031") + "\x03" + "\x02" + buildGroupe("ADCO", "026489026467") + "\x0A" "BASE 000057000 X\x0D"
+			+ buildGroupe("PAPP", "00990") + "\x03" + "\x02" + buildGroupe("ADCO", "026489026467") + "\x03";
+	string reparation = withParity("\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000056991") + buildGroupe("PAPP", "01110") + "\x03");
+	reparation[20] ^= 0x80; // Un caractère de ADCO reçu avec une erreur de parité
+	string reparationRefusee = withParity("\x02" + buildGroupe("OPTARIF", "BBR(") + "\x03");
+	reparationRefusee[12] ^= 0x81;
+
+	string synthetique;
+	TeleinfoStreamGenerator generator;
+	for (int frame = 0; frame < 20; frame++) {
+		generator.appendFrame(synthetique);
+	}
+	// Flux synthétique partiellement corrompu : un octet remplacé toutes les 97 positions
+	string bruite = synthetique;
+	for (unsigned int i = 50; i < bruite.length(); i += 97) {
+		bruite[i] = (char) (i & 0x7F);
+	}
+
+	return writeSeed(directory, "heures-creuses", 0, heuresCreuses)
+			&& writeSeed(directory, "base-offset-auto", OFFSET_AUTO, base + base)
+			&& writeSeed(directory, "triphase", 0, triphase)
+			&& writeSeed(directory, "etiquette-inconnue", 0, inconnu)
+			&& writeSeed(directory, "resynchronisation", 0, resynchro)
+			&& writeSeed(directory, "recuperation", TELEINFO_OPTION_SALVAGE, corrompue)
+			&& writeSeed(directory, "interruption", TELEINFO_OPTION_SALVAGE, interrompue)
+			&& writeSeed(directory, "report", TELEINFO_OPTION_CARRY_FORWARD | TELEINFO_OPTION_SALVAGE, report)
+			&& writeSeed(directory, "reparation", TELEINFO_OPTION_REPAIR | OFFSET_AUTO, reparation)
+			&& writeSeed(directory, "reparation-refusee", TELEINFO_OPTION_REPAIR, reparationRefusee)
+			&& writeSeed(directory, "synthetique", OFFSET_AUTO, synthetique)
+			&& writeSeed(directory, "synthetique-bruite", TELEINFO_OPTION_SALVAGE | TELEINFO_OPTION_CARRY_FORWARD, bruite)
+			&& writeSeed(directory, "synthetique-parite", TELEINFO_OPTION_REPAIR | TELEINFO_OPTION_SALVAGE, withParity(bruite));
+}
+
+/*********************************************************************************************************************************************************************
+  REJEU
+ *********************************************************************************************************************************************************************/
+
+static uint32_t random32() {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/**
+ * Rejoue une entrée et ses variantes
+ */
+static void replay(const string& input, unsigned long variants) {
+	LLVMFuzzerTestOneInput((const uint8_t*) input.data(), input.length());
+	inputs++;
+	static const char specials[] = { 0x02, 0x03, 0x04, 0x0A, 0x0D, 0x20 };
+	for (unsigned long variant = 0; variant < variants && input.length() > 2; variant++) {
+		string mutated = input;
+		unsigned int changes = 1 + random32() % 4;
+		for (unsigned int change = 0; change < changes && mutated.length() > 2; change++) {
+			unsigned int position = 2 + random32() % (mutated.length() - 2);
+			switch (random32() % 5) {
+				case 0 : mutated[position] = (char) random32(); break;
+				case 1 : mutated[position] = specials[random32() % sizeof(specials)]; break;
+				case 2 : mutated.insert(position, 1, specials[random32() % sizeof(specials)]); break;
+				case 3 : mutated.erase(position, 1); break;
+				default : mutated[position] ^= 0x80; break; // Erreur de parité
+			}
+		}
+		if (random32() % 8 == 0) {
+			mutated[0] = (char) random32();
+		}
+		LLVMFuzzerTestOneInput((const uint8_t*) mutated.data(), mutated.length());
+		mutations++;
+	}
+}
+
+/**
+ * Rejoue un fichier, ou les fichiers d'un répertoire
+ */
+static bool replayPath(const char* path, unsigned long variants) {
+	struct stat status;
+	if (stat(path, &status) != 0) {
+		fprintf(stderr, "Introuvable : %s\n", path);
+		return false;
+	}
+	if (S_ISDIR(status.st_mode)) {
+		DIR* directory = opendir(path);
+		if (directory == NULL) {
+			return false;
+		}
+		bool replayed = true;
+		struct dirent* entry;
+		while ((entry = readdir(directory)) != NULL && replayed) {
+			if (entry->d_name[0] != '.') {
+				string child = string(path) + "/" + entry->d_name;
+				replayed = replayPath(child.c_str(), variants);
+			}
+		}
+		closedir(directory);
+		return replayed;
+	}
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Illisible : %s\n", path);
+		return false;
+	}
+	string input;
+	char buffer[4096];
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		input.append(buffer, count);
+	}
+	fclose(file);
+	replay(input, variants);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	unsigned long variants = 0;
+	int paths = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			if (!writeSeeds(argv[++i]) || !replayPath(argv[i], variants)) {
+				return 1;
+			}
+			paths++;
+		} else if (strcmp(argv[i], "--mutate") == 0 && i + 1 < argc) {
+			variants = strtoul(argv[++i], NULL, 10);
+		} else if (!replayPath(argv[i], variants)) {
+			return 1;
+		} else {
+			paths++;
+		}
+	}
+	if (paths == 0) {
+		fprintf(stderr, "Usage : %s [--seed <répertoire>] [--mutate <n>] <fichiers ou répertoires du corpus>...\n", argv[0]);
+		return 1;
+	}
+	printf("%lu entrées, %lu variantes : aucun écart\n", inputs, mutations);
+	return 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * Implémentation de l'agrégation des trames Téléinfo sur fenêtres glissantes
+ *
+ * @author LK
+ */
+#include "TeleinfoAggregator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Durée des fenêtres (ms)
+ */
+static const uint64_t WINDOW_DURATIONS[TELEINFO_WINDOWS] = { 60000, 900000, 3600000 };
+
+TeleinfoAggregator::TeleinfoAggregator(unsigned int meters) {
+	this->meters = (Meter*) calloc(meters, sizeof(Meter));
+	this->metersCount = this->meters != NULL ? meters : 0;
+}
+
+TeleinfoAggregator::~TeleinfoAggregator() {
+	free(meters);
+}
+
+bool TeleinfoAggregator::update(unsigned int meter, Teleinfo* teleinfo, uint64_t timestamp) {
+	if (meter >= metersCount || teleinfo == NULL) {
+		return false;
+	}
+	Meter* current = &meters[meter];
+
+	// Energie : écart de l'index total depuis la trame précédente (un index qui recule est ignoré)
+	uint32_t energy = 0;
+	unsigned long index = teleinfo->getTotalIndex();
+	if (current->started && index >= current->lastIndex) {
+		energy = index - current->lastIndex;
+	}
+	current->lastIndex = index;
+	current->started = true;
+
+	int32_t power = teleinfo->getInstPower();
+	int32_t iinst = teleinfo->getIinst();
+	for (int i = 0; i < TELEINFO_WINDOWS; i++) {
+		Window* window = &current->windows[i];
+		uint32_t bucket = timestamp / (WINDOW_DURATIONS[i] / TELEINFO_AGGREGATOR_BUCKETS);
+		advance(window, bucket);
+		if (bucket < window->bucket) {
+			bucket = window->bucket; // Trame en retard : comptée dans la tranche en cours
+		}
+		unsigned int slot = bucket % TELEINFO_AGGREGATOR_BUCKETS;
+		window->count[slot]++;
+		window->power[slot] += power;
+		window->iinst[slot] += iinst;
+		window->energy[slot] += energy;
+		window->totalCount++;
+		window->totalPower += power;
+		window->totalIinst += iinst;
+		window->totalEnergy += energy;
+		add(&window->powerMin, bucket, power, true);
+		add(&window->powerMax, bucket, power, false);
+		add(&window->iinstMin, bucket, iinst, true);
+		add(&window->iinstMax, bucket, iinst, false);
+	}
+	return true;
+}
+
+bool TeleinfoAggregator::getWindow(unsigned int meter, int window, uint64_t timestamp, TeleinfoWindow* result) {
+	if (meter >= metersCount || window < 0 || window >= TELEINFO_WINDOWS) {
+		return false;
+	}
+	Window* current = &meters[meter].windows[window];
+	advance(current, timestamp / (WINDOW_DURATIONS[window] / TELEINFO_AGGREGATOR_BUCKETS));
+
+	memset(result, 0, sizeof(TeleinfoWindow));
+	result->count = current->totalCount;
+	result->energy = current->totalEnergy;
+	if (current->totalCount > 0) {
+		result->powerMin = current->powerMin.value[current->powerMin.head];
+		result->powerMax = current->powerMax.value[current->powerMax.head];
+		result->powerMean = current->totalPower / current->totalCount;
+		result->iinstMin = current->iinstMin.value[current->iinstMin.head];
+		result->iinstMax = current->iinstMax.value[current->iinstMax.head];
+		result->iinstMean = current->totalIinst / current->totalCount;
+	}
+	return true;
+}
+
+void TeleinfoAggregator::clear(unsigned int meter) {
+	if (meter < metersCount) {
+		memset(&meters[meter], 0, sizeof(Meter));
+	}
+}
+
+unsigned int TeleinfoAggregator::getMeterCount() {
+	return metersCount;
+}
+
+unsigned long TeleinfoAggregator::getStateSize() {
+	return metersCount * sizeof(Meter);
+}
+
+void TeleinfoAggregator::saveState(void* buffer) {
+	memcpy(buffer, meters, metersCount * sizeof(Meter));
+}
+
+bool TeleinfoAggregator::restoreState(const void* buffer, unsigned long size) {
+	if (size != getStateSize()) {
+		return false;
+	}
+	memcpy(meters, buffer, size);
+	return true;
+}
+
+uint64_t TeleinfoAggregator::getWindowDuration(int window) {
+	return window >= 0 && window < TELEINFO_WINDOWS ? WINDOW_DURATIONS[window] : 0;
+}
+
+/**
+ * Fait glisser la fenêtre jusqu'à la tranche donnée : les tranches sorties de la fenêtre sont retirées des totaux
+ */
+void TeleinfoAggregator::advance(Window* window, uint32_t bucket) {
+	if (bucket <= window->bucket) {
+		return;
+	}
+	uint32_t gap = bucket - window->bucket;
+	if (gap > TELEINFO_AGGREGATOR_BUCKETS) {
+		gap = TELEINFO_AGGREGATOR_BUCKETS;
+	}
+	for (uint32_t i = 1; i <= gap; i++) {
+		unsigned int slot = (bucket - gap + i) % TELEINFO_AGGREGATOR_BUCKETS;
+		window->totalCount -= window->count[slot];
+		window->totalPower -= window->power[slot];
+		window->totalIinst -= window->iinst[slot];
+		window->totalEnergy -= window->energy[slot];
+		window->count[slot] = 0;
+		window->power[slot] = 0;
+		window->iinst[slot] = 0;
+		window->energy[slot] = 0;
+	}
+	window->bucket = bucket;
+	expire(&window->powerMin, bucket);
+	expire(&window->powerMax, bucket);
+	expire(&window->iinstMin, bucket);
+	expire(&window->iinstMax, bucket);
+}
+
+/**
+ * Ajoute une valeur de la tranche en cours à la file monotone.
+ * Les valeurs des tranches précédentes qu'elle domine ne peuvent plus être l'extrême de la fenêtre et sont retirées :
+ * la file reste triée, son premier élément est l'extrême de la fenêtre et elle contient au plus une valeur par tranche.
+ */
+void TeleinfoAggregator::add(Extremum* extremum, uint32_t bucket, int32_t value, bool minimum) {
+	while (extremum->count > 0) {
+		unsigned int last = (extremum->head + extremum->count - 1) % TELEINFO_AGGREGATOR_BUCKETS;
+		int32_t lastValue = extremum->value[last];
+		if (minimum ? lastValue < value : lastValue > value) {
+			if (extremum->bucket[last] == bucket) {
+				return; // La tranche en cours a déjà un extrême meilleur
+			}
+			break;
+		}
+		extremum->count--;
+	}
+	unsigned int position = (extremum->head + extremum->count) % TELEINFO_AGGREGATOR_BUCKETS;
+	extremum->bucket[position] = bucket;
+	extremum->value[position] = value;
+	extremum->count++;
+}
+
+/**
+ * Retire de la file monotone les valeurs des tranches sorties de la fenêtre
+ */
+void TeleinfoAggregator::expire(Extremum* extremum, uint32_t bucket) {
+	while (extremum->count > 0 && extremum->bucket[extremum->head] + TELEINFO_AGGREGATOR_BUCKETS <= bucket) {
+		extremum->head = (extremum->head + 1) % TELEINFO_AGGREGATOR_BUCKETS;
+		extremum->count--;
+	}
+}
@@ -0,0 +1,164 @@
+/**
+ * Déclaration de l'agrégation des trames Téléinfo sur fenêtres glissantes
+ *
+ * Pour chaque compteur et chaque fenêtre (1 minute, 15 minutes, 1 heure), l'agrégateur tient à jour à chaque trame
+ * le minimum, le maximum et la moyenne de la puissance instantanée (getInstPower()) et de l'intensité instantanée (IINST),
+ * ainsi que l'énergie consommée (écarts successifs de getTotalIndex()).
+ *
+ * Chaque fenêtre est découpée en TELEINFO_AGGREGATOR_BUCKETS tranches de temps : les sommes sont tenues par tranche et
+ * pour la fenêtre entière, les extrêmes par des files monotones de minima et maxima des tranches. Une trame, comme une
+ * consultation, ne coûte qu'un temps constant (amorti) et toute la mémoire est allouée à la création de l'agrégateur.
+ * La fenêtre glisse par tranche : elle couvre la tranche en cours et les TELEINFO_AGGREGATOR_BUCKETS - 1 précédentes.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_AGGREGATOR_H_
+#define TELEINFO_AGGREGATOR_H_
+
+#include "TeleinfoDecoder.h"
+
+#include <stdint.h>
+
+/**
+ * Nombre de tranches de temps d'une fenêtre (granularité du glissement)
+ */
+#ifndef TELEINFO_AGGREGATOR_BUCKETS
+#define TELEINFO_AGGREGATOR_BUCKETS   12
+#endif
+
+/**
+ * Fenêtres d'agrégation
+ */
+#define TELEINFO_WINDOW_1MIN          0
+#define TELEINFO_WINDOW_15MIN         1
+#define TELEINFO_WINDOW_1H            2
+#define TELEINFO_WINDOWS              3
+
+/**
+ * Valeurs agrégées d'une fenêtre
+ */
+struct TeleinfoWindow {
+  unsigned int count;       // Nombre de trames
+  int powerMin;             // Puissance instantanée (W), voir Teleinfo::getInstPower()
+  int powerMax;
+  int powerMean;
+  int iinstMin;             // Intensité instantanée (A)
+  int iinstMax;
+  int iinstMean;
+  unsigned long energy;     // Energie consommée (Wh), somme des écarts de l'index total
+};
+
+/**
+ * Agrégation sur fenêtres glissantes des trames d'un ensemble de compteurs
+ */
+class TeleinfoAggregator {
+  private:
+    /**
+     * File monotone des extrêmes des tranches de la fenêtre
+     */
+    struct Extremum {
+      uint32_t bucket[TELEINFO_AGGREGATOR_BUCKETS];
+      int32_t value[TELEINFO_AGGREGATOR_BUCKETS];
+      unsigned char head;
+      unsigned char count;
+    };
+
+    /**
+     * Une fenêtre d'un compteur
+     */
+    struct Window {
+      uint32_t bucket;   // Numéro de la tranche en cours (date / durée d'une tranche)
+      uint32_t count[TELEINFO_AGGREGATOR_BUCKETS];
+      uint32_t power[TELEINFO_AGGREGATOR_BUCKETS];
+      uint32_t iinst[TELEINFO_AGGREGATOR_BUCKETS];
+      uint32_t energy[TELEINFO_AGGREGATOR_BUCKETS];
+      uint32_t totalCount;
+      uint64_t totalPower;
+      uint64_t totalIinst;
+      uint64_t totalEnergy;
+      Extremum powerMin;
+      Extremum powerMax;
+      Extremum iinstMin;
+      Extremum iinstMax;
+    };
+
+    /**
+     * Un compteur
+     */
+    struct Meter {
+      Window windows[TELEINFO_WINDOWS];
+      unsigned long lastIndex;
+      bool started;
+    };
+
+    Meter* meters;
+    unsigned int metersCount;
+
+    void advance(Window* window, uint32_t bucket);
+    void add(Extremum* extremum, uint32_t bucket, int32_t value, bool minimum);
+    void expire(Extremum* extremum, uint32_t bucket);
+
+  public:
+    /**
+     * Création de l'agrégateur
+     * @param meters le nombre de compteurs, numérotés de 0 à meters - 1 par l'appelant
+     */
+    TeleinfoAggregator(unsigned int meters);
+    ~TeleinfoAggregator();
+
+    /**
+     * Agrège une trame
+     *
+     * @param meter le numéro du compteur
+     * @param teleinfo la trame décodée
+     * @param timestamp la date de réception de la trame (ms, croissante) : une trame plus ancienne que la tranche en cours y est comptée
+     * @return false si le numéro de compteur est invalide
+     */
+    bool update(unsigned int meter, Teleinfo* teleinfo, uint64_t timestamp);
+
+    /**
+     * Donne les valeurs agrégées d'une fenêtre, à la date donnée
+     *
+     * @param meter le numéro du compteur
+     * @param window la fenêtre, TELEINFO_WINDOW_1MIN, TELEINFO_WINDOW_15MIN ou TELEINFO_WINDOW_1H
+     * @param timestamp la date de consultation (ms), pas antérieure à celle de la dernière trame
+     * @param result reçoit les valeurs agrégées ; les extrêmes et moyennes ne sont significatifs que si result->count > 0
+     * @return false si le numéro de compteur ou la fenêtre est invalide
+     */
+    bool getWindow(unsigned int meter, int window, uint64_t timestamp, TeleinfoWindow* result);
+
+    /**
+     * Efface les données agrégées d'un compteur
+     */
+    void clear(unsigned int meter);
+
+    /**
+     * Donne le nombre de compteurs
+     */
+    unsigned int getMeterCount();
+
+    /**
+     * Donne la taille de l'état de l'agrégateur (voir saveState(...))
+     */
+    unsigned long getStateSize();
+
+    /**
+     * Copie l'état de l'agrégateur de tous les compteurs pour un point de reprise
+     * @param buffer reçoit l'état, getStateSize() octets
+     */
+    void saveState(void* buffer);
+
+    /**
+     * Restaure l'état copié par saveState(...)
+     * @return false si la taille ne correspond pas (autre nombre de compteurs), l'état est alors inchangé
+     */
+    bool restoreState(const void* buffer, unsigned long size);
+
+    /**
+     * Donne la durée d'une fenêtre (ms)
+     */
+    static uint64_t getWindowDuration(int window);
+};
+
+#endif  // TELEINFO_AGGREGATOR_H_
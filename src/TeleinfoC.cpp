@@ -0,0 +1,196 @@
+/**
+ * Implémentation de l'interface C du décodeur Téléinfo
+ *
+ * @author LK
+ */
+#include "TeleinfoC.h"
+#include "TeleinfoDecoder.h"
+
+#include <new>
+#include <string.h>
+
+static_assert(sizeof(TeleinfoFlatFrame) == TELEINFO_C_FRAME_SIZE, "disposition de TeleinfoFlatFrame modifiée");
+
+// Les constantes de l'interface C reprennent celles du décodeur
+static_assert(TELEINFO_C_OPTION_SALVAGE == TELEINFO_OPTION_SALVAGE, "TELEINFO_C_OPTION_SALVAGE différente de TELEINFO_OPTION_SALVAGE");
+static_assert(TELEINFO_C_OPTION_CARRY_FORWARD == TELEINFO_OPTION_CARRY_FORWARD, "TELEINFO_C_OPTION_CARRY_FORWARD différente de TELEINFO_OPTION_CARRY_FORWARD");
+static_assert(TELEINFO_C_OPTION_REPAIR == TELEINFO_OPTION_REPAIR, "TELEINFO_C_OPTION_REPAIR différente de TELEINFO_OPTION_REPAIR");
+static_assert(TELEINFO_C_FIELD_ADCO == TELEINFO_FIELD_ADCO, "TELEINFO_C_FIELD_ADCO différent de TELEINFO_FIELD_ADCO");
+static_assert(TELEINFO_C_FIELD_OPTARIF == TELEINFO_FIELD_OPTARIF, "TELEINFO_C_FIELD_OPTARIF différent de TELEINFO_FIELD_OPTARIF");
+static_assert(TELEINFO_C_FIELD_ISOUSC == TELEINFO_FIELD_ISOUSC, "TELEINFO_C_FIELD_ISOUSC différent de TELEINFO_FIELD_ISOUSC");
+static_assert(TELEINFO_C_FIELD_BASE == TELEINFO_FIELD_BASE, "TELEINFO_C_FIELD_BASE différent de TELEINFO_FIELD_BASE");
+static_assert(TELEINFO_C_FIELD_HCHC == TELEINFO_FIELD_HCHC, "TELEINFO_C_FIELD_HCHC différent de TELEINFO_FIELD_HCHC");
+static_assert(TELEINFO_C_FIELD_HCHP == TELEINFO_FIELD_HCHP, "TELEINFO_C_FIELD_HCHP différent de TELEINFO_FIELD_HCHP");
+static_assert(TELEINFO_C_FIELD_EJPHN == TELEINFO_FIELD_EJPHN, "TELEINFO_C_FIELD_EJPHN différent de TELEINFO_FIELD_EJPHN");
+static_assert(TELEINFO_C_FIELD_EJPHPM == TELEINFO_FIELD_EJPHPM, "TELEINFO_C_FIELD_EJPHPM différent de TELEINFO_FIELD_EJPHPM");
+static_assert(TELEINFO_C_FIELD_BBRHCJB == TELEINFO_FIELD_BBRHCJB, "TELEINFO_C_FIELD_BBRHCJB différent de TELEINFO_FIELD_BBRHCJB");
+static_assert(TELEINFO_C_FIELD_BBRHPJB == TELEINFO_FIELD_BBRHPJB, "TELEINFO_C_FIELD_BBRHPJB différent de TELEINFO_FIELD_BBRHPJB");
+static_assert(TELEINFO_C_FIELD_BBRHCJW == TELEINFO_FIELD_BBRHCJW, "TELEINFO_C_FIELD_BBRHCJW différent de TELEINFO_FIELD_BBRHCJW");
+static_assert(TELEINFO_C_FIELD_BBRHPJW == TELEINFO_FIELD_BBRHPJW, "TELEINFO_C_FIELD_BBRHPJW différent de TELEINFO_FIELD_BBRHPJW");
+static_assert(TELEINFO_C_FIELD_BBRHCJR == TELEINFO_FIELD_BBRHCJR, "TELEINFO_C_FIELD_BBRHCJR différent de TELEINFO_FIELD_BBRHCJR");
+static_assert(TELEINFO_C_FIELD_BBRHPJR == TELEINFO_FIELD_BBRHPJR, "TELEINFO_C_FIELD_BBRHPJR différent de TELEINFO_FIELD_BBRHPJR");
+static_assert(TELEINFO_C_FIELD_PEJP == TELEINFO_FIELD_PEJP, "TELEINFO_C_FIELD_PEJP différent de TELEINFO_FIELD_PEJP");
+static_assert(TELEINFO_C_FIELD_PTEC == TELEINFO_FIELD_PTEC, "TELEINFO_C_FIELD_PTEC différent de TELEINFO_FIELD_PTEC");
+static_assert(TELEINFO_C_FIELD_DEMAIN == TELEINFO_FIELD_DEMAIN, "TELEINFO_C_FIELD_DEMAIN différent de TELEINFO_FIELD_DEMAIN");
+static_assert(TELEINFO_C_FIELD_IINST == TELEINFO_FIELD_IINST, "TELEINFO_C_FIELD_IINST différent de TELEINFO_FIELD_IINST");
+static_assert(TELEINFO_C_FIELD_ADPS == TELEINFO_FIELD_ADPS, "TELEINFO_C_FIELD_ADPS différent de TELEINFO_FIELD_ADPS");
+static_assert(TELEINFO_C_FIELD_IMAX == TELEINFO_FIELD_IMAX, "TELEINFO_C_FIELD_IMAX différent de TELEINFO_FIELD_IMAX");
+static_assert(TELEINFO_C_FIELD_PAPP == TELEINFO_FIELD_PAPP, "TELEINFO_C_FIELD_PAPP différent de TELEINFO_FIELD_PAPP");
+static_assert(TELEINFO_C_FIELD_HHPHC == TELEINFO_FIELD_HHPHC, "TELEINFO_C_FIELD_HHPHC différent de TELEINFO_FIELD_HHPHC");
+static_assert(TELEINFO_C_FIELD_MOTDETAT == TELEINFO_FIELD_MOTDETAT, "TELEINFO_C_FIELD_MOTDETAT différent de TELEINFO_FIELD_MOTDETAT");
+static_assert(TELEINFO_C_FIELD_IINST1 == TELEINFO_FIELD_IINST1, "TELEINFO_C_FIELD_IINST1 différent de TELEINFO_FIELD_IINST1");
+static_assert(TELEINFO_C_FIELD_IINST2 == TELEINFO_FIELD_IINST2, "TELEINFO_C_FIELD_IINST2 différent de TELEINFO_FIELD_IINST2");
+static_assert(TELEINFO_C_FIELD_IINST3 == TELEINFO_FIELD_IINST3, "TELEINFO_C_FIELD_IINST3 différent de TELEINFO_FIELD_IINST3");
+static_assert(TELEINFO_C_FIELD_IMAX1 == TELEINFO_FIELD_IMAX1, "TELEINFO_C_FIELD_IMAX1 différent de TELEINFO_FIELD_IMAX1");
+static_assert(TELEINFO_C_FIELD_IMAX2 == TELEINFO_FIELD_IMAX2, "TELEINFO_C_FIELD_IMAX2 différent de TELEINFO_FIELD_IMAX2");
+static_assert(TELEINFO_C_FIELD_IMAX3 == TELEINFO_FIELD_IMAX3, "TELEINFO_C_FIELD_IMAX3 différent de TELEINFO_FIELD_IMAX3");
+static_assert(TELEINFO_C_FIELD_PMAX == TELEINFO_FIELD_PMAX, "TELEINFO_C_FIELD_PMAX différent de TELEINFO_FIELD_PMAX");
+static_assert(TELEINFO_C_FIELD_PPOT == TELEINFO_FIELD_PPOT, "TELEINFO_C_FIELD_PPOT différent de TELEINFO_FIELD_PPOT");
+static_assert(TELEINFO_C_FIELD_ADIR1 == TELEINFO_FIELD_ADIR1, "TELEINFO_C_FIELD_ADIR1 différent de TELEINFO_FIELD_ADIR1");
+static_assert(TELEINFO_C_FIELD_ADIR2 == TELEINFO_FIELD_ADIR2, "TELEINFO_C_FIELD_ADIR2 différent de TELEINFO_FIELD_ADIR2");
+static_assert(TELEINFO_C_FIELD_ADIR3 == TELEINFO_FIELD_ADIR3, "TELEINFO_C_FIELD_ADIR3 différent de TELEINFO_FIELD_ADIR3");
+
+/**
+ * Décodeur opaque : aucune exception ne doit traverser l'interface C, la création les intercepte
+ */
+struct TeleinfoHandle {
+	TeleinfoDecoder decoder;
+};
+
+/**
+ * Copie un texte dans un champ de taille fixe, tronqué si besoin et toujours terminé par un NUL
+ */
+static void copyText(char* target, size_t size, const char* source) {
+	size_t length = 0;
+	if (source != NULL) {
+		length = strnlen(source, size - 1);
+		memcpy(target, source, length);
+	}
+	target[length] = '\0';
+}
+
+/**
+ * Copie une trame décodée à plat
+ * @param end la position dans le tampon de l'octet qui suit l'ETX
+ */
+static void flatten(TeleinfoFrame* frame, TeleinfoFlatFrame* flat, unsigned int end) {
+	memset(flat, 0, sizeof(TeleinfoFlatFrame));
+	flat->validFields = frame->getValidFields();
+	flat->carriedFields = frame->getCarriedFields();
+	flat->totalIndex = frame->getTotalIndex();
+	flat->adco = frame->getAdcoAsLong();
+	flat->end = end;
+	flat->papp = frame->getPapp();
+	flat->indexes[TELEINFO_C_INDEX_BASE] = frame->getBase();
+	flat->indexes[TELEINFO_C_INDEX_HCHC] = frame->getHchc();
+	flat->indexes[TELEINFO_C_INDEX_HCHP] = frame->getHchp();
+	flat->indexes[TELEINFO_C_INDEX_EJPHN] = frame->getEjphn();
+	flat->indexes[TELEINFO_C_INDEX_EJPHPM] = frame->getEjphpm();
+	flat->indexes[TELEINFO_C_INDEX_BBRHCJB] = frame->getBbrhcjb();
+	flat->indexes[TELEINFO_C_INDEX_BBRHPJB] = frame->getBbrhpjb();
+	flat->indexes[TELEINFO_C_INDEX_BBRHCJW] = frame->getBbrhcjw();
+	flat->indexes[TELEINFO_C_INDEX_BBRHPJW] = frame->getBbrhpjw();
+	flat->indexes[TELEINFO_C_INDEX_BBRHCJR] = frame->getBbrhcjr();
+	flat->indexes[TELEINFO_C_INDEX_BBRHPJR] = frame->getBbrhpjr();
+	flat->isousc = frame->getIsousc();
+	flat->pejp = frame->getPejp();
+	flat->iinst = frame->getIinst();
+	flat->adps = frame->getAdps();
+	flat->imax = frame->getImax();
+	copyText(flat->adcoText, sizeof(flat->adcoText), frame->getAdco());
+	copyText(flat->optarif, sizeof(flat->optarif), frame->getOptarif());
+	copyText(flat->ptec, sizeof(flat->ptec), frame->getPtec());
+	copyText(flat->demain, sizeof(flat->demain), frame->getDemain());
+	copyText(flat->motdetat, sizeof(flat->motdetat), frame->getMotdetat());
+	flat->hhphc = frame->getHhphc();
+#ifndef TELEINFO_DISABLE_THREE_PHASE
+	flat->pmax = frame->getPmax();
+	for (int phase = 1; phase <= 3; phase++) {
+		flat->iinstPhases[phase - 1] = frame->getIinstPhase(phase);
+		flat->imaxPhases[phase - 1] = frame->getImaxPhase(phase);
+		flat->adirPhases[phase - 1] = frame->getAdirPhase(phase);
+	}
+	copyText(flat->ppot, sizeof(flat->ppot), frame->getPpot());
+#endif
+}
+
+int teleinfoVersion(void) {
+	return TELEINFO_C_VERSION;
+}
+
+unsigned int teleinfoFrameSize(void) {
+	return sizeof(TeleinfoFlatFrame);
+}
+
+TeleinfoHandle* teleinfoCreate(unsigned int options) {
+	TeleinfoHandle* handle;
+	try {
+		handle = new (std::nothrow) TeleinfoHandle();
+	} catch (...) {
+		// nothrow ne couvre que l'allocation : le constructeur du décodeur peut encore lever une exception
+		return NULL;
+	}
+	if (handle != NULL) {
+		handle->decoder.setOptions(options);
+	}
+	return handle;
+}
+
+void teleinfoDestroy(TeleinfoHandle* handle) {
+	delete handle;
+}
+
+int teleinfoDecode(TeleinfoHandle* handle, const unsigned char* buffer, unsigned int length, TeleinfoFlatFrame* frames,
+		unsigned int capacity, unsigned int* consumed) {
+	if (handle == NULL || (buffer == NULL && length > 0) || (frames == NULL && capacity > 0)) {
+		return -1;
+	}
+	unsigned int index = 0;
+	unsigned int count = 0;
+	while (index < length && count < capacity) {
+		unsigned int used = 0;
+		TeleinfoFrame* frame = handle->decoder.decode(buffer + index, length - index, &used);
+		index += used;
+		if (frame != NULL) {
+			flatten(frame, &frames[count++], index);
+		}
+	}
+	if (consumed != NULL) {
+		*consumed = index;
+	}
+	return count;
+}
+
+int teleinfoDecodeByte(TeleinfoHandle* handle, int character, TeleinfoFlatFrame* frame) {
+	if (handle == NULL || frame == NULL) {
+		return -1;
+	}
+	TeleinfoFrame* decoded = handle->decoder.decode(character);
+	if (decoded == NULL) {
+		return 0;
+	}
+	flatten(decoded, frame, 1);
+	return 1;
+}
+
+void teleinfoReset(TeleinfoHandle* handle) {
+	if (handle != NULL) {
+		handle->decoder.reset();
+	}
+}
+
+int teleinfoGetStats(TeleinfoHandle* handle, TeleinfoFlatStats* stats) {
+	if (handle == NULL || stats == NULL) {
+		return -1;
+	}
+	TeleinfoStats decoderStats;
+	handle->decoder.getStats(&decoderStats);
+	stats->frames = decoderStats.frames;
+	stats->lostFrames = decoderStats.lostFrames;
+	stats->salvagedFrames = decoderStats.salvagedFrames;
+	stats->droppedGroupes = decoderStats.droppedGroupes;
+	stats->parityErrors = decoderStats.parityErrors;
+	stats->repairs = decoderStats.repairs;
+	stats->rejectedRepairs = decoderStats.rejectedRepairs;
+	return 0;
+}
@@ -0,0 +1,216 @@
+/**
+ * Déclaration de l'interface C du décodeur Téléinfo (bibliothèque partagée libteleinfodecoder.so)
+ *
+ * Destinée aux langages qui appellent le décodeur par une interface de fonctions C (ctypes ou cffi en Python, cgo en Go...) :
+ * le décodeur est désigné par un pointeur opaque, et les trames décodées sont copiées dans des structures à plat de
+ * taille et de disposition fixes, sans pointeur ni appel virtuel. Un seul appel à teleinfoDecode(...) décode un tampon
+ * de plusieurs milliers d'octets et renvoie toutes les trames terminées : le coût d'un passage de langage à l'autre est
+ * payé une fois par tampon plutôt qu'une fois par octet.
+ *
+ * L'interface est stable : une structure n'est jamais modifiée, seulement complétée dans une nouvelle version de
+ * l'interface (voir teleinfoVersion()). Seules les fonctions de cet en-tête sont exportées par la bibliothèque partagée ;
+ * les classes C++ sont disponibles dans la bibliothèque statique.
+ *
+ * Ce fichier est un en-tête C (C99), utilisable aussi en C++.
+ * @author LK
+ */
+
+#ifndef TELEINFO_C_H_
+#define TELEINFO_C_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Version de l'interface C
+ */
+#define TELEINFO_C_VERSION          1
+
+/**
+ * Fonctions exportées par la bibliothèque partagée (compilée avec -fvisibility=hidden)
+ */
+#if defined(__GNUC__)
+#define TELEINFO_C_API              __attribute__((visibility("default")))
+#else
+#define TELEINFO_C_API
+#endif
+
+/**
+ * Taille d'une trame à plat (octets), vérifiée à la compilation de la bibliothèque
+ */
+#define TELEINFO_C_FRAME_SIZE       160
+
+/**
+ * Rang des index dans TeleinfoFlatFrame::indexes
+ */
+#define TELEINFO_C_INDEX_BASE       0
+#define TELEINFO_C_INDEX_HCHC       1
+#define TELEINFO_C_INDEX_HCHP       2
+#define TELEINFO_C_INDEX_EJPHN      3
+#define TELEINFO_C_INDEX_EJPHPM     4
+#define TELEINFO_C_INDEX_BBRHCJB    5
+#define TELEINFO_C_INDEX_BBRHPJB    6
+#define TELEINFO_C_INDEX_BBRHCJW    7
+#define TELEINFO_C_INDEX_BBRHPJW    8
+#define TELEINFO_C_INDEX_BBRHCJR    9
+#define TELEINFO_C_INDEX_BBRHPJR    10
+#define TELEINFO_C_INDEXES          11
+
+/**
+ * Options d'un décodeur (voir teleinfoCreate(...)), mêmes valeurs que TELEINFO_OPTION_* de TeleinfoDecoder.h
+ */
+#define TELEINFO_C_OPTION_SALVAGE            0x01  /* Un groupe invalide n'écarte que lui-même, la trame est conservée */
+#define TELEINFO_C_OPTION_CARRY_FORWARD      0x02  /* Un groupe absent de la trame garde sa dernière valeur valide */
+#define TELEINFO_C_OPTION_REPAIR             0x04  /* Réparation d'un caractère erroné par la parité et le checksum */
+
+/**
+ * Champs d'une trame, bits de TeleinfoFlatFrame::validFields et carriedFields, mêmes valeurs que TELEINFO_FIELD_*
+ * de TeleinfoDecoder.h
+ */
+#define TELEINFO_C_FIELD_ADCO        (1ULL << 0)
+#define TELEINFO_C_FIELD_OPTARIF     (1ULL << 1)
+#define TELEINFO_C_FIELD_ISOUSC      (1ULL << 2)
+#define TELEINFO_C_FIELD_BASE        (1ULL << 3)
+#define TELEINFO_C_FIELD_HCHC        (1ULL << 4)
+#define TELEINFO_C_FIELD_HCHP        (1ULL << 5)
+#define TELEINFO_C_FIELD_EJPHN       (1ULL << 6)
+#define TELEINFO_C_FIELD_EJPHPM      (1ULL << 7)
+#define TELEINFO_C_FIELD_BBRHCJB     (1ULL << 8)
+#define TELEINFO_C_FIELD_BBRHPJB     (1ULL << 9)
+#define TELEINFO_C_FIELD_BBRHCJW     (1ULL << 10)
+#define TELEINFO_C_FIELD_BBRHPJW     (1ULL << 11)
+#define TELEINFO_C_FIELD_BBRHCJR     (1ULL << 12)
+#define TELEINFO_C_FIELD_BBRHPJR     (1ULL << 13)
+#define TELEINFO_C_FIELD_PEJP        (1ULL << 14)
+#define TELEINFO_C_FIELD_PTEC        (1ULL << 15)
+#define TELEINFO_C_FIELD_DEMAIN      (1ULL << 16)
+#define TELEINFO_C_FIELD_IINST       (1ULL << 17)
+#define TELEINFO_C_FIELD_ADPS        (1ULL << 18)
+#define TELEINFO_C_FIELD_IMAX        (1ULL << 19)
+#define TELEINFO_C_FIELD_PAPP        (1ULL << 20)
+#define TELEINFO_C_FIELD_HHPHC       (1ULL << 21)
+#define TELEINFO_C_FIELD_MOTDETAT    (1ULL << 22)
+#define TELEINFO_C_FIELD_IINST1      (1ULL << 23)  /* Compteurs triphasés */
+#define TELEINFO_C_FIELD_IINST2      (1ULL << 24)
+#define TELEINFO_C_FIELD_IINST3      (1ULL << 25)
+#define TELEINFO_C_FIELD_IMAX1       (1ULL << 26)
+#define TELEINFO_C_FIELD_IMAX2       (1ULL << 27)
+#define TELEINFO_C_FIELD_IMAX3       (1ULL << 28)
+#define TELEINFO_C_FIELD_PMAX        (1ULL << 29)
+#define TELEINFO_C_FIELD_PPOT        (1ULL << 30)
+#define TELEINFO_C_FIELD_ADIR1       (1ULL << 31)
+#define TELEINFO_C_FIELD_ADIR2       (1ULL << 32)
+#define TELEINFO_C_FIELD_ADIR3       (1ULL << 33)
+
+/**
+ * Trame décodée, à plat. Un champ absent de la trame vaut 0 (chaîne vide pour un texte) ;
+ * les textes sont terminés par un caractère nul.
+ */
+typedef struct TeleinfoFlatFrame {
+  uint64_t validFields;         /* Champs reçus dans la trame, bits TELEINFO_C_FIELD_* */
+  uint64_t carriedFields;       /* Champs reportés d'une trame précédente (option TELEINFO_C_OPTION_CARRY_FORWARD) */
+  uint64_t totalIndex;          /* Somme des index moins l'offset de l'index total (Wh) */
+  uint64_t adco;                /* Adresse du compteur en entier, 0 si absente ou mal formée */
+  uint32_t end;                 /* Position dans le tampon de l'appel de l'octet qui suit l'ETX de la trame */
+  uint32_t papp;                /* Puissance apparente (VA) */
+  uint32_t pmax;                /* Puissance maximale triphasée atteinte (W) */
+  uint32_t indexes[TELEINFO_C_INDEXES]; /* Index (Wh), rangs TELEINFO_C_INDEX_* */
+  uint16_t isousc;              /* Intensité souscrite (A) */
+  uint16_t pejp;                /* Préavis de début EJP (min) */
+  uint16_t iinst;               /* Intensité instantanée (A) */
+  uint16_t adps;                /* Avertissement de dépassement de puissance souscrite (A) */
+  uint16_t imax;                /* Intensité maximale appelée (A) */
+  uint16_t iinstPhases[3];      /* Compteurs triphasés : intensité instantanée de chaque phase (A) */
+  uint16_t imaxPhases[3];       /* Compteurs triphasés : intensité maximale de chaque phase (A) */
+  uint16_t adirPhases[3];       /* Compteurs triphasés : avertissement de dépassement de chaque phase (A) */
+  char adcoText[13];            /* Adresse du compteur (12 chiffres) */
+  char optarif[5];
+  char ptec[5];
+  char demain[5];
+  char motdetat[7];
+  char ppot[3];
+  char hhphc;
+  char reserved[5];
+} TeleinfoFlatFrame;
+
+/**
+ * Compteurs d'activité d'un décodeur (voir TeleinfoStats)
+ */
+typedef struct TeleinfoFlatStats {
+  uint64_t frames;
+  uint64_t lostFrames;
+  uint64_t salvagedFrames;
+  uint64_t droppedGroupes;
+  uint64_t parityErrors;
+  uint64_t repairs;
+  uint64_t rejectedRepairs;
+} TeleinfoFlatStats;
+
+/**
+ * Décodeur opaque
+ */
+typedef struct TeleinfoHandle TeleinfoHandle;
+
+/**
+ * Donne la version de l'interface (TELEINFO_C_VERSION de la bibliothèque chargée)
+ */
+TELEINFO_C_API int teleinfoVersion(void);
+
+/**
+ * Donne la taille d'une trame à plat, pour vérifier la déclaration de la structure côté appelant
+ */
+TELEINFO_C_API unsigned int teleinfoFrameSize(void);
+
+/**
+ * Création d'un décodeur
+ * @param options une combinaison de TELEINFO_C_OPTION_*, 0 par défaut
+ * @return le décodeur, NULL si la mémoire n'a pu être allouée
+ */
+TELEINFO_C_API TeleinfoHandle* teleinfoCreate(unsigned int options);
+
+/**
+ * Destruction d'un décodeur (sans effet si NULL)
+ */
+TELEINFO_C_API void teleinfoDestroy(TeleinfoHandle* handle);
+
+/**
+ * Décode un tampon et copie chaque trame terminée dans le tableau.
+ * La trame en cours à la fin du tampon est conservée par le décodeur et terminée lors d'un appel suivant.
+ *
+ * @param buffer les octets lus du flux
+ * @param length le nombre d'octets du tampon
+ * @param frames reçoit les trames terminées
+ * @param capacity le nombre de trames du tableau
+ * @param consumed reçoit le nombre d'octets décodés : length, sauf si le tableau est plein (les octets restants
+ *        sont à passer à l'appel suivant) ; facultatif, peut être NULL
+ * @return le nombre de trames copiées, -1 si le décodeur ou le tableau est invalide
+ */
+TELEINFO_C_API int teleinfoDecode(TeleinfoHandle* handle, const unsigned char* buffer, unsigned int length, TeleinfoFlatFrame* frames,
+    unsigned int capacity, unsigned int* consumed);
+
+/**
+ * Décode un seul octet (équivalent de TeleinfoDecoder::decode(int), pour comparaison)
+ * @param frame reçoit la trame si l'octet la termine
+ * @return 1 si une trame est terminée, 0 sinon, -1 si le décodeur ou la trame est invalide
+ */
+TELEINFO_C_API int teleinfoDecodeByte(TeleinfoHandle* handle, int character, TeleinfoFlatFrame* frame);
+
+/**
+ * Abandonne la trame en cours de décodage
+ */
+TELEINFO_C_API void teleinfoReset(TeleinfoHandle* handle);
+
+/**
+ * Donne les compteurs d'activité du décodeur
+ * @return 0, -1 si le décodeur est invalide
+ */
+TELEINFO_C_API int teleinfoGetStats(TeleinfoHandle* handle, TeleinfoFlatStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* TELEINFO_C_H_ */
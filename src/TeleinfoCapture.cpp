@@ -0,0 +1,460 @@
+/**
+ * Implémentation du format de capture indexée du flux Téléinfo
+ *
+ * @author LK
+ */
+#include "TeleinfoCapture.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*********************************************************************************************************************************************************************
+  CONSTANTES
+ *********************************************************************************************************************************************************************/
+
+#define TELEINFO_CAPTURE_VERSION       1
+#define TELEINFO_CAPTURE_HEADER_SIZE   16
+#define TELEINFO_CAPTURE_BLOCK_HEADER  16
+
+/* Types de blocs */
+#define TELEINFO_CAPTURE_BLOCK_RAW     0x57415242  // "BRAW"
+#define TELEINFO_CAPTURE_BLOCK_INDEX   0x58444E49  // "INDX"
+
+#define TELEINFO_CHAR_STX              0x02
+
+/**
+ * Arrondi d'une longueur au multiple de 8 supérieur
+ */
+static uint64_t align8(uint64_t length) {
+	return (length + 7) & ~((uint64_t) 7);
+}
+
+/*********************************************************************************************************************************************************************
+  ECRITURE
+ *********************************************************************************************************************************************************************/
+
+TeleinfoCaptureWriter::TeleinfoCaptureWriter(TeleinfoDecoder* teleinfoDecoder) {
+	this->teleinfoDecoder = teleinfoDecoder;
+	file = NULL;
+	block = NULL;
+	blockSize = 0;
+	blockLength = 0;
+	rawOffset = 0;
+	entries = NULL;
+	entriesCount = 0;
+	entriesCapacity = 0;
+	entriesWritten = 0;
+	stxSeen = false;
+	stxOffset = 0;
+	stxTimestamp = 0;
+}
+
+TeleinfoCaptureWriter::~TeleinfoCaptureWriter() {
+	close();
+}
+
+bool TeleinfoCaptureWriter::open(const char* path, unsigned int blockSize) {
+	close();
+	file = fopen(path, "wb");
+	block = (unsigned char*) malloc(blockSize);
+	if (file == NULL || block == NULL) {
+		close();
+		return false;
+	}
+	this->blockSize = blockSize;
+	blockLength = 0;
+	rawOffset = 0;
+	entriesCount = 0;
+	entriesWritten = 0;
+	stxSeen = false;
+
+	unsigned char header[TELEINFO_CAPTURE_HEADER_SIZE];
+	uint32_t version = TELEINFO_CAPTURE_VERSION;
+	uint32_t size = blockSize;
+	memcpy(header, TELEINFO_CAPTURE_MAGIC, 8);
+	memcpy(header + 8, &version, 4);
+	memcpy(header + 12, &size, 4);
+	if (fwrite(header, sizeof(header), 1, file) != 1) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+Teleinfo* TeleinfoCaptureWriter::capture(const unsigned char* buffer, unsigned int length, unsigned int* consumed, uint64_t timestamp) {
+	if (file == NULL) {
+		return NULL;
+	}
+	unsigned int count = 0;
+	Teleinfo* teleinfo = teleinfoDecoder->decode(buffer, length, &count);
+	if (consumed != NULL) {
+		*consumed = count;
+	}
+
+	// Le début de la trame terminée est le dernier STX reçu
+	for (unsigned int i = 0; i < count; i++) {
+		if ((buffer[i] & 0x7F) == TELEINFO_CHAR_STX) {
+			stxSeen = true;
+			stxOffset = rawOffset + i;
+			stxTimestamp = timestamp;
+		}
+	}
+
+	// Copie des octets bruts, un bloc est écrit dès qu'il est plein
+	unsigned int index = 0;
+	while (index < count) {
+		unsigned int chunk = count - index;
+		if (chunk > blockSize - blockLength) {
+			chunk = blockSize - blockLength;
+		}
+		memcpy(block + blockLength, buffer + index, chunk);
+		blockLength += chunk;
+		rawOffset += chunk;
+		index += chunk;
+		if (blockLength == blockSize) {
+			flush();
+		}
+	}
+
+	// Indexation de la trame terminée, après ses octets bruts
+	if (teleinfo != NULL && stxSeen) {
+		if (entriesCount == entriesCapacity) {
+			unsigned int capacity = entriesCapacity == 0 ? 64 : entriesCapacity * 2;
+			TeleinfoCaptureEntry* resized = (TeleinfoCaptureEntry*) realloc(entries, capacity * sizeof(TeleinfoCaptureEntry));
+			if (resized != NULL) {
+				entries = resized;
+				entriesCapacity = capacity;
+			}
+		}
+		if (entriesCount < entriesCapacity) {
+			entries[entriesCount].offset = stxOffset;
+			entries[entriesCount].timestamp = stxTimestamp;
+			entries[entriesCount].adco = teleinfo->getAdcoAsLong();
+			entriesCount++;
+		}
+	}
+	return teleinfo;
+}
+
+bool TeleinfoCaptureWriter::writeBlock(uint32_t type, const void* data, uint32_t length, uint64_t position) {
+	static const unsigned char padding[8] = { 0 };
+	unsigned char header[TELEINFO_CAPTURE_BLOCK_HEADER];
+	memcpy(header, &type, 4);
+	memcpy(header + 4, &length, 4);
+	memcpy(header + 8, &position, 8);
+	return fwrite(header, sizeof(header), 1, file) == 1
+			&& fwrite(data, 1, length, file) == length
+			&& fwrite(padding, 1, align8(length) - length, file) == align8(length) - length;
+}
+
+bool TeleinfoCaptureWriter::flush() {
+	if (file == NULL) {
+		return false;
+	}
+	bool success = true;
+	if (blockLength > 0) {
+		success = writeBlock(TELEINFO_CAPTURE_BLOCK_RAW, block, blockLength, rawOffset - blockLength);
+		blockLength = 0;
+	}
+	if (entriesCount > 0) {
+		success = writeBlock(TELEINFO_CAPTURE_BLOCK_INDEX, entries, entriesCount * sizeof(TeleinfoCaptureEntry), entriesWritten) && success;
+		entriesWritten += entriesCount;
+		entriesCount = 0;
+	}
+	return fflush(file) == 0 && success;
+}
+
+bool TeleinfoCaptureWriter::close() {
+	bool success = true;
+	if (file != NULL) {
+		success = flush();
+		success = fclose(file) == 0 && success;
+		file = NULL;
+	}
+	free(block);
+	block = NULL;
+	free(entries);
+	entries = NULL;
+	entriesCapacity = 0;
+	return success;
+}
+
+uint64_t TeleinfoCaptureWriter::getFrameCount() {
+	return entriesWritten + entriesCount;
+}
+
+/*********************************************************************************************************************************************************************
+  LECTURE
+ *********************************************************************************************************************************************************************/
+
+TeleinfoCaptureReader::TeleinfoCaptureReader() {
+	map = NULL;
+	mapLength = 0;
+	rawBlocks = NULL;
+	rawBlocksCount = 0;
+	indexBlocks = NULL;
+	indexBlocksCount = 0;
+	frameCount = 0;
+	rawLength = 0;
+	meterFrames = NULL;
+}
+
+TeleinfoCaptureReader::~TeleinfoCaptureReader() {
+	close();
+}
+
+bool TeleinfoCaptureReader::open(const char* path) {
+	close();
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat status;
+	if (fstat(fd, &status) != 0 || status.st_size < TELEINFO_CAPTURE_HEADER_SIZE) {
+		::close(fd);
+		return false;
+	}
+	void* projection = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (projection == MAP_FAILED) {
+		return false;
+	}
+	map = (unsigned char*) projection;
+	mapLength = status.st_size;
+
+	uint32_t version;
+	memcpy(&version, map + 8, 4);
+	if (memcmp(map, TELEINFO_CAPTURE_MAGIC, 8) != 0 || version != TELEINFO_CAPTURE_VERSION) {
+		close();
+		return false;
+	}
+
+	// Parcours des en-têtes de blocs, arrêt au premier bloc incomplet (capture interrompue)
+	uint64_t position = TELEINFO_CAPTURE_HEADER_SIZE;
+	while (position + TELEINFO_CAPTURE_BLOCK_HEADER <= mapLength) {
+		uint32_t type;
+		uint32_t length;
+		Block found;
+		memcpy(&type, map + position, 4);
+		memcpy(&length, map + position + 4, 4);
+		memcpy(&found.position, map + position + 8, 8);
+		found.data = map + position + TELEINFO_CAPTURE_BLOCK_HEADER;
+		if (position + TELEINFO_CAPTURE_BLOCK_HEADER + length > mapLength) {
+			break;
+		}
+		if (type == TELEINFO_CAPTURE_BLOCK_RAW && found.position == rawLength) {
+			found.length = length;
+			if (!addBlock(&rawBlocks, &rawBlocksCount, found)) {
+				break;
+			}
+			rawLength += length;
+		} else if (type == TELEINFO_CAPTURE_BLOCK_INDEX && found.position == frameCount && length % sizeof(TeleinfoCaptureEntry) == 0) {
+			found.length = length / sizeof(TeleinfoCaptureEntry);
+			if (!addBlock(&indexBlocks, &indexBlocksCount, found)) {
+				break;
+			}
+			frameCount += found.length;
+		} else {
+			break;
+		}
+		position += TELEINFO_CAPTURE_BLOCK_HEADER + align8(length);
+	}
+	return true;
+}
+
+bool TeleinfoCaptureReader::addBlock(Block** blocks, unsigned int* count, Block block) {
+	if ((*count & (*count - 1)) == 0) { // Capacité doublée à chaque puissance de 2
+		Block* resized = (Block*) realloc(*blocks, (*count == 0 ? 1 : *count * 2) * sizeof(Block));
+		if (resized == NULL) {
+			return false;
+		}
+		*blocks = resized;
+	}
+	(*blocks)[(*count)++] = block;
+	return true;
+}
+
+void TeleinfoCaptureReader::close() {
+	if (map != NULL) {
+		munmap(map, mapLength);
+		map = NULL;
+	}
+	free(rawBlocks);
+	rawBlocks = NULL;
+	rawBlocksCount = 0;
+	free(indexBlocks);
+	indexBlocks = NULL;
+	indexBlocksCount = 0;
+	free(meterFrames);
+	meterFrames = NULL;
+	frameCount = 0;
+	rawLength = 0;
+}
+
+uint64_t TeleinfoCaptureReader::getFrameCount() {
+	return frameCount;
+}
+
+uint64_t TeleinfoCaptureReader::getRawLength() {
+	return rawLength;
+}
+
+long TeleinfoCaptureReader::findBlock(Block* blocks, unsigned int count, uint64_t position) {
+	// Dernier bloc commençant à la position donnée ou avant
+	long low = 0;
+	long high = (long) count - 1;
+	long found = -1;
+	while (low <= high) {
+		long middle = (low + high) / 2;
+		if (blocks[middle].position <= position) {
+			found = middle;
+			low = middle + 1;
+		} else {
+			high = middle - 1;
+		}
+	}
+	return found;
+}
+
+const TeleinfoCaptureEntry* TeleinfoCaptureReader::getEntry(uint64_t frame) {
+	if (frame >= frameCount) {
+		return NULL;
+	}
+	long found = findBlock(indexBlocks, indexBlocksCount, frame);
+	const TeleinfoCaptureEntry* entries = (const TeleinfoCaptureEntry*) indexBlocks[found].data;
+	return &entries[frame - indexBlocks[found].position];
+}
+
+int64_t TeleinfoCaptureReader::findFrame(uint64_t timestamp) {
+	int64_t low = 0;
+	int64_t high = (int64_t) frameCount - 1;
+	int64_t found = -1;
+	while (low <= high) {
+		int64_t middle = (low + high) / 2;
+		if (getEntry(middle)->timestamp <= timestamp) {
+			found = middle;
+			low = middle + 1;
+		} else {
+			high = middle - 1;
+		}
+	}
+	return found;
+}
+
+int TeleinfoCaptureReader::compareMeterFrames(const void* first, const void* second) {
+	const MeterFrame* a = (const MeterFrame*) first;
+	const MeterFrame* b = (const MeterFrame*) second;
+	if (a->adco != b->adco) {
+		return a->adco < b->adco ? -1 : 1;
+	}
+	return a->frame < b->frame ? -1 : (a->frame > b->frame ? 1 : 0);
+}
+
+bool TeleinfoCaptureReader::buildMeterFrames() {
+	if (meterFrames != NULL) {
+		return true;
+	}
+	if (frameCount == 0 || frameCount > SIZE_MAX / sizeof(MeterFrame)) {
+		return false;
+	}
+	meterFrames = (MeterFrame*) malloc(frameCount * sizeof(MeterFrame));
+	if (meterFrames == NULL) {
+		return false;
+	}
+	for (uint64_t frame = 0; frame < frameCount; frame++) {
+		meterFrames[frame].adco = getEntry(frame)->adco;
+		meterFrames[frame].frame = frame;
+	}
+	qsort(meterFrames, frameCount, sizeof(MeterFrame), compareMeterFrames);
+	return true;
+}
+
+int64_t TeleinfoCaptureReader::findFrame(uint64_t timestamp, uint64_t adco) {
+	if (!buildMeterFrames()) {
+		// Sans index (capture vide ou mémoire insuffisante) : parcours à rebours depuis la date
+		int64_t frame = findFrame(timestamp);
+		while (frame >= 0 && getEntry(frame)->adco != adco) {
+			frame--;
+		}
+		return frame;
+	}
+
+	// Première trame du compteur dans l'index
+	int64_t low = 0;
+	int64_t high = (int64_t) frameCount;
+	while (low < high) {
+		int64_t middle = (low + high) / 2;
+		if (meterFrames[middle].adco < adco) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	// Dernière trame du compteur reçue à la date ou avant : les dates croissent avec le numéro de trame
+	int64_t found = -1;
+	high = (int64_t) frameCount - 1;
+	while (low <= high) {
+		int64_t middle = (low + high) / 2;
+		if (meterFrames[middle].adco == adco && getEntry(meterFrames[middle].frame)->timestamp <= timestamp) {
+			found = middle;
+			low = middle + 1;
+		} else {
+			high = middle - 1;
+		}
+	}
+	return found >= 0 ? (int64_t) meterFrames[found].frame : -1;
+}
+
+int64_t TeleinfoCaptureReader::findPreviousFrame(uint64_t frame, uint64_t adco) {
+	if (!buildMeterFrames()) {
+		// Sans index (capture vide ou mémoire insuffisante) : parcours à rebours depuis la trame
+		int64_t previous = (int64_t) (frame < frameCount ? frame : frameCount) - 1;
+		while (previous >= 0 && getEntry(previous)->adco != adco) {
+			previous--;
+		}
+		return previous;
+	}
+
+	// Première entrée de l'index qui suit (compteur, trame) : l'entrée précédente est la trame cherchée si elle est du compteur
+	int64_t low = 0;
+	int64_t high = (int64_t) frameCount;
+	while (low < high) {
+		int64_t middle = (low + high) / 2;
+		if (meterFrames[middle].adco < adco || (meterFrames[middle].adco == adco && meterFrames[middle].frame < frame)) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low > 0 && meterFrames[low - 1].adco == adco ? (int64_t) meterFrames[low - 1].frame : -1;
+}
+
+bool TeleinfoCaptureReader::indexMeters() {
+	return frameCount == 0 || buildMeterFrames();
+}
+
+Teleinfo* TeleinfoCaptureReader::decodeFrame(uint64_t frame, TeleinfoDecoder* teleinfoDecoder) {
+	const TeleinfoCaptureEntry* entry = getEntry(frame);
+	if (entry == NULL) {
+		return NULL;
+	}
+	teleinfoDecoder->reset();
+	uint64_t position = entry->offset;
+	long found = findBlock(rawBlocks, rawBlocksCount, position);
+	while (found >= 0 && found < (long) rawBlocksCount) {
+		Block* raw = &rawBlocks[found];
+		uint64_t index = position - raw->position;
+		unsigned int consumed = 0;
+		Teleinfo* teleinfo = teleinfoDecoder->decode(raw->data + index, raw->length - index, &consumed);
+		if (teleinfo != NULL) {
+			return teleinfo;
+		}
+		position += consumed;
+		found++; // La trame continue dans le bloc suivant
+	}
+	return NULL;
+}
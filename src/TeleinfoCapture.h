@@ -0,0 +1,219 @@
+/**
+ * Déclaration du format de capture indexée du flux Téléinfo
+ *
+ * Un fichier de capture contient les octets bruts du flux, tels que reçus, répartis en blocs,
+ * et un index de chaque trame décodée (position de son STX, date de réception, adresse du compteur).
+ * Il est écrit pendant le décodage du flux et peut être relu par projection en mémoire (mmap) :
+ * la trame N ou la trame reçue à une date donnée est retrouvée par recherche dichotomique
+ * puis seule la portion du flux correspondante est décodée.
+ *
+ * Structure du fichier (entiers dans l'ordre des octets de la machine, tout est aligné sur 8 octets) :
+ *   - en-tête : TELEINFO_CAPTURE_MAGIC (8 octets), version (4 octets), taille des blocs (4 octets)
+ *   - suite de blocs : type (4 octets), longueur des données (4 octets), position (8 octets), données complétées à 8 octets
+ *       - bloc brut : octets du flux, la position est celle du premier octet dans le flux
+ *       - bloc d'index : entrées TeleinfoCaptureEntry, la position est le numéro de la première entrée
+ *
+ * Chaque bloc d'index suit le bloc brut écrit en même temps : une capture interrompue (coupure, arrêt brutal)
+ * reste lisible jusqu'au dernier bloc complet.
+ *
+ * Disponible sur les systèmes POSIX uniquement.
+ * @author LK
+ */
+
+#ifndef TELEINFO_CAPTURE_H_
+#define TELEINFO_CAPTURE_H_
+
+#include "TeleinfoDecoder.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Identifiant d'un fichier de capture Téléinfo
+ */
+#define TELEINFO_CAPTURE_MAGIC        "TICAPT01"
+
+/**
+ * Taille par défaut des blocs d'octets bruts
+ */
+#define TELEINFO_CAPTURE_BLOCK_SIZE   65536
+
+/**
+ * Entrée de l'index : une trame décodée
+ */
+struct TeleinfoCaptureEntry {
+  uint64_t offset;     // Position du STX de la trame dans le flux brut
+  uint64_t timestamp;  // Date de réception du STX, fournie par l'appelant (unité libre, croissante)
+  uint64_t adco;       // Adresse du compteur, voir Teleinfo::getAdcoAsLong()
+};
+
+/**
+ * Ecriture d'une capture, pendant le décodage du flux
+ */
+class TeleinfoCaptureWriter {
+  private:
+    TeleinfoDecoder* teleinfoDecoder;
+    FILE* file;
+    unsigned char* block;
+    unsigned int blockSize;
+    unsigned int blockLength;
+    uint64_t rawOffset;            // Nombre d'octets bruts reçus
+    TeleinfoCaptureEntry* entries; // Entrées en attente d'écriture
+    unsigned int entriesCount;
+    unsigned int entriesCapacity;
+    uint64_t entriesWritten;
+    bool stxSeen;
+    uint64_t stxOffset;
+    uint64_t stxTimestamp;
+
+    bool writeBlock(uint32_t type, const void* data, uint32_t length, uint64_t position);
+
+  public:
+    /**
+     * Création de l'écriture d'une capture
+     * @param teleinfoDecoder le décodeur utilisé pour le décodage du flux capturé
+     */
+    TeleinfoCaptureWriter(TeleinfoDecoder* teleinfoDecoder);
+    ~TeleinfoCaptureWriter();
+
+    /**
+     * Crée le fichier de capture
+     * @return false si le fichier n'a pu être créé
+     */
+    bool open(const char* path, unsigned int blockSize = TELEINFO_CAPTURE_BLOCK_SIZE);
+
+    /**
+     * Capture et décode un bloc d'octets du flux, comme TeleinfoDecoder::decode(buffer, length, consumed).
+     * Seuls les octets consommés sont capturés : les octets restants sont à fournir lors de l'appel suivant.
+     *
+     * @param timestamp la date de réception des octets
+     * @return la trame terminée par le dernier octet consommé, NULL sinon
+     */
+    Teleinfo* capture(const unsigned char* buffer, unsigned int length, unsigned int* consumed, uint64_t timestamp);
+
+    /**
+     * Ecrit les octets et les entrées d'index en attente
+     * @return false en cas d'erreur d'écriture
+     */
+    bool flush();
+
+    /**
+     * Ecrit les données en attente et ferme le fichier
+     * @return false en cas d'erreur d'écriture
+     */
+    bool close();
+
+    /**
+     * Donne le nombre de trames indexées
+     */
+    uint64_t getFrameCount();
+};
+
+/**
+ * Lecture d'une capture par projection en mémoire
+ */
+class TeleinfoCaptureReader {
+  private:
+    /**
+     * Un bloc du fichier
+     */
+    struct Block {
+      uint64_t position;   // Position du premier octet (bloc brut) ou numéro de la première entrée (bloc d'index)
+      uint32_t length;     // Nombre d'octets (bloc brut) ou d'entrées (bloc d'index)
+      const unsigned char* data;
+    };
+
+    /**
+     * Une trame d'un compteur, pour l'index par compteur
+     */
+    struct MeterFrame {
+      uint64_t adco;
+      uint64_t frame;
+    };
+
+    unsigned char* map;
+    size_t mapLength;
+    Block* rawBlocks;
+    unsigned int rawBlocksCount;
+    Block* indexBlocks;
+    unsigned int indexBlocksCount;
+    uint64_t frameCount;
+    uint64_t rawLength;
+    MeterFrame* meterFrames;       // Trames triées par compteur puis par numéro, construit à la première recherche par compteur
+
+    bool addBlock(Block** blocks, unsigned int* count, Block block);
+    long findBlock(Block* blocks, unsigned int count, uint64_t position);
+    bool buildMeterFrames();
+    static int compareMeterFrames(const void* first, const void* second);
+
+  public:
+    TeleinfoCaptureReader();
+    ~TeleinfoCaptureReader();
+
+    /**
+     * Ouvre et projette en mémoire un fichier de capture
+     * @return false si le fichier n'a pu être lu ou n'est pas une capture Téléinfo
+     */
+    bool open(const char* path);
+
+    /**
+     * Ferme le fichier de capture
+     */
+    void close();
+
+    /**
+     * Donne le nombre de trames indexées
+     */
+    uint64_t getFrameCount();
+
+    /**
+     * Donne le nombre d'octets bruts capturés
+     */
+    uint64_t getRawLength();
+
+    /**
+     * Donne l'entrée d'index de la trame N
+     * @return NULL si la trame n'existe pas
+     */
+    const TeleinfoCaptureEntry* getEntry(uint64_t frame);
+
+    /**
+     * Recherche la dernière trame reçue à la date donnée ou avant
+     * @return le numéro de la trame, -1 si aucune
+     */
+    int64_t findFrame(uint64_t timestamp);
+
+    /**
+     * Recherche la dernière trame d'un compteur reçue à la date donnée ou avant
+     *
+     * La première recherche construit un index des trames de chaque compteur (16 octets par trame) ; les suivantes sont
+     * des recherches dichotomiques parmi les trames du compteur.
+     * @param adco l'adresse du compteur, voir Teleinfo::getAdcoAsLong()
+     * @return le numéro de la trame, -1 si aucune
+     */
+    int64_t findFrame(uint64_t timestamp, uint64_t adco);
+
+    /**
+     * Recherche la dernière trame d'un compteur qui précède la trame N, par l'index des trames de chaque compteur
+     * @param adco l'adresse du compteur, voir Teleinfo::getAdcoAsLong()
+     * @return le numéro de la trame, -1 si aucune
+     */
+    int64_t findPreviousFrame(uint64_t frame, uint64_t adco);
+
+    /**
+     * Construit l'index des trames de chaque compteur sans attendre la première recherche par compteur.
+     * La construction n'est pas protégée : à appeler avant des recherches faites en parallèle par plusieurs threads.
+     * @return false si la mémoire est insuffisante
+     */
+    bool indexMeters();
+
+    /**
+     * Décode la trame N : seuls les octets bruts de cette trame sont décodés
+     *
+     * @param teleinfoDecoder le décodeur à utiliser, la trame qu'il décodait éventuellement est abandonnée
+     * @return la trame, NULL si elle n'existe pas ou ne peut être décodée
+     */
+    Teleinfo* decodeFrame(uint64_t frame, TeleinfoDecoder* teleinfoDecoder);
+};
+
+#endif  // TELEINFO_CAPTURE_H_
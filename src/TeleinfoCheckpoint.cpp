@@ -0,0 +1,381 @@
+/**
+ * Implémentation des points de reprise d'une passerelle Téléinfo
+ *
+ * @author LK
+ */
+#include "TeleinfoCheckpoint.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*********************************************************************************************************************************************************************
+  CONSTANTES
+ *********************************************************************************************************************************************************************/
+
+#define TELEINFO_CHECKPOINT_VERSION       1
+#define TELEINFO_CHECKPOINT_HEADER_SIZE   4096
+#define TELEINFO_CHECKPOINT_PAGE_SIZE     4096
+
+/**
+ * En-tête d'un emplacement
+ */
+struct TeleinfoCheckpointSlot {
+	uint64_t sequence;   // 0 si l'emplacement n'a jamais été écrit
+	uint64_t length;
+	uint64_t checksum;
+	uint64_t reserved;
+};
+
+/**
+ * En-tête d'une section
+ */
+struct TeleinfoCheckpointSection {
+	uint32_t type;
+	uint32_t count;
+	uint64_t length;
+};
+
+/**
+ * Arrondi d'une longueur au multiple de 8 supérieur
+ */
+static uint64_t align8(uint64_t length) {
+	return (length + 7) & ~((uint64_t) 7);
+}
+
+/*********************************************************************************************************************************************************************
+  POINTS DE REPRISE
+ *********************************************************************************************************************************************************************/
+
+TeleinfoCheckpoint::TeleinfoCheckpoint(const char* path, uint64_t interval) {
+	this->path = strdup(path);
+	this->interval = interval;
+	fd = -1;
+	map = NULL;
+	slotSize = 0;
+	sequence = 0;
+	lastSave = 0;
+	sectionsCount = 0;
+}
+
+TeleinfoCheckpoint::~TeleinfoCheckpoint() {
+	closeFile();
+	free(path);
+}
+
+bool TeleinfoCheckpoint::addDecoders(TeleinfoDecoder** decoders, unsigned int count) {
+	// Le point de reprise peut être écrit pendant la réception d'une trame : la dernière trame est copiée à chaque ETX
+	for (unsigned int i = 0; i < count; i++) {
+		decoders[i]->setOptions(decoders[i]->getOptions() | TELEINFO_OPTION_KEEP_LAST_FRAME);
+	}
+	return addSection(TELEINFO_CHECKPOINT_DECODERS, count, decoders);
+}
+
+bool TeleinfoCheckpoint::addAggregator(TeleinfoAggregator* aggregator) {
+	return addSection(TELEINFO_CHECKPOINT_AGGREGATOR, 1, aggregator);
+}
+
+bool TeleinfoCheckpoint::addTariff(TeleinfoTariff* tariff) {
+	return addSection(TELEINFO_CHECKPOINT_TARIFF, 1, tariff);
+}
+
+bool TeleinfoCheckpoint::addRegistry(TeleinfoRegistry* registry) {
+	return addSection(TELEINFO_CHECKPOINT_REGISTRY, 1, registry);
+}
+
+bool TeleinfoCheckpoint::restore() {
+	if (!openFile(0) || sequence == 0) {
+		return false;
+	}
+	TeleinfoCheckpointSlot* header = (TeleinfoCheckpointSlot*) getSlot(sequence & 1); // Vérifié par openFile(...)
+	unsigned char* data = (unsigned char*) (header + 1);
+
+	// Vérification de toutes les sections avant de modifier le moindre objet
+	uint64_t offset = 0;
+	for (unsigned int i = 0; i < sectionsCount; i++) {
+		TeleinfoCheckpointSection* section = (TeleinfoCheckpointSection*) (data + offset);
+		if (offset + sizeof(TeleinfoCheckpointSection) > header->length
+				|| section->type != sections[i].type
+				|| section->count != sections[i].count
+				|| section->length != getSectionSize(&sections[i])) {
+			return false;
+		}
+		offset += sizeof(TeleinfoCheckpointSection) + align8(section->length);
+	}
+	if (offset != header->length) {
+		return false;
+	}
+
+	// Restauration
+	offset = 0;
+	for (unsigned int i = 0; i < sectionsCount; i++) {
+		TeleinfoCheckpointSection* section = (TeleinfoCheckpointSection*) (data + offset);
+		unsigned char* state = (unsigned char*) (section + 1);
+		switch (section->type) {
+			case TELEINFO_CHECKPOINT_DECODERS : {
+				TeleinfoDecoder** decoders = (TeleinfoDecoder**) sections[i].object;
+				uint64_t stride = section->count > 0 ? section->length / section->count : 0;
+				for (unsigned int decoder = 0; decoder < section->count; decoder++) {
+					decoders[decoder]->restoreState(state + decoder * stride, stride);
+				}
+				break;
+			}
+			case TELEINFO_CHECKPOINT_AGGREGATOR :
+				((TeleinfoAggregator*) sections[i].object)->restoreState(state, section->length);
+				break;
+			case TELEINFO_CHECKPOINT_TARIFF :
+				((TeleinfoTariff*) sections[i].object)->restoreState(state, section->length);
+				break;
+			case TELEINFO_CHECKPOINT_REGISTRY :
+				((TeleinfoRegistry*) sections[i].object)->restoreState(state, section->length);
+				break;
+		}
+		offset += sizeof(TeleinfoCheckpointSection) + align8(section->length);
+	}
+	return true;
+}
+
+bool TeleinfoCheckpoint::save() {
+	uint64_t length = getPayloadSize();
+	uint64_t required = sizeof(TeleinfoCheckpointSlot) + length;
+	required = (required + TELEINFO_CHECKPOINT_PAGE_SIZE - 1) / TELEINFO_CHECKPOINT_PAGE_SIZE * TELEINFO_CHECKPOINT_PAGE_SIZE;
+	if (!openFile(required)) {
+		return false;
+	}
+
+	// Ecriture dans l'emplacement le plus ancien
+	uint64_t next = sequence + 1;
+	unsigned char* slot = getSlot(next & 1);
+	unsigned char* data = slot + sizeof(TeleinfoCheckpointSlot);
+	uint64_t offset = 0;
+	for (unsigned int i = 0; i < sectionsCount; i++) {
+		TeleinfoCheckpointSection* section = (TeleinfoCheckpointSection*) (data + offset);
+		unsigned char* state = (unsigned char*) (section + 1);
+		section->type = sections[i].type;
+		section->count = sections[i].count;
+		section->length = getSectionSize(&sections[i]);
+		switch (section->type) {
+			case TELEINFO_CHECKPOINT_DECODERS : {
+				TeleinfoDecoder** decoders = (TeleinfoDecoder**) sections[i].object;
+				uint64_t stride = section->count > 0 ? section->length / section->count : 0;
+				for (unsigned int decoder = 0; decoder < section->count; decoder++) {
+					decoders[decoder]->saveState(state + decoder * stride);
+				}
+				break;
+			}
+			case TELEINFO_CHECKPOINT_AGGREGATOR :
+				((TeleinfoAggregator*) sections[i].object)->saveState(state);
+				break;
+			case TELEINFO_CHECKPOINT_TARIFF :
+				((TeleinfoTariff*) sections[i].object)->saveState(state);
+				break;
+			case TELEINFO_CHECKPOINT_REGISTRY :
+				((TeleinfoRegistry*) sections[i].object)->saveState(state);
+				break;
+		}
+		memset(state + section->length, 0, align8(section->length) - section->length);
+		offset += sizeof(TeleinfoCheckpointSection) + align8(section->length);
+	}
+
+	// Les données sont sur disque avant l'en-tête qui les valide
+	if (msync(slot, sizeof(TeleinfoCheckpointSlot) + length, MS_SYNC) != 0) {
+		return false;
+	}
+	TeleinfoCheckpointSlot* header = (TeleinfoCheckpointSlot*) slot;
+	header->length = length;
+	header->checksum = hash(next, length, data);
+	header->reserved = 0;
+	header->sequence = next;
+	if (msync(slot, sizeof(TeleinfoCheckpointSlot), MS_SYNC) != 0) {
+		return false;
+	}
+	sequence = next;
+	return true;
+}
+
+bool TeleinfoCheckpoint::tick(uint64_t now) {
+	if (now < lastSave + interval) {
+		return false;
+	}
+	lastSave = now;
+	return save();
+}
+
+uint64_t TeleinfoCheckpoint::getSequence() {
+	return sequence;
+}
+
+bool TeleinfoCheckpoint::addSection(uint32_t type, uint32_t count, void* object) {
+	if (sectionsCount >= TELEINFO_CHECKPOINT_SECTIONS || object == NULL) {
+		return false;
+	}
+	sections[sectionsCount].type = type;
+	sections[sectionsCount].count = count;
+	sections[sectionsCount].object = object;
+	sectionsCount++;
+	return true;
+}
+
+/**
+ * Taille de l'état des objets d'une section (sans son en-tête)
+ */
+uint64_t TeleinfoCheckpoint::getSectionSize(Section* section) {
+	switch (section->type) {
+		case TELEINFO_CHECKPOINT_DECODERS :
+			return section->count > 0 ? (uint64_t) section->count * ((TeleinfoDecoder**) section->object)[0]->getStateSize() : 0;
+		case TELEINFO_CHECKPOINT_AGGREGATOR :
+			return ((TeleinfoAggregator*) section->object)->getStateSize();
+		case TELEINFO_CHECKPOINT_TARIFF :
+			return ((TeleinfoTariff*) section->object)->getStateSize();
+		case TELEINFO_CHECKPOINT_REGISTRY :
+			return ((TeleinfoRegistry*) section->object)->getStateSize();
+		default :
+			return 0;
+	}
+}
+
+/**
+ * Taille des données d'un point de reprise (sections et leurs en-têtes)
+ */
+uint64_t TeleinfoCheckpoint::getPayloadSize() {
+	uint64_t length = 0;
+	for (unsigned int i = 0; i < sectionsCount; i++) {
+		length += sizeof(TeleinfoCheckpointSection) + align8(getSectionSize(&sections[i]));
+	}
+	return length;
+}
+
+/**
+ * Ouverture et projection du fichier
+ *
+ * @param requiredSlotSize la taille d'emplacement attendue : le fichier est créé, ou recréé s'il est invalide ou d'une autre taille ;
+ *        0 pour ouvrir le fichier existant tel quel
+ */
+bool TeleinfoCheckpoint::openFile(uint64_t requiredSlotSize) {
+	if (map != NULL) {
+		if (requiredSlotSize == 0 || requiredSlotSize == slotSize) {
+			return true;
+		}
+		closeFile();
+	}
+	fd = ::open(path, requiredSlotSize != 0 ? O_RDWR | O_CREAT : O_RDWR, 0644);
+	if (fd < 0) {
+		return false;
+	}
+
+	// Lecture de l'en-tête
+	unsigned char header[24];
+	uint32_t version = 0;
+	uint64_t size = 0;
+	struct stat status;
+	if (fstat(fd, &status) == 0 && pread(fd, header, sizeof(header), 0) == sizeof(header)) {
+		memcpy(&version, header + 8, 4);
+		memcpy(&size, header + 16, 8);
+		if (memcmp(header, TELEINFO_CHECKPOINT_MAGIC, 8) != 0 || version != TELEINFO_CHECKPOINT_VERSION
+				|| size == 0 || (uint64_t) status.st_size != TELEINFO_CHECKPOINT_HEADER_SIZE + 2 * size) {
+			size = 0;
+		}
+	}
+
+	// Création du fichier
+	if (size == 0 || (requiredSlotSize != 0 && size != requiredSlotSize)) {
+		if (requiredSlotSize == 0) {
+			closeFile();
+			return false;
+		}
+		size = requiredSlotSize;
+		version = TELEINFO_CHECKPOINT_VERSION;
+		memset(header, 0, sizeof(header));
+		memcpy(header, TELEINFO_CHECKPOINT_MAGIC, 8);
+		memcpy(header + 8, &version, 4);
+		memcpy(header + 16, &size, 8);
+		if (ftruncate(fd, 0) != 0 || ftruncate(fd, TELEINFO_CHECKPOINT_HEADER_SIZE + 2 * size) != 0
+				|| pwrite(fd, header, sizeof(header), 0) != sizeof(header) || fsync(fd) != 0) {
+			closeFile();
+			return false;
+		}
+	}
+
+	int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+	flags |= MAP_POPULATE; // Chargement du fichier en une fois, plutôt que page par page
+#endif
+	void* projection = mmap(NULL, TELEINFO_CHECKPOINT_HEADER_SIZE + 2 * size, PROT_READ | PROT_WRITE, flags, fd, 0);
+	if (projection == MAP_FAILED) {
+		closeFile();
+		return false;
+	}
+	map = (unsigned char*) projection;
+	slotSize = size;
+
+	// La numérotation reprend après le dernier point de reprise du fichier
+	int slot = getNewestSlot();
+	sequence = slot >= 0 ? ((TeleinfoCheckpointSlot*) getSlot(slot))->sequence : 0;
+	return true;
+}
+
+void TeleinfoCheckpoint::closeFile() {
+	if (map != NULL) {
+		munmap(map, TELEINFO_CHECKPOINT_HEADER_SIZE + 2 * slotSize);
+		map = NULL;
+	}
+	if (fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+	slotSize = 0;
+}
+
+/**
+ * Donne l'emplacement valide le plus récent, -1 si aucun.
+ * La somme de contrôle de l'emplacement le plus ancien n'est calculée que si le plus récent est invalide.
+ */
+int TeleinfoCheckpoint::getNewestSlot() {
+	TeleinfoCheckpointSlot* headers[2] = { (TeleinfoCheckpointSlot*) getSlot(0), (TeleinfoCheckpointSlot*) getSlot(1) };
+	int newest = headers[1]->sequence > headers[0]->sequence ? 1 : 0;
+	for (int slot = newest, i = 0; i < 2; slot = 1 - slot, i++) {
+		TeleinfoCheckpointSlot* header = headers[slot];
+		if (header->sequence != 0
+				&& header->length <= slotSize - sizeof(TeleinfoCheckpointSlot) && header->length % 8 == 0
+				&& header->checksum == hash(header->sequence, header->length, (unsigned char*) (header + 1))) {
+			return slot;
+		}
+	}
+	return -1;
+}
+
+unsigned char* TeleinfoCheckpoint::getSlot(int slot) {
+	return map + TELEINFO_CHECKPOINT_HEADER_SIZE + slot * slotSize;
+}
+
+/**
+ * Somme de contrôle d'un emplacement, calculée par mots de 8 octets (length multiple de 8)
+ * sur quatre accumulateurs indépendants, pour ne pas attendre le résultat de chaque multiplication
+ */
+uint64_t TeleinfoCheckpoint::hash(uint64_t sequence, uint64_t length, const unsigned char* data) {
+	uint64_t lanes[4] = { sequence, length, 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL };
+	uint64_t i = 0;
+	for (; i + 32 <= length; i += 32) {
+		for (int lane = 0; lane < 4; lane++) {
+			uint64_t word;
+			memcpy(&word, data + i + lane * 8, 8);
+			lanes[lane] = (lanes[lane] ^ word) * 0x100000001B3ULL;
+			lanes[lane] ^= lanes[lane] >> 32;
+		}
+	}
+	for (; i < length; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		lanes[0] = (lanes[0] ^ word) * 0x100000001B3ULL;
+		lanes[0] ^= lanes[0] >> 32;
+	}
+	uint64_t hash = 0;
+	for (int lane = 0; lane < 4; lane++) {
+		hash = (hash ^ lanes[lane]) * 0x9E3779B97F4A7C15ULL;
+		hash ^= hash >> 29;
+	}
+	return hash;
+}
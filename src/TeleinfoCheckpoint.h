@@ -0,0 +1,144 @@
+/**
+ * Déclaration des points de reprise d'une passerelle Téléinfo
+ *
+ * Un point de reprise est une copie de l'état des décodeurs (dernière trame valide, offset de l'index total,
+ * derniers index, compteurs d'activité), des agrégateurs, des comptabilités et du registre des compteurs.
+ * Il est écrit périodiquement dans un fichier projeté en mémoire (mmap) et relu au démarrage : la passerelle
+ * repart de son dernier état sans attendre de nouvelles trames ni recalculer les agrégats.
+ *
+ * Structure du fichier (entiers dans l'ordre des octets de la machine, tout est aligné sur 8 octets) :
+ *   - en-tête (une page de 4096 octets) : TELEINFO_CHECKPOINT_MAGIC (8 octets), version (4 octets),
+ *     réservé (4 octets), taille d'un emplacement (8 octets)
+ *   - deux emplacements, écrits en alternance : numéro de séquence (8 octets), longueur des données (8 octets),
+ *     somme de contrôle de la séquence, de la longueur et des données (8 octets), réservé (8 octets), puis les sections
+ *   - section : type (4 octets), nombre d'objets (4 octets), longueur (8 octets), état des objets complété à 8 octets
+ *
+ * Un point de reprise est écrit dans l'emplacement le plus ancien : données, synchronisation, en-tête, synchronisation.
+ * Un arrêt brutal pendant l'écriture laisse un emplacement dont la somme de contrôle est fausse : la restauration
+ * utilise alors l'autre emplacement, le point de reprise précédent.
+ *
+ * Disponible sur les systèmes POSIX uniquement.
+ * @author LK
+ */
+
+#ifndef TELEINFO_CHECKPOINT_H_
+#define TELEINFO_CHECKPOINT_H_
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoAggregator.h"
+#include "TeleinfoTariff.h"
+#include "TeleinfoRegistry.h"
+
+#include <stdint.h>
+
+/**
+ * Identifiant d'un fichier de points de reprise
+ */
+#define TELEINFO_CHECKPOINT_MAGIC         "TICKPT01"
+
+/**
+ * Nombre maximal de sections d'un point de reprise
+ */
+#ifndef TELEINFO_CHECKPOINT_SECTIONS
+#define TELEINFO_CHECKPOINT_SECTIONS      16
+#endif
+
+/* Types de section */
+#define TELEINFO_CHECKPOINT_DECODERS      1
+#define TELEINFO_CHECKPOINT_AGGREGATOR    2
+#define TELEINFO_CHECKPOINT_TARIFF        3
+#define TELEINFO_CHECKPOINT_REGISTRY      4
+
+/**
+ * Points de reprise d'une passerelle : les objets à sauvegarder sont déclarés une fois, dans le même ordre
+ * à chaque démarrage, puis restaurés par restore() et sauvegardés par save() ou tick(...)
+ */
+class TeleinfoCheckpoint {
+  private:
+    struct Section {
+      uint32_t type;
+      uint32_t count;
+      void* object;                // TeleinfoDecoder** pour TELEINFO_CHECKPOINT_DECODERS, l'objet sinon
+    };
+
+    char* path;
+    int fd;
+    unsigned char* map;
+    uint64_t slotSize;
+    uint64_t sequence;             // Numéro du dernier point de reprise écrit, 0 si aucun
+    uint64_t interval;
+    uint64_t lastSave;
+    Section sections[TELEINFO_CHECKPOINT_SECTIONS];
+    unsigned int sectionsCount;
+
+    bool addSection(uint32_t type, uint32_t count, void* object);
+    uint64_t getSectionSize(Section* section);
+    uint64_t getPayloadSize();
+    bool openFile(uint64_t requiredSlotSize);
+    void closeFile();
+    int getNewestSlot();
+    unsigned char* getSlot(int slot);
+    static uint64_t hash(uint64_t sequence, uint64_t length, const unsigned char* data);
+
+  public:
+    /**
+     * Création des points de reprise
+     * @param path le chemin du fichier
+     * @param interval la durée minimale entre deux points de reprise écrits par tick(...) (unité de la date passée à tick(...))
+     */
+    TeleinfoCheckpoint(const char* path, uint64_t interval);
+    ~TeleinfoCheckpoint();
+
+    /**
+     * Déclare des décodeurs à sauvegarder ; l'option TELEINFO_OPTION_KEEP_LAST_FRAME leur est ajoutée
+     * @return false si le nombre maximal de sections est atteint
+     */
+    bool addDecoders(TeleinfoDecoder** decoders, unsigned int count);
+
+    /**
+     * Déclare un agrégateur à sauvegarder
+     * @return false si le nombre maximal de sections est atteint
+     */
+    bool addAggregator(TeleinfoAggregator* aggregator);
+
+    /**
+     * Déclare une comptabilité à sauvegarder
+     * @return false si le nombre maximal de sections est atteint
+     */
+    bool addTariff(TeleinfoTariff* tariff);
+
+    /**
+     * Déclare un registre des compteurs à sauvegarder
+     * @return false si le nombre maximal de sections est atteint
+     */
+    bool addRegistry(TeleinfoRegistry* registry);
+
+    /**
+     * Restaure le dernier point de reprise valide du fichier.
+     * Les sections du fichier doivent correspondre aux objets déclarés (même ordre, même type, même nombre d'objets,
+     * même taille) : sinon aucun objet n'est modifié.
+     *
+     * @return false si le fichier est absent ou illisible, sans point de reprise valide, ou s'il ne correspond pas
+     */
+    bool restore();
+
+    /**
+     * Ecrit un point de reprise. Le fichier est créé (ou recréé si les objets déclarés ont changé de taille) au besoin.
+     * @return false en cas d'erreur d'écriture
+     */
+    bool save();
+
+    /**
+     * Ecrit un point de reprise si le dernier date d'au moins interval
+     * @param now la date (unité libre, croissante)
+     * @return true si un point de reprise a été écrit
+     */
+    bool tick(uint64_t now);
+
+    /**
+     * Donne le numéro du dernier point de reprise écrit ou restauré, 0 si aucun
+     */
+    uint64_t getSequence();
+};
+
+#endif  // TELEINFO_CHECKPOINT_H_
@@ -0,0 +1,730 @@
+/**
+ * Implémentation du codec de compression du flux Téléinfo brut
+ *
+ * @author LK
+ */
+#include "TeleinfoCodec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*********************************************************************************************************************************************************************
+  CONSTANTES
+ *********************************************************************************************************************************************************************/
+
+/* Caractères spéciaux du protocole TeleInfo */
+#define TELEINFO_CHAR_STX            0x02  // Start of Text
+#define TELEINFO_CHAR_ETX            0x03  // End of Text
+#define TELEINFO_CHAR_LF             0x0A  // Groupe Feed
+#define TELEINFO_CHAR_CR             0x0D  // Carriage return
+#define TELEINFO_CHAR_SPACE          0x20  // Space
+
+/* Codes des opérations */
+#define CODEC_OP_SAME                0x00
+#define CODEC_OP_DELTA               0x40
+#define CODEC_OP_VALUE               0x80
+#define CODEC_OP_NEW                 0xC0
+#define CODEC_OP_STX                 0xC1
+#define CODEC_OP_ETX                 0xC2
+#define CODEC_OP_PARITY              0xC3
+#define CODEC_OP_LITERAL             0xC3  // + nombre d'octets bruts (1 à CODEC_LITERAL_MAX)
+#define CODEC_LITERAL_MAX            60
+
+/* Nombre maximal de chiffres d'une donnée codée par écart numérique */
+#define CODEC_DIGITS_MAX             18
+
+/* En-tête d'un bloc compressé : nombre d'octets d'opérations et longueur du code, sur 2 octets chacun */
+#define CODEC_BLOCK_HEADER           4
+
+/*
+ * Taille maximale du code d'un bloc : un octet d'opération est codé par 8 décisions binaires,
+ * chacune coûtant au plus log2(2048 / 31), soit ~6 bits, pour la plus faible probabilité atteignable
+ */
+#define CODEC_CODE_MAX               (TELEINFO_CODEC_BLOCK_SIZE * 7 + 16)
+
+/* Codeur arithmétique binaire : probabilités sur 11 bits, adaptées d'1/32 à chaque décision */
+#define CODEC_PROBABILITY_BITS       11
+#define CODEC_PROBABILITY_INIT       (1 << (CODEC_PROBABILITY_BITS - 1))
+#define CODEC_ADAPT_BITS             5
+#define CODEC_RANGE_TOP              (1u << 24)
+
+/*
+ * Contextes du codage des opérations : les codes 0x00 à 0xBF (opérations d'une étiquette connue) et un contexte commun
+ * aux autres codes, chacun pour l'octet de code suivant et pour les 3 premières positions dans l'opération
+ */
+#define CODEC_CONTEXTS               (CODEC_OP_NEW + 1)
+#define CODEC_CONTEXT_POSITIONS      4
+
+/* Partie attendue de l'opération en cours */
+#define CODEC_TOKEN_CODE             0
+#define CODEC_TOKEN_VARINT           1
+#define CODEC_TOKEN_LENGTH           2
+#define CODEC_TOKEN_BYTES            3
+
+/**
+ * Donne le caractère avec son bit de parité paire (bit 7)
+ */
+static unsigned char evenParity(unsigned char character) {
+	unsigned char ones = character & 0x7F;
+	ones ^= ones >> 4;
+	ones ^= ones >> 2;
+	ones ^= ones >> 1;
+	return (character & 0x7F) | ((ones & 1) << 7);
+}
+
+/**
+ * Indique si une donnée n'est composée que de chiffres et peut être codée par un écart numérique
+ */
+static bool isNumeric(const char* donnee, unsigned int length) {
+	if (length == 0 || length > CODEC_DIGITS_MAX) {
+		return false;
+	}
+	for (unsigned int i = 0; i < length; i++) {
+		if (donnee[i] < '0' || donnee[i] > '9') {
+			return false;
+		}
+	}
+	return true;
+}
+
+static unsigned long long parseNumeric(const char* donnee, unsigned int length) {
+	unsigned long long value = 0;
+	for (unsigned int i = 0; i < length; i++) {
+		value = value * 10 + (donnee[i] - '0');
+	}
+	return value;
+}
+
+/*********************************************************************************************************************************************************************
+  MODELE
+ *********************************************************************************************************************************************************************/
+
+TeleinfoCodecModel::TeleinfoCodecModel() {
+	labelsCount = 0;
+	lastLabel = 0;
+	parity = false;
+
+	unsigned int count = CODEC_CONTEXTS * CODEC_CONTEXT_POSITIONS * 256;
+	probabilities = (unsigned short*) malloc(count * sizeof(unsigned short));
+	for (unsigned int i = 0; i < count; i++) {
+		probabilities[i] = CODEC_PROBABILITY_INIT;
+	}
+	tokenState = CODEC_TOKEN_CODE;
+	tokenOperation = CODEC_OP_ETX;
+	lastOperation = CODEC_OP_ETX;
+	tokenPosition = 0;
+	tokenRemaining = 0;
+	tokenFields = 0;
+}
+
+TeleinfoCodecModel::~TeleinfoCodecModel() {
+	free(probabilities);
+}
+
+int TeleinfoCodecModel::findLabel(const char* etiquette, unsigned int length) {
+	// Les étiquettes se suivent dans le même ordre d'une trame à l'autre : la suivante de la dernière est testée en premier
+	for (unsigned int i = 0; i < labelsCount; i++) {
+		unsigned int label = (lastLabel + 1 + i) % labelsCount;
+		if (labels[label].etiquetteLength == length && memcmp(labels[label].etiquette, etiquette, length) == 0) {
+			lastLabel = label;
+			return label;
+		}
+	}
+	return -1;
+}
+
+void TeleinfoCodecModel::addLabel(const char* etiquette, unsigned int etiquetteLength, const char* donnee, unsigned int donneeLength) {
+	if (labelsCount < TELEINFO_CODEC_LABELS) {
+		memcpy(labels[labelsCount].etiquette, etiquette, etiquetteLength);
+		labels[labelsCount].etiquetteLength = etiquetteLength;
+		lastLabel = labelsCount;
+		setDonnee(labelsCount++, donnee, donneeLength);
+	}
+}
+
+void TeleinfoCodecModel::setDonnee(unsigned int label, const char* donnee, unsigned int length) {
+	memcpy(labels[label].donnee, donnee, length);
+	labels[label].donneeLength = length;
+}
+
+unsigned short* TeleinfoCodecModel::getProbabilities() {
+	unsigned int context;
+	unsigned int position;
+	if (tokenState == CODEC_TOKEN_CODE) {
+		context = lastOperation;
+		position = 0;
+	} else {
+		context = tokenOperation;
+		position = 1 + (tokenPosition < CODEC_CONTEXT_POSITIONS - 2 ? tokenPosition : CODEC_CONTEXT_POSITIONS - 2);
+	}
+	if (context > CODEC_OP_NEW) {
+		context = CODEC_OP_NEW;
+	}
+	return probabilities + (context * CODEC_CONTEXT_POSITIONS + position) * 256;
+}
+
+void TeleinfoCodecModel::nextToken(unsigned char token) {
+	switch (tokenState) {
+	case CODEC_TOKEN_CODE:
+		tokenOperation = token;
+		tokenPosition = 0;
+		if (token >= CODEC_OP_DELTA && token < CODEC_OP_VALUE) {
+			tokenState = CODEC_TOKEN_VARINT;
+		} else if (token >= CODEC_OP_VALUE && token <= CODEC_OP_NEW) {
+			tokenState = CODEC_TOKEN_LENGTH;
+			tokenFields = token == CODEC_OP_NEW ? 2 : 1;
+		} else if (token > CODEC_OP_LITERAL) {
+			tokenState = CODEC_TOKEN_BYTES;
+			tokenRemaining = token - CODEC_OP_LITERAL;
+			tokenFields = 0;
+		} else {
+			lastOperation = token;
+		}
+		return;
+
+	case CODEC_TOKEN_VARINT:
+		if ((token & 0x80) == 0) {
+			tokenState = CODEC_TOKEN_CODE;
+		}
+		break;
+
+	case CODEC_TOKEN_LENGTH:
+		tokenFields--;
+		tokenRemaining = token;
+		if (token > 0) {
+			tokenState = CODEC_TOKEN_BYTES;
+		} else if (tokenFields == 0) {
+			tokenState = CODEC_TOKEN_CODE;
+		}
+		break;
+
+	default:
+		if (--tokenRemaining == 0) {
+			tokenState = tokenFields > 0 ? CODEC_TOKEN_LENGTH : CODEC_TOKEN_CODE;
+		}
+		break;
+	}
+	tokenPosition++;
+	if (tokenState == CODEC_TOKEN_CODE) {
+		lastOperation = tokenOperation;
+	}
+}
+
+bool TeleinfoCodecModel::isTokenBoundary() {
+	return tokenState == CODEC_TOKEN_CODE;
+}
+
+/*********************************************************************************************************************************************************************
+  COMPRESSION
+ *********************************************************************************************************************************************************************/
+
+TeleinfoCompressor::TeleinfoCompressor() {
+	tokens = (unsigned char*) malloc(TELEINFO_CODEC_BLOCK_SIZE);
+	tokensLength = 0;
+	encoded = (unsigned char*) malloc(CODEC_BLOCK_HEADER + CODEC_CODE_MAX);
+	encodedLength = 0;
+	encodedPosition = 0;
+	low = 0;
+	range = 0xFFFFFFFF;
+	cache = 0;
+	cacheSize = 1;
+}
+
+TeleinfoCompressor::~TeleinfoCompressor() {
+	free(tokens);
+	free(encoded);
+}
+
+unsigned int TeleinfoCompressor::compress(const unsigned char* input, unsigned int length, unsigned int* consumed, unsigned char* output, unsigned int capacity, bool flush) {
+	unsigned int index = 0;
+	unsigned int written = 0;
+
+	while (true) {
+		// Sortie du bloc compressé en attente
+		if (encodedPosition < encodedLength) {
+			unsigned int count = encodedLength - encodedPosition;
+			if (count > capacity - written) {
+				count = capacity - written;
+			}
+			memcpy(output + written, encoded + encodedPosition, count);
+			written += count;
+			encodedPosition += count;
+			if (encodedPosition < encodedLength) {
+				break; // Tampon de sortie plein
+			}
+		}
+
+		if (index < length) {
+			index += tokenize(input + index, length - index, flush);
+		}
+		if (TELEINFO_CODEC_BLOCK_SIZE - tokensLength < TELEINFO_CODEC_OPERATION_MAX || (flush && index == length && tokensLength > 0)) {
+			encodeBlock();
+		} else {
+			break; // La suite du flux est attendue lors de l'appel suivant
+		}
+	}
+	if (consumed != NULL) {
+		*consumed = index;
+	}
+	return written;
+}
+
+unsigned int TeleinfoCompressor::tokenize(const unsigned char* input, unsigned int length, bool flush) {
+	unsigned int index = 0;
+	unsigned int literal = 0;   // Position du code de la suite d'octets bruts en cours
+	unsigned int literalCount = 0;
+
+	while (index < length && TELEINFO_CODEC_BLOCK_SIZE - tokensLength >= TELEINFO_CODEC_OPERATION_MAX) {
+		unsigned char character = input[index];
+		unsigned int operationLength = 0;
+		unsigned char operation[TELEINFO_CODEC_OPERATION_MAX];
+
+		if ((character & 0x7F) == TELEINFO_CHAR_LF) {
+			unsigned int groupeLength = 0;
+			bool groupeParity = parity;
+			int groupe = parseGroupe(input + index, length - index, &groupeLength, &groupeParity);
+			if (groupe == GROUPE_INCOMPLET && !flush) {
+				break; // La suite du groupe est attendue lors de l'appel suivant
+			}
+			// Un groupe valide ne peut dépasser les octets fournis ; sinon, il est traité comme des octets bruts
+			if (groupe == GROUPE_VALIDE && groupeLength > 0 && groupeLength <= length - index) {
+				if (groupeParity != parity) {
+					operation[operationLength++] = CODEC_OP_PARITY;
+					parity = groupeParity;
+				}
+				operationLength += encodeGroupe(input + index, groupeLength, operation + operationLength);
+				index += groupeLength;
+			}
+		} else if (character == (parity ? evenParity(TELEINFO_CHAR_STX) : TELEINFO_CHAR_STX)) {
+			operation[operationLength++] = CODEC_OP_STX;
+			index++;
+		} else if (character == (parity ? evenParity(TELEINFO_CHAR_ETX) : TELEINFO_CHAR_ETX)) {
+			operation[operationLength++] = CODEC_OP_ETX;
+			index++;
+		}
+
+		if (operationLength > 0) {
+			if (literalCount > 0) {
+				tokens[literal] = CODEC_OP_LITERAL + literalCount;
+				literalCount = 0;
+			}
+			memcpy(tokens + tokensLength, operation, operationLength);
+			tokensLength += operationLength;
+		} else {
+			// Octet brut, ajouté à la suite en cours
+			if (literalCount == 0) {
+				literal = tokensLength++;
+			}
+			tokens[tokensLength++] = character;
+			index++;
+			if (++literalCount == CODEC_LITERAL_MAX) {
+				tokens[literal] = CODEC_OP_LITERAL + literalCount;
+				literalCount = 0;
+			}
+		}
+	}
+	if (literalCount > 0) {
+		tokens[literal] = CODEC_OP_LITERAL + literalCount;
+	}
+	return index;
+}
+
+int TeleinfoCompressor::parseGroupe(const unsigned char* input, unsigned int length, unsigned int* groupeLength, bool* groupeParity) {
+	// LF étiquette SP donnée SP checksum CR
+	unsigned int index = 1;
+	unsigned int etiquetteLength = 0;
+	unsigned int donneeLength = 0;
+	unsigned int sum = TELEINFO_CHAR_SPACE;
+	int field = 0; // 0 : étiquette, 1 : donnée, 2 : checksum, 3 : CR attendu
+	bool sevenBits = (input[0] & 0x80) == 0;
+	bool even = input[0] == evenParity(input[0]);
+
+	while (index < length) {
+		unsigned char character = input[index];
+		unsigned char value = character & 0x7F;
+		sevenBits = sevenBits && (character & 0x80) == 0;
+		even = even && character == evenParity(character);
+		index++;
+
+		if (field == 0 || field == 1) {
+			if (value == TELEINFO_CHAR_SPACE) {
+				if (field == 0 && etiquetteLength == 0) {
+					return GROUPE_INVALIDE;
+				}
+				field++;
+			} else if (value > TELEINFO_CHAR_SPACE && value < 0x7F) {
+				unsigned int* fieldLength = field == 0 ? &etiquetteLength : &donneeLength;
+				if (++(*fieldLength) > (field == 0 ? TELEINFO_CODEC_ETIQUETTE_MAX : TELEINFO_CODEC_DONNEE_MAX)) {
+					return GROUPE_INVALIDE;
+				}
+				sum += value;
+			} else {
+				return GROUPE_INVALIDE;
+			}
+		} else if (field == 2) {
+			if (value != ((sum & 0x3F) + 0x20)) {
+				return GROUPE_INVALIDE;
+			}
+			field++;
+		} else {
+			if (value != TELEINFO_CHAR_CR) {
+				return GROUPE_INVALIDE;
+			}
+			// Le mode de parité en cours est conservé s'il convient, sinon il est basculé
+			if ((*groupeParity && even) || (!*groupeParity && sevenBits)) {
+				// Mode inchangé
+			} else if (even) {
+				*groupeParity = true;
+			} else if (sevenBits) {
+				*groupeParity = false;
+			} else {
+				return GROUPE_INVALIDE;
+			}
+			*groupeLength = index;
+			return GROUPE_VALIDE;
+		}
+	}
+	return GROUPE_INCOMPLET;
+}
+
+unsigned int TeleinfoCompressor::encodeGroupe(const unsigned char* groupe, unsigned int groupeLength, unsigned char* output) {
+	char etiquette[TELEINFO_CODEC_ETIQUETTE_MAX];
+	char donnee[TELEINFO_CODEC_DONNEE_MAX];
+	unsigned int etiquetteLength = 0;
+	unsigned int donneeLength = 0;
+	unsigned int index = 1;
+	while ((groupe[index] & 0x7F) != TELEINFO_CHAR_SPACE) {
+		etiquette[etiquetteLength++] = groupe[index++] & 0x7F;
+	}
+	index++;
+	while ((groupe[index] & 0x7F) != TELEINFO_CHAR_SPACE) {
+		donnee[donneeLength++] = groupe[index++] & 0x7F;
+	}
+
+	unsigned int length = 0;
+	int label = findLabel(etiquette, etiquetteLength);
+	if (label < 0) {
+		output[length++] = CODEC_OP_NEW;
+		output[length++] = etiquetteLength;
+		memcpy(output + length, etiquette, etiquetteLength);
+		length += etiquetteLength;
+		output[length++] = donneeLength;
+		memcpy(output + length, donnee, donneeLength);
+		length += donneeLength;
+		addLabel(etiquette, etiquetteLength, donnee, donneeLength);
+		return length;
+	}
+
+	Label* previous = &labels[label];
+	if (previous->donneeLength == donneeLength && memcmp(previous->donnee, donnee, donneeLength) == 0) {
+		output[length++] = CODEC_OP_SAME | label;
+
+	} else if (previous->donneeLength == donneeLength && isNumeric(donnee, donneeLength) && isNumeric(previous->donnee, donneeLength)) {
+		long long delta = (long long) (parseNumeric(donnee, donneeLength) - parseNumeric(previous->donnee, donneeLength));
+		unsigned long long zigzag = ((unsigned long long) delta << 1) ^ (unsigned long long) (delta >> 63);
+		output[length++] = CODEC_OP_DELTA | label;
+		do {
+			output[length++] = (zigzag & 0x7F) | (zigzag > 0x7F ? 0x80 : 0);
+			zigzag >>= 7;
+		} while (zigzag > 0);
+
+	} else {
+		output[length++] = CODEC_OP_VALUE | label;
+		output[length++] = donneeLength;
+		memcpy(output + length, donnee, donneeLength);
+		length += donneeLength;
+	}
+	setDonnee(label, donnee, donneeLength);
+	return length;
+}
+
+void TeleinfoCompressor::encodeBlock() {
+	encodedLength = CODEC_BLOCK_HEADER;
+	encodedPosition = 0;
+	low = 0;
+	range = 0xFFFFFFFF;
+	cache = 0;
+	cacheSize = 1;
+
+	for (unsigned int i = 0; i < tokensLength; i++) {
+		unsigned short* tree = getProbabilities();
+		unsigned int node = 1;
+		for (int shift = 7; shift >= 0; shift--) {
+			unsigned int bit = (tokens[i] >> shift) & 1;
+			encodeBit(tree + node, bit);
+			node = (node << 1) | bit;
+		}
+		nextToken(tokens[i]);
+	}
+	for (int i = 0; i < 5; i++) {
+		shiftLow();
+	}
+
+	unsigned int codeLength = encodedLength - CODEC_BLOCK_HEADER;
+	encoded[0] = tokensLength & 0xFF;
+	encoded[1] = tokensLength >> 8;
+	encoded[2] = codeLength & 0xFF;
+	encoded[3] = codeLength >> 8;
+	tokensLength = 0;
+}
+
+void TeleinfoCompressor::encodeBit(unsigned short* probability, unsigned int bit) {
+	uint32_t bound = (range >> CODEC_PROBABILITY_BITS) * *probability;
+	if (bit == 0) {
+		range = bound;
+		*probability += ((1 << CODEC_PROBABILITY_BITS) - *probability) >> CODEC_ADAPT_BITS;
+	} else {
+		low += bound;
+		range -= bound;
+		*probability -= *probability >> CODEC_ADAPT_BITS;
+	}
+	while (range < CODEC_RANGE_TOP) {
+		range <<= 8;
+		shiftLow();
+	}
+}
+
+void TeleinfoCompressor::shiftLow() {
+	// Les octets 0xFF sont retenus tant qu'une retenue peut encore les modifier
+	if ((uint32_t) low < 0xFF000000 || (low >> 32) != 0) {
+		unsigned char carry = low >> 32;
+		unsigned char byte = cache;
+		do {
+			encoded[encodedLength++] = byte + carry;
+			byte = 0xFF;
+		} while (--cacheSize != 0);
+		cache = (low >> 24) & 0xFF;
+	}
+	cacheSize++;
+	low = (low & 0x00FFFFFF) << 8;
+}
+
+/*********************************************************************************************************************************************************************
+  DECOMPRESSION
+ *********************************************************************************************************************************************************************/
+
+TeleinfoDecompressor::TeleinfoDecompressor() {
+	tokens = (unsigned char*) malloc(TELEINFO_CODEC_BLOCK_SIZE);
+	tokensLength = 0;
+	tokensPosition = 0;
+	code = NULL;
+	codeLength = 0;
+	codePosition = 0;
+	range = 0;
+	value = 0;
+}
+
+TeleinfoDecompressor::~TeleinfoDecompressor() {
+	free(tokens);
+}
+
+int TeleinfoDecompressor::decompress(const unsigned char* input, unsigned int length, unsigned int* consumed, unsigned char* output, unsigned int capacity) {
+	unsigned int index = 0;
+	unsigned int written = 0;
+
+	while (true) {
+		if (tokensPosition < tokensLength) {
+			if (capacity - written < TELEINFO_CODEC_OPERATION_MAX) {
+				break;
+			}
+			unsigned int operationLength = 0;
+			int operationWritten = decodeOperation(tokens + tokensPosition, tokensLength - tokensPosition, &operationLength, output + written);
+			if (operationWritten < 0) {
+				return -1;
+			}
+			written += operationWritten;
+			tokensPosition += operationLength;
+
+		} else {
+			if (length - index < CODEC_BLOCK_HEADER) {
+				break;
+			}
+			unsigned int count = input[index] | (input[index + 1] << 8);
+			unsigned int blockLength = input[index + 2] | (input[index + 3] << 8);
+			if (count == 0 || count > TELEINFO_CODEC_BLOCK_SIZE || blockLength > CODEC_CODE_MAX) {
+				return -1;
+			}
+			if (length - index - CODEC_BLOCK_HEADER < blockLength) {
+				break; // Bloc incomplet
+			}
+			if (!decodeBlock(input + index + CODEC_BLOCK_HEADER, count, blockLength)) {
+				return -1;
+			}
+			index += CODEC_BLOCK_HEADER + blockLength;
+		}
+	}
+	if (consumed != NULL) {
+		*consumed = index;
+	}
+	return written;
+}
+
+bool TeleinfoDecompressor::decodeBlock(const unsigned char* block, unsigned int count, unsigned int length) {
+	code = block;
+	codeLength = length;
+	codePosition = 0;
+	range = 0xFFFFFFFF;
+	value = 0;
+	for (int i = 0; i < 5; i++) {
+		value = (value << 8) | (codePosition < codeLength ? code[codePosition++] : 0);
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned short* tree = getProbabilities();
+		unsigned int node = 1;
+		while (node < 0x100) {
+			node = (node << 1) | decodeBit(tree + node);
+		}
+		tokens[i] = node & 0xFF;
+		nextToken(tokens[i]);
+	}
+	tokensLength = count;
+	tokensPosition = 0;
+	return isTokenBoundary(); // Un bloc ne contient que des opérations complètes
+}
+
+unsigned int TeleinfoDecompressor::decodeBit(unsigned short* probability) {
+	unsigned int bit;
+	uint32_t bound = (range >> CODEC_PROBABILITY_BITS) * *probability;
+	if (value < bound) {
+		range = bound;
+		*probability += ((1 << CODEC_PROBABILITY_BITS) - *probability) >> CODEC_ADAPT_BITS;
+		bit = 0;
+	} else {
+		value -= bound;
+		range -= bound;
+		*probability -= *probability >> CODEC_ADAPT_BITS;
+		bit = 1;
+	}
+	if (range < CODEC_RANGE_TOP) {
+		range <<= 8;
+		value = (value << 8) | (codePosition < codeLength ? code[codePosition++] : 0);
+	}
+	return bit;
+}
+
+int TeleinfoDecompressor::decodeOperation(const unsigned char* operation, unsigned int available, unsigned int* operationLength, unsigned char* output) {
+	unsigned char opcode = operation[0];
+
+	if (opcode < CODEC_OP_DELTA) {
+		unsigned int label = opcode & 0x3F;
+		if (label >= labelsCount) {
+			return -1;
+		}
+		*operationLength = 1;
+		return writeGroupe(label, output);
+
+	} else if (opcode < CODEC_OP_VALUE) {
+		unsigned int label = opcode & 0x3F;
+		if (label >= labelsCount) {
+			return -1;
+		}
+		unsigned long long zigzag = 0;
+		unsigned int position = 1;
+		int shift = 0;
+		while (true) {
+			if (position >= available || shift >= 64) {
+				return -1;
+			}
+			unsigned char byte = operation[position++];
+			zigzag |= (unsigned long long) (byte & 0x7F) << shift;
+			shift += 7;
+			if ((byte & 0x80) == 0) {
+				break;
+			}
+		}
+		Label* previous = &labels[label];
+		if (!isNumeric(previous->donnee, previous->donneeLength)) {
+			return -1;
+		}
+		long long delta = (long long) (zigzag >> 1) ^ -(long long) (zigzag & 1);
+		unsigned long long number = parseNumeric(previous->donnee, previous->donneeLength) + delta;
+		for (int i = previous->donneeLength - 1; i >= 0; i--) {
+			previous->donnee[i] = '0' + number % 10;
+			number /= 10;
+		}
+		if (number != 0) {
+			return -1;
+		}
+		*operationLength = position;
+		return writeGroupe(label, output);
+
+	} else if (opcode < CODEC_OP_NEW) {
+		unsigned int label = opcode & 0x3F;
+		if (label >= labelsCount || available < 2 || available < 2u + operation[1]) {
+			return -1;
+		}
+		unsigned int donneeLength = operation[1];
+		if (donneeLength > TELEINFO_CODEC_DONNEE_MAX) {
+			return -1;
+		}
+		setDonnee(label, (const char*) operation + 2, donneeLength);
+		*operationLength = 2 + donneeLength;
+		return writeGroupe(label, output);
+
+	} else if (opcode == CODEC_OP_NEW) {
+		if (available < 2 || available < 3u + operation[1] || available < 3u + operation[1] + operation[2 + operation[1]]) {
+			return -1;
+		}
+		unsigned int etiquetteLength = operation[1];
+		unsigned int donneeLength = operation[2 + etiquetteLength];
+		if (etiquetteLength == 0 || etiquetteLength > TELEINFO_CODEC_ETIQUETTE_MAX || donneeLength > TELEINFO_CODEC_DONNEE_MAX) {
+			return -1;
+		}
+		const char* etiquette = (const char*) operation + 2;
+		const char* donnee = etiquette + etiquetteLength + 1;
+		addLabel(etiquette, etiquetteLength, donnee, donneeLength); // Ignorée s'il n'y a plus de place, comme à la compression
+		*operationLength = 3 + etiquetteLength + donneeLength;
+		return writeGroupe(etiquette, etiquetteLength, donnee, donneeLength, output);
+
+	} else if (opcode == CODEC_OP_STX) {
+		*operationLength = 1;
+		output[0] = withParity(TELEINFO_CHAR_STX);
+		return 1;
+
+	} else if (opcode == CODEC_OP_ETX) {
+		*operationLength = 1;
+		output[0] = withParity(TELEINFO_CHAR_ETX);
+		return 1;
+
+	} else if (opcode == CODEC_OP_PARITY) {
+		*operationLength = 1;
+		parity = !parity;
+		return 0;
+	}
+
+	unsigned int count = opcode - CODEC_OP_LITERAL;
+	if (available < 1 + count) {
+		return -1;
+	}
+	memcpy(output, operation + 1, count);
+	*operationLength = 1 + count;
+	return count;
+}
+
+unsigned int TeleinfoDecompressor::writeGroupe(unsigned int label, unsigned char* output) {
+	return writeGroupe(labels[label].etiquette, labels[label].etiquetteLength, labels[label].donnee, labels[label].donneeLength, output);
+}
+
+unsigned int TeleinfoDecompressor::writeGroupe(const char* etiquette, unsigned int etiquetteLength, const char* donnee, unsigned int donneeLength, unsigned char* output) {
+	unsigned int length = 0;
+	unsigned int sum = TELEINFO_CHAR_SPACE;
+	output[length++] = withParity(TELEINFO_CHAR_LF);
+	for (unsigned int i = 0; i < etiquetteLength; i++) {
+		sum += etiquette[i];
+		output[length++] = withParity(etiquette[i]);
+	}
+	output[length++] = withParity(TELEINFO_CHAR_SPACE);
+	for (unsigned int i = 0; i < donneeLength; i++) {
+		sum += donnee[i];
+		output[length++] = withParity(donnee[i]);
+	}
+	output[length++] = withParity(TELEINFO_CHAR_SPACE);
+	output[length++] = withParity((sum & 0x3F) + 0x20); // Checksum recalculé
+	output[length++] = withParity(TELEINFO_CHAR_CR);
+	return length;
+}
+
+unsigned char TeleinfoDecompressor::withParity(unsigned char character) {
+	return parity ? evenParity(character) : character;
+}
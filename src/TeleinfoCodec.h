@@ -0,0 +1,204 @@
+/**
+ * Déclaration du codec de compression du flux Téléinfo brut
+ *
+ * Le codec modélise la structure des trames : chaque groupe valide (LF étiquette SP donnée SP checksum CR) est remplacé
+ * par un numéro d'étiquette et sa donnée est prédite par la valeur précédente de la même étiquette (identique, écart
+ * numérique ou nouvelle valeur). Le checksum et le bit de parité (7E1) ne sont pas stockés mais recalculés.
+ * Tout le reste (groupes erronés, parasites, trames tronquées...) est conservé tel quel : la décompression redonne
+ * exactement les octets d'origine.
+ *
+ * Les groupes sont d'abord traduits en une suite d'opérations, chacune commençant par un octet de code
+ *   0x00 - 0x3F : groupe identique au précédent de l'étiquette n° (code & 0x3F)
+ *   0x40 - 0x7F : groupe numérique de l'étiquette n° (code & 0x3F), suivi de l'écart avec la valeur précédente (varint zigzag)
+ *   0x80 - 0xBF : groupe de l'étiquette n° (code & 0x3F), suivi de la longueur de la donnée et de la donnée
+ *   0xC0        : groupe d'une nouvelle étiquette, suivi de la longueur et de l'étiquette, de la longueur et de la donnée
+ *   0xC1        : STX
+ *   0xC2        : ETX
+ *   0xC3        : bascule du mode de parité (octets sur 7 bits / bit de parité paire)
+ *   0xC4 - 0xFF : octets bruts, au nombre de (code - 0xC3), qui suivent
+ *
+ * Les opérations sont ensuite codées par blocs d'au plus TELEINFO_CODEC_BLOCK_SIZE octets, par un codeur arithmétique binaire
+ * adaptatif dont le contexte est l'opération précédente (les étiquettes se suivent dans le même ordre d'une trame à l'autre)
+ * ou l'opération en cours et la position dans celle-ci. Le modèle de contexte se poursuit d'un bloc à l'autre.
+ * Un bloc compressé est formé du nombre d'octets d'opérations (2 octets), de la longueur du code (2 octets) puis du code.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_CODEC_H_
+#define TELEINFO_CODEC_H_
+
+#include <stdint.h>
+
+/**
+ * Nombre maximal d'étiquettes mémorisées
+ */
+#define TELEINFO_CODEC_LABELS          64
+
+/**
+ * Longueurs maximales d'étiquette et de donnée d'un groupe compressé (un groupe plus long est conservé en octets bruts)
+ */
+#define TELEINFO_CODEC_ETIQUETTE_MAX   16
+#define TELEINFO_CODEC_DONNEE_MAX      32
+
+/**
+ * Taille maximale d'une opération, compressée ou décompressée.
+ * Un tampon de sortie de la décompression d'au moins cette taille garantit sa progression.
+ */
+#define TELEINFO_CODEC_OPERATION_MAX   64
+
+/**
+ * Taille maximale d'un bloc d'opérations.
+ * La compression sort un bloc lorsqu'il est plein ou à la demande, la décompression attend qu'un bloc soit complet.
+ */
+#define TELEINFO_CODEC_BLOCK_SIZE      4096
+
+/**
+ * Modèle commun au compresseur et au décompresseur : étiquettes connues et dernière donnée de chacune,
+ * contexte et probabilités du codage des opérations
+ */
+class TeleinfoCodecModel {
+  protected:
+    struct Label {
+      char etiquette[TELEINFO_CODEC_ETIQUETTE_MAX + 1];
+      unsigned char etiquetteLength;
+      char donnee[TELEINFO_CODEC_DONNEE_MAX + 1];
+      unsigned char donneeLength;
+    };
+
+    Label labels[TELEINFO_CODEC_LABELS];
+    unsigned int labelsCount;
+    unsigned int lastLabel;
+    bool parity;
+
+    unsigned short* probabilities;
+    unsigned char tokenState;      // Partie attendue de l'opération en cours
+    unsigned char tokenOperation;  // Code de l'opération en cours
+    unsigned char lastOperation;   // Code de la dernière opération terminée
+    unsigned int tokenPosition;    // Position dans l'opération en cours
+    unsigned int tokenRemaining;   // Nombre d'octets restant à lire dans le champ en cours
+    unsigned int tokenFields;      // Nombre de champs (longueur et octets) restant à lire
+
+    TeleinfoCodecModel();
+    ~TeleinfoCodecModel();
+
+    /**
+     * Recherche une étiquette connue, en commençant par celle qui suit la dernière rencontrée
+     * @return le numéro de l'étiquette, -1 si elle est inconnue
+     */
+    int findLabel(const char* etiquette, unsigned int length);
+
+    /**
+     * Mémorise une nouvelle étiquette si la place le permet
+     */
+    void addLabel(const char* etiquette, unsigned int etiquetteLength, const char* donnee, unsigned int donneeLength);
+
+    /**
+     * Mémorise la dernière donnée d'une étiquette
+     */
+    void setDonnee(unsigned int label, const char* donnee, unsigned int length);
+
+    /**
+     * Donne l'arbre des probabilités de l'octet d'opération suivant, selon son contexte
+     */
+    unsigned short* getProbabilities();
+
+    /**
+     * Avance le contexte d'un octet d'opération
+     */
+    void nextToken(unsigned char token);
+
+    /**
+     * Indique si le contexte est au début d'une opération
+     */
+    bool isTokenBoundary();
+};
+
+/**
+ * Compresseur du flux Téléinfo brut
+ */
+class TeleinfoCompressor : private TeleinfoCodecModel {
+  public:
+    TeleinfoCompressor();
+    ~TeleinfoCompressor();
+
+    /**
+     * Compresse un bloc du flux brut.
+     * La compression s'arrête lorsque le tampon de sortie est plein, ou sur un groupe incomplet en fin de bloc (sauf si flush) :
+     * les octets non consommés sont à fournir à nouveau lors de l'appel suivant.
+     * Les octets consommés sont conservés en opérations jusqu'à ce qu'un bloc d'opérations soit plein, ou jusqu'à flush.
+     *
+     * @param input les octets du flux brut
+     * @param length le nombre d'octets de input
+     * @param consumed reçoit le nombre d'octets de input compressés
+     * @param output le tampon de sortie
+     * @param capacity la taille du tampon de sortie
+     * @param flush true en fin de flux, ou pour sortir tout ce qui a été consommé : dans ce cas, appeler tant que des octets sont écrits
+     * @return le nombre d'octets écrits dans output
+     */
+    unsigned int compress(const unsigned char* input, unsigned int length, unsigned int* consumed, unsigned char* output, unsigned int capacity, bool flush);
+
+  private:
+    /* Résultat de l'analyse d'un groupe */
+    enum { GROUPE_INVALIDE, GROUPE_INCOMPLET, GROUPE_VALIDE };
+
+    unsigned char* tokens;          // Bloc d'opérations en cours
+    unsigned int tokensLength;
+    unsigned char* encoded;         // Bloc compressé en attente de sortie
+    unsigned int encodedLength;
+    unsigned int encodedPosition;
+    uint64_t low;                   // Etat du codeur arithmétique
+    uint32_t range;
+    unsigned char cache;
+    unsigned int cacheSize;
+
+    unsigned int tokenize(const unsigned char* input, unsigned int length, bool flush);
+    int parseGroupe(const unsigned char* input, unsigned int length, unsigned int* groupeLength, bool* groupeParity);
+    unsigned int encodeGroupe(const unsigned char* groupe, unsigned int groupeLength, unsigned char* output);
+    void encodeBlock();
+    void encodeBit(unsigned short* probability, unsigned int bit);
+    void shiftLow();
+};
+
+/**
+ * Décompresseur du flux Téléinfo brut
+ */
+class TeleinfoDecompressor : private TeleinfoCodecModel {
+  public:
+    TeleinfoDecompressor();
+    ~TeleinfoDecompressor();
+
+    /**
+     * Décompresse un bloc du flux compressé.
+     * Seuls les blocs complets sont consommés : les octets non consommés sont à fournir à nouveau lors de l'appel suivant.
+     * Les opérations d'un bloc consommé qui n'ont pu être écrites, faute de place en sortie, le sont lors des appels suivants :
+     * appeler tant que des octets sont consommés ou écrits. Le tampon de sortie doit faire au moins TELEINFO_CODEC_OPERATION_MAX octets.
+     *
+     * @param input les octets du flux compressé
+     * @param length le nombre d'octets de input
+     * @param consumed reçoit le nombre d'octets de input décompressés
+     * @param output le tampon de sortie
+     * @param capacity la taille du tampon de sortie
+     * @return le nombre d'octets écrits dans output, -1 si le flux compressé est invalide
+     */
+    int decompress(const unsigned char* input, unsigned int length, unsigned int* consumed, unsigned char* output, unsigned int capacity);
+
+  private:
+    unsigned char* tokens;          // Bloc d'opérations décodé
+    unsigned int tokensLength;
+    unsigned int tokensPosition;
+    const unsigned char* code;      // Etat du décodeur arithmétique
+    unsigned int codeLength;
+    unsigned int codePosition;
+    uint32_t range;
+    uint32_t value;
+
+    bool decodeBlock(const unsigned char* block, unsigned int count, unsigned int length);
+    unsigned int decodeBit(unsigned short* probability);
+    int decodeOperation(const unsigned char* operation, unsigned int available, unsigned int* operationLength, unsigned char* output);
+    unsigned int writeGroupe(unsigned int label, unsigned char* output);
+    unsigned int writeGroupe(const char* etiquette, unsigned int etiquetteLength, const char* donnee, unsigned int donneeLength, unsigned char* output);
+    unsigned char withParity(unsigned char character);
+};
+
+#endif  // TELEINFO_CODEC_H_
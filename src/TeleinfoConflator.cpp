@@ -0,0 +1,113 @@
+/**
+ * Implémentation de l'étage de fusion des trames
+ *
+ * @author LK
+ */
+#include "TeleinfoConflator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+TeleinfoConflator::TeleinfoConflator(unsigned int meters, unsigned int sinks) {
+	this->latest = new TeleinfoSnapshot[meters];
+	this->known = (unsigned char*) calloc(meters, sizeof(unsigned char));
+	this->sinks = (Sink*) calloc(sinks, sizeof(Sink));
+	bool allocated = latest != NULL && known != NULL && this->sinks != NULL;
+	for (unsigned int sink = 0; allocated && sink < sinks; sink++) {
+		this->sinks[sink].queue = (unsigned int*) malloc(meters * sizeof(unsigned int));
+		this->sinks[sink].pending = (unsigned char*) calloc(meters, sizeof(unsigned char));
+		this->sinks[sink].changes = (unsigned long long*) calloc(meters, sizeof(unsigned long long));
+		allocated = this->sinks[sink].queue != NULL && this->sinks[sink].pending != NULL && this->sinks[sink].changes != NULL;
+	}
+	this->metersCount = allocated ? meters : 0;
+	this->sinksCount = this->sinks != NULL ? sinks : 0;
+	this->published = 0;
+}
+
+TeleinfoConflator::~TeleinfoConflator() {
+	for (unsigned int sink = 0; sink < sinksCount; sink++) {
+		free(sinks[sink].queue);
+		free(sinks[sink].pending);
+		free(sinks[sink].changes);
+	}
+	free(sinks);
+	free(known);
+	delete[] latest;
+}
+
+bool TeleinfoConflator::publish(unsigned int meter, Teleinfo* teleinfo) {
+	if (meter >= metersCount || teleinfo == NULL) {
+		return false;
+	}
+	TeleinfoSnapshot* previous = &latest[meter];
+	incoming.copy(teleinfo);
+	unsigned long long presence = incoming.getValidFields() | incoming.getCarriedFields();
+	unsigned long long changes = incoming.compare(previous);
+	if (known[meter]) {
+		changes |= presence ^ (previous->getValidFields() | previous->getCarriedFields());
+	} else {
+		changes |= presence;
+		known[meter] = 1;
+	}
+	*previous = incoming;
+	published++;
+
+	for (unsigned int i = 0; i < sinksCount; i++) {
+		Sink* sink = &sinks[i];
+		if (sink->pending[meter]) {
+			sink->conflated++; // La trame en attente est remplacée
+		} else {
+			sink->queue[(sink->head + sink->count) % metersCount] = meter;
+			sink->count++;
+			sink->pending[meter] = 1;
+		}
+		sink->changes[meter] |= changes;
+	}
+	return true;
+}
+
+int TeleinfoConflator::pull(unsigned int sink, TeleinfoSnapshot* snapshot, unsigned long long* changedFields) {
+	if (sink >= sinksCount || sinks[sink].count == 0) {
+		return TELEINFO_CONFLATOR_NONE;
+	}
+	Sink* current = &sinks[sink];
+	unsigned int meter = current->queue[current->head];
+	current->head = (current->head + 1) % metersCount;
+	current->count--;
+	current->pending[meter] = 0;
+	current->delivered++;
+	*snapshot = latest[meter];
+	if (changedFields != NULL) {
+		*changedFields = current->changes[meter];
+	}
+	current->changes[meter] = 0;
+	return meter;
+}
+
+TeleinfoSnapshot* TeleinfoConflator::getLatest(unsigned int meter) {
+	return meter < metersCount && known[meter] ? &latest[meter] : NULL;
+}
+
+unsigned int TeleinfoConflator::getPending(unsigned int sink) {
+	return sink < sinksCount ? sinks[sink].count : 0;
+}
+
+unsigned long TeleinfoConflator::getDelivered(unsigned int sink) {
+	return sink < sinksCount ? sinks[sink].delivered : 0;
+}
+
+unsigned long TeleinfoConflator::getConflated(unsigned int sink) {
+	return sink < sinksCount ? sinks[sink].conflated : 0;
+}
+
+unsigned long TeleinfoConflator::getPublished() {
+	return published;
+}
+
+unsigned int TeleinfoConflator::getMeterCount() {
+	return metersCount;
+}
+
+unsigned int TeleinfoConflator::getSinkCount() {
+	return sinksCount;
+}
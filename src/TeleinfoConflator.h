@@ -0,0 +1,122 @@
+/**
+ * Déclaration de l'étage de fusion des trames (conflation) entre le décodage et les destinataires
+ *
+ * Un destinataire (base de données, liaison radio, sonde RfxMeter...) peut être plus lent que le flux Téléinfo.
+ * Le faire attendre bloquerait la boucle de décodage (débordement de l'UART), empiler les trames consommerait
+ * une mémoire sans limite. Le conflateur ne garde que la dernière trame de chaque compteur : le décodage la publie
+ * sans jamais attendre, chaque destinataire la prend à son rythme. Une trame remplacée avant d'avoir été prise par
+ * un destinataire est comptée comme fusionnée pour ce destinataire, et les champs modifiés par les trames fusionnées
+ * lui sont signalés avec la dernière.
+ *
+ * Pour chaque destinataire, les compteurs en attente forment une file (chaque compteur y figure au plus une fois,
+ * dans l'ordre de leur première trame non prise) : publication et prise coûtent un temps constant et toute la mémoire
+ * est allouée à la création du conflateur.
+ *
+ * Le conflateur n'est pas protégé contre les accès concurrents : si destinataires et décodage sont dans des threads
+ * différents, publish(...) et pull(...) sont appelés sous un même verrou. Ces appels sont courts (une copie de trame),
+ * le traitement lent du destinataire se fait hors du verrou sur la copie donnée par pull(...).
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_CONFLATOR_H_
+#define TELEINFO_CONFLATOR_H_
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoSnapshot.h"
+
+/**
+ * Numéro de compteur invalide : aucune trame en attente
+ */
+#define TELEINFO_CONFLATOR_NONE   -1
+
+/**
+ * Fusion des trames d'un ensemble de compteurs pour un ensemble de destinataires
+ */
+class TeleinfoConflator {
+  private:
+    struct Sink {
+      unsigned int* queue;            // File circulaire des compteurs en attente
+      unsigned int head;
+      unsigned int count;
+      unsigned char* pending;         // 1 si le compteur est dans la file
+      unsigned long long* changes;    // Champs modifiés depuis la dernière prise, par compteur
+      unsigned long delivered;
+      unsigned long conflated;
+    };
+
+    TeleinfoSnapshot* latest;         // Dernière trame de chaque compteur
+    unsigned char* known;             // 1 si une trame du compteur a été publiée
+    TeleinfoSnapshot incoming;
+    unsigned int metersCount;
+    Sink* sinks;
+    unsigned int sinksCount;
+    unsigned long published;
+
+  public:
+    /**
+     * Création du conflateur
+     * @param meters le nombre de compteurs, numérotés de 0 à meters - 1 par l'appelant (voir TeleinfoRegistry)
+     * @param sinks le nombre de destinataires, numérotés de 0 à sinks - 1
+     */
+    TeleinfoConflator(unsigned int meters, unsigned int sinks);
+    ~TeleinfoConflator();
+
+    /**
+     * Publie la trame d'un compteur pour tous les destinataires (côté décodage, ne bloque jamais)
+     *
+     * @param meter le numéro du compteur
+     * @param teleinfo la trame décodée, copiée
+     * @return false si le numéro de compteur est invalide
+     */
+    bool publish(unsigned int meter, Teleinfo* teleinfo);
+
+    /**
+     * Prend la dernière trame d'un compteur en attente pour un destinataire (le compteur en attente depuis le plus longtemps)
+     *
+     * @param sink le numéro du destinataire
+     * @param snapshot reçoit la copie de la trame
+     * @param changedFields reçoit les champs (TELEINFO_FIELD_*) modifiés depuis la trame précédemment prise par le destinataire,
+     *        y compris par les trames fusionnées (facultatif, peut être NULL)
+     * @return le numéro du compteur, TELEINFO_CONFLATOR_NONE si aucune trame n'est en attente ou si le destinataire est invalide
+     */
+    int pull(unsigned int sink, TeleinfoSnapshot* snapshot, unsigned long long* changedFields);
+
+    /**
+     * Donne la dernière trame publiée d'un compteur
+     * @return NULL si aucune trame n'a été publiée ou si le numéro est invalide
+     */
+    TeleinfoSnapshot* getLatest(unsigned int meter);
+
+    /**
+     * Donne le nombre de compteurs en attente pour un destinataire (son retard)
+     */
+    unsigned int getPending(unsigned int sink);
+
+    /**
+     * Donne le nombre de trames prises par un destinataire
+     */
+    unsigned long getDelivered(unsigned int sink);
+
+    /**
+     * Donne le nombre de trames remplacées avant d'avoir été prises par un destinataire
+     */
+    unsigned long getConflated(unsigned int sink);
+
+    /**
+     * Donne le nombre de trames publiées
+     */
+    unsigned long getPublished();
+
+    /**
+     * Donne le nombre de compteurs
+     */
+    unsigned int getMeterCount();
+
+    /**
+     * Donne le nombre de destinataires
+     */
+    unsigned int getSinkCount();
+};
+
+#endif  // TELEINFO_CONFLATOR_H_
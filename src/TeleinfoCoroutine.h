@@ -0,0 +1,180 @@
+/**
+ * Interface coroutine (C++20) du décodeur Téléinfo
+ *
+ * Les trames sont produites par une coroutine qui lit le flux par blocs depuis une source asynchrone
+ * et les décode avec TeleinfoDecoder::decode(buffer, length, consumed). La coroutine n'est suspendue
+ * qu'en attente d'un bloc de la source ou à la mise à disposition d'une trame : jamais pour un octet.
+ *
+ * Une source est un objet offrant une méthode read(unsigned char* buffer, unsigned int size) qui renvoie
+ * un objet "awaitable" dont le résultat est le nombre d'octets lus (0 pour la fin du flux).
+ *
+ * Exemple :
+ *   TeleinfoAsyncFrames frames = asyncFrames(teleinfoDecoder, source);
+ *   while (Teleinfo* teleinfo = co_await frames.next()) {
+ *     ...
+ *   }
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_COROUTINE_H_
+#define TELEINFO_COROUTINE_H_
+
+#include "TeleinfoDecoder.h"
+
+#include <coroutine>
+#include <exception>
+#include <stddef.h>
+
+/**
+ * Taille des blocs lus depuis la source par la coroutine
+ */
+#ifndef TELEINFO_ASYNC_CHUNK_SIZE
+#define TELEINFO_ASYNC_CHUNK_SIZE   256
+#endif
+
+/**
+ * Générateur asynchrone de trames Téléinfo.
+ *
+ * L'objet Teleinfo obtenu est celui du décodeur (aucune copie) : il reste valide jusqu'à la demande de la trame suivante.
+ */
+class TeleinfoAsyncFrames {
+  public:
+    struct promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+    /**
+     * Suspension de la coroutine productrice : la main est rendue directement au consommateur en attente
+     */
+    struct TransferAwaiter {
+      bool await_ready() noexcept {
+        return false;
+      }
+      std::coroutine_handle<> await_suspend(Handle handle) noexcept {
+        return handle.promise().continuation;
+      }
+      void await_resume() noexcept {
+      }
+    };
+
+    struct promise_type {
+      Teleinfo* current = NULL;
+      std::coroutine_handle<> continuation;
+
+      TeleinfoAsyncFrames get_return_object() {
+        return TeleinfoAsyncFrames(Handle::from_promise(*this));
+      }
+      std::suspend_always initial_suspend() noexcept {
+        return {};
+      }
+      TransferAwaiter final_suspend() noexcept {
+        current = NULL;
+        return {};
+      }
+      TransferAwaiter yield_value(Teleinfo* teleinfo) noexcept {
+        current = teleinfo;
+        return {};
+      }
+      void return_void() {
+      }
+      void unhandled_exception() {
+        std::terminate();
+      }
+    };
+
+    /**
+     * Attente de la trame suivante par une coroutine consommatrice
+     */
+    struct NextAwaiter {
+      Handle handle;
+
+      bool await_ready() noexcept {
+        return handle.done();
+      }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) noexcept {
+        handle.promise().continuation = consumer;
+        handle.promise().current = NULL;
+        return handle;
+      }
+      Teleinfo* await_resume() noexcept {
+        return handle.done() ? NULL : handle.promise().current;
+      }
+    };
+
+    TeleinfoAsyncFrames(TeleinfoAsyncFrames&& other) noexcept : handle(other.handle) {
+      other.handle = Handle();
+    }
+
+    TeleinfoAsyncFrames(const TeleinfoAsyncFrames&) = delete;
+    TeleinfoAsyncFrames& operator=(const TeleinfoAsyncFrames&) = delete;
+
+    ~TeleinfoAsyncFrames() {
+      if (handle) {
+        handle.destroy();
+      }
+    }
+
+    /**
+     * Donne la trame suivante (à utiliser avec co_await)
+     * @return un awaitable dont le résultat est la trame, ou NULL à la fin du flux
+     */
+    NextAwaiter next() {
+      return NextAwaiter{handle};
+    }
+
+    /**
+     * Donne la trame suivante sans coroutine consommatrice.
+     * Réservé aux sources synchrones (dont les lectures ne suspendent jamais la coroutine).
+     * @return la trame, ou NULL à la fin du flux
+     */
+    Teleinfo* pull() {
+      if (handle.done()) {
+        return NULL;
+      }
+      handle.promise().continuation = std::noop_coroutine();
+      handle.promise().current = NULL;
+      handle.resume();
+      return handle.done() ? NULL : handle.promise().current;
+    }
+
+    /**
+     * Indique si le flux est terminé
+     */
+    bool isDone() {
+      return handle.done();
+    }
+
+  private:
+    Handle handle;
+
+    explicit TeleinfoAsyncFrames(Handle handle) : handle(handle) {
+    }
+};
+
+/**
+ * Coroutine de décodage d'une source d'octets : produit chacune des trames terminées
+ *
+ * @param teleinfoDecoder le décodeur dont l'état est utilisé (une trame commencée avant reste décodée)
+ * @param source la source des octets, doit rester valide tant que le générateur est utilisé
+ */
+template<typename Source>
+TeleinfoAsyncFrames asyncFrames(TeleinfoDecoder* teleinfoDecoder, Source& source) {
+  unsigned char buffer[TELEINFO_ASYNC_CHUNK_SIZE];
+  for (;;) {
+    unsigned int length = co_await source.read(buffer, sizeof(buffer));
+    if (length == 0) {
+      co_return;
+    }
+    unsigned int index = 0;
+    while (index < length) {
+      unsigned int consumed = 0;
+      Teleinfo* teleinfo = teleinfoDecoder->decode(buffer + index, length - index, &consumed);
+      index += consumed;
+      if (teleinfo != NULL) {
+        co_yield teleinfo;
+      }
+    }
+  }
+}
+
+#endif  // TELEINFO_COROUTINE_H_
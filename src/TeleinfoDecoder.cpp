@@ -4,405 +4,254 @@
  * @author LK
  */
 #include "TeleinfoDecoder.h"
+#include "TeleinfoInternal.h"
+#include "TeleinfoProbes.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-/*********************************************************************************************************************************************************************
-  CONSTANTES
- *********************************************************************************************************************************************************************/
-
-/* Caractères spéciaux du protocole TeleInfo */
-#define TELEINFO_CHAR_STX            0x02  // Start of Text
-#define TELEINFO_CHAR_ETX            0x03  // End of Text
-#define TELEINFO_CHAR_EOT            0x04  // End of Transmission
-#define TELEINFO_CHAR_LF             0x0A  // Groupe Feed
-#define TELEINFO_CHAR_CR             0x0D  // Carriage return
-#define TELEINFO_CHAR_SPACE          0x20  // Space
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <time.h>
+#endif
+#endif
 
 /*********************************************************************************************************************************************************************
-   CLASSES INTERNES
+  SCHEMA DES ETIQUETTES
  *********************************************************************************************************************************************************************/
 
 /**
- * Représente un groupe Téléinfo : un ocuple composé d'une étiquette et d'une donnée.
- *
- * Toutes les données du compteur sont délivrées par groupes d'information qui forment chacun un ensemble cohérent
- * avec une étiquette et une valeur associée de telle sorte qu'il soit facile de les distinguer les unes des autres.
+ * Schéma des étiquettes connues : champ, emplacement de la valeur dans la trame et grammaire de la donnée
  */
-class TeleinfoGroupe {
-private:
-	char etiquette[64];
-	unsigned int indexEtiquette;
-	char donnee[64];
-	unsigned int indexDonnee;
-	char checksum;
-
-public:
-	/**
-       Constructeur
-	 */
-	TeleinfoGroupe() {
-		reset();
-	}
+static const TeleinfoLabel TELEINFO_SCHEMA[] = {
+	{ "ADCO",     TELEINFO_FIELD_ADCO,     TELEINFO_TYPE_TEXT,   TELEINFO_SLOT_ADCO,     12, TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "OPTARIF",  TELEINFO_FIELD_OPTARIF,  TELEINFO_TYPE_TEXT,   TELEINFO_SLOT_OPTARIF,  4,  TELEINFO_GRAMMAR_VALUES, -1, "BASE|HC..|EJP.|BBR?" },
+	{ "ISOUSC",   TELEINFO_FIELD_ISOUSC,   TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_ISOUSC,   2,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "BASE",     TELEINFO_FIELD_BASE,     TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_BASE,     9,  TELEINFO_GRAMMAR_INDEX,  0,  NULL },
+	{ "HCHC",     TELEINFO_FIELD_HCHC,     TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_HCHC,     9,  TELEINFO_GRAMMAR_INDEX,  1,  NULL },
+	{ "HCHP",     TELEINFO_FIELD_HCHP,     TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_HCHP,     9,  TELEINFO_GRAMMAR_INDEX,  2,  NULL },
+	{ "EJPHN",    TELEINFO_FIELD_EJPHN,    TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_EJPHN,    9,  TELEINFO_GRAMMAR_INDEX,  3,  NULL },
+	{ "EJPHPM",   TELEINFO_FIELD_EJPHPM,   TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_EJPHPM,   9,  TELEINFO_GRAMMAR_INDEX,  4,  NULL },
+	{ "BBRHCJB",  TELEINFO_FIELD_BBRHCJB,  TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_BBRHCJB,  9,  TELEINFO_GRAMMAR_INDEX,  5,  NULL },
+	{ "BBRHPJB",  TELEINFO_FIELD_BBRHPJB,  TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_BBRHPJB,  9,  TELEINFO_GRAMMAR_INDEX,  6,  NULL },
+	{ "BBRHCJW",  TELEINFO_FIELD_BBRHCJW,  TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_BBRHCJW,  9,  TELEINFO_GRAMMAR_INDEX,  7,  NULL },
+	{ "BBRHPJW",  TELEINFO_FIELD_BBRHPJW,  TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_BBRHPJW,  9,  TELEINFO_GRAMMAR_INDEX,  8,  NULL },
+	{ "BBRHCJR",  TELEINFO_FIELD_BBRHCJR,  TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_BBRHCJR,  9,  TELEINFO_GRAMMAR_INDEX,  9,  NULL },
+	{ "BBRHPJR",  TELEINFO_FIELD_BBRHPJR,  TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_BBRHPJR,  9,  TELEINFO_GRAMMAR_INDEX,  10, NULL },
+	{ "PEJP",     TELEINFO_FIELD_PEJP,     TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_PEJP,     2,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "PTEC",     TELEINFO_FIELD_PTEC,     TELEINFO_TYPE_TEXT,   TELEINFO_SLOT_PTEC,     4,  TELEINFO_GRAMMAR_VALUES, -1, "TH..|HC..|HP..|HN..|PM..|HCJB|HPJB|HCJW|HPJW|HCJR|HPJR" },
+	{ "DEMAIN",   TELEINFO_FIELD_DEMAIN,   TELEINFO_TYPE_TEXT,   TELEINFO_SLOT_DEMAIN,   4,  TELEINFO_GRAMMAR_VALUES, -1, "----|BLEU|BLAN|ROUG" },
+	{ "IINST",    TELEINFO_FIELD_IINST,    TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_IINST,    3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "ADPS",     TELEINFO_FIELD_ADPS,     TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_ADPS,     3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "IMAX",     TELEINFO_FIELD_IMAX,     TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_IMAX,     3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "PAPP",     TELEINFO_FIELD_PAPP,     TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_PAPP,     5,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "HHPHC",    TELEINFO_FIELD_HHPHC,    TELEINFO_TYPE_CHAR,   TELEINFO_SLOT_HHPHC,    1,  TELEINFO_GRAMMAR_VALUES, -1, "A|C|D|E|Y" },
+	{ "MOTDETAT", TELEINFO_FIELD_MOTDETAT, TELEINFO_TYPE_TEXT,   TELEINFO_SLOT_MOTDETAT, 6,  TELEINFO_GRAMMAR_HEX,    -1, NULL },
+#ifndef TELEINFO_DISABLE_THREE_PHASE
+	{ "IINST1",   TELEINFO_FIELD_IINST1,   TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_IINST1,   3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "IINST2",   TELEINFO_FIELD_IINST2,   TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_IINST2,   3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "IINST3",   TELEINFO_FIELD_IINST3,   TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_IINST3,   3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "IMAX1",    TELEINFO_FIELD_IMAX1,    TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_IMAX1,    3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "IMAX2",    TELEINFO_FIELD_IMAX2,    TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_IMAX2,    3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "IMAX3",    TELEINFO_FIELD_IMAX3,    TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_IMAX3,    3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "PMAX",     TELEINFO_FIELD_PMAX,     TELEINFO_TYPE_NUMBER, TELEINFO_SLOT_PMAX,     5,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "PPOT",     TELEINFO_FIELD_PPOT,     TELEINFO_TYPE_TEXT,   TELEINFO_SLOT_PPOT,     2,  TELEINFO_GRAMMAR_HEX,    -1, NULL },
+	{ "ADIR1",    TELEINFO_FIELD_ADIR1,    TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_ADIR1,    3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "ADIR2",    TELEINFO_FIELD_ADIR2,    TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_ADIR2,    3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+	{ "ADIR3",    TELEINFO_FIELD_ADIR3,    TELEINFO_TYPE_SHORT,  TELEINFO_SLOT_ADIR3,    3,  TELEINFO_GRAMMAR_DIGITS, -1, NULL },
+#endif
+};
 
-	/**
-     * RAZ du contenu de la ligne TeleInfo
-	 */
-	void reset() {
-		memset(etiquette, '\0', sizeof(etiquette));
-		memset(donnee, '\0', sizeof(donnee));
-		indexEtiquette = 0;
-		indexDonnee = 0;
-		checksum = 0;
-	}
+#define TELEINFO_SCHEMA_LABELS       (sizeof(TELEINFO_SCHEMA) / sizeof(TELEINFO_SCHEMA[0]))
 
-	/**
-	 * Ajoute un caractère à l'étiquette, le caractère est ignoré si la taille max de létiquette est atteinte
-	 */
-	void appendToEtiquette(char character) {
-		if (indexEtiquette < (sizeof(etiquette) - 1)) { // On laisse un caractère 0x00 de fin pour marquer la fin de la chaîne
-			etiquette[indexEtiquette++] = character;
-		}
-	}
-
-	/**
-	 * Ajoute un caractère à la donnée, le caractère est ignoré si la taille max de létiquette est atteinte
-	 */
-	void appendToDonnee(char character) {
-		if (indexDonnee < (sizeof(donnee) - 1)) { // On laisse un caractère 0x00 de fin pour marquer la fin de la chaîne
-			donnee[indexDonnee++] = character;
+/**
+ * Recherche d'une étiquette dans le schéma
+ * @return NULL si l'étiquette est inconnue
+ */
+static const TeleinfoLabel* findLabel(const char* etiquette) {
+	for (unsigned int i = 0; i < TELEINFO_SCHEMA_LABELS; i++) {
+		if (strcmp(etiquette, TELEINFO_SCHEMA[i].etiquette) == 0) {
+			return &TELEINFO_SCHEMA[i];
 		}
 	}
+	return NULL;
+}
 
-	/**
-	 * Définit le checksum
-	 */
-	void setChecksum(char character) {
-		checksum = character;
-	}
+const TeleinfoLabel* TeleinfoDecoder::getSchema(unsigned int* count) {
+	*count = TELEINFO_SCHEMA_LABELS;
+	return TELEINFO_SCHEMA;
+}
 
-	/**
-	 * Vérifie le checksum
-	 *
-	 * La "checksum" est calculée sur l'ensemble des caractères allant du début du champ étiquette
-	 * à la fin du champ donnée, caractère SP inclus. On fait tout d'abord la somme des codes ASCII
-	 * de tous ces caractères. Pour éviter d'introduire des fonctions ASCII (00 à 1F en hexadécimal),
-	 * on ne conserve que les six bits de poids faible du résultat obtenu (cette opération se traduit
-	 * par un ET logique entre la somme précédemment calculée et 03Fh).
-	 * Enfin, on ajoute 20 en hexadécimal.
-	 */
-	bool check() {
-		unsigned int sum = 0;
-		for (int i = 0; i < sizeof(etiquette); i++) {
-			sum = sum + etiquette[i];
-		}
-		sum = sum + 0x20;
-		for (int i = 0; i < sizeof(donnee); i++) {
-			sum = sum + donnee[i];
-		}
-		sum = (sum & 0x3F) + 0x20;
-		if (checksum == sum) {
-			return true;
-		} else {
-			return false;
+const TeleinfoLabel* TeleinfoDecoder::getLabel(unsigned long long field) {
+	for (unsigned int i = 0; i < TELEINFO_SCHEMA_LABELS; i++) {
+		if (TELEINFO_SCHEMA[i].field == field) {
+			return &TELEINFO_SCHEMA[i];
 		}
 	}
-
-	/**
-	 * Donne l'étiquette
-	 */
-	char* getEtiquette() {
-		return etiquette;
-	}
-
-	/**
-	 * Donne la chaîne de donnée
-	 */
-	char* getDonnee() {
-		return donnee;
-	}
-};
-
+	return NULL;
+}
 
 /**
- * L'implémentation de Teleinfo
+ * Lecture d'une étiquette du schéma par les accesseurs de l'interface, pour une implémentation de Teleinfo sans TeleinfoRecord
  */
-class TeleinfoImpl : public Teleinfo {
-private :
-
-	unsigned long totalOffset;
-
-
-	// Toutes les données du compteur
-	// Voir : http://www.worldofgz.com/electronique/recuperer-la-teleinformation-erdf-sur-larduino/
-	char adco[12 + 1]; // Adresse du compteur (+1 octet pour une null-terminated-string)
-	char optarif[4 + 1]; // Option tarifaire choisie (+1 octet pour une null-terminated-string)
-	int isousc; // Intensité souscrite (A)
-
-	// Option BASE
-	unsigned long base; // Index option base (Wh)
-
-	// Option Heures Creuses
-	unsigned long hchc; // Index option heure creuse (Wh)
-	unsigned long hchp; // Index option heure pleine (Wh)
-
-	// Option EJP
-	unsigned long ejphn; // Index heures normales (Wh)
-	unsigned long ejphpm; // Index heures de pointe mobile (Wh)
-
-	// Option TEMPO
-	unsigned long bbrhcjb; // Index heures creuses jours bleus (Wh)
-	unsigned long bbrhpjb; // Index heures pleines jours bleus (Wh)
-	unsigned long bbrhcjw; // Index heures creuses jours blancs (Wh)
-	unsigned long bbrhpjw; // Index heures pleines jours blancs (Wh)
-	unsigned long bbrhcjr; // Index heures creuses jours rouges (Wh)
-	unsigned long bbrhpjr; // Index heures pleines jours rouges (Wh)
-
-	// Autreslo
-	int pejp; // Préavis heures EJP (min)
-	char ptec[4 + 1]; // Période tarifaire en cours (+1 octet pour une null-terminated-string)
-	char demain[4 + 1]; // Couleur du lendemain (+1 octet pour une null-terminated-string)
-	int iinst; // Intensité instantanée (A)
-	int adps; // Avertissement de dépassement de puissance souscrite (A)
-	int imax; // Intensité maximale appelée (A)
-	int papp; // Puissance apparent (VA)
-	char hhphc; // Horaire geure creuse heure pleine
-	char motdetat[6 + 1]; // Mot d'état du compteur (+1 octet pour une null-terminated-string)
-
-public:
-
-	TeleinfoImpl(unsigned long totalOffset) {
-		this->totalOffset = totalOffset;
-	}
-
-	// Méthodes de l'interface -------------------------------------------------------------------------------------------------
+unsigned long Teleinfo::getNumber(const TeleinfoLabel* label) {
+	switch (label->field) {
+		case TELEINFO_FIELD_ISOUSC : return getIsousc();
+		case TELEINFO_FIELD_BASE : return getBase();
+		case TELEINFO_FIELD_HCHC : return getHchc();
+		case TELEINFO_FIELD_HCHP : return getHchp();
+		case TELEINFO_FIELD_EJPHN : return getEjphn();
+		case TELEINFO_FIELD_EJPHPM : return getEjphpm();
+		case TELEINFO_FIELD_BBRHCJB : return getBbrhcjb();
+		case TELEINFO_FIELD_BBRHPJB : return getBbrhpjb();
+		case TELEINFO_FIELD_BBRHCJW : return getBbrhcjw();
+		case TELEINFO_FIELD_BBRHPJW : return getBbrhpjw();
+		case TELEINFO_FIELD_BBRHCJR : return getBbrhcjr();
+		case TELEINFO_FIELD_BBRHPJR : return getBbrhpjr();
+		case TELEINFO_FIELD_PEJP : return getPejp();
+		case TELEINFO_FIELD_IINST : return getIinst();
+		case TELEINFO_FIELD_ADPS : return getAdps();
+		case TELEINFO_FIELD_IMAX : return getImax();
+		case TELEINFO_FIELD_PAPP : return getPapp();
+		case TELEINFO_FIELD_HHPHC : return (unsigned char) getHhphc();
+		case TELEINFO_FIELD_IINST1 : return getIinstPhase(1);
+		case TELEINFO_FIELD_IINST2 : return getIinstPhase(2);
+		case TELEINFO_FIELD_IINST3 : return getIinstPhase(3);
+		case TELEINFO_FIELD_IMAX1 : return getImaxPhase(1);
+		case TELEINFO_FIELD_IMAX2 : return getImaxPhase(2);
+		case TELEINFO_FIELD_IMAX3 : return getImaxPhase(3);
+		case TELEINFO_FIELD_PMAX : return getPmax();
+		case TELEINFO_FIELD_ADIR1 : return getAdirPhase(1);
+		case TELEINFO_FIELD_ADIR2 : return getAdirPhase(2);
+		case TELEINFO_FIELD_ADIR3 : return getAdirPhase(3);
+	}
+	return 0;
+}
 
-	char* getAdco() {
-		return adco;
+const char* Teleinfo::getText(const TeleinfoLabel* label) {
+	switch (label->field) {
+		case TELEINFO_FIELD_ADCO : return getAdco();
+		case TELEINFO_FIELD_OPTARIF : return getOptarif();
+		case TELEINFO_FIELD_PTEC : return getPtec();
+		case TELEINFO_FIELD_DEMAIN : return getDemain();
+		case TELEINFO_FIELD_MOTDETAT : return getMotdetat();
+		case TELEINFO_FIELD_PPOT : return getPpot();
 	}
-    unsigned long getAdcoAsLong() {
-    	return strtoul(adco, NULL, 10);
-    }
-    unsigned int getAdcoChecksum8() {
-    	unsigned int checksum8 = 0;
-    	char* ptr = adco;
-    	while(int val = *ptr) {
-    		checksum8 = (checksum8 + *ptr++) & 0xFF;
-    	}
-    	return checksum8;
-    }
+	return "";
+}
 
-	char* getOptarif() {
-		return optarif;
-	}
-	int getIsousc() {
-		return isousc;
-	}
-	unsigned long getBase() {
-		return base;
-	}
-	unsigned long getHchc() {
-		return hchc;
-	}
-	unsigned long getHchp() {
-		return hchp;
-	}
-	unsigned long getEjphn() {
-		return ejphn;
-	}
-	unsigned long getEjphpm() {
-		return ejphpm;
-	}
-	unsigned long getBbrhcjb() {
-		return bbrhcjb;
-	}
-	unsigned long getBbrhpjb() {
-		return bbrhpjb;
-	}
-	unsigned long getBbrhcjw() {
-		return bbrhcjw;
-	}
-	unsigned long getBbrhpjw() {
-		return bbrhpjw;
-	}
-	unsigned long getBbrhcjr() {
-		return bbrhcjr;
-	}
-	unsigned long getBbrhpjr() {
-		return bbrhpjr;
-	}
-	int getPejp() {
-		return pejp;
-	}
-	char* getPtec() {
-		return ptec;
-	}
-	char* getDemain() {
-		return demain;
-	}
-	int getIinst() {
-		return iinst;
-	}
-	int getAdps() {
-		return adps;
-	}
-	int getImax() {
-		return imax;
-	}
-	int getPapp() {
-		return papp;
-	}
-	char getHhphc() {
-		return hhphc;
-	}
-	char* getMotdetat() {
-		return motdetat;
-	}
+/*********************************************************************************************************************************************************************
+   CLASSES INTERNES
+ *********************************************************************************************************************************************************************/
 
-	// Méthodes pratiques ------------------------------------------------------------------------------------------------------
+/**
+ * Etat du décodeur sauvegardé dans un point de reprise
+ */
+struct TeleinfoDecoderState {
+	uint32_t hasFrame;            // 1 si frame contient une trame, 0 si aucune trame n'a encore été décodée
+	uint32_t reserved;
+	TeleinfoStats stats;
+	TeleinfoImplState frame;      // Dernière trame valide et état du décodage d'une trame à la suivante
+};
 
-	unsigned long getTotalIndex() {
-		return (base + hchc + hchp + ejphn + ejphpm + bbrhcjb + bbrhpjb + bbrhcjw + bbrhpjw + bbrhcjr + bbrhpjr) - totalOffset;
-	}
+/**
+ * Accesseurs de TeleinfoFrame qui ne sont pas définis dans la déclaration
+ */
+unsigned long TeleinfoFrame::getAdcoAsLong() {
+	return strtoul(getAdco(), NULL, 10);
+}
 
-	unsigned long getTotalOffset() {
-		return totalOffset;
+unsigned int TeleinfoFrame::getAdcoChecksum8() {
+	unsigned int checksum8 = 0;
+	char* ptr = getAdco();
+	while (*ptr != '\0') {
+		checksum8 = (checksum8 + *ptr++) & 0xFF;
 	}
+	return checksum8;
+}
 
-	int getInstPower() {
-		if(papp > 0) {
-				return papp;
-
-		} else if(iinst > 0) {
-			return iinst * 230;
-
-		} else{
-			return 0;
+/**
+ * Méthodes de TeleinfoImpl qui dépendent du schéma des étiquettes
+ */
+void TeleinfoImpl::invalidate() {
+	for (unsigned int i = 0; i < TELEINFO_SCHEMA_LABELS; i++) {
+		if (TELEINFO_SCHEMA[i].field & TELEINFO_FIELDS_TRANSIENT) {
+			clear(&TELEINFO_SCHEMA[i]);
 		}
 	}
+	knownFields &= ~TELEINFO_FIELDS_TRANSIENT;
+	frame.validFields = 0;
+	frame.carriedFields = 0;
+	droppedGroupes = 0;
+	acceptedGroupes = 0;
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+	memset(&timestamps, 0, sizeof(timestamps));
+#endif
+}
 
-	// Divers ------------------------------------------------------------------------------------------------------------------
+bool TeleinfoImpl::isPlausible(const char* etiquette, const char* donnee) {
+	const TeleinfoLabel* label = findLabel(etiquette);
+	if (label == NULL) {
+		return false;
+	}
+	if (strlen(donnee) != label->length) {
+		return false;
+	}
+	switch (label->grammar) {
+		case TELEINFO_GRAMMAR_VALUES :
+			return matchesValues(donnee, label->values);
+
+		case TELEINFO_GRAMMAR_HEX :
+			return strspn(donnee, "0123456789ABCDEF") == label->length;
+
+		case TELEINFO_GRAMMAR_INDEX : {
+			if (strspn(donnee, "0123456789") != label->length) {
+				return false;
+			}
+			unsigned long last = lastIndexes[label->index];
+			if (last == 0) {
+				return true;
+			}
+			unsigned long value = strtoul(donnee, NULL, 10);
+			unsigned long step = (value + TELEINFO_INDEX_MODULO - last) % TELEINFO_INDEX_MODULO;
+			return step <= TELEINFO_REPAIR_INDEX_STEP;
+		}
 
-	/**
-	 * Remet à zéro les groupes d'informations.
-	 * Ne remete pas à zéro l'offest total car celui-ci est constant une fois qu'il a été initialisé
-	 */
-	void reset() {
-		memset(adco, '\0', sizeof(adco));
-		memset(optarif, '\0', sizeof(optarif));
-		isousc = 0;
-		base = 0;
-		hchc = 0;
-		hchp = 0;
-		ejphn = 0;
-		ejphpm = 0;
-		bbrhcjb = 0;
-		bbrhpjb = 0;
-		bbrhcjw = 0;
-		bbrhpjw = 0;
-		bbrhcjr = 0;
-		bbrhpjr = 0;
-		pejp = 0;
-		memset(ptec, '\0', sizeof(ptec));
-		memset(demain, '\0', sizeof(demain));
-		iinst = 0;
-		adps = 0;
-		imax = 0;
-		papp = 0;
-		hhphc = '\0';
-		memset(motdetat, '\0', sizeof(motdetat));
+		default :
+			return strspn(donnee, "0123456789") == label->length;
 	}
+}
 
-	/**
-	 * Recalcule l'offset total
-	 */
-	void computeTotalOffset() {
-		if(totalOffset == TELEINFO_TOTAL_OFFSET_AUTO) {
-			totalOffset = 0; // Pour ne pas perturber le calcul d el'index total
-			totalOffset = getTotalIndex();
-		}
+void TeleinfoImpl::store(TeleinfoGroupe* teleinfoGroupe) {
+	acceptedGroupes++;
+	const TeleinfoLabel* label = findLabel(teleinfoGroupe->getEtiquette());
+	if (label == NULL) {
+		return;
 	}
+	char* donnee = teleinfoGroupe->getDonnee();
+	switch (label->type) {
+		case TELEINFO_TYPE_NUMBER :
+			frame.record.numbers[label->slot] = strtoul(donnee, NULL, 10);
+			break;
 
-	/**
-	 *  Trasfert les données d'un groupe dans la structure totale Teleinfo
-	 */
-	void store(TeleinfoGroupe* teleinfoGroupe) {
-		char* etiquette = teleinfoGroupe->getEtiquette();
-		char* donnee = teleinfoGroupe->getDonnee();
-		if (strcmp(etiquette, "ADCO") == 0) {
-			strcpy(adco, donnee);
-
-		} else if (strcmp(etiquette, "OPTARIF") == 0) {
-			strcpy(optarif, donnee);
-
-		} else if (strcmp(etiquette, "ISOUSC") == 0) {
-			isousc = atoi(donnee);
-
-		} else if (strcmp(etiquette, "BASE") == 0) {
-			base = strtoul(donnee, NULL, 10);
-
-		} else if (strcmp(etiquette, "HCHC") == 0) {
-			hchc = strtoul(donnee, NULL, 10);
-
-		} else if (strcmp(etiquette, "HCHP") == 0) {
-			hchp = strtoul(donnee, NULL, 10);
-
-		} else if (strcmp(etiquette, "EJPHN") == 0) {
-			ejphn = strtoul(donnee, NULL, 10);
+		case TELEINFO_TYPE_SHORT :
+			frame.record.shorts[label->slot] = (uint16_t) atoi(donnee);
+			break;
 
-		} else if (strcmp(etiquette, "EJPHPM") == 0) {
-			ejphpm = strtoul(donnee, NULL, 10);
-
-		} else if (strcmp(etiquette, "BBRHCJB") == 0) {
-			bbrhcjb = strtoul(donnee, NULL, 10);
-
-		} else if (strcmp(etiquette, "BBRHPJB") == 0) {
-			bbrhpjb = strtoul(donnee, NULL, 10);
-
-		} else if (strcmp(etiquette, "BBRHCJW") == 0) {
-			bbrhcjw = strtoul(donnee, NULL, 10);
-
-		} else if (strcmp(etiquette, "BBRHPJW") == 0) {
-			bbrhpjw = strtoul(donnee, NULL, 10);
-
-		} else if (strcmp(etiquette, "BBRHCJR") == 0) {
-			bbrhcjr = strtoul(donnee, NULL, 10);
-
-		} else if (strcmp(etiquette, "BBRHPJR") == 0) {
-			bbrhpjr = strtoul(donnee, NULL, 10);
-
-		} else if (strcmp(etiquette, "PEJP") == 0) {
-			pejp = atoi(donnee);
-
-		} else if (strcmp(etiquette, "PTEC") == 0) {
-			strcpy(ptec, donnee);
-
-		} else if (strcmp(etiquette, "DEMAIN") == 0) {
-			strcpy(demain, donnee);
-
-		} else if (strcmp(etiquette, "IINST") == 0) {
-			iinst = atoi(donnee);
-
-		} else if (strcmp(etiquette, "ADPS") == 0) {
-			adps = atoi(donnee);
-
-		} else if (strcmp(etiquette, "IMAX") == 0) {
-			imax = atoi(donnee);
-
-		} else if (strcmp(etiquette, "PAPP") == 0) {
-			papp = atoi(donnee);
-
-		} else if (strcmp(etiquette, "HHPHC") == 0) {
-			hhphc = donnee[0];
-
-		} else if (strcmp(etiquette, "MOTDETAT") == 0) {
-			strcpy(motdetat, donnee);
-		}
+		case TELEINFO_TYPE_CHAR :
+			frame.record.texts[label->slot] = donnee[0];
+			break;
 
+		default : // Texte tronqué à la longueur de la donnée
+			strncpy(&frame.record.texts[label->slot], donnee, label->length);
+			frame.record.texts[label->slot + label->length] = '\0';
+			break;
 	}
-
-};
+	frame.validFields |= label->field;
+}
 
 /*********************************************************************************************************************************************************************
    MACHINE D'ETAT DE DECODAGE DES TRAMES TELEINFO
@@ -413,6 +262,7 @@ public:
  */
 class StateInterface {
 public:
+	virtual ~StateInterface() {}
 	/* Chaque action donne l'état suivant ou lui même. NULL si aucun état suivant trame Téléinfo terminée */
 	virtual StateInterface* stx() = 0;
 	virtual StateInterface* etx() = 0;
@@ -421,7 +271,7 @@ public:
 	virtual StateInterface* lf() = 0;
 	virtual StateInterface* space() = 0;
 	virtual StateInterface* other(char character) = 0;
-	virtual Teleinfo* getResult() = 0;
+	virtual TeleinfoFrame* getResult() = 0;
 	virtual const char* getName() = 0;
 };
 
@@ -438,9 +288,16 @@ private:
 	StateInterface* waitingEndGroupeState;
 	StateInterface* waitingEndTextOrStartGroupeState;
 	StateInterface* terminatedState;
+	StateInterface* skippingGroupeState;
+	unsigned int options;
+	TeleinfoStats stats;
+	unsigned long id;
 
 public:
 	StateRegistry(TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl);
+	~StateRegistry();
+	StateRegistry(const StateRegistry&) = delete; // Possède ses états
+	StateRegistry& operator=(const StateRegistry&) = delete;
 	StateInterface* getWaitingStartTextState();
 	StateInterface* getWaitingStartGroupeState();
 	StateInterface* getReadingEtiquetteState();
@@ -449,6 +306,12 @@ public:
 	StateInterface* getWaitingEndGroupeState();
 	StateInterface* getWaitingEndTextOrStartGroupeState();
 	StateInterface* getTerminatedState();
+	StateInterface* getSkippingGroupeState();
+	unsigned int getOptions();
+	void setOptions(unsigned int options);
+	TeleinfoStats* getStats();
+	unsigned long getId();
+	void setId(unsigned long id);
 };
 
 /**
@@ -467,29 +330,41 @@ public:
 		this->teleinfoImpl = teleinfoImpl;
 	}
 	StateInterface* stx() {
-		return stateRegistry->getWaitingStartTextState();
+		return fallback(TELEINFO_CHAR_STX);
 	}
 	StateInterface* etx() {
-		return stateRegistry->getWaitingStartTextState();
+		return fallback(TELEINFO_CHAR_ETX);
 	}
 	StateInterface* eot() {
-		return stateRegistry->getWaitingStartTextState();
+		return fallback(TELEINFO_CHAR_EOT);
 	}
 	StateInterface* cr() {
-		return stateRegistry->getWaitingStartTextState();
+		return fallback(TELEINFO_CHAR_CR);
 	}
 	StateInterface* lf() {
-		return stateRegistry->getWaitingStartTextState();
+		return fallback(TELEINFO_CHAR_LF);
 	}
 	StateInterface* space() {
-		return stateRegistry->getWaitingStartTextState();
+		return fallback(TELEINFO_CHAR_SPACE);
 	}
 	StateInterface* other(char character) {
-		return stateRegistry->getWaitingStartTextState();
+		return fallback(character);
 	}
-	Teleinfo* getResult() {
+	TeleinfoFrame* getResult() {
 		return NULL;
 	}
+
+protected:
+	/**
+	 * Caractère inattendu : retour à l'attente d'un STX (sonde fallback, sauf depuis l'attente d'un STX elle-même)
+	 */
+	StateInterface* fallback(char character) {
+		StateInterface* waitingStartTextState = stateRegistry->getWaitingStartTextState();
+		if (this != waitingStartTextState) {
+			TELEINFO_PROBE3(fallback, stateRegistry->getId(), getName(), character);
+		}
+		return waitingStartTextState;
+	}
 };
 
 class WaitingStartTextState: public DefaultState {
@@ -498,8 +373,13 @@ public:
 		// do nothing
 	}
 	StateInterface* stx() {
-		// Vidage des données du compteur
-		teleinfoImpl->reset();
+		TELEINFO_PROBE1(frame_start, stateRegistry->getId());
+		// Vidage des données du compteur, sauf en report des dernières valeurs valides
+		if (stateRegistry->getOptions() & TELEINFO_OPTION_CARRY_FORWARD) {
+			teleinfoImpl->invalidate();
+		} else {
+			teleinfoImpl->reset();
+		}
 		return stateRegistry->getWaitingStartGroupeState();
 	}
 	const char* getName() {
@@ -507,9 +387,77 @@ public:
 	}
 };
 
-class WaitingStartGroupeState: public DefaultState {
+/**
+ * Etat à l'intérieur d'une trame.
+ * En mode récupération (TELEINFO_OPTION_SALVAGE), un caractère inattendu n'écarte que le groupe en cours : la suite
+ * est ignorée jusqu'au LF du groupe suivant ou jusqu'au ETX de fin de trame.
+ * Une trame dont aucun groupe n'a été accepté est perdue, comme hors mode récupération.
+ */
+class FrameState: public DefaultState {
+private:
+	bool groupe; // Etat de lecture d'un groupe
+
+public:
+	FrameState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl, bool groupe) : DefaultState(stateRegistry, teleinfoGroupe, teleinfoImpl) {
+		this->groupe = groupe;
+	}
+	StateInterface* stx() {
+		if (isSalvaging()) {
+			return stateRegistry->getWaitingStartTextState()->stx(); // Début d'une nouvelle trame, la trame en cours est perdue
+		}
+		return DefaultState::stx();
+	}
+	StateInterface* etx() {
+		if (isSalvaging()) {
+			if (groupe) {
+				teleinfoImpl->dropGroupe();
+			}
+			if (teleinfoImpl->getAcceptedGroupes() == 0) {
+				return fallback(TELEINFO_CHAR_ETX); // Aucun groupe accepté : pas de trame à publier
+			}
+			return stateRegistry->getWaitingEndTextOrStartGroupeState()->etx();
+		}
+		return DefaultState::etx();
+	}
+	StateInterface* lf() {
+		if (isSalvaging()) {
+			if (groupe) {
+				teleinfoImpl->dropGroupe();
+			}
+			return stateRegistry->getWaitingStartGroupeState()->lf();
+		}
+		return DefaultState::lf();
+	}
+	StateInterface* cr() {
+		return error(TELEINFO_CHAR_CR);
+	}
+	StateInterface* space() {
+		return error(TELEINFO_CHAR_SPACE);
+	}
+	StateInterface* other(char character) {
+		return error(character);
+	}
+
+protected:
+	bool isSalvaging() {
+		return stateRegistry->getOptions() & TELEINFO_OPTION_SALVAGE;
+	}
+
+	/**
+	 * Caractère inattendu : abandon de la trame, ou en mode récupération abandon du groupe en cours
+	 */
+	StateInterface* error(char character) {
+		if (isSalvaging()) {
+			teleinfoImpl->dropGroupe();
+			return stateRegistry->getSkippingGroupeState();
+		}
+		return fallback(character);
+	}
+};
+
+class WaitingStartGroupeState: public FrameState {
 public:
-	WaitingStartGroupeState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : DefaultState(stateRegistry, teleinfoGroupe, teleinfoImpl) {
+	WaitingStartGroupeState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : FrameState(stateRegistry, teleinfoGroupe, teleinfoImpl, false) {
 		// do nothing
 	}
 	StateInterface* lf() {
@@ -521,9 +469,9 @@ public:
 	}
 };
 
-class ReadingEtiquetteState: public DefaultState {
+class ReadingEtiquetteState: public FrameState {
 public:
-	ReadingEtiquetteState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : DefaultState(stateRegistry, teleinfoGroupe, teleinfoImpl) {
+	ReadingEtiquetteState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : FrameState(stateRegistry, teleinfoGroupe, teleinfoImpl, true) {
 		// do nothing
 	}
 	StateInterface* space() {
@@ -538,9 +486,9 @@ public:
 	}
 };
 
-class ReadingDonneeState: public DefaultState {
+class ReadingDonneeState: public FrameState {
 public:
-	ReadingDonneeState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : DefaultState(stateRegistry, teleinfoGroupe, teleinfoImpl) {
+	ReadingDonneeState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : FrameState(stateRegistry, teleinfoGroupe, teleinfoImpl, true) {
 		// do nothing
 	}
 	StateInterface* space() {
@@ -555,9 +503,9 @@ public:
 	}
 };
 
-class ReadingChecksumState: public DefaultState {
+class ReadingChecksumState: public FrameState {
 public:
-	ReadingChecksumState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : DefaultState(stateRegistry, teleinfoGroupe, teleinfoImpl) {
+	ReadingChecksumState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : FrameState(stateRegistry, teleinfoGroupe, teleinfoImpl, true) {
 		// do nothing
 	}
 	StateInterface* space() {
@@ -573,35 +521,95 @@ public:
 	}
 };
 
-class WaitingEndGroupeState: public DefaultState {
+class WaitingEndGroupeState: public FrameState {
 public:
-	WaitingEndGroupeState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : DefaultState(stateRegistry, teleinfoGroupe, teleinfoImpl) {
+	WaitingEndGroupeState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : FrameState(stateRegistry, teleinfoGroupe, teleinfoImpl, true) {
 		// do nothing
 	}
 	StateInterface* cr() {
-		if (teleinfoGroupe->check()) {
+		bool valid = stateRegistry->getOptions() & TELEINFO_OPTION_REPAIR ? repair() : teleinfoGroupe->check();
+		if (valid) {
+			TELEINFO_PROBE2(checksum_ok, stateRegistry->getId(), teleinfoGroupe->getEtiquette());
 			teleinfoImpl->store(teleinfoGroupe);
 			return stateRegistry->getWaitingEndTextOrStartGroupeState();
 		} else {
 			// checksum error
-			return stateRegistry->getWaitingStartTextState();
+			TELEINFO_PROBE3(checksum_fail, stateRegistry->getId(), teleinfoGroupe->getEtiquette(), teleinfoGroupe->getDonnee());
+			return error(TELEINFO_CHAR_CR);
 		}
 	}
 	const char* getName() {
 		return "WaitingEndGroupeState";
 	}
+
+private:
+	/**
+	 * Réparation d'un groupe dont un caractère a été reçu avec une erreur de parité.
+	 * Parmi le caractère reçu (seul le bit de parité était faux) et ceux qui en diffèrent d'un bit, la réparation
+	 * retient le seul qui donne un checksum valide et une donnée plausible. Si aucun ou plusieurs conviennent,
+	 * le groupe n'est pas réparé.
+	 *
+	 * Dès qu'une erreur de parité a été vue, quel que soit le nombre de caractères en cause, un checksum valide
+	 * ne suffit pas : le groupe n'est accepté que si sa donnée est aussi plausible.
+	 *
+	 * @return true si le groupe est valide, éventuellement après réparation
+	 */
+	bool repair() {
+		TeleinfoStats* stats = stateRegistry->getStats();
+		char* suspect = teleinfoGroupe->getSuspect();
+		if (teleinfoGroupe->getSuspects() == 0) {
+			return teleinfoGroupe->check();
+		} else if (teleinfoGroupe->getSuspects() > 1) {
+			// Plusieurs caractères erronés : pas de réparation, le groupe n'est accepté que tel qu'il a été reçu
+			if (teleinfoGroupe->check() && teleinfoImpl->isPlausible(teleinfoGroupe->getEtiquette(), teleinfoGroupe->getDonnee())) {
+				return true;
+			}
+			stats->rejectedRepairs++;
+			return false;
+		}
+
+		bool checksum = teleinfoGroupe->isChecksum(suspect);
+		char received = *suspect;
+		char repaired = received;
+		int candidates = 0;
+		for (int bit = -1; bit < 7; bit++) {
+			char candidate = bit < 0 ? received : received ^ (1 << bit);
+			// Le caractère remplacé n'a pas été interprété comme un caractère spécial, le candidat ne peut pas en être un
+			if (checksum ? (candidate < 0x20 || candidate > 0x5F) : (candidate <= TELEINFO_CHAR_SPACE || candidate == 0x7F)) {
+				continue;
+			}
+			*suspect = candidate;
+			if (teleinfoGroupe->check() && teleinfoImpl->isPlausible(teleinfoGroupe->getEtiquette(), teleinfoGroupe->getDonnee())) {
+				repaired = candidate;
+				candidates++;
+			}
+		}
+
+		if (candidates == 1) {
+			*suspect = repaired;
+			if (repaired != received) {
+				stats->repairs++;
+			}
+			return true;
+		}
+		*suspect = received;
+		stats->rejectedRepairs++;
+		return false;
+	}
 };
 
-class WaitingEndTextOrStartGroupeState: public DefaultState {
+class WaitingEndTextOrStartGroupeState: public FrameState {
 public:
-	WaitingEndTextOrStartGroupeState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : DefaultState(stateRegistry, teleinfoGroupe, teleinfoImpl) {
+	WaitingEndTextOrStartGroupeState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : FrameState(stateRegistry, teleinfoGroupe, teleinfoImpl, false) {
 		// do nothing
 	}
 	StateInterface* lf() {
 		return stateRegistry->getWaitingStartGroupeState()->lf(); // Début d'une nouvelle ligne, on fait suivre à WaitingStartGroupeState
 	}
 	StateInterface* etx() { // C'est ici que la trame Téléinfo se termine !
-		teleinfoImpl->computeTotalOffset();
+		teleinfoImpl->computeTotalIndex();
+		teleinfoImpl->computeCarriedFields();
+		teleinfoImpl->rememberIndexes();
 		return stateRegistry->getTerminatedState();
 	}
 	const char* getName() {
@@ -609,6 +617,28 @@ public:
 	}
 };
 
+/**
+ * Mode récupération : groupe écarté, en attente du groupe suivant ou de la fin de la trame
+ */
+class SkippingGroupeState: public FrameState {
+public:
+	SkippingGroupeState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : FrameState(stateRegistry, teleinfoGroupe, teleinfoImpl, false) {
+		// do nothing
+	}
+	StateInterface* cr() {
+		return this;
+	}
+	StateInterface* space() {
+		return this;
+	}
+	StateInterface* other(char character) {
+		return this;
+	}
+	const char* getName() {
+		return "SkippingGroupeState";
+	}
+};
+
 class TerminatedState: public DefaultState {
 public:
 	TerminatedState(StateRegistry* stateRegistry, TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* teleinfoImpl) : DefaultState(stateRegistry, teleinfoGroupe, teleinfoImpl) {
@@ -617,8 +647,8 @@ public:
 	const char* getName() {
 		return "TerminatedState";
 	}
-	Teleinfo* getResult() {
-		return teleinfoImpl;
+	TeleinfoFrame* getResult() {
+		return teleinfoImpl->getFrame();
 	}
 };
 
@@ -632,6 +662,21 @@ StateRegistry::StateRegistry(TeleinfoGroupe* teleinfoGroupe, TeleinfoImpl* telei
 	waitingEndGroupeState = new WaitingEndGroupeState(this, teleinfoGroupe, teleinfoImpl);
 	waitingEndTextOrStartGroupeState = new WaitingEndTextOrStartGroupeState(this, teleinfoGroupe, teleinfoImpl);
 	terminatedState = new TerminatedState(this, teleinfoGroupe, teleinfoImpl);
+	skippingGroupeState = new SkippingGroupeState(this, teleinfoGroupe, teleinfoImpl);
+	options = 0;
+	memset(&stats, 0, sizeof(stats));
+	id = 0;
+}
+StateRegistry::~StateRegistry() {
+	delete waitingStartTextState;
+	delete waitingStartGroupeState;
+	delete readingEtiquetteState;
+	delete readingDonneeState;
+	delete readingChecksumState;
+	delete waitingEndGroupeState;
+	delete waitingEndTextOrStartGroupeState;
+	delete terminatedState;
+	delete skippingGroupeState;
 }
 StateInterface* StateRegistry::getWaitingStartTextState() {
 	return waitingStartTextState;
@@ -657,6 +702,24 @@ StateInterface* StateRegistry::getWaitingEndTextOrStartGroupeState() {
 StateInterface* StateRegistry::getTerminatedState() {
 	return terminatedState;
 }
+StateInterface* StateRegistry::getSkippingGroupeState() {
+	return skippingGroupeState;
+}
+unsigned int StateRegistry::getOptions() {
+	return options;
+}
+void StateRegistry::setOptions(unsigned int options) {
+	this->options = options;
+}
+TeleinfoStats* StateRegistry::getStats() {
+	return &stats;
+}
+unsigned long StateRegistry::getId() {
+	return id;
+}
+void StateRegistry::setId(unsigned long id) {
+	this->id = id;
+}
 
 /*********************************************************************************************************************************************************************
   LE DECODEUR TELEINFO (PIMPL IDIOM) @see https://en.wikibooks.org/wiki/C%2B%2B_Programming/Idioms#Pointer_To_Implementation_.28pImpl.29
@@ -666,10 +729,23 @@ StateInterface* StateRegistry::getTerminatedState() {
  */
 class TeleinfoDecoder::TeleinfoDecoderImpl {
 private:
+	static unsigned long createdDecoders; // Nombre de décodeurs créés : identifiant par défaut du décodeur suivant
+
 	TeleinfoGroupe* teleinfoGroupe;
 	TeleinfoImpl* teleinfoImpl;
 	StateRegistry* stateRegistry;
 	StateInterface* currentState;
+	TeleinfoStats* stats;
+	TeleinfoImplState* lastFrame;  // Copie de la dernière trame valide, NULL tant qu'elle n'est pas demandée (voir keepLastFrame())
+	bool hasLastFrame;             // lastFrame contient une trame
+	bool frameInImpl;              // teleinfoImpl contient encore la dernière trame terminée (aucun STX depuis)
+	TeleinfoImpl* restoredFrame;   // Dernière trame valide, reconstruite à la demande (voir getLastFrame()), NULL avant le premier appel
+	TeleinfoClock clock;           // Source de dates, NULL pour l'horloge monotone du système
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+	// Ces membres ne sont pas visibles de l'application (idiome pimpl) : ils ne coûtent de mémoire qu'avec l'horodatage
+	uint64_t lastEtx; // Date du ETX de la trame précédente, 0 si aucune
+	TeleinfoHistogram histograms[TELEINFO_HISTOGRAMS];
+#endif
 
 public:
 
@@ -680,22 +756,53 @@ public:
 		teleinfoGroupe = new TeleinfoGroupe();
 		teleinfoImpl = new TeleinfoImpl(totalOffset);
 		stateRegistry = new StateRegistry(teleinfoGroupe, teleinfoImpl);
+		stats = stateRegistry->getStats();
+		stateRegistry->setId(__atomic_fetch_add(&createdDecoders, 1, __ATOMIC_RELAXED)); // Décodeurs créés par plusieurs threads
+		lastFrame = NULL;
+		hasLastFrame = false;
+		frameInImpl = false;
+		restoredFrame = NULL;
+		clock = NULL;
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+		lastEtx = 0;
+#endif
 		reset();
 	}
 
+	~TeleinfoDecoderImpl() {
+		delete restoredFrame;
+		delete lastFrame;
+		delete stateRegistry;
+		delete teleinfoImpl;
+		delete teleinfoGroupe;
+	}
+
+	TeleinfoDecoderImpl(const TeleinfoDecoderImpl&) = delete;
+	TeleinfoDecoderImpl& operator=(const TeleinfoDecoderImpl&) = delete;
+
 	/**
 	 * Décodage d'un caractère flux Téléinfo
 	 */
-	Teleinfo* decode(int character) {
+	TeleinfoFrame* decode(int character) {
 		if(character == -1) { // Pré-filtre : on ignore les caractères -1
 			return NULL;
 		}
 
+		bool repairing = stateRegistry->getOptions() & TELEINFO_OPTION_REPAIR;
+		if (repairing) {
+			bool parityError = hasParityError(character);
+			if (parityError) {
+				stats->parityErrors++;
+			}
+			teleinfoGroupe->setParityError(parityError);
+		}
+
 		character = character & 0x7F; // Pré-filtre (les caractères sont stockés sur 7 bits + 1 bit de parité)
 
 		StateInterface* nextState;
 		switch (character) {
 			case TELEINFO_CHAR_STX  :
+				frameInImpl = false; // Le début d'une trame efface la précédente
 				nextState = currentState->stx();
 				break;
 
@@ -724,28 +831,310 @@ public:
 				break;
 		}
 
+		if ((nextState == stateRegistry->getWaitingStartTextState() || character == TELEINFO_CHAR_STX) && currentState != stateRegistry->getWaitingStartTextState()) {
+			stats->lostFrames++;
+		}
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+		stamp(character, nextState);
+#endif
 		currentState = nextState;
+		if (repairing) {
+			teleinfoGroupe->setParityError(false);
+		}
 
-		Teleinfo* result = currentState->getResult();
+		TeleinfoFrame* result = currentState->getResult();
 		if(result != NULL) {
+			TELEINFO_PROBE3(frame_end, stateRegistry->getId(), result->getValidFields(), teleinfoImpl->getDroppedGroupes());
+			stats->frames++;
+			if (teleinfoImpl->getDroppedGroupes() > 0) {
+				stats->salvagedFrames++;
+				stats->droppedGroupes += teleinfoImpl->getDroppedGroupes();
+			}
+			frameInImpl = true;
+			if (lastFrame != NULL) {
+				teleinfoImpl->save(lastFrame);
+				hasLastFrame = true;
+			}
 			reset();
 		}
 		return result;
 	}
 
+	/**
+	 * Décodage d'un bloc d'octets du flux Téléinfo, jusqu'à la fin du bloc ou d'une trame
+	 */
+	TeleinfoFrame* decode(const unsigned char* buffer, unsigned int length, unsigned int* consumed) {
+		TeleinfoFrame* result = NULL;
+		unsigned int index = 0;
+		bool repairing = stateRegistry->getOptions() & TELEINFO_OPTION_REPAIR;
+		while (index < length && result == NULL) {
+			// Accélération : les caractères ordinaires d'une étiquette ou d'une donnée sont ajoutés
+			// directement au groupe, sans passer par la machine d'état pour chacun d'eux
+			if (currentState == stateRegistry->getReadingEtiquetteState()) {
+				while (index < length && isOrdinary(buffer[index]) && !(repairing && hasParityError(buffer[index]))) {
+					teleinfoGroupe->appendToEtiquette(buffer[index++] & 0x7F);
+				}
+			} else if (currentState == stateRegistry->getReadingDonneeState()) {
+				while (index < length && isOrdinary(buffer[index]) && !(repairing && hasParityError(buffer[index]))) {
+					teleinfoGroupe->appendToDonnee(buffer[index++] & 0x7F);
+				}
+			}
+			if (index < length) {
+				result = decode(buffer[index++]);
+			}
+		}
+		if (consumed != NULL) {
+			*consumed = index;
+		}
+		return result;
+	}
+
+	/**
+	 * Retour à l'état initial, en attente du début d'une trame
+	 */
+	void reset() {
+		currentState = stateRegistry->getWaitingStartTextState();
+	}
+
+	void setOptions(unsigned int options) {
+		stateRegistry->setOptions(options);
+		if (options & TELEINFO_OPTION_KEEP_LAST_FRAME) {
+			keepLastFrame();
+		}
+	}
+
+	unsigned int getOptions() {
+		return stateRegistry->getOptions();
+	}
+
+	void getStats(TeleinfoStats* stats) {
+		*stats = *this->stats;
+	}
+
+	void resetStats() {
+		memset(stats, 0, sizeof(TeleinfoStats));
+	}
+
+	void setId(unsigned long id) {
+		stateRegistry->setId(id);
+	}
+
+	unsigned long getId() {
+		return stateRegistry->getId();
+	}
+
+	TeleinfoFrame* getLastFrame() {
+		keepLastFrame();
+		if (!hasLastFrame) {
+			return NULL;
+		}
+		if (restoredFrame == NULL) {
+			restoredFrame = new TeleinfoImpl(TELEINFO_TOTAL_OFFSET_NONE);
+		}
+		restoredFrame->restore(lastFrame);
+		return restoredFrame->getFrame();
+	}
+
+	unsigned long getStateSize() {
+		return sizeof(TeleinfoDecoderState);
+	}
+
+	void saveState(void* buffer) {
+		TeleinfoDecoderState* state = (TeleinfoDecoderState*) buffer;
+		memset(state, 0, sizeof(TeleinfoDecoderState));
+		keepLastFrame();
+		state->hasFrame = hasLastFrame ? 1 : 0;
+		state->stats = *stats;
+		if (hasLastFrame) {
+			state->frame = *lastFrame;
+		}
+	}
+
+	bool restoreState(const void* buffer, unsigned long size) {
+		if (size != sizeof(TeleinfoDecoderState)) {
+			return false;
+		}
+		const TeleinfoDecoderState* state = (const TeleinfoDecoderState*) buffer;
+		*stats = state->stats;
+		keepLastFrame();
+		hasLastFrame = state->hasFrame != 0;
+		frameInImpl = false;
+		if (hasLastFrame) {
+			// Le décodage reprend avec l'offset, les index et les champs connus de la dernière trame
+			*lastFrame = state->frame;
+			teleinfoImpl->restore(lastFrame);
+			frameInImpl = true;
+		}
+		reset();
+		return true;
+	}
+
+	void setClock(TeleinfoClock clock) {
+		this->clock = clock;
+	}
+
+	void acknowledge(Teleinfo* teleinfo) {
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+		if (teleinfo != NULL) {
+			uint64_t now = readClock();
+			uint64_t etx = teleinfo->getTimestamps()->etx;
+			histograms[TELEINFO_HISTOGRAM_CONSUMER].record(now > etx ? now - etx : 0);
+		}
+#endif
+	}
+
+	TeleinfoHistogram* getHistogram(int histogram) {
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+		if (histogram >= 0 && histogram < TELEINFO_HISTOGRAMS) {
+			return &histograms[histogram];
+		}
+#endif
+		return NULL;
+	}
+
 	private:
-		void reset() {
-			currentState = stateRegistry->getWaitingStartTextState();
+
+		/**
+		 * Tient la copie de la dernière trame à partir du premier appel : la trame terminée est copiée si aucune
+		 * trame n'a commencé depuis
+		 */
+		void keepLastFrame() {
+			if (lastFrame != NULL) {
+				return;
+			}
+			lastFrame = new TeleinfoImplState();
+			if (frameInImpl) {
+				teleinfoImpl->save(lastFrame);
+				hasLastFrame = true;
+			}
+		}
+
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+		/**
+		 * Horodatage des transitions de la machine d'état : début de trame, groupe accepté, fin de trame
+		 */
+		void stamp(int character, StateInterface* nextState) {
+			if (character == TELEINFO_CHAR_STX && nextState == stateRegistry->getWaitingStartGroupeState()) {
+				uint64_t now = readClock();
+				teleinfoImpl->stampStx(now);
+				if (lastEtx != 0) {
+					histograms[TELEINFO_HISTOGRAM_GAP].record(now > lastEtx ? now - lastEtx : 0);
+				}
+
+			} else if (nextState == stateRegistry->getWaitingEndTextOrStartGroupeState() && currentState == stateRegistry->getWaitingEndGroupeState()) {
+				teleinfoImpl->stampGroupe(readClock());
+
+			} else if (nextState == stateRegistry->getTerminatedState()) {
+				uint64_t now = readClock();
+				teleinfoImpl->stampEtx(now);
+				histograms[TELEINFO_HISTOGRAM_ASSEMBLY].record(now - teleinfoImpl->getFrame()->getTimestamps()->stx);
+				lastEtx = now;
+			}
+		}
+
+		/**
+		 * Lecture de la source de dates
+		 */
+		uint64_t readClock() {
+			return clock != NULL ? clock() : monotonicClock();
+		}
+
+		/**
+		 * Horloge monotone du système, en nanosecondes
+		 */
+		static uint64_t monotonicClock() {
+#ifdef ARDUINO
+			return (uint64_t) micros() * 1000;
+#else
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+		}
+#endif
+
+		/**
+		 * Indique si un octet est un caractère ordinaire (ni caractère spécial du protocole, ni espace)
+		 */
+		static bool isOrdinary(unsigned char character) {
+			switch (character & 0x7F) {
+				case TELEINFO_CHAR_STX :
+				case TELEINFO_CHAR_ETX :
+				case TELEINFO_CHAR_EOT :
+				case TELEINFO_CHAR_LF :
+				case TELEINFO_CHAR_CR :
+				case TELEINFO_CHAR_SPACE :
+					return false;
+				default :
+					return true;
+			}
+		}
+
+		/**
+		 * Indique si un octet reçu avec son bit de parité (bit de poids fort) a une erreur de parité (parité paire)
+		 */
+		static bool hasParityError(unsigned char character) {
+			return __builtin_parity(character);
 		}
 };
 
+unsigned long TeleinfoDecoder::TeleinfoDecoderImpl::createdDecoders = 0;
+
 /**
  * TeleinfoDecoder : redirection -> TeleinfoDecoder::TeleinfoDecoderImpl
  */
 TeleinfoDecoder::TeleinfoDecoder(unsigned long totalOffset) {
 	pimpl_ = new TeleinfoDecoderImpl(totalOffset);
 }
-Teleinfo* TeleinfoDecoder::decode(int character) {
+TeleinfoDecoder::~TeleinfoDecoder() {
+	delete pimpl_;
+}
+TeleinfoFrame* TeleinfoDecoder::decode(int character) {
 	return pimpl_->decode(character);
 }
-
+TeleinfoFrame* TeleinfoDecoder::decode(const unsigned char* buffer, unsigned int length, unsigned int* consumed) {
+	return pimpl_->decode(buffer, length, consumed);
+}
+void TeleinfoDecoder::reset() {
+	pimpl_->reset();
+}
+void TeleinfoDecoder::setOptions(unsigned int options) {
+	pimpl_->setOptions(options);
+}
+unsigned int TeleinfoDecoder::getOptions() {
+	return pimpl_->getOptions();
+}
+void TeleinfoDecoder::getStats(TeleinfoStats* stats) {
+	pimpl_->getStats(stats);
+}
+void TeleinfoDecoder::resetStats() {
+	pimpl_->resetStats();
+}
+void TeleinfoDecoder::setId(unsigned long id) {
+	pimpl_->setId(id);
+}
+unsigned long TeleinfoDecoder::getId() {
+	return pimpl_->getId();
+}
+TeleinfoFrame* TeleinfoDecoder::getLastFrame() {
+	return pimpl_->getLastFrame();
+}
+unsigned long TeleinfoDecoder::getStateSize() {
+	return pimpl_->getStateSize();
+}
+void TeleinfoDecoder::saveState(void* buffer) {
+	pimpl_->saveState(buffer);
+}
+bool TeleinfoDecoder::restoreState(const void* buffer, unsigned long size) {
+	return pimpl_->restoreState(buffer, size);
+}
+void TeleinfoDecoder::setClock(TeleinfoClock clock) {
+	pimpl_->setClock(clock);
+}
+void TeleinfoDecoder::acknowledge(Teleinfo* teleinfo) {
+	pimpl_->acknowledge(teleinfo);
+}
+TeleinfoHistogram* TeleinfoDecoder::getHistogram(int histogram) {
+	return pimpl_->getHistogram(histogram);
+}
+
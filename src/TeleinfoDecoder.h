@@ -23,6 +23,234 @@
  */
 #define TELEINFO_TOTAL_OFFSET_NONE    0
 
+/**
+ * Options du décodeur (voir TeleinfoDecoder::setOptions(...))
+ */
+#define TELEINFO_OPTION_SALVAGE         0x01  // Un groupe invalide n'écarte que lui-même, la trame est conservée
+#define TELEINFO_OPTION_CARRY_FORWARD   0x02  // Un groupe absent de la trame garde sa dernière valeur valide
+#define TELEINFO_OPTION_REPAIR          0x04  // Réparation d'un caractère erroné par la parité et le checksum (octets reçus avec leur bit de parité)
+#define TELEINFO_OPTION_KEEP_LAST_FRAME 0x08  // Copie de chaque trame terminée, pour getLastFrame() et saveState(...) (voir getLastFrame())
+
+/**
+ * Valeur à laquelle un index repasse à zéro (index sur 9 chiffres)
+ */
+#define TELEINFO_INDEX_MODULO           1000000000UL
+
+/**
+ * Ecart maximal d'un index d'une trame à la suivante pour qu'une réparation soit plausible (Wh)
+ */
+#ifndef TELEINFO_REPAIR_INDEX_STEP
+#define TELEINFO_REPAIR_INDEX_STEP      1000
+#endif
+
+/**
+ * Champs d'une trame, pour les masques de validité (voir Teleinfo::getValidFields())
+ */
+#define TELEINFO_FIELD_ADCO       (1ULL << 0)
+#define TELEINFO_FIELD_OPTARIF    (1ULL << 1)
+#define TELEINFO_FIELD_ISOUSC     (1ULL << 2)
+#define TELEINFO_FIELD_BASE       (1ULL << 3)
+#define TELEINFO_FIELD_HCHC       (1ULL << 4)
+#define TELEINFO_FIELD_HCHP       (1ULL << 5)
+#define TELEINFO_FIELD_EJPHN      (1ULL << 6)
+#define TELEINFO_FIELD_EJPHPM     (1ULL << 7)
+#define TELEINFO_FIELD_BBRHCJB    (1ULL << 8)
+#define TELEINFO_FIELD_BBRHPJB    (1ULL << 9)
+#define TELEINFO_FIELD_BBRHCJW    (1ULL << 10)
+#define TELEINFO_FIELD_BBRHPJW    (1ULL << 11)
+#define TELEINFO_FIELD_BBRHCJR    (1ULL << 12)
+#define TELEINFO_FIELD_BBRHPJR    (1ULL << 13)
+#define TELEINFO_FIELD_PEJP       (1ULL << 14)
+#define TELEINFO_FIELD_PTEC       (1ULL << 15)
+#define TELEINFO_FIELD_DEMAIN     (1ULL << 16)
+#define TELEINFO_FIELD_IINST      (1ULL << 17)
+#define TELEINFO_FIELD_ADPS       (1ULL << 18)
+#define TELEINFO_FIELD_IMAX       (1ULL << 19)
+#define TELEINFO_FIELD_PAPP       (1ULL << 20)
+#define TELEINFO_FIELD_HHPHC      (1ULL << 21)
+#define TELEINFO_FIELD_MOTDETAT   (1ULL << 22)
+#define TELEINFO_FIELD_IINST1     (1ULL << 23)  // Compteurs triphasés (voir TELEINFO_DISABLE_THREE_PHASE)
+#define TELEINFO_FIELD_IINST2     (1ULL << 24)
+#define TELEINFO_FIELD_IINST3     (1ULL << 25)
+#define TELEINFO_FIELD_IMAX1      (1ULL << 26)
+#define TELEINFO_FIELD_IMAX2      (1ULL << 27)
+#define TELEINFO_FIELD_IMAX3      (1ULL << 28)
+#define TELEINFO_FIELD_PMAX       (1ULL << 29)
+#define TELEINFO_FIELD_PPOT       (1ULL << 30)
+#define TELEINFO_FIELD_ADIR1      (1ULL << 31)
+#define TELEINFO_FIELD_ADIR2      (1ULL << 32)
+#define TELEINFO_FIELD_ADIR3      (1ULL << 33)
+
+/**
+ * Champs qui ne sont émis que ponctuellement (préavis EJP, dépassement de puissance) : ils ne sont jamais reportés
+ */
+#define TELEINFO_FIELDS_TRANSIENT (TELEINFO_FIELD_PEJP | TELEINFO_FIELD_ADPS | TELEINFO_FIELD_ADIR1 | TELEINFO_FIELD_ADIR2 | TELEINFO_FIELD_ADIR3)
+
+/**
+ * Emplacements des valeurs d'une trame (voir TeleinfoRecord), dans l'ordre de leur tableau
+ *
+ * Les étiquettes des compteurs triphasés (IINST1..3, IMAX1..3, PMAX, PPOT, ADIR1..3) occupent les derniers emplacements
+ * de chaque tableau : compilé avec TELEINFO_DISABLE_THREE_PHASE, le décodeur ne les reconnaît plus et une trame n'en paie pas la place.
+ * L'option change la taille de TeleinfoRecord, donc la disposition de TeleinfoFrame et de TeleinfoSnapshot dont les accesseurs
+ * sont définis ici : elle doit être la même pour la bibliothèque et pour l'application qui l'utilise.
+ */
+#define TELEINFO_SLOT_BASE        0   // numbers : index (Wh) et puissances
+#define TELEINFO_SLOT_HCHC        1
+#define TELEINFO_SLOT_HCHP        2
+#define TELEINFO_SLOT_EJPHN       3
+#define TELEINFO_SLOT_EJPHPM      4
+#define TELEINFO_SLOT_BBRHCJB     5
+#define TELEINFO_SLOT_BBRHPJB     6
+#define TELEINFO_SLOT_BBRHCJW     7
+#define TELEINFO_SLOT_BBRHPJW     8
+#define TELEINFO_SLOT_BBRHCJR     9
+#define TELEINFO_SLOT_BBRHPJR     10
+#define TELEINFO_SLOT_PAPP        11
+#define TELEINFO_SLOT_PMAX        12
+
+#define TELEINFO_SLOT_ISOUSC      0   // shorts : intensités (A) et préavis (min)
+#define TELEINFO_SLOT_PEJP        1
+#define TELEINFO_SLOT_IINST       2
+#define TELEINFO_SLOT_ADPS        3
+#define TELEINFO_SLOT_IMAX        4
+#define TELEINFO_SLOT_IINST1      5
+#define TELEINFO_SLOT_IINST2      6
+#define TELEINFO_SLOT_IINST3      7
+#define TELEINFO_SLOT_IMAX1       8
+#define TELEINFO_SLOT_IMAX2       9
+#define TELEINFO_SLOT_IMAX3       10
+#define TELEINFO_SLOT_ADIR1       11
+#define TELEINFO_SLOT_ADIR2       12
+#define TELEINFO_SLOT_ADIR3       13
+
+#define TELEINFO_SLOT_ADCO        0   // texts : position du texte, terminé par un caractère nul
+#define TELEINFO_SLOT_OPTARIF     13
+#define TELEINFO_SLOT_PTEC        18
+#define TELEINFO_SLOT_DEMAIN      23
+#define TELEINFO_SLOT_MOTDETAT    28
+#define TELEINFO_SLOT_HHPHC       35  // Un seul caractère, sans caractère nul
+#define TELEINFO_SLOT_PPOT        36
+
+#ifdef TELEINFO_DISABLE_THREE_PHASE
+#define TELEINFO_SLOTS_NUMBERS    12
+#define TELEINFO_SLOTS_SHORTS     5
+#define TELEINFO_SLOTS_TEXTS      36
+#else
+#define TELEINFO_SLOTS_NUMBERS    13
+#define TELEINFO_SLOTS_SHORTS     14
+#define TELEINFO_SLOTS_TEXTS      40
+#endif
+
+/**
+ * Types des emplacements (voir TeleinfoRecord)
+ */
+#define TELEINFO_TYPE_NUMBER      0   // Entier sur 32 bits (numbers)
+#define TELEINFO_TYPE_SHORT       1   // Entier sur 16 bits (shorts)
+#define TELEINFO_TYPE_TEXT        2   // Texte terminé par un caractère nul (texts)
+#define TELEINFO_TYPE_CHAR        3   // Caractère unique (texts)
+
+/**
+ * Grammaire des données, pour la réparation des groupes
+ */
+#define TELEINFO_GRAMMAR_DIGITS   0   // Chiffres décimaux
+#define TELEINFO_GRAMMAR_INDEX    1   // Index : chiffres décimaux, croissant d'une trame à la suivante
+#define TELEINFO_GRAMMAR_HEX      2   // Chiffres hexadécimaux
+#define TELEINFO_GRAMMAR_VALUES   3   // Une valeur parmi une liste (séparateur '|', '?' pour un caractère quelconque)
+
+/**
+ * Etiquette du schéma des étiquettes connues : champ, emplacement de la valeur dans la trame et grammaire de la donnée
+ * (voir TeleinfoDecoder::getSchema(...))
+ */
+struct TeleinfoLabel {
+  const char* etiquette;
+  unsigned long long field;  // TELEINFO_FIELD_*
+  unsigned char type;        // TELEINFO_TYPE_*
+  unsigned char slot;        // TELEINFO_SLOT_*
+  unsigned char length;      // Longueur de la donnée
+  unsigned char grammar;     // TELEINFO_GRAMMAR_*
+  signed char index;         // TELEINFO_GRAMMAR_INDEX : le numéro de l'index
+  const char* values;        // TELEINFO_GRAMMAR_VALUES : les valeurs possibles
+};
+
+/**
+ * Compteurs d'activité du décodeur
+ */
+struct TeleinfoStats {
+  unsigned long frames;           // Trames décodées
+  unsigned long lostFrames;       // Trames abandonnées (erreur hors mode TELEINFO_OPTION_SALVAGE, STX ou EOT inattendu)
+  unsigned long salvagedFrames;   // Trames décodées malgré au moins un groupe écarté
+  unsigned long droppedGroupes;   // Groupes écartés dans les trames décodées
+  unsigned long parityErrors;     // Caractères reçus avec une erreur de parité (option TELEINFO_OPTION_REPAIR)
+  unsigned long repairs;          // Groupes réparés
+  unsigned long rejectedRepairs;  // Groupes invalides non réparés : aucune réparation plausible, ou plusieurs
+};
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Horodatage des trames (voir TELEINFO_ENABLE_TIMESTAMPS) : les déclarations qui suivent ne dépendent pas de l'option,
+ * seules les lectures de l'horloge en dépendent. Une application compilée avec ou sans l'option peut ainsi utiliser
+ * une bibliothèque compilée autrement : les classes gardent la même disposition.
+ */
+#include "TeleinfoHistogram.h"
+
+/**
+ * Nombre maximal de groupes horodatés par trame (les groupes suivants ne sont pas horodatés)
+ */
+#define TELEINFO_TIMESTAMPS_GROUPES   32
+
+/**
+ * Histogrammes de durées tenus par le décodeur
+ */
+#define TELEINFO_HISTOGRAM_ASSEMBLY   0  // Durée de réception d'une trame, de STX à ETX
+#define TELEINFO_HISTOGRAM_CONSUMER   1  // Délai entre ETX et la prise en compte de la trame (voir TeleinfoDecoder::acknowledge(...))
+#define TELEINFO_HISTOGRAM_GAP        2  // Silence entre deux trames, de ETX au STX suivant
+#define TELEINFO_HISTOGRAMS           3
+
+/**
+ * Source de dates du décodeur (en nanosecondes, monotone)
+ */
+typedef uint64_t (*TeleinfoClock)();
+
+/**
+ * Dates de réception d'une trame
+ */
+struct TeleinfoTimestamps {
+  uint64_t stx;                                  // Date du STX
+  uint64_t etx;                                  // Date du ETX
+  uint64_t groupes[TELEINFO_TIMESTAMPS_GROUPES]; // Date de fin (CR) de chaque groupe accepté, dans l'ordre de réception
+  unsigned int groupesCount;                     // Nombre de groupes horodatés
+};
+
+/**
+ * Valeurs d'une trame, rangées par type dans des emplacements contigus (TELEINFO_SLOT_*)
+ */
+struct TeleinfoRecord {
+  uint32_t numbers[TELEINFO_SLOTS_NUMBERS];
+  uint16_t shorts[TELEINFO_SLOTS_SHORTS];
+  char texts[TELEINFO_SLOTS_TEXTS];
+
+  /**
+   * Donne la valeur d'une étiquette numérique, ou le caractère d'une étiquette TELEINFO_TYPE_CHAR
+   */
+  unsigned long getNumber(const TeleinfoLabel* label) const {
+    switch (label->type) {
+      case TELEINFO_TYPE_NUMBER : return numbers[label->slot];
+      case TELEINFO_TYPE_SHORT : return shorts[label->slot];
+      case TELEINFO_TYPE_CHAR : return (unsigned char) texts[label->slot];
+    }
+    return 0;
+  }
+
+  /**
+   * Donne le texte d'une étiquette TELEINFO_TYPE_TEXT (texte vide pour une étiquette d'un autre type)
+   */
+  const char* getText(const TeleinfoLabel* label) const {
+    return label->type == TELEINFO_TYPE_TEXT ? &texts[label->slot] : "";
+  }
+};
+
 /**
  * Cette interface donne accès aux données du compteur qui ont été lues par le protocole Téléinfo
  */
@@ -143,6 +371,36 @@ class Teleinfo {
      */
     virtual char* getMotdetat()=0; 
 
+    // Compteurs triphasés : 0 (ou texte vide) pour un compteur monophasé, ou si le décodeur est compilé avec TELEINFO_DISABLE_THREE_PHASE
+
+    /**
+     * Triphasé : donne l'Intensité instantanée d'une phase (A)
+     * @param phase 1, 2 ou 3
+     */
+    virtual int getIinstPhase(int phase) { return 0; }
+
+    /**
+     * Triphasé : donne l'Intensité maximale appelée d'une phase (A)
+     * @param phase 1, 2 ou 3
+     */
+    virtual int getImaxPhase(int phase) { return 0; }
+
+    /**
+     * Triphasé : donne l'Avertissement de dépassement d'intensité de réglage d'une phase (A)
+     * @param phase 1, 2 ou 3
+     */
+    virtual int getAdirPhase(int phase) { return 0; }
+
+    /**
+     * Triphasé : donne la Puissance maximale triphasée atteinte (W)
+     */
+    virtual unsigned long getPmax() { return 0; }
+
+    /**
+     * Triphasé : donne la Présence des potentiels (2 caractères hexadécimaux)
+     */
+    virtual char* getPpot() { return (char*) ""; }
+
     // Fonctions spéciales -----------------------------------------------------------------------------------------------------------------
 
     /**
@@ -172,6 +430,104 @@ class Teleinfo {
      */
     virtual unsigned int getAdcoChecksum8()=0;
 
+    /**
+     * Donne les champs (TELEINFO_FIELD_*) dont un groupe valide a été reçu dans cette trame
+     * (0 par défaut, pour les implémentations qui ne tiennent pas ce masque)
+     */
+    virtual unsigned long long getValidFields() { return 0; }
+
+    /**
+     * Donne les champs (TELEINFO_FIELD_*) absents de cette trame dont la valeur est reportée d'une trame précédente
+     * (option TELEINFO_OPTION_CARRY_FORWARD ; 0 par défaut)
+     */
+    virtual unsigned long long getCarriedFields() { return 0; }
+
+    /**
+     * Donne les dates de réception de la trame (valables jusqu'au début de la trame suivante) ; NULL si le décodeur
+     * est compilé sans TELEINFO_ENABLE_TIMESTAMPS, et par défaut pour les implémentations qui ne les tiennent pas
+     */
+    virtual const TeleinfoTimestamps* getTimestamps() { return NULL; }
+
+    /**
+     * Donne la valeur d'une étiquette du schéma (voir TeleinfoDecoder::getSchema(...)) : nombre pour TELEINFO_TYPE_NUMBER
+     * et TELEINFO_TYPE_SHORT, caractère pour TELEINFO_TYPE_CHAR. Par défaut, la valeur est lue par l'accesseur de l'étiquette.
+     */
+    virtual unsigned long getNumber(const TeleinfoLabel* label);
+
+    /**
+     * Donne le texte d'une étiquette du schéma de type TELEINFO_TYPE_TEXT
+     */
+    virtual const char* getText(const TeleinfoLabel* label);
+
+};
+
+/**
+ * Trame décodée, implémentation de Teleinfo donnée par le décodeur
+ *
+ * La classe est finale et ses accesseurs sont définis ici : appelés sur un TeleinfoFrame* plutôt que sur un Teleinfo*,
+ * ils ne passent pas par la table virtuelle et sont intégrés par le compilateur à la boucle de l'appelant.
+ * Les accesseurs lisent les emplacements de l'enregistrement TeleinfoRecord, remplis d'après le schéma des étiquettes du décodeur.
+ * L'index total est calculé une seule fois, à la fin de la trame.
+ */
+class TeleinfoFrame final : public Teleinfo {
+  friend class TeleinfoImpl;
+
+  private:
+    unsigned long totalOffset;
+    unsigned long totalIndex;       // Somme des index moins l'offset, calculée à la fin de la trame
+    unsigned long long validFields; // Champs reçus dans la trame
+    unsigned long long carriedFields; // Champs reportés d'une trame précédente
+    TeleinfoRecord record;
+    const TeleinfoTimestamps* timestamps; // Tenues par le décodeur, NULL sans TELEINFO_ENABLE_TIMESTAMPS
+
+    TeleinfoFrame() {}
+
+  public:
+    char* getAdco() { return &record.texts[TELEINFO_SLOT_ADCO]; }
+    char* getOptarif() { return &record.texts[TELEINFO_SLOT_OPTARIF]; }
+    int getIsousc() { return record.shorts[TELEINFO_SLOT_ISOUSC]; }
+    unsigned long getBase() { return record.numbers[TELEINFO_SLOT_BASE]; }
+    unsigned long getHchc() { return record.numbers[TELEINFO_SLOT_HCHC]; }
+    unsigned long getHchp() { return record.numbers[TELEINFO_SLOT_HCHP]; }
+    unsigned long getEjphn() { return record.numbers[TELEINFO_SLOT_EJPHN]; }
+    unsigned long getEjphpm() { return record.numbers[TELEINFO_SLOT_EJPHPM]; }
+    unsigned long getBbrhcjb() { return record.numbers[TELEINFO_SLOT_BBRHCJB]; }
+    unsigned long getBbrhpjb() { return record.numbers[TELEINFO_SLOT_BBRHPJB]; }
+    unsigned long getBbrhcjw() { return record.numbers[TELEINFO_SLOT_BBRHCJW]; }
+    unsigned long getBbrhpjw() { return record.numbers[TELEINFO_SLOT_BBRHPJW]; }
+    unsigned long getBbrhcjr() { return record.numbers[TELEINFO_SLOT_BBRHCJR]; }
+    unsigned long getBbrhpjr() { return record.numbers[TELEINFO_SLOT_BBRHPJR]; }
+    int getPejp() { return record.shorts[TELEINFO_SLOT_PEJP]; }
+    char* getPtec() { return &record.texts[TELEINFO_SLOT_PTEC]; }
+    char* getDemain() { return &record.texts[TELEINFO_SLOT_DEMAIN]; }
+    int getIinst() { return record.shorts[TELEINFO_SLOT_IINST]; }
+    int getAdps() { return record.shorts[TELEINFO_SLOT_ADPS]; }
+    int getImax() { return record.shorts[TELEINFO_SLOT_IMAX]; }
+    int getPapp() { return record.numbers[TELEINFO_SLOT_PAPP]; }
+    char getHhphc() { return record.texts[TELEINFO_SLOT_HHPHC]; }
+    char* getMotdetat() { return &record.texts[TELEINFO_SLOT_MOTDETAT]; }
+#ifndef TELEINFO_DISABLE_THREE_PHASE
+    int getIinstPhase(int phase) { return phase >= 1 && phase <= 3 ? record.shorts[TELEINFO_SLOT_IINST1 + phase - 1] : 0; }
+    int getImaxPhase(int phase) { return phase >= 1 && phase <= 3 ? record.shorts[TELEINFO_SLOT_IMAX1 + phase - 1] : 0; }
+    int getAdirPhase(int phase) { return phase >= 1 && phase <= 3 ? record.shorts[TELEINFO_SLOT_ADIR1 + phase - 1] : 0; }
+    unsigned long getPmax() { return record.numbers[TELEINFO_SLOT_PMAX]; }
+    char* getPpot() { return &record.texts[TELEINFO_SLOT_PPOT]; }
+#endif
+    unsigned long getTotalIndex() { return totalIndex; }
+    unsigned long getTotalOffset() { return totalOffset; }
+    int getInstPower() { return getPapp() > 0 ? getPapp() : (getIinst() > 0 ? getIinst() * 230 : 0); }
+    unsigned long getAdcoAsLong();
+    unsigned int getAdcoChecksum8();
+    unsigned long long getValidFields() { return validFields; }
+    unsigned long long getCarriedFields() { return carriedFields; }
+    const TeleinfoTimestamps* getTimestamps() { return timestamps; }
+    unsigned long getNumber(const TeleinfoLabel* label) { return record.getNumber(label); }
+    const char* getText(const TeleinfoLabel* label) { return record.getText(label); }
+
+    /**
+     * Donne l'enregistrement des valeurs de la trame
+     */
+    const TeleinfoRecord* getRecord() { return &record; }
 };
 
 /**
@@ -191,18 +547,148 @@ class TeleinfoDecoder {
      * @param totalOffset un offset total facultatif
      */
     TeleinfoDecoder(unsigned long totalOffset = TELEINFO_TOTAL_OFFSET_NONE);
+    ~TeleinfoDecoder();
+
+    /**
+     * Le décodeur possède son implémentation : il n'est ni copiable ni affectable
+     */
+    TeleinfoDecoder(const TeleinfoDecoder&) = delete;
+    TeleinfoDecoder& operator=(const TeleinfoDecoder&) = delete;
 
     /**
      * Décode un caractère du flux Téléinfo
      * 
      * @return un objet Teleinfo qui donne accès aux données du compteur, ou NULL si aucun flux Téléinfo n'a pu Ãªtre lu
      */
-    Teleinfo* decode(int character);
+    TeleinfoFrame* decode(int character);
+
+    /**
+     * Décode un bloc d'octets du flux Téléinfo.
+     * Le décodage s'arrête dès qu'une trame est terminée : les octets restants du bloc sont à injecter lors d'un appel suivant.
+     *
+     * @param buffer les octets lus du flux
+     * @param length le nombre d'octets disponibles dans buffer
+     * @param consumed reçoit le nombre d'octets de buffer effectivement décodés (facultatif, peut être NULL)
+     * @return un objet Teleinfo si une trame a été terminée par le dernier octet consommé, NULL sinon
+     */
+    TeleinfoFrame* decode(const unsigned char* buffer, unsigned int length, unsigned int* consumed);
 
+    /**
+     * Abandonne la trame en cours de décodage : le décodeur attend le début d'une nouvelle trame
+     */
+    void reset();
+
+    /**
+     * Définit les options du décodeur
+     * @param options une combinaison de TELEINFO_OPTION_*, 0 par défaut : toute erreur fait abandonner la trame
+     */
+    void setOptions(unsigned int options);
+
+    /**
+     * Donne les options du décodeur
+     */
+    unsigned int getOptions();
+
+    /**
+     * Donne les compteurs d'activité du décodeur
+     */
+    void getStats(TeleinfoStats* stats);
+
+    /**
+     * Remet à zéro les compteurs d'activité du décodeur
+     */
+    void resetStats();
+
+    /**
+     * Donne l'identifiant du décodeur, premier argument des sondes USDT (voir TeleinfoProbes.h)
+     * Par défaut, les décodeurs sont numérotés à partir de 0 dans l'ordre de leur création.
+     */
+    unsigned long getId();
+
+    /**
+     * Fixe l'identifiant du décodeur (par exemple le numéro du compteur ou du port série)
+     */
+    void setId(unsigned long id);
+
+    /**
+     * Donne la dernière trame décodée sans erreur, conservée jusqu'à la trame suivante
+     * (ou restaurée par restoreState(...))
+     *
+     * La copie de la dernière trame n'est tenue qu'une fois demandée : par l'option TELEINFO_OPTION_KEEP_LAST_FRAME,
+     * ou à partir du premier appel de getLastFrame(), saveState(...) ou restoreState(...). Ce premier appel alloue
+     * la copie ; fait pendant la réception d'une trame, il ne retrouve pas la trame précédente.
+     *
+     * @return la trame, NULL si aucune trame n'a encore été décodée
+     */
+    TeleinfoFrame* getLastFrame();
+
+    /**
+     * Donne la taille de l'état du décodeur (voir saveState(...))
+     */
+    unsigned long getStateSize();
+
+    /**
+     * Copie l'état du décodeur pour un point de reprise : dernière trame valide, offset de l'index total,
+     * derniers index reçus et compteurs d'activité. La trame en cours de décodage n'est pas sauvegardée.
+     *
+     * @param buffer reçoit l'état, getStateSize() octets
+     */
+    void saveState(void* buffer);
+
+    /**
+     * Restaure l'état copié par saveState(...) : le décodeur attend le début d'une nouvelle trame
+     *
+     * @param buffer l'état
+     * @param size la taille de l'état
+     * @return false si la taille ne correspond pas (état d'une autre version de la bibliothèque), l'état est alors inchangé
+     */
+    bool restoreState(const void* buffer, unsigned long size);
+
+    // Horodatage : sans effet si le décodeur est compilé sans TELEINFO_ENABLE_TIMESTAMPS ----------------------------------------
+
+    /**
+     * Remplace la source de dates du décodeur, par exemple par une fonction qui donne la date de réception
+     * de l'octet en cours de décodage, relevée par l'appelant
+     *
+     * @param clock la source de dates, NULL pour l'horloge monotone du système
+     */
+    void setClock(TeleinfoClock clock);
+
+    /**
+     * Signale la prise en compte d'une trame par son destinataire : le délai depuis son ETX est enregistré
+     * dans l'histogramme TELEINFO_HISTOGRAM_CONSUMER
+     */
+    void acknowledge(Teleinfo* teleinfo);
+
+    /**
+     * Donne un histogramme de durées (en nanosecondes)
+     *
+     * @param histogram TELEINFO_HISTOGRAM_ASSEMBLY, TELEINFO_HISTOGRAM_CONSUMER ou TELEINFO_HISTOGRAM_GAP
+     * @return l'histogramme, NULL si le numéro est invalide ou si le décodeur est compilé sans TELEINFO_ENABLE_TIMESTAMPS
+     */
+    TeleinfoHistogram* getHistogram(int histogram);
+
+    // Schéma des étiquettes ------------------------------------------------------------------------------------------------------
+
+    /**
+     * Donne le schéma des étiquettes reconnues par le décodeur, dans l'ordre des champs TELEINFO_FIELD_*
+     * (sans les étiquettes des compteurs triphasés si le décodeur est compilé avec TELEINFO_DISABLE_THREE_PHASE)
+     *
+     * @param count reçoit le nombre d'étiquettes
+     */
+    static const TeleinfoLabel* getSchema(unsigned int* count);
+
+    /**
+     * Donne l'étiquette d'un champ
+     *
+     * @param field un champ TELEINFO_FIELD_*
+     * @return NULL si le champ n'est pas dans le schéma
+     */
+    static const TeleinfoLabel* getLabel(unsigned long long field);
 
 };
 
 #endif  // TELEINFO_DECODER_H_
 
 
-
+
@@ -0,0 +1,212 @@
+/**
+ * Implémentation de l'encodage de trames Téléinfo
+ *
+ * @author LK
+ */
+#include "TeleinfoEncoder.h"
+#include "TeleinfoInternal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*********************************************************************************************************************************************************************
+  CONSTANTES
+ *********************************************************************************************************************************************************************/
+
+/* Caractères de contrôle */
+#define TELEINFO_ENCODER_STX    0x02
+#define TELEINFO_ENCODER_ETX    0x03
+#define TELEINFO_ENCODER_LF     0x0A
+#define TELEINFO_ENCODER_CR     0x0D
+#define TELEINFO_ENCODER_SP     0x20
+
+/* Energie d'un Wh (VA.ms) */
+#define TELEINFO_ENCODER_WH     3600000ULL
+
+/* Tension pour le calcul de l'intensité (V) */
+#define TELEINFO_ENCODER_VOLTS  230
+
+/**
+ * Valeurs de PTEC, dans l'ordre des périodes (les étiquettes des index sont celles du schéma du décodeur)
+ */
+static const char* const PERIODS[TELEINFO_PERIODS] = { "TH..", "HC..", "HP..", "HN..", "PM..", "HCJB", "HPJB", "HCJW", "HPJW", "HCJR", "HPJR" };
+
+/**
+ * Valeurs de OPTARIF, libellés, première et dernière période de chaque option
+ */
+static const char* const OPTARIFS[TELEINFO_OPTARIFS] = { "BASE", "HC..", "EJP.", "BBR(" };
+static const char* const OPTARIF_NAMES[TELEINFO_OPTARIFS] = { "BASE", "HC", "EJP", "TEMPO" };
+static const int FIRST_PERIODS[TELEINFO_OPTARIFS] = { TELEINFO_PERIOD_TH, TELEINFO_PERIOD_HC, TELEINFO_PERIOD_HN, TELEINFO_PERIOD_HCJB };
+static const int LAST_PERIODS[TELEINFO_OPTARIFS] = { TELEINFO_PERIOD_TH, TELEINFO_PERIOD_HP, TELEINFO_PERIOD_PM, TELEINFO_PERIOD_HPJR };
+
+/**
+ * Valeurs de DEMAIN
+ */
+static const char* const DEMAINS[] = { "----", "BLEU", "BLAN", "ROUG" };
+
+/*********************************************************************************************************************************************************************
+  ENCODEUR
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Etiquette de l'index d'une période : l'index du schéma du décodeur qui porte le numéro de la période
+ */
+static const char* getIndexEtiquette(int period) {
+	unsigned int count;
+	const TeleinfoLabel* schema = TeleinfoDecoder::getSchema(&count);
+	for (unsigned int i = 0; i < count; i++) {
+		if (schema[i].grammar == TELEINFO_GRAMMAR_INDEX && schema[i].index == period) {
+			return schema[i].etiquette;
+		}
+	}
+	return "";
+}
+
+TeleinfoEncoder::TeleinfoEncoder(const char* adco, int optarif, int isousc) {
+	snprintf(this->adco, sizeof(this->adco), "%s", adco);
+	this->optarif = optarif >= 0 && optarif < TELEINFO_OPTARIFS ? optarif : TELEINFO_OPTARIF_BASE;
+	this->isousc = isousc;
+	period = FIRST_PERIODS[this->optarif];
+	demain = TELEINFO_DEMAIN_NONE;
+	preavis = false;
+	memset(index, 0, sizeof(index));
+	energy = 0;
+	power = 0;
+	imax = 0;
+}
+
+bool TeleinfoEncoder::setPeriod(int period) {
+	if (period < FIRST_PERIODS[optarif] || period > LAST_PERIODS[optarif]) {
+		return false;
+	}
+	this->period = period;
+	return true;
+}
+
+int TeleinfoEncoder::getPeriod() {
+	return period;
+}
+
+void TeleinfoEncoder::setDemain(int demain) {
+	this->demain = demain >= TELEINFO_DEMAIN_NONE && demain <= TELEINFO_DEMAIN_ROUGE ? demain : TELEINFO_DEMAIN_NONE;
+}
+
+void TeleinfoEncoder::setPreavis(bool preavis) {
+	this->preavis = preavis;
+}
+
+void TeleinfoEncoder::setPower(int power) {
+	this->power = power > 0 ? (power < 99999 ? power : 99999) : 0;
+	if (getIinst() > imax) {
+		imax = getIinst();
+	}
+}
+
+int TeleinfoEncoder::getIinst() {
+	return (power + TELEINFO_ENCODER_VOLTS - 1) / TELEINFO_ENCODER_VOLTS;
+}
+
+void TeleinfoEncoder::setIndex(int period, unsigned long value) {
+	if (period >= 0 && period < TELEINFO_PERIODS) {
+		index[period] = value % TELEINFO_INDEX_MODULO;
+	}
+}
+
+unsigned long TeleinfoEncoder::getIndex(int period) {
+	return period >= 0 && period < TELEINFO_PERIODS ? index[period] : 0;
+}
+
+void TeleinfoEncoder::advance(uint64_t milliseconds) {
+	energy += (uint64_t) power * milliseconds;
+	if (energy >= TELEINFO_ENCODER_WH) {
+		index[period] = (index[period] + energy / TELEINFO_ENCODER_WH) % TELEINFO_INDEX_MODULO;
+		energy %= TELEINFO_ENCODER_WH;
+	}
+}
+
+unsigned int TeleinfoEncoder::encode(unsigned char* output, bool parity) {
+	char value[16];
+	unsigned int length = 0;
+	output[length++] = parity ? withParity(TELEINFO_ENCODER_STX) : TELEINFO_ENCODER_STX;
+	length += appendGroupe(&output[length], "ADCO", adco, parity);
+	length += appendGroupe(&output[length], "OPTARIF", OPTARIFS[optarif], parity);
+	snprintf(value, sizeof(value), "%02d", isousc);
+	length += appendGroupe(&output[length], "ISOUSC", value, parity);
+	for (int indexPeriod = FIRST_PERIODS[optarif]; indexPeriod <= LAST_PERIODS[optarif]; indexPeriod++) {
+		snprintf(value, sizeof(value), "%09lu", index[indexPeriod]);
+		length += appendGroupe(&output[length], getIndexEtiquette(indexPeriod), value, parity);
+	}
+	if (optarif == TELEINFO_OPTARIF_EJP && preavis) {
+		length += appendGroupe(&output[length], "PEJP", "30", parity);
+	}
+	length += appendGroupe(&output[length], "PTEC", PERIODS[period], parity);
+	if (optarif == TELEINFO_OPTARIF_TEMPO) {
+		length += appendGroupe(&output[length], "DEMAIN", DEMAINS[demain], parity);
+	}
+	int iinst = getIinst();
+	snprintf(value, sizeof(value), "%03d", iinst);
+	length += appendGroupe(&output[length], "IINST", value, parity);
+	if (iinst > isousc) {
+		length += appendGroupe(&output[length], "ADPS", value, parity);
+	}
+	snprintf(value, sizeof(value), "%03d", imax);
+	length += appendGroupe(&output[length], "IMAX", value, parity);
+	snprintf(value, sizeof(value), "%05d", power);
+	length += appendGroupe(&output[length], "PAPP", value, parity);
+	length += appendGroupe(&output[length], "HHPHC", "A", parity);
+	length += appendGroupe(&output[length], "MOTDETAT", "000000", parity);
+	output[length++] = parity ? withParity(TELEINFO_ENCODER_ETX) : TELEINFO_ENCODER_ETX;
+	return length;
+}
+
+int TeleinfoEncoder::parseOptarif(const char* name) {
+	for (int optarif = 0; optarif < TELEINFO_OPTARIFS; optarif++) {
+		if (strcmp(name, OPTARIF_NAMES[optarif]) == 0) {
+			return optarif;
+		}
+	}
+	return -1;
+}
+
+int TeleinfoEncoder::parsePeriod(const char* ptec) {
+	for (int period = 0; period < TELEINFO_PERIODS; period++) {
+		if (strcmp(ptec, PERIODS[period]) == 0) {
+			return period;
+		}
+	}
+	return TELEINFO_PERIOD_UNKNOWN;
+}
+
+char TeleinfoEncoder::checksum(const char* etiquette, const char* donnee) {
+	return TeleinfoGroupe::computeChecksum(etiquette, strlen(etiquette), donnee, strlen(donnee));
+}
+
+unsigned char TeleinfoEncoder::withParity(unsigned char character) {
+	character &= 0x7F;
+	return __builtin_parity(character) ? character | 0x80 : character;
+}
+
+/**
+ * Ajoute un groupe : LF étiquette SP donnée SP checksum CR
+ * @return le nombre d'octets ajoutés
+ */
+unsigned int TeleinfoEncoder::appendGroupe(unsigned char* output, const char* etiquette, const char* donnee, bool parity) {
+	unsigned int length = 0;
+	output[length++] = TELEINFO_ENCODER_LF;
+	for (const char* ptr = etiquette; *ptr; ptr++) {
+		output[length++] = *ptr;
+	}
+	output[length++] = TELEINFO_ENCODER_SP;
+	for (const char* ptr = donnee; *ptr; ptr++) {
+		output[length++] = *ptr;
+	}
+	output[length++] = TELEINFO_ENCODER_SP;
+	output[length++] = checksum(etiquette, donnee);
+	output[length++] = TELEINFO_ENCODER_CR;
+	if (parity) {
+		for (unsigned int i = 0; i < length; i++) {
+			output[i] = withParity(output[i]);
+		}
+	}
+	return length;
+}
@@ -0,0 +1,142 @@
+/**
+ * Déclaration de l'encodage de trames Téléinfo (simulation de compteurs)
+ *
+ * Un encodeur tient l'état d'un compteur monophasé (option tarifaire, période en cours, index, puissance apparente)
+ * et produit ses trames octet pour octet comme le compteur : groupes LF étiquette SP donnée SP checksum CR avec le
+ * checksum vérifié par le décodeur, trame entre STX et ETX, bit de parité paire optionnel (7E1). La forme de la trame
+ * suit l'option tarifaire :
+ *   - BASE  : BASE, PTEC TH..
+ *   - HC    : HCHC, HCHP, PTEC HC.. ou HP..
+ *   - EJP   : EJPHN, EJPHPM, PEJP pendant le préavis, PTEC HN.. ou PM..
+ *   - TEMPO : BBRHCJB ... BBRHPJR, PTEC HCJB ... HPJR, DEMAIN
+ * avec ADCO, OPTARIF, ISOUSC, IINST, ADPS en cas de dépassement de la puissance souscrite, IMAX, PAPP, HHPHC et MOTDETAT.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_ENCODER_H_
+#define TELEINFO_ENCODER_H_
+
+#include "TeleinfoTariff.h"
+
+#include <stdint.h>
+
+/**
+ * Options tarifaires
+ */
+#define TELEINFO_OPTARIF_BASE        0
+#define TELEINFO_OPTARIF_HC          1
+#define TELEINFO_OPTARIF_EJP         2
+#define TELEINFO_OPTARIF_TEMPO       3
+#define TELEINFO_OPTARIFS            4
+
+/**
+ * Taille maximale d'une trame encodée (octets)
+ */
+#define TELEINFO_ENCODER_FRAME_SIZE  512
+
+/**
+ * Encodeur des trames d'un compteur
+ */
+class TeleinfoEncoder {
+  private:
+    char adco[16];
+    int optarif;
+    int isousc;
+    int period;                               // Période en cours (TELEINFO_PERIOD_*)
+    int demain;                               // Couleur du lendemain (TELEINFO_DEMAIN_*), option TEMPO
+    bool preavis;                             // Préavis de pointe mobile, option EJP
+    unsigned long index[TELEINFO_PERIODS];    // Index de chaque période (Wh)
+    uint64_t energy;                          // Energie pas encore comptée dans l'index (VA.ms)
+    int power;                                // Puissance apparente (VA)
+    int imax;
+
+    unsigned int appendGroupe(unsigned char* output, const char* etiquette, const char* donnee, bool parity);
+
+  public:
+    /**
+     * Création d'un encodeur
+     * @param adco l'adresse du compteur (12 chiffres)
+     * @param optarif l'option tarifaire (TELEINFO_OPTARIF_*)
+     * @param isousc l'intensité souscrite (A)
+     */
+    TeleinfoEncoder(const char* adco, int optarif, int isousc = 30);
+
+    /**
+     * Change de période tarifaire
+     * @return false si la période n'existe pas dans l'option tarifaire du compteur
+     */
+    bool setPeriod(int period);
+
+    /**
+     * Donne la période tarifaire en cours
+     */
+    int getPeriod();
+
+    /**
+     * Fixe la couleur du lendemain (option TEMPO)
+     */
+    void setDemain(int demain);
+
+    /**
+     * Active ou désactive le préavis de pointe mobile (option EJP)
+     */
+    void setPreavis(bool preavis);
+
+    /**
+     * Fixe la puissance apparente (VA) : IINST en découle, ADPS est émis si IINST dépasse ISOUSC
+     */
+    void setPower(int power);
+
+    /**
+     * Donne l'intensité instantanée (A)
+     */
+    int getIinst();
+
+    /**
+     * Fixe un index
+     */
+    void setIndex(int period, unsigned long value);
+
+    /**
+     * Donne un index
+     */
+    unsigned long getIndex(int period);
+
+    /**
+     * Fait avancer le temps : l'énergie consommée à la puissance en cours est ajoutée à l'index de la période
+     * @param milliseconds la durée écoulée (ms)
+     */
+    void advance(uint64_t milliseconds);
+
+    /**
+     * Encode une trame complète (STX ... ETX)
+     * @param output reçoit la trame, au moins TELEINFO_ENCODER_FRAME_SIZE octets
+     * @param parity true pour ajouter le bit de parité paire à chaque octet (liaison 7E1)
+     * @return la longueur de la trame
+     */
+    unsigned int encode(unsigned char* output, bool parity);
+
+    /**
+     * Donne l'option tarifaire correspondant à un libellé ("BASE", "HC", "EJP", "TEMPO"), -1 si inconnu
+     */
+    static int parseOptarif(const char* name);
+
+    /**
+     * Donne la période correspondant à une valeur de PTEC ("HC..", "HPJR"...), TELEINFO_PERIOD_UNKNOWN si inconnue
+     */
+    static int parsePeriod(const char* ptec);
+
+    /**
+     * Calcule le checksum d'un groupe : somme des caractères de l'étiquette, du séparateur et de la donnée, réduite à ses
+     * 6 bits de poids faible, plus 0x20 (calcul du décodeur, voir TeleinfoGroupe::check())
+     */
+    static char checksum(const char* etiquette, const char* donnee);
+
+    /**
+     * Ajoute le bit de parité paire à un caractère sur 7 bits
+     */
+    static unsigned char withParity(unsigned char character);
+};
+
+#endif  // TELEINFO_ENCODER_H_
@@ -0,0 +1,251 @@
+/**
+ * Implémentation de la table des dernières valeurs d'un parc de compteurs
+ *
+ * @author LK
+ */
+#include "TeleinfoFleet.h"
+
+#include <stdlib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Ramène une valeur de la trame dans un tableau de 16 bits
+ */
+static int16_t narrow(int value) {
+	if (value < 0) {
+		return 0;
+	}
+	return value < TELEINFO_FLEET_NO_LIMIT ? value : TELEINFO_FLEET_NO_LIMIT - 1;
+}
+
+/**
+ * Copie les numéros des compteurs d'un bloc retenus par le masque (un bit par compteur)
+ * @return le nombre de compteurs trouvés, y compris ceux du bloc
+ */
+static unsigned int collect(unsigned int mask, unsigned int base, uint32_t* meters, unsigned int capacity, unsigned int found) {
+	while (mask != 0) {
+		if (found < capacity) {
+			meters[found] = base + __builtin_ctz(mask);
+		}
+		found++;
+		mask &= mask - 1;
+	}
+	return found;
+}
+
+#ifdef __SSE2__
+static inline __m128i load(const void* address) {
+	return _mm_loadu_si128((const __m128i*) address);
+}
+#endif
+
+TeleinfoFleet::TeleinfoFleet(unsigned int meters) {
+	unsigned int padded = (meters + TELEINFO_FLEET_LANES - 1) / TELEINFO_FLEET_LANES * TELEINFO_FLEET_LANES;
+	// Un seul bloc, les tableaux les plus larges en tête : chacun reste aligné sur sa taille d'élément
+	memory = malloc((unsigned long) padded * (sizeof(uint64_t) + sizeof(int32_t) + 3 * sizeof(int16_t)));
+	if (memory == NULL) {
+		padded = 0;
+		meters = 0;
+	}
+	timestamps = (uint64_t*) memory;
+	power = (int32_t*) (timestamps + padded);
+	iinst = (int16_t*) (power + padded);
+	isousc = iinst + padded;
+	adps = isousc + padded;
+	metersCount = meters;
+	paddedCount = padded;
+	// Les compteurs de complément restent vides : ils ne sont jamais retenus
+	for (unsigned int meter = 0; meter < paddedCount; meter++) {
+		reset(meter);
+	}
+}
+
+TeleinfoFleet::~TeleinfoFleet() {
+	free(memory);
+}
+
+void TeleinfoFleet::reset(unsigned int meter) {
+	timestamps[meter] = 0;
+	power[meter] = TELEINFO_FLEET_NO_POWER;
+	iinst[meter] = 0;
+	isousc[meter] = TELEINFO_FLEET_NO_LIMIT;
+	adps[meter] = 0;
+}
+
+bool TeleinfoFleet::update(unsigned int meter, Teleinfo* teleinfo, uint64_t timestamp) {
+	if (meter >= metersCount || teleinfo == NULL) {
+		return false;
+	}
+	int limit = teleinfo->getIsousc();
+	timestamps[meter] = timestamp;
+	power[meter] = teleinfo->getInstPower();
+	iinst[meter] = narrow(teleinfo->getIinst());
+	isousc[meter] = limit > 0 ? narrow(limit) : TELEINFO_FLEET_NO_LIMIT;
+	adps[meter] = narrow(teleinfo->getAdps());
+	return true;
+}
+
+void TeleinfoFleet::clear(unsigned int meter) {
+	if (meter < metersCount) {
+		reset(meter);
+	}
+}
+
+unsigned int TeleinfoFleet::findOverloads(uint32_t* meters, unsigned int capacity) {
+	unsigned int found = 0;
+	for (unsigned int base = 0; base < paddedCount; base += TELEINFO_FLEET_LANES) {
+#ifdef __SSE2__
+		__m128i low = _mm_cmpgt_epi16(load(&iinst[base]), load(&isousc[base]));
+		__m128i high = _mm_cmpgt_epi16(load(&iinst[base + 8]), load(&isousc[base + 8]));
+		unsigned int mask = _mm_movemask_epi8(_mm_packs_epi16(low, high));
+#else
+		unsigned int mask = 0;
+		for (unsigned int lane = 0; lane < TELEINFO_FLEET_LANES; lane++) {
+			mask |= (unsigned int) (iinst[base + lane] > isousc[base + lane]) << lane;
+		}
+#endif
+		if (mask != 0) {
+			found = collect(mask, base, meters, capacity, found);
+		}
+	}
+	return found;
+}
+
+unsigned int TeleinfoFleet::findAdps(uint32_t* meters, unsigned int capacity) {
+	unsigned int found = 0;
+#ifdef __SSE2__
+	__m128i zero = _mm_setzero_si128();
+#endif
+	for (unsigned int base = 0; base < paddedCount; base += TELEINFO_FLEET_LANES) {
+#ifdef __SSE2__
+		__m128i low = _mm_cmpeq_epi16(load(&adps[base]), zero);
+		__m128i high = _mm_cmpeq_epi16(load(&adps[base + 8]), zero);
+		unsigned int mask = ~_mm_movemask_epi8(_mm_packs_epi16(low, high)) & 0xFFFF;
+#else
+		unsigned int mask = 0;
+		for (unsigned int lane = 0; lane < TELEINFO_FLEET_LANES; lane++) {
+			mask |= (unsigned int) (adps[base + lane] != 0) << lane;
+		}
+#endif
+		if (mask != 0) {
+			found = collect(mask, base, meters, capacity, found);
+		}
+	}
+	return found;
+}
+
+/**
+ * Un compteur est moins bien classé qu'un autre s'il a une puissance plus faible ou, à puissance égale, un numéro plus grand
+ */
+bool TeleinfoFleet::isWorse(uint32_t meter, uint32_t other) {
+	return power[meter] < power[other] || (power[meter] == power[other] && meter > other);
+}
+
+/**
+ * Rétablit le tas (le moins bien classé à la racine) sous un élément
+ */
+void TeleinfoFleet::siftDown(uint32_t* heap, unsigned int count, unsigned int index) {
+	while (true) {
+		unsigned int worst = index;
+		unsigned int child = 2 * index + 1;
+		if (child < count && isWorse(heap[child], heap[worst])) {
+			worst = child;
+		}
+		if (child + 1 < count && isWorse(heap[child + 1], heap[worst])) {
+			worst = child + 1;
+		}
+		if (worst == index) {
+			return;
+		}
+		uint32_t swap = heap[index];
+		heap[index] = heap[worst];
+		heap[worst] = swap;
+		index = worst;
+	}
+}
+
+unsigned int TeleinfoFleet::findTopPower(unsigned int count, uint32_t* meters, int32_t* powers) {
+	if (meters == NULL || count == 0) {
+		return 0;
+	}
+	// Le tableau des résultats sert de tas ; tant qu'il n'est pas plein, tout compteur ayant reçu une trame est retenu
+	unsigned int size = 0;
+	int32_t threshold = TELEINFO_FLEET_NO_POWER;
+	for (unsigned int base = 0; base < paddedCount; base += TELEINFO_FLEET_LANES) {
+#ifdef __SSE2__
+		__m128i limit = _mm_set1_epi32(threshold);
+		__m128i low = _mm_packs_epi32(_mm_cmpgt_epi32(load(&power[base]), limit), _mm_cmpgt_epi32(load(&power[base + 4]), limit));
+		__m128i high = _mm_packs_epi32(_mm_cmpgt_epi32(load(&power[base + 8]), limit), _mm_cmpgt_epi32(load(&power[base + 12]), limit));
+		unsigned int mask = _mm_movemask_epi8(_mm_packs_epi16(low, high));
+#else
+		unsigned int mask = 0;
+		for (unsigned int lane = 0; lane < TELEINFO_FLEET_LANES; lane++) {
+			mask |= (unsigned int) (power[base + lane] > threshold) << lane;
+		}
+#endif
+		while (mask != 0) {
+			uint32_t meter = base + __builtin_ctz(mask);
+			mask &= mask - 1;
+			if (size < count) {
+				meters[size++] = meter;
+				if (size == count) {
+					for (unsigned int index = count / 2; index-- > 0;) {
+						siftDown(meters, count, index);
+					}
+					threshold = power[meters[0]];
+				}
+			} else if (power[meter] > threshold) {
+				// A puissance égale, le compteur déjà retenu a le plus petit numéro
+				meters[0] = meter;
+				siftDown(meters, count, 0);
+				threshold = power[meters[0]];
+			}
+		}
+	}
+
+	// Tri par extraction : le moins bien classé passe en fin de tableau
+	if (size < count) {
+		for (unsigned int index = size / 2; index-- > 0;) {
+			siftDown(meters, size, index);
+		}
+	}
+	for (unsigned int end = size; end-- > 1;) {
+		uint32_t swap = meters[0];
+		meters[0] = meters[end];
+		meters[end] = swap;
+		siftDown(meters, end, 0);
+	}
+	if (powers != NULL) {
+		for (unsigned int index = 0; index < size; index++) {
+			powers[index] = power[meters[index]];
+		}
+	}
+	return size;
+}
+
+int TeleinfoFleet::getIinst(unsigned int meter) {
+	return meter < metersCount ? iinst[meter] : 0;
+}
+
+int TeleinfoFleet::getIsousc(unsigned int meter) {
+	return meter < metersCount && isousc[meter] != TELEINFO_FLEET_NO_LIMIT ? isousc[meter] : 0;
+}
+
+int TeleinfoFleet::getAdps(unsigned int meter) {
+	return meter < metersCount ? adps[meter] : 0;
+}
+
+int TeleinfoFleet::getPower(unsigned int meter) {
+	return meter < metersCount && power[meter] != TELEINFO_FLEET_NO_POWER ? power[meter] : 0;
+}
+
+uint64_t TeleinfoFleet::getTimestamp(unsigned int meter) {
+	return meter < metersCount ? timestamps[meter] : 0;
+}
+
+unsigned int TeleinfoFleet::getMeterCount() {
+	return metersCount;
+}
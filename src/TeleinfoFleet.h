@@ -0,0 +1,122 @@
+/**
+ * Déclaration de la table des dernières valeurs d'un parc de compteurs
+ *
+ * Pour surveiller un parc entier (dépassements de l'intensité souscrite, avertissements ADPS, plus fortes puissances),
+ * la table garde la dernière valeur de chaque champ surveillé dans un tableau par champ : un tableau des IINST, un des
+ * ISOUSC, un des ADPS, un des puissances instantanées... indexés par le numéro du compteur (voir TeleinfoRegistry).
+ * Une trame ne met à jour que quelques cases ; un parcours du parc ne lit que les tableaux du champ interrogé, de façon
+ * contiguë, sans appel virtuel ni accès aux trames.
+ *
+ * Les recherches comparent TELEINFO_FLEET_LANES compteurs à la fois en SSE2 et ne traitent un à un que les compteurs
+ * retenus (une minorité) ; sans SSE2, une boucle simple est utilisée. Les plus fortes puissances sont sélectionnées par
+ * un tas des N meilleures valeurs : seules les puissances qui dépassent la plus petite du tas sont examinées.
+ * Toute la mémoire est allouée à la création de la table.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_FLEET_H_
+#define TELEINFO_FLEET_H_
+
+#include "TeleinfoDecoder.h"
+
+#include <stdint.h>
+
+/**
+ * Nombre de compteurs comparés à la fois ; les tableaux sont complétés à un multiple de ce nombre
+ */
+#define TELEINFO_FLEET_LANES      16
+
+/**
+ * ISOUSC d'un compteur sans intensité souscrite connue (jamais dépassée)
+ */
+#define TELEINFO_FLEET_NO_LIMIT   0x7FFF
+
+/**
+ * Puissance d'un compteur sans trame (jamais retenu parmi les plus fortes puissances)
+ */
+#define TELEINFO_FLEET_NO_POWER   -1
+
+/**
+ * Dernières valeurs d'un parc, un tableau par champ
+ */
+class TeleinfoFleet {
+  private:
+    void* memory;
+    uint64_t* timestamps;     // Date de la dernière trame (ms), 0 si aucune
+    int32_t* power;           // Puissance instantanée (W), voir Teleinfo::getInstPower()
+    int16_t* iinst;           // Intensité instantanée (A)
+    int16_t* isousc;          // Intensité souscrite (A)
+    int16_t* adps;            // Avertissement de dépassement (A), 0 si absent de la dernière trame
+    unsigned int metersCount;
+    unsigned int paddedCount; // Multiple de TELEINFO_FLEET_LANES
+
+    void reset(unsigned int meter);
+    bool isWorse(uint32_t meter, uint32_t other);
+    void siftDown(uint32_t* heap, unsigned int count, unsigned int index);
+
+  public:
+    /**
+     * Création de la table
+     * @param meters le nombre de compteurs, numérotés de 0 à meters - 1 par l'appelant
+     */
+    TeleinfoFleet(unsigned int meters);
+    ~TeleinfoFleet();
+
+    /**
+     * Enregistre les valeurs d'une trame terminée
+     *
+     * @param meter le numéro du compteur
+     * @param teleinfo la trame décodée
+     * @param timestamp la date de réception de la trame (ms)
+     * @return false si le numéro de compteur est invalide
+     */
+    bool update(unsigned int meter, Teleinfo* teleinfo, uint64_t timestamp);
+
+    /**
+     * Efface les valeurs d'un compteur : il n'est plus retenu par les recherches
+     */
+    void clear(unsigned int meter);
+
+    /**
+     * Recherche les compteurs dont l'intensité instantanée dépasse l'intensité souscrite (IINST > ISOUSC)
+     *
+     * @param meters reçoit les numéros des compteurs, par ordre croissant
+     * @param capacity le nombre de numéros du tableau : les suivants sont comptés mais pas copiés
+     * @return le nombre de compteurs trouvés
+     */
+    unsigned int findOverloads(uint32_t* meters, unsigned int capacity);
+
+    /**
+     * Recherche les compteurs dont la dernière trame porte un avertissement de dépassement (ADPS)
+     * @see findOverloads(...)
+     */
+    unsigned int findAdps(uint32_t* meters, unsigned int capacity);
+
+    /**
+     * Recherche les compteurs de plus forte puissance instantanée
+     *
+     * @param count le nombre de compteurs recherchés
+     * @param meters reçoit les numéros des compteurs (count numéros), par puissance décroissante, à puissance égale
+     *        par numéro croissant
+     * @param powers reçoit leurs puissances (W) ; facultatif, peut être NULL
+     * @return le nombre de compteurs copiés : count, ou moins si le parc compte moins de compteurs ayant reçu une trame
+     */
+    unsigned int findTopPower(unsigned int count, uint32_t* meters, int32_t* powers);
+
+    /**
+     * Donne les dernières valeurs d'un compteur (0 si le numéro est invalide ou sans trame)
+     */
+    int getIinst(unsigned int meter);
+    int getIsousc(unsigned int meter);
+    int getAdps(unsigned int meter);
+    int getPower(unsigned int meter);
+    uint64_t getTimestamp(unsigned int meter);
+
+    /**
+     * Donne le nombre de compteurs
+     */
+    unsigned int getMeterCount();
+};
+
+#endif  // TELEINFO_FLEET_H_
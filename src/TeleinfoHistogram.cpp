@@ -0,0 +1,102 @@
+/**
+ * Implémentation de l'histogramme de durées
+ *
+ * @author LK
+ */
+#include "TeleinfoHistogram.h"
+
+#include <string.h>
+
+TeleinfoHistogram::TeleinfoHistogram() {
+	reset();
+}
+
+void TeleinfoHistogram::record(uint64_t value) {
+	__atomic_fetch_add(&buckets[bucketOf(value)], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&sum, value, __ATOMIC_RELAXED);
+
+	uint64_t current = __atomic_load_n(&min, __ATOMIC_RELAXED);
+	while (value < current && !__atomic_compare_exchange_n(&min, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		// current a été relu, nouvel essai
+	}
+	current = __atomic_load_n(&max, __ATOMIC_RELAXED);
+	while (value > current && !__atomic_compare_exchange_n(&max, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		// current a été relu, nouvel essai
+	}
+	__atomic_fetch_add(&count, 1, __ATOMIC_RELEASE); // Publie la valeur en dernier
+}
+
+void TeleinfoHistogram::reset() {
+	memset(buckets, 0, sizeof(buckets));
+	count = 0;
+	sum = 0;
+	min = UINT64_MAX;
+	max = 0;
+}
+
+uint64_t TeleinfoHistogram::getCount() {
+	return __atomic_load_n(&count, __ATOMIC_ACQUIRE);
+}
+
+uint64_t TeleinfoHistogram::getMin() {
+	return getCount() > 0 ? __atomic_load_n(&min, __ATOMIC_RELAXED) : 0;
+}
+
+uint64_t TeleinfoHistogram::getMax() {
+	return __atomic_load_n(&max, __ATOMIC_RELAXED);
+}
+
+uint64_t TeleinfoHistogram::getMean() {
+	uint64_t values = getCount();
+	return values > 0 ? __atomic_load_n(&sum, __ATOMIC_RELAXED) / values : 0;
+}
+
+uint64_t TeleinfoHistogram::getPercentile(double percentile) {
+	uint64_t values = getCount();
+	if (values == 0) {
+		return 0;
+	}
+	uint64_t rank = (uint64_t) (percentile / 100.0 * values + 0.5);
+	if (rank < 1) {
+		rank = 1;
+	}
+	if (rank > values) {
+		rank = values;
+	}
+	uint64_t seen = 0;
+	for (unsigned int bucket = 0; bucket < TELEINFO_HISTOGRAM_BUCKETS; bucket++) {
+		seen += __atomic_load_n(&buckets[bucket], __ATOMIC_RELAXED);
+		if (seen >= rank) {
+			uint64_t highest = highestOf(bucket);
+			uint64_t largest = getMax();
+			return highest < largest ? highest : largest;
+		}
+	}
+	return getMax(); // Enregistrement concurrent : le total des classes n'a pas encore atteint count
+}
+
+/**
+ * Donne la classe d'une valeur : les valeurs inférieures à 2^TELEINFO_HISTOGRAM_SUB_BITS ont chacune leur classe,
+ * au-delà la classe est donnée par le rang du bit de poids fort et les TELEINFO_HISTOGRAM_SUB_BITS bits qui le suivent
+ */
+unsigned int TeleinfoHistogram::bucketOf(uint64_t value) {
+	if (value < (1u << TELEINFO_HISTOGRAM_SUB_BITS)) {
+		return value;
+	}
+	unsigned int exponent = 63 - __builtin_clzll(value);
+	unsigned int sub = (value >> (exponent - TELEINFO_HISTOGRAM_SUB_BITS)) & ((1u << TELEINFO_HISTOGRAM_SUB_BITS) - 1);
+	return ((exponent - TELEINFO_HISTOGRAM_SUB_BITS + 1) << TELEINFO_HISTOGRAM_SUB_BITS) + sub;
+}
+
+/**
+ * Donne la plus grande valeur d'une classe
+ */
+uint64_t TeleinfoHistogram::highestOf(unsigned int bucket) {
+	if (bucket < (1u << TELEINFO_HISTOGRAM_SUB_BITS)) {
+		return bucket;
+	}
+	unsigned int exponent = (bucket >> TELEINFO_HISTOGRAM_SUB_BITS) + TELEINFO_HISTOGRAM_SUB_BITS - 1;
+	uint64_t sub = bucket & ((1u << TELEINFO_HISTOGRAM_SUB_BITS) - 1);
+	uint64_t width = (uint64_t) 1 << (exponent - TELEINFO_HISTOGRAM_SUB_BITS);
+	return (((1u << TELEINFO_HISTOGRAM_SUB_BITS) + sub) << (exponent - TELEINFO_HISTOGRAM_SUB_BITS)) + width - 1;
+}
@@ -0,0 +1,85 @@
+/**
+ * Déclaration de l'histogramme de durées
+ *
+ * Histogramme à échelle logarithmique (à la manière de HdrHistogram) : chaque puissance de 2 est découpée en
+ * 2^TELEINFO_HISTOGRAM_SUB_BITS classes de même largeur, soit une précision relative de 12,5 % sur toute l'étendue
+ * des valeurs de 64 bits, pour une taille fixe d'environ 2 Ko.
+ *
+ * L'enregistrement d'une valeur est sans verrou (opérations atomiques) : un thread peut enregistrer pendant que
+ * d'autres consultent l'histogramme.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_HISTOGRAM_H_
+#define TELEINFO_HISTOGRAM_H_
+
+#include <stdint.h>
+
+/**
+ * Nombre de bits de subdivision de chaque puissance de 2
+ */
+#define TELEINFO_HISTOGRAM_SUB_BITS   3
+
+/**
+ * Nombre de classes de l'histogramme
+ */
+#define TELEINFO_HISTOGRAM_BUCKETS    ((64 - TELEINFO_HISTOGRAM_SUB_BITS + 1) << TELEINFO_HISTOGRAM_SUB_BITS)
+
+class TeleinfoHistogram {
+  private:
+    uint32_t buckets[TELEINFO_HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+
+    static unsigned int bucketOf(uint64_t value);
+    static uint64_t highestOf(unsigned int bucket);
+
+  public:
+    /**
+     * Création d'un histogramme vide
+     */
+    TeleinfoHistogram();
+
+    /**
+     * Enregistre une valeur
+     */
+    void record(uint64_t value);
+
+    /**
+     * Vide l'histogramme (ne doit pas être appelé pendant un enregistrement)
+     */
+    void reset();
+
+    /**
+     * Donne le nombre de valeurs enregistrées
+     */
+    uint64_t getCount();
+
+    /**
+     * Donne la plus petite valeur enregistrée, 0 si aucune
+     */
+    uint64_t getMin();
+
+    /**
+     * Donne la plus grande valeur enregistrée
+     */
+    uint64_t getMax();
+
+    /**
+     * Donne la moyenne des valeurs enregistrées, 0 si aucune
+     */
+    uint64_t getMean();
+
+    /**
+     * Donne la valeur sous laquelle se trouve le pourcentage donné des valeurs enregistrées,
+     * à la précision de l'histogramme près (borne haute de la classe), 0 si aucune
+     *
+     * @param percentile le pourcentage, de 0 à 100
+     */
+    uint64_t getPercentile(double percentile);
+};
+
+#endif  // TELEINFO_HISTOGRAM_H_
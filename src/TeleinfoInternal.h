@@ -0,0 +1,424 @@
+/**
+ * Déclaration des classes internes du décodeur Téléinfo
+ *
+ * Ces classes ne font pas partie de l'interface de la bibliothèque : elles sont déclarées ici pour être partagées entre
+ * l'implémentation du décodeur et les benchmarks qui les mesurent (TeleinfoGroupe::check(), TeleinfoImpl::store()).
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_INTERNAL_H_
+#define TELEINFO_INTERNAL_H_
+
+#include "TeleinfoDecoder.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Caractères spéciaux du protocole TeleInfo */
+#define TELEINFO_CHAR_STX            0x02  // Start of Text
+#define TELEINFO_CHAR_ETX            0x03  // End of Text
+#define TELEINFO_CHAR_EOT            0x04  // End of Transmission
+#define TELEINFO_CHAR_LF             0x0A  // Groupe Feed
+#define TELEINFO_CHAR_CR             0x0D  // Carriage return
+#define TELEINFO_CHAR_SPACE          0x20  // Space
+
+/* Nombre d'index (BASE, HCHC, HCHP, EJPHN, EJPHPM, BBR*), aux emplacements 0 à 10 de TeleinfoRecord::numbers */
+#define TELEINFO_INDEXES             11
+
+/**
+ * Etat d'une trame, copié pour les points de reprise (voir TeleinfoDecoder::saveState(...))
+ */
+struct TeleinfoImplState {
+    unsigned long totalOffset;
+    TeleinfoRecord record;
+    unsigned long long validFields;
+    unsigned long long carriedFields;
+    unsigned long long knownFields;
+    unsigned long lastIndexes[TELEINFO_INDEXES];
+};
+
+/**
+ * Représente un groupe Téléinfo : un ocuple composé d'une étiquette et d'une donnée.
+ *
+ * Toutes les données du compteur sont délivrées par groupes d'information qui forment chacun un ensemble cohérent
+ * avec une étiquette et une valeur associée de telle sorte qu'il soit facile de les distinguer les unes des autres.
+ */
+class TeleinfoGroupe {
+  private:
+    char etiquette[64];
+    unsigned int indexEtiquette;
+    char donnee[64];
+    unsigned int indexDonnee;
+    char checksum;
+    char* suspect; // Caractère reçu avec une erreur de parité
+    unsigned int suspects; // Nombre de caractères reçus avec une erreur de parité
+    bool parityError; // Le caractère en cours de décodage a une erreur de parité
+
+  public:
+    /**
+       Constructeur
+     */
+    TeleinfoGroupe() {
+      parityError = false;
+      reset();
+    }
+
+    /**
+     * RAZ du contenu de la ligne TeleInfo
+     */
+    void reset() {
+      memset(etiquette, '\0', sizeof(etiquette));
+      memset(donnee, '\0', sizeof(donnee));
+      indexEtiquette = 0;
+      indexDonnee = 0;
+      checksum = 0;
+      suspect = NULL;
+      suspects = 0;
+    }
+
+    /**
+     * Ajoute un caractère à l'étiquette, le caractère est ignoré si la taille max de létiquette est atteinte
+     */
+    void appendToEtiquette(char character) {
+      if (indexEtiquette < (sizeof(etiquette) - 1)) { // On laisse un caractère 0x00 de fin pour marquer la fin de la chaîne
+        if (parityError) {
+          markSuspect(&etiquette[indexEtiquette]);
+        }
+        etiquette[indexEtiquette++] = character;
+      }
+    }
+
+    /**
+     * Ajoute un caractère à la donnée, le caractère est ignoré si la taille max de létiquette est atteinte
+     */
+    void appendToDonnee(char character) {
+      if (indexDonnee < (sizeof(donnee) - 1)) { // On laisse un caractère 0x00 de fin pour marquer la fin de la chaîne
+        if (parityError) {
+          markSuspect(&donnee[indexDonnee]);
+        }
+        donnee[indexDonnee++] = character;
+      }
+    }
+
+    /**
+     * Définit le checksum
+     */
+    void setChecksum(char character) {
+      if (parityError) {
+        markSuspect(&checksum);
+      }
+      checksum = character;
+    }
+
+    /**
+     * Signale que le caractère en cours de décodage a (ou n'a pas) une erreur de parité
+     */
+    void setParityError(bool parityError) {
+      this->parityError = parityError;
+    }
+
+    /**
+     * Donne le dernier caractère du groupe reçu avec une erreur de parité, NULL si aucun
+     */
+    char* getSuspect() {
+      return suspect;
+    }
+
+    /**
+     * Donne le nombre de caractères du groupe reçus avec une erreur de parité
+     */
+    unsigned int getSuspects() {
+      return suspects;
+    }
+
+    /**
+     * Indique si un caractère est le checksum du groupe
+     */
+    bool isChecksum(char* character) {
+      return character == &checksum;
+    }
+
+    /**
+     * Vérifie le checksum
+     *
+     * La "checksum" est calculée sur l'ensemble des caractères allant du début du champ étiquette
+     * à la fin du champ donnée, caractère SP inclus. On fait tout d'abord la somme des codes ASCII
+     * de tous ces caractères. Pour éviter d'introduire des fonctions ASCII (00 à 1F en hexadécimal),
+     * on ne conserve que les six bits de poids faible du résultat obtenu (cette opération se traduit
+     * par un ET logique entre la somme précédemment calculée et 03Fh).
+     * Enfin, on ajoute 20 en hexadécimal.
+     */
+    bool check() {
+      return checksum == computeChecksum(etiquette, indexEtiquette, donnee, indexDonnee);
+    }
+
+    /**
+     * Calcule le checksum d'une étiquette et d'une donnée (voir check()), aussi utilisé par l'encodeur
+     */
+    static char computeChecksum(const char* etiquette, unsigned int etiquetteLength, const char* donnee, unsigned int donneeLength) {
+      unsigned int sum = TELEINFO_CHAR_SPACE;
+      for (unsigned int i = 0; i < etiquetteLength; i++) {
+        sum = sum + etiquette[i];
+      }
+      for (unsigned int i = 0; i < donneeLength; i++) {
+        sum = sum + donnee[i];
+      }
+      return (char) ((sum & 0x3F) + 0x20);
+    }
+
+  private:
+    void markSuspect(char* character) {
+      suspect = character;
+      suspects++;
+    }
+
+  public:
+    /**
+     * Donne l'étiquette
+     */
+    char* getEtiquette() {
+      return etiquette;
+    }
+
+    /**
+     * Donne la chaîne de donnée
+     */
+    char* getDonnee() {
+      return donnee;
+    }
+};
+
+/**
+ * Construction d'une trame Téléinfo : décodage des groupes, report des champs absents, vérification des réparations
+ */
+class TeleinfoImpl {
+  private:
+
+    TeleinfoFrame frame; // La trame construite
+    unsigned long long knownFields; // Champs dont la valeur est connue
+    unsigned int droppedGroupes; // Groupes écartés dans la trame
+    unsigned int acceptedGroupes; // Groupes acceptés dans la trame, étiquette connue ou non
+    unsigned long lastIndexes[TELEINFO_INDEXES]; // Dernière valeur reçue de chaque index, 0 si inconnue
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+    TeleinfoTimestamps timestamps; // Dates de réception de la trame, données par TeleinfoFrame::getTimestamps()
+#endif
+
+  public:
+
+    TeleinfoImpl(unsigned long totalOffset) {
+      frame.totalOffset = totalOffset;
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+      memset(&timestamps, 0, sizeof(timestamps));
+      frame.timestamps = &timestamps;
+#else
+      frame.timestamps = NULL;
+#endif
+      memset(lastIndexes, 0, sizeof(lastIndexes));
+      reset();
+    }
+
+    /**
+     * Donne la trame construite
+     */
+    TeleinfoFrame* getFrame() {
+      return &frame;
+    }
+
+    // Divers ------------------------------------------------------------------------------------------------------------------
+
+    /**
+     * Remet à zéro les groupes d'informations.
+     * Ne remete pas à zéro l'offest total car celui-ci est constant une fois qu'il a été initialisé
+     */
+    void reset() {
+      memset(&frame.record, 0, sizeof(frame.record));
+      frame.totalIndex = 0;
+      knownFields = 0;
+      invalidate();
+    }
+
+    /**
+     * Début d'une trame sans remise à zéro des groupes d'informations : les champs absents de la trame gardent
+     * leur dernière valeur valide, sauf les champs ponctuels
+     */
+    void invalidate();
+
+    /**
+     * Fin de la trame : les champs connus qui n'ont pas été reçus sont reportés
+     */
+    void computeCarriedFields() {
+      frame.carriedFields = knownFields & ~frame.validFields;
+      knownFields |= frame.validFields;
+    }
+
+    /**
+     * Copie de la trame et de l'état du décodage d'une trame à la suivante
+     */
+    void save(TeleinfoImplState* state) {
+      state->totalOffset = frame.totalOffset;
+      state->record = frame.record;
+      state->validFields = frame.validFields;
+      state->carriedFields = frame.carriedFields;
+      state->knownFields = knownFields;
+      memcpy(state->lastIndexes, lastIndexes, sizeof(lastIndexes));
+    }
+
+    /**
+     * Restauration d'une copie faite par save(...)
+     */
+    void restore(const TeleinfoImplState* state) {
+      reset();
+      frame.totalOffset = state->totalOffset;
+      frame.record = state->record;
+      frame.validFields = state->validFields;
+      frame.carriedFields = state->carriedFields;
+      knownFields = state->knownFields;
+      memcpy(lastIndexes, state->lastIndexes, sizeof(lastIndexes));
+      if (frame.totalOffset != TELEINFO_TOTAL_OFFSET_AUTO) {
+        computeTotalIndex(); // Sinon la trame sauvegardée était incomplète : l'index total reste à 0
+      }
+    }
+
+    /**
+     * Fin de la trame : mémorisation des index reçus, pour juger de la plausibilité des réparations
+     */
+    void rememberIndexes() {
+      for (int i = 0; i < TELEINFO_INDEXES; i++) {
+        if (frame.record.numbers[i] != 0) {
+          lastIndexes[i] = frame.record.numbers[i];
+        }
+      }
+    }
+
+    /**
+     * Vérifie qu'une donnée respecte la grammaire de son étiquette : longueur, caractères autorisés,
+     * et pour un index, progression limitée depuis la trame précédente
+     *
+     * @return false si l'étiquette est inconnue
+     */
+    bool isPlausible(const char* etiquette, const char* donnee);
+
+    /**
+     * Signale un groupe écarté
+     */
+    void dropGroupe() {
+      droppedGroupes++;
+    }
+
+    /**
+     * Donne le nombre de groupes écartés dans la trame
+     */
+    unsigned int getDroppedGroupes() {
+      return droppedGroupes;
+    }
+
+    /**
+     * Donne le nombre de groupes acceptés dans la trame
+     */
+    unsigned int getAcceptedGroupes() {
+      return acceptedGroupes;
+    }
+
+#ifdef TELEINFO_ENABLE_TIMESTAMPS
+    /**
+     * Horodatage du début de la trame
+     */
+    void stampStx(uint64_t now) {
+      timestamps.stx = now;
+    }
+
+    /**
+     * Horodatage d'un groupe accepté
+     */
+    void stampGroupe(uint64_t now) {
+      if (timestamps.groupesCount < TELEINFO_TIMESTAMPS_GROUPES) {
+        timestamps.groupes[timestamps.groupesCount++] = now;
+      }
+    }
+
+    /**
+     * Horodatage de la fin de la trame
+     */
+    void stampEtx(uint64_t now) {
+      timestamps.etx = now;
+    }
+#endif
+
+    /**
+     * Fin de la trame : recalcule l'offset total, puis l'index total donné par TeleinfoFrame::getTotalIndex()
+     *
+     * Un index connu absent de la trame (groupe écarté en mode TELEINFO_OPTION_SALVAGE) garde sa dernière valeur :
+     * l'index total ne recule pas. L'offset automatique n'est appris que d'une trame complète, l'index total reste
+     * à 0 jusque-là.
+     */
+    void computeTotalIndex() {
+      unsigned long sum = 0;
+      bool complete = droppedGroupes == 0;
+      for (int i = 0; i < TELEINFO_INDEXES; i++) {
+        if (frame.record.numbers[i] == 0 && lastIndexes[i] != 0) {
+          sum += lastIndexes[i];
+          complete = false;
+        } else {
+          sum += frame.record.numbers[i];
+        }
+      }
+      if (frame.totalOffset == TELEINFO_TOTAL_OFFSET_AUTO) {
+        if (!complete) {
+          frame.totalIndex = 0;
+          return;
+        }
+        frame.totalOffset = sum;
+      }
+      frame.totalIndex = sum - frame.totalOffset;
+    }
+
+    /**
+     * Vérifie qu'une donnée est l'une des valeurs d'une liste ("valeur|valeur|...", '?' pour un caractère quelconque)
+     */
+    static bool matchesValues(const char* donnee, const char* values) {
+      const char* value = values;
+      while (true) {
+        unsigned int i = 0;
+        while (donnee[i] != '\0' && (value[i] == donnee[i] || value[i] == '?')) {
+          i++;
+        }
+        if (donnee[i] == '\0' && (value[i] == '|' || value[i] == '\0')) {
+          return true;
+        }
+        value = strchr(value, '|');
+        if (value == NULL) {
+          return false;
+        }
+        value++;
+      }
+    }
+
+    /**
+     * Remet à zéro l'emplacement d'une étiquette
+     */
+    void clear(const TeleinfoLabel* label) {
+      switch (label->type) {
+        case TELEINFO_TYPE_NUMBER :
+          frame.record.numbers[label->slot] = 0;
+          break;
+
+        case TELEINFO_TYPE_SHORT :
+          frame.record.shorts[label->slot] = 0;
+          break;
+
+        default :
+          memset(&frame.record.texts[label->slot], '\0', label->type == TELEINFO_TYPE_CHAR ? 1 : label->length + 1);
+          break;
+      }
+    }
+
+    /**
+     *  Trasfert les données d'un groupe dans son emplacement de la trame, d'après le schéma des étiquettes (étiquette inconnue ignorée)
+     */
+    void store(TeleinfoGroupe* teleinfoGroupe);
+
+};
+
+#endif  // TELEINFO_INTERNAL_H_
@@ -0,0 +1,585 @@
+/**
+ * Implémentation du point d'accès OpenMetrics
+ *
+ * @author LK
+ */
+#include "TeleinfoMetrics.h"
+#include "TeleinfoSerializer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*********************************************************************************************************************************************************************
+  CONSTANTES
+ *********************************************************************************************************************************************************************/
+
+/* Taille d'une étiquette de compteur : {meter="4294967295",adco="..." */
+#define TELEINFO_METRICS_LABEL_SIZE   64
+
+/* ADCO d'une étiquette de compteur sans ADCO reçu */
+#define TELEINFO_METRICS_NO_ADCO      ((unsigned long) -1)
+
+/* Place libre nécessaire dans le tampon pour y écrire un échantillon */
+#define TELEINFO_METRICS_LINE_SIZE    256
+
+/**
+ * Index des compteurs : une série par étiquette d'index du schéma du décodeur (étiquette register)
+ */
+static const char TELEINFO_METRICS_INDEX[] =
+	"# TYPE teleinfo_index_watt_hours counter\n"
+	"# UNIT teleinfo_index_watt_hours watt_hours\n"
+	"# HELP teleinfo_index_watt_hours Index du compteur.\n";
+
+/**
+ * Grandeurs instantanées des compteurs ; celles d'un compteur triphasé portent en plus l'étiquette phase="..."
+ */
+struct TeleinfoMetricsGauge {
+	const char* header;   // NULL pour la phase suivante d'une même grandeur
+	const char* name;
+	unsigned long long field;
+	const char* phase;    // NULL pour une grandeur sans phase
+};
+
+static const TeleinfoMetricsGauge TELEINFO_METRICS_GAUGES[] = {
+	{ "# TYPE teleinfo_subscribed_current_amperes gauge\n"
+	  "# UNIT teleinfo_subscribed_current_amperes amperes\n"
+	  "# HELP teleinfo_subscribed_current_amperes Intensité souscrite (ISOUSC).\n",
+	  "teleinfo_subscribed_current_amperes", TELEINFO_FIELD_ISOUSC },
+	{ "# TYPE teleinfo_current_amperes gauge\n"
+	  "# UNIT teleinfo_current_amperes amperes\n"
+	  "# HELP teleinfo_current_amperes Intensité instantanée (IINST).\n",
+	  "teleinfo_current_amperes", TELEINFO_FIELD_IINST },
+	{ "# TYPE teleinfo_max_current_amperes gauge\n"
+	  "# UNIT teleinfo_max_current_amperes amperes\n"
+	  "# HELP teleinfo_max_current_amperes Intensité maximale appelée (IMAX).\n",
+	  "teleinfo_max_current_amperes", TELEINFO_FIELD_IMAX },
+	{ "# TYPE teleinfo_overload_current_amperes gauge\n"
+	  "# UNIT teleinfo_overload_current_amperes amperes\n"
+	  "# HELP teleinfo_overload_current_amperes Avertissement de dépassement de puissance souscrite (ADPS).\n",
+	  "teleinfo_overload_current_amperes", TELEINFO_FIELD_ADPS },
+	{ "# TYPE teleinfo_apparent_power_voltamperes gauge\n"
+	  "# UNIT teleinfo_apparent_power_voltamperes voltamperes\n"
+	  "# HELP teleinfo_apparent_power_voltamperes Puissance apparente (PAPP).\n",
+	  "teleinfo_apparent_power_voltamperes", TELEINFO_FIELD_PAPP },
+#ifndef TELEINFO_DISABLE_THREE_PHASE
+	{ "# TYPE teleinfo_phase_current_amperes gauge\n"
+	  "# UNIT teleinfo_phase_current_amperes amperes\n"
+	  "# HELP teleinfo_phase_current_amperes Intensité instantanée d'une phase (IINST1, IINST2, IINST3).\n",
+	  "teleinfo_phase_current_amperes", TELEINFO_FIELD_IINST1, "1" },
+	{ NULL, "teleinfo_phase_current_amperes", TELEINFO_FIELD_IINST2, "2" },
+	{ NULL, "teleinfo_phase_current_amperes", TELEINFO_FIELD_IINST3, "3" },
+	{ "# TYPE teleinfo_phase_max_current_amperes gauge\n"
+	  "# UNIT teleinfo_phase_max_current_amperes amperes\n"
+	  "# HELP teleinfo_phase_max_current_amperes Intensité maximale appelée d'une phase (IMAX1, IMAX2, IMAX3).\n",
+	  "teleinfo_phase_max_current_amperes", TELEINFO_FIELD_IMAX1, "1" },
+	{ NULL, "teleinfo_phase_max_current_amperes", TELEINFO_FIELD_IMAX2, "2" },
+	{ NULL, "teleinfo_phase_max_current_amperes", TELEINFO_FIELD_IMAX3, "3" },
+	{ "# TYPE teleinfo_phase_overload_current_amperes gauge\n"
+	  "# UNIT teleinfo_phase_overload_current_amperes amperes\n"
+	  "# HELP teleinfo_phase_overload_current_amperes Dépassement d'intensité de réglage d'une phase (ADIR1, ADIR2, ADIR3).\n",
+	  "teleinfo_phase_overload_current_amperes", TELEINFO_FIELD_ADIR1, "1" },
+	{ NULL, "teleinfo_phase_overload_current_amperes", TELEINFO_FIELD_ADIR2, "2" },
+	{ NULL, "teleinfo_phase_overload_current_amperes", TELEINFO_FIELD_ADIR3, "3" },
+	{ "# TYPE teleinfo_max_power_watts gauge\n"
+	  "# UNIT teleinfo_max_power_watts watts\n"
+	  "# HELP teleinfo_max_power_watts Puissance maximale triphasée atteinte (PMAX).\n",
+	  "teleinfo_max_power_watts", TELEINFO_FIELD_PMAX },
+	{ "# TYPE teleinfo_potentials gauge\n"
+	  "# HELP teleinfo_potentials Présence des potentiels (PPOT), valeur du mot hexadécimal.\n",
+	  "teleinfo_potentials", TELEINFO_FIELD_PPOT },
+#endif
+};
+
+/**
+ * Période tarifaire en cours : une série de valeur 1 (étiquette period)
+ */
+static const char TELEINFO_METRICS_PERIOD[] =
+	"# TYPE teleinfo_tariff_period gauge\n"
+	"# HELP teleinfo_tariff_period Période tarifaire en cours (PTEC).\n";
+
+/**
+ * Compteurs d'activité des décodeurs (voir TeleinfoStats)
+ */
+static const char* const TELEINFO_METRICS_STATS[] = {
+	"teleinfo_decoder_frames", "Trames décodées.",
+	"teleinfo_decoder_lost_frames", "Trames abandonnées.",
+	"teleinfo_decoder_salvaged_frames", "Trames décodées malgré au moins un groupe écarté.",
+	"teleinfo_decoder_dropped_groupes", "Groupes écartés dans les trames décodées.",
+	"teleinfo_decoder_parity_errors", "Caractères reçus avec une erreur de parité.",
+	"teleinfo_decoder_repairs", "Groupes réparés.",
+	"teleinfo_decoder_rejected_repairs", "Groupes invalides non réparés."
+};
+
+#define TELEINFO_METRICS_STATS_COUNT  7
+
+/**
+ * Réponses HTTP
+ */
+static const char TELEINFO_METRICS_OK[] =
+	"HTTP/1.1 200 OK\r\n"
+	"Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+	"Connection: close\r\n"
+	"Content-Length: ";
+
+static const char TELEINFO_METRICS_NOT_FOUND[] =
+	"HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nConnection: close\r\nContent-Length: 10\r\n\r\nNot Found\n";
+
+static const char TELEINFO_METRICS_NOT_ALLOWED[] =
+	"HTTP/1.1 405 Method Not Allowed\r\nAllow: GET\r\nContent-Type: text/plain\r\nConnection: close\r\nContent-Length: 19\r\n\r\nMethod Not Allowed\n";
+
+static const char TELEINFO_METRICS_UNAVAILABLE[] =
+	"HTTP/1.1 503 Service Unavailable\r\nContent-Type: text/plain\r\nConnection: close\r\nContent-Length: 17\r\n\r\nBuffer too small\n";
+
+/*********************************************************************************************************************************************************************
+  ECRITURE
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Ecriture d'une chaîne sans caractère nul final
+ */
+static char* appendString(char* target, const char* text) {
+	while (*text != '\0') {
+		*target++ = *text++;
+	}
+	return target;
+}
+
+/**
+ * Ecriture d'une valeur d'étiquette, '"', '\' et saut de ligne échappés
+ */
+static char* appendLabelValue(char* target, const char* text, unsigned int maxLength) {
+	for (unsigned int i = 0; i < maxLength && text[i] != '\0'; i++) {
+		if (text[i] == '"' || text[i] == '\\') {
+			*target++ = '\\';
+			*target++ = text[i];
+		} else if (text[i] == '\n') {
+			*target++ = '\\';
+			*target++ = 'n';
+		} else {
+			*target++ = text[i];
+		}
+	}
+	return target;
+}
+
+/**
+ * Ecriture d'un entier signé
+ */
+static char* appendNumber(char* target, long long number) {
+	if (number < 0) {
+		*target++ = '-';
+		return target + TeleinfoSerializer::formatUnsigned(target, (uint64_t) -number);
+	}
+	return target + TeleinfoSerializer::formatUnsigned(target, (uint64_t) number);
+}
+
+/**
+ * Lecture d'une grandeur instantanée, d'après son étiquette dans le schéma du décodeur
+ */
+static long long getGauge(TeleinfoSnapshot* snapshot, const TeleinfoLabel* label) {
+	if (label->type == TELEINFO_TYPE_TEXT) {
+		return strtol(snapshot->getText(label), NULL, 16); // Mot hexadécimal (PPOT)
+	}
+	return snapshot->getNumber(label);
+}
+
+/*********************************************************************************************************************************************************************
+  POINT D'ACCES
+ *********************************************************************************************************************************************************************/
+
+TeleinfoMetrics::TeleinfoMetrics(TeleinfoConflator* conflator, unsigned int bufferSize) {
+	this->conflator = conflator;
+	unsigned int meters = conflator->getMeterCount();
+	this->labels = (char*) malloc(meters * TELEINFO_METRICS_LABEL_SIZE);
+	this->labelLengths = (unsigned char*) calloc(meters, sizeof(unsigned char));
+	this->labelAdcos = (unsigned long*) calloc(meters, sizeof(unsigned long));
+	this->buffer = (char*) malloc(bufferSize);
+	bool allocated = labels != NULL && labelLengths != NULL && labelAdcos != NULL;
+	this->metersCount = allocated ? meters : 0;
+	this->bufferSize = buffer != NULL ? bufferSize : 0;
+	this->length = 0;
+	this->decodersCount = 0;
+	this->listener = -1;
+	this->unixPath = NULL;
+}
+
+TeleinfoMetrics::~TeleinfoMetrics() {
+	close();
+	free(buffer);
+	free(labelAdcos);
+	free(labelLengths);
+	free(labels);
+}
+
+bool TeleinfoMetrics::addDecoder(TeleinfoDecoder* decoder, const char* name) {
+	if (decodersCount >= TELEINFO_METRICS_DECODERS) {
+		return false;
+	}
+	char* label = appendString(decoderLabels[decodersCount], "{decoder=\"");
+	label = appendLabelValue(label, name, TELEINFO_METRICS_DECODER_NAME);
+	*label++ = '"';
+	*label++ = '}';
+	*label = '\0';
+	decoders[decodersCount++] = decoder;
+	return true;
+}
+
+char* TeleinfoMetrics::appendLabel(char* target, unsigned int meter, TeleinfoSnapshot* snapshot) {
+	char* label = labels + meter * TELEINFO_METRICS_LABEL_SIZE;
+	unsigned long adco = (snapshot->getValidFields() | snapshot->getCarriedFields()) & TELEINFO_FIELD_ADCO ? snapshot->getAdcoAsLong() : TELEINFO_METRICS_NO_ADCO;
+	if (labelLengths[meter] == 0 || labelAdcos[meter] != adco) {
+		// Construction de l'étiquette : à la première collecte, puis seulement si le compteur change d'ADCO
+		char* position = appendString(label, "{meter=\"");
+		position += TeleinfoSerializer::formatUnsigned(position, meter);
+		*position++ = '"';
+		if (adco != TELEINFO_METRICS_NO_ADCO) {
+			position = appendString(position, ",adco=\"");
+			position = appendLabelValue(position, snapshot->getAdco(), 12);
+			*position++ = '"';
+		}
+		labelLengths[meter] = position - label;
+		labelAdcos[meter] = adco;
+	}
+	memcpy(target, label, labelLengths[meter]);
+	return target + labelLengths[meter];
+}
+
+bool TeleinfoMetrics::render() {
+	char* target = buffer;
+	char* limit = buffer + bufferSize;
+	TeleinfoSnapshot* snapshot;
+	unsigned int count;
+	const TeleinfoLabel* schema = TeleinfoDecoder::getSchema(&count);
+
+	// Index
+	if (limit - target < TELEINFO_METRICS_LINE_SIZE) {
+		length = 0;
+		return false;
+	}
+	target = appendString(target, TELEINFO_METRICS_INDEX);
+	for (unsigned int meter = 0; meter < metersCount; meter++) {
+		snapshot = conflator->getLatest(meter);
+		if (snapshot == NULL) {
+			continue;
+		}
+		unsigned long long present = snapshot->getValidFields() | snapshot->getCarriedFields();
+		for (unsigned int i = 0; i < count; i++) {
+			if (schema[i].grammar != TELEINFO_GRAMMAR_INDEX || (present & schema[i].field) == 0) {
+				continue;
+			}
+			if (limit - target < TELEINFO_METRICS_LINE_SIZE) {
+				length = target - buffer;
+				return false;
+			}
+			target = appendString(target, "teleinfo_index_watt_hours_total");
+			target = appendLabel(target, meter, snapshot);
+			target = appendString(target, ",register=\"");
+			target = appendString(target, schema[i].etiquette);
+			*target++ = '"';
+			*target++ = '}';
+			*target++ = ' ';
+			target = appendNumber(target, snapshot->getNumber(&schema[i]));
+			*target++ = '\n';
+		}
+	}
+
+	// Grandeurs instantanées
+	for (unsigned int gauge = 0; gauge < sizeof(TELEINFO_METRICS_GAUGES) / sizeof(TELEINFO_METRICS_GAUGES[0]); gauge++) {
+		const TeleinfoMetricsGauge* current = &TELEINFO_METRICS_GAUGES[gauge];
+		const TeleinfoLabel* label = TeleinfoDecoder::getLabel(current->field);
+		if (limit - target < TELEINFO_METRICS_LINE_SIZE) {
+			length = target - buffer;
+			return false;
+		}
+		if (current->header != NULL) {
+			target = appendString(target, current->header);
+		}
+		for (unsigned int meter = 0; meter < metersCount; meter++) {
+			snapshot = conflator->getLatest(meter);
+			if (snapshot == NULL || ((snapshot->getValidFields() | snapshot->getCarriedFields()) & current->field) == 0) {
+				continue;
+			}
+			if (limit - target < TELEINFO_METRICS_LINE_SIZE) {
+				length = target - buffer;
+				return false;
+			}
+			target = appendString(target, current->name);
+			target = appendLabel(target, meter, snapshot);
+			if (current->phase != NULL) {
+				target = appendString(target, ",phase=\"");
+				target = appendString(target, current->phase);
+				*target++ = '"';
+			}
+			*target++ = '}';
+			*target++ = ' ';
+			target = appendNumber(target, getGauge(snapshot, label));
+			*target++ = '\n';
+		}
+	}
+
+	// Période tarifaire
+	if (limit - target < TELEINFO_METRICS_LINE_SIZE) {
+		length = target - buffer;
+		return false;
+	}
+	target = appendString(target, TELEINFO_METRICS_PERIOD);
+	for (unsigned int meter = 0; meter < metersCount; meter++) {
+		snapshot = conflator->getLatest(meter);
+		if (snapshot == NULL || ((snapshot->getValidFields() | snapshot->getCarriedFields()) & TELEINFO_FIELD_PTEC) == 0) {
+			continue;
+		}
+		if (limit - target < TELEINFO_METRICS_LINE_SIZE) {
+			length = target - buffer;
+			return false;
+		}
+		target = appendString(target, "teleinfo_tariff_period");
+		target = appendLabel(target, meter, snapshot);
+		target = appendString(target, ",period=\"");
+		target = appendLabelValue(target, snapshot->getPtec(), 4);
+		target = appendString(target, "\"} 1\n");
+	}
+
+	// Compteurs d'activité des décodeurs
+	for (int stat = 0; stat < TELEINFO_METRICS_STATS_COUNT; stat++) {
+		if (limit - target < TELEINFO_METRICS_LINE_SIZE) {
+			length = target - buffer;
+			return false;
+		}
+		const char* name = TELEINFO_METRICS_STATS[stat * 2];
+		target = appendString(target, "# TYPE ");
+		target = appendString(target, name);
+		target = appendString(target, " counter\n# HELP ");
+		target = appendString(target, name);
+		*target++ = ' ';
+		target = appendString(target, TELEINFO_METRICS_STATS[stat * 2 + 1]);
+		*target++ = '\n';
+		for (unsigned int i = 0; i < decodersCount; i++) {
+			if (limit - target < TELEINFO_METRICS_LINE_SIZE) {
+				length = target - buffer;
+				return false;
+			}
+			TeleinfoStats stats;
+			decoders[i]->getStats(&stats);
+			unsigned long values[TELEINFO_METRICS_STATS_COUNT] = {
+				stats.frames, stats.lostFrames, stats.salvagedFrames, stats.droppedGroupes, stats.parityErrors, stats.repairs, stats.rejectedRepairs
+			};
+			target = appendString(target, name);
+			target = appendString(target, "_total");
+			target = appendString(target, decoderLabels[i]);
+			*target++ = ' ';
+			target = appendNumber(target, values[stat]);
+			*target++ = '\n';
+		}
+	}
+
+	if (limit - target < TELEINFO_METRICS_LINE_SIZE) {
+		length = target - buffer;
+		return false;
+	}
+	target = appendString(target, "# EOF\n");
+	length = target - buffer;
+	return true;
+}
+
+const char* TeleinfoMetrics::getBuffer() {
+	return buffer;
+}
+
+unsigned int TeleinfoMetrics::getLength() {
+	return length;
+}
+
+/*********************************************************************************************************************************************************************
+  SERVEUR HTTP
+ *********************************************************************************************************************************************************************/
+
+bool TeleinfoMetrics::listenTcp(unsigned short port) {
+	close();
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return false;
+	}
+	int reuse = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	if (bind(fd, (struct sockaddr*) &address, sizeof(address)) < 0 || listen(fd, 16) < 0) {
+		::close(fd);
+		return false;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	listener = fd;
+	return true;
+}
+
+bool TeleinfoMetrics::listenUnix(const char* path) {
+	close();
+	struct sockaddr_un address;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		return false;
+	}
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return false;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	unlink(path);
+	if (bind(fd, (struct sockaddr*) &address, sizeof(address)) < 0 || listen(fd, 16) < 0) {
+		::close(fd);
+		return false;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	listener = fd;
+	unixPath = strdup(path);
+	return true;
+}
+
+unsigned short TeleinfoMetrics::getPort() {
+	struct sockaddr_in address;
+	socklen_t size = sizeof(address);
+	if (listener < 0 || unixPath != NULL || getsockname(listener, (struct sockaddr*) &address, &size) < 0) {
+		return 0;
+	}
+	return ntohs(address.sin_port);
+}
+
+/**
+ * Donne l'horloge monotone (ms)
+ */
+static uint64_t monotonic() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+/**
+ * Attend qu'une connexion soit prête en lecture ou en écriture, au plus jusqu'à l'échéance
+ * @return false si l'échéance est dépassée ou si la connexion est en erreur
+ */
+static bool waitReady(int connection, short events, uint64_t deadline) {
+	struct pollfd descriptor;
+	descriptor.fd = connection;
+	descriptor.events = events;
+	while (true) {
+		uint64_t now = monotonic();
+		if (now >= deadline) {
+			return false;
+		}
+		int ready = poll(&descriptor, 1, (int) (deadline - now));
+		if (ready > 0) {
+			return true;
+		}
+		if (ready < 0 && errno != EINTR) {
+			return false;
+		}
+	}
+}
+
+int TeleinfoMetrics::poll(int timeout) {
+	if (listener < 0) {
+		return -1;
+	}
+	struct pollfd descriptor;
+	descriptor.fd = listener;
+	descriptor.events = POLLIN;
+	if (::poll(&descriptor, 1, timeout) <= 0) {
+		return 0;
+	}
+	int served = 0;
+	int connection;
+	while ((connection = accept(listener, NULL, NULL)) >= 0) {
+		// La connexion est non bloquante : la lecture de la requête et l'écriture de la réponse partagent une même
+		// échéance, qu'un client qui envoie ou lit un octet à la fois ne repousse pas
+		fcntl(connection, F_SETFL, fcntl(connection, F_GETFL) | O_NONBLOCK);
+		if (serve(connection, monotonic() + TELEINFO_METRICS_TIMEOUT)) {
+			served++;
+		}
+		::close(connection);
+	}
+	return served;
+}
+
+bool TeleinfoMetrics::serve(int connection, uint64_t deadline) {
+	// Lecture de la requête jusqu'à la ligne vide qui termine les en-têtes
+	unsigned int received = 0;
+	while (true) {
+		if (received >= sizeof(request) - 1) {
+			return false;
+		}
+		if (!waitReady(connection, POLLIN, deadline)) {
+			return false;
+		}
+		ssize_t count = recv(connection, request + received, sizeof(request) - 1 - received, 0);
+		if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			continue;
+		}
+		if (count <= 0) {
+			return false;
+		}
+		received += count;
+		request[received] = '\0';
+		if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL) {
+			break;
+		}
+	}
+
+	if (strncmp(request, "GET ", 4) != 0) {
+		return send(connection, TELEINFO_METRICS_NOT_ALLOWED, sizeof(TELEINFO_METRICS_NOT_ALLOWED) - 1, deadline);
+	}
+	if (strncmp(request + 4, "/metrics ", 9) != 0 && strncmp(request + 4, "/metrics? ", 10) != 0) {
+		return send(connection, TELEINFO_METRICS_NOT_FOUND, sizeof(TELEINFO_METRICS_NOT_FOUND) - 1, deadline);
+	}
+	if (!render()) {
+		return send(connection, TELEINFO_METRICS_UNAVAILABLE, sizeof(TELEINFO_METRICS_UNAVAILABLE) - 1, deadline);
+	}
+	char header[sizeof(TELEINFO_METRICS_OK) + 32];
+	memcpy(header, TELEINFO_METRICS_OK, sizeof(TELEINFO_METRICS_OK) - 1);
+	char* position = header + sizeof(TELEINFO_METRICS_OK) - 1;
+	position += TeleinfoSerializer::formatUnsigned(position, length);
+	position = appendString(position, "\r\n\r\n");
+	return send(connection, header, position - header, deadline) && send(connection, buffer, length, deadline);
+}
+
+bool TeleinfoMetrics::send(int connection, const char* data, unsigned int size, uint64_t deadline) {
+	while (size > 0) {
+		if (!waitReady(connection, POLLOUT, deadline)) {
+			return false;
+		}
+		ssize_t count = ::send(connection, data, size, MSG_NOSIGNAL);
+		if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			continue;
+		}
+		if (count <= 0) {
+			return false;
+		}
+		data += count;
+		size -= count;
+	}
+	return true;
+}
+
+void TeleinfoMetrics::close() {
+	if (listener >= 0) {
+		::close(listener);
+		listener = -1;
+	}
+	if (unixPath != NULL) {
+		unlink(unixPath);
+		free(unixPath);
+		unixPath = NULL;
+	}
+}
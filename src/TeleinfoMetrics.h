@@ -0,0 +1,143 @@
+/**
+ * Déclaration du point d'accès OpenMetrics (Prometheus) d'une passerelle Téléinfo
+ *
+ * Un serveur HTTP/1.1 minimal, lié à l'interface locale (127.0.0.1) ou à une socket Unix, répond à GET /metrics
+ * par les dernières valeurs de chaque compteur (dernière trame publiée dans un TeleinfoConflator) et les compteurs
+ * d'activité des décodeurs déclarés, au format texte OpenMetrics.
+ *
+ * Les étiquettes (adco="...", decoder="...") sont construites une fois, le texte est écrit dans un tampon alloué
+ * à la création et réutilisé : une collecte ne fait aucune allocation. Le serveur ne crée pas de thread : poll(...)
+ * est appelé depuis la boucle principale et sert les requêtes en attente, une connexion à la fois.
+ *
+ * Disponible sur les systèmes POSIX uniquement.
+ * @author LK
+ */
+
+#ifndef TELEINFO_METRICS_H_
+#define TELEINFO_METRICS_H_
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoConflator.h"
+
+/**
+ * Nombre maximal de décodeurs déclarés
+ */
+#ifndef TELEINFO_METRICS_DECODERS
+#define TELEINFO_METRICS_DECODERS   64
+#endif
+
+/**
+ * Longueur maximale du nom d'un décodeur, et taille de son étiquette : {decoder="...", nom échappé (chaque caractère
+ * doublé au pire), "} et caractère nul
+ */
+#define TELEINFO_METRICS_DECODER_NAME         24
+#define TELEINFO_METRICS_DECODER_LABEL_SIZE   (10 + 2 * TELEINFO_METRICS_DECODER_NAME + 3)
+
+/**
+ * Délai maximal pour servir une connexion, lecture de la requête et écriture de la réponse comprises (ms) : un client lent,
+ * même s'il envoie ou lit un octet à la fois, ne bloque pas la boucle principale plus longtemps
+ */
+#ifndef TELEINFO_METRICS_TIMEOUT
+#define TELEINFO_METRICS_TIMEOUT    1000
+#endif
+
+/**
+ * Taille maximale d'une requête HTTP (ligne de requête et en-têtes)
+ */
+#define TELEINFO_METRICS_REQUEST_SIZE   2048
+
+/**
+ * Taille conseillée du tampon de réponse : TELEINFO_METRICS_BASE_SIZE, plus TELEINFO_METRICS_METER_SIZE par compteur et par décodeur
+ */
+#define TELEINFO_METRICS_BASE_SIZE      4096
+#define TELEINFO_METRICS_METER_SIZE     2048  // Un compteur triphasé ajoute onze séries
+
+/**
+ * Point d'accès OpenMetrics
+ */
+class TeleinfoMetrics {
+  private:
+    TeleinfoConflator* conflator;
+    char* labels;                     // Etiquettes des compteurs : {meter="0",adco="..." (sans accolade fermante)
+    unsigned char* labelLengths;      // 0 si l'étiquette n'est pas construite
+    unsigned long* labelAdcos;        // ADCO de l'étiquette construite
+    unsigned int metersCount;
+    TeleinfoDecoder* decoders[TELEINFO_METRICS_DECODERS];
+    char decoderLabels[TELEINFO_METRICS_DECODERS][TELEINFO_METRICS_DECODER_LABEL_SIZE];
+    unsigned int decodersCount;
+    char* buffer;
+    unsigned int bufferSize;
+    unsigned int length;
+    int listener;
+    char* unixPath;
+    char request[TELEINFO_METRICS_REQUEST_SIZE];
+
+    char* appendLabel(char* target, unsigned int meter, TeleinfoSnapshot* snapshot);
+    bool serve(int connection, uint64_t deadline);
+    bool send(int connection, const char* data, unsigned int size, uint64_t deadline);
+
+  public:
+    /**
+     * Création du point d'accès
+     * @param conflator les dernières trames des compteurs (voir TeleinfoConflator::getLatest(...))
+     * @param bufferSize la taille du tampon de réponse (voir TELEINFO_METRICS_BASE_SIZE)
+     */
+    TeleinfoMetrics(TeleinfoConflator* conflator, unsigned int bufferSize);
+    ~TeleinfoMetrics();
+
+    /**
+     * Déclare un décodeur dont les compteurs d'activité sont publiés
+     * @param name le nom du décodeur (étiquette decoder="name"), TELEINFO_METRICS_DECODER_NAME caractères au plus,
+     *        les suivants sont ignorés
+     * @return false si le nombre maximal de décodeurs est atteint
+     */
+    bool addDecoder(TeleinfoDecoder* decoder, const char* name);
+
+    /**
+     * Ecrit le texte OpenMetrics dans le tampon de réponse
+     * @return false si le tampon est trop petit (le texte est incomplet)
+     */
+    bool render();
+
+    /**
+     * Donne le texte écrit par render() (non terminé par un caractère nul)
+     */
+    const char* getBuffer();
+
+    /**
+     * Donne la longueur du texte écrit par render()
+     */
+    unsigned int getLength();
+
+    /**
+     * Ecoute sur l'interface locale (127.0.0.1)
+     * @param port le port TCP, 0 pour un port libre choisi par le système (voir getPort())
+     * @return false si la socket ne peut être créée ou liée
+     */
+    bool listenTcp(unsigned short port);
+
+    /**
+     * Ecoute sur une socket Unix (un fichier existant à ce chemin est remplacé)
+     * @return false si la socket ne peut être créée ou liée
+     */
+    bool listenUnix(const char* path);
+
+    /**
+     * Donne le port TCP d'écoute, 0 si le point d'accès n'écoute pas en TCP
+     */
+    unsigned short getPort();
+
+    /**
+     * Sert les requêtes en attente
+     * @param timeout l'attente maximale d'une première connexion (ms), 0 pour ne pas attendre
+     * @return le nombre de requêtes servies, -1 si le point d'accès n'écoute pas
+     */
+    int poll(int timeout);
+
+    /**
+     * Arrête l'écoute
+     */
+    void close();
+};
+
+#endif  // TELEINFO_METRICS_H_
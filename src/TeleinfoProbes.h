@@ -0,0 +1,38 @@
+/**
+ * Sondes statiques (USDT) du décodeur Téléinfo
+ *
+ * Compilé avec -DTELEINFO_ENABLE_PROBES (Linux, en-tête <sys/sdt.h> de systemtap-sdt-dev), le décodeur déclare des
+ * sondes du fournisseur "teleinfo", lisibles par bpftrace ou perf sans modifier ni redémarrer l'application. Une sonde
+ * non suivie est une simple instruction nop. Sans TELEINFO_ENABLE_PROBES, les sondes ne produisent aucun code.
+ *
+ * Sondes (le premier argument est toujours l'identifiant du décodeur, voir TeleinfoDecoder::getId()) :
+ *   - frame_start(id)                           : STX reçu, début d'une trame
+ *   - checksum_ok(id, etiquette)                : groupe accepté
+ *   - checksum_fail(id, etiquette, donnee)      : groupe rejeté (checksum ou réparation)
+ *   - fallback(id, etat, caractere)             : caractère inattendu, retour à l'attente d'un STX (etat : nom de l'état quitté)
+ *   - frame_end(id, champs, groupes_ecartes)    : trame terminée et valide (champs : getValidFields())
+ *
+ * Voir tools/teleinfo.bt.
+ * @author LK
+ */
+
+#ifndef TELEINFO_PROBES_H_
+#define TELEINFO_PROBES_H_
+
+#ifdef TELEINFO_ENABLE_PROBES
+
+#include <sys/sdt.h>
+
+#define TELEINFO_PROBE1(name, a)        DTRACE_PROBE1(teleinfo, name, a)
+#define TELEINFO_PROBE2(name, a, b)     DTRACE_PROBE2(teleinfo, name, a, b)
+#define TELEINFO_PROBE3(name, a, b, c)  DTRACE_PROBE3(teleinfo, name, a, b, c)
+
+#else
+
+#define TELEINFO_PROBE1(name, a)        do {} while (0)
+#define TELEINFO_PROBE2(name, a, b)     do {} while (0)
+#define TELEINFO_PROBE3(name, a, b, c)  do {} while (0)
+
+#endif
+
+#endif  // TELEINFO_PROBES_H_
@@ -0,0 +1,447 @@
+/**
+ * Implémentation de la reconstruction parallèle d'un historique
+ *
+ * @author LK
+ */
+#include "TeleinfoRebuild.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*********************************************************************************************************************************************************************
+  CONSTANTES
+ *********************************************************************************************************************************************************************/
+
+/* Version du format du fichier de progression */
+#define TELEINFO_REBUILD_VERSION     1
+
+/**
+ * En-tête d'un fichier de progression, suivi du nombre de trames de chaque capture (uint64_t) puis d'un octet par partition (1 si cumulée)
+ */
+struct TeleinfoRebuildHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t captures;
+	uint64_t partitionFrames;
+	uint64_t partitions;
+	uint64_t generation;      // L'historique cumulé est enregistré dans <fichier>.rollup.<generation>
+	uint32_t meters;
+	uint32_t tiers;
+};
+
+/**
+ * Construit le nom d'un fichier à partir de celui du fichier de progression
+ * @return le nom, à libérer par free(...), NULL si la mémoire manque
+ */
+static char* buildPath(const char* path, const char* suffix, uint64_t generation) {
+	size_t length = strlen(path) + strlen(suffix) + 24;
+	char* built = (char*) malloc(length);
+	if (built != NULL) {
+		snprintf(built, length, "%s%s%llu", path, suffix, (unsigned long long) generation);
+	}
+	return built;
+}
+
+/*********************************************************************************************************************************************************************
+  RECONSTRUCTION
+ *********************************************************************************************************************************************************************/
+
+TeleinfoRebuild::TeleinfoRebuild(TeleinfoRegistry* registry, TeleinfoRollup* rollup, uint64_t partitionFrames) {
+	this->registry = registry;
+	this->rollup = rollup;
+	this->partitionFrames = partitionFrames > 0 ? partitionFrames : TELEINFO_REBUILD_PARTITION;
+	capturesCount = 0;
+	partitions = NULL;
+	done = NULL;
+	partitionsCount = 0;
+	firstCapture = NULL;
+	firstFrame = NULL;
+	nextPartition = 0;
+	progressPath = NULL;
+	checkpointInterval = TELEINFO_REBUILD_CHECKPOINT;
+	generation = 0;
+	callback = NULL;
+	callbackContext = NULL;
+	stopping = false;
+	pthread_mutex_init(&mutex, NULL);
+	memset(&progress, 0, sizeof(progress));
+	startTime = 0;
+	lastCheckpoint = 0;
+	failed = false;
+}
+
+TeleinfoRebuild::~TeleinfoRebuild() {
+	for (unsigned int i = 0; i < capturesCount; i++) {
+		delete captures[i];
+	}
+	free(partitions);
+	free(done);
+	free(firstCapture);
+	free(firstFrame);
+	free(progressPath);
+	pthread_mutex_destroy(&mutex);
+}
+
+bool TeleinfoRebuild::addCapture(const char* path) {
+	if (capturesCount >= TELEINFO_REBUILD_CAPTURES) {
+		return false;
+	}
+	TeleinfoCaptureReader* reader = new TeleinfoCaptureReader();
+	if (!reader->open(path)) {
+		delete reader;
+		return false;
+	}
+	captures[capturesCount++] = reader;
+	return true;
+}
+
+void TeleinfoRebuild::setProgressPath(const char* path, unsigned int interval) {
+	free(progressPath);
+	progressPath = path != NULL ? strdup(path) : NULL;
+	checkpointInterval = interval;
+}
+
+void TeleinfoRebuild::setCallback(TeleinfoRebuildCallback callback, void* context) {
+	this->callback = callback;
+	this->callbackContext = context;
+}
+
+bool TeleinfoRebuild::rebuild(unsigned int workers) {
+	failed = false;
+	stopping = false;
+	if (!prepare() || (progressPath != NULL && !loadProgress())) {
+		return false;
+	}
+	memset(&progress, 0, sizeof(progress));
+	progress.partitions = partitionsCount;
+	unsigned long remaining = 0;
+	for (unsigned long i = 0; i < partitionsCount; i++) {
+		if (done[i]) {
+			progress.donePartitions++;
+		} else {
+			remaining++;
+		}
+	}
+	nextPartition = 0;
+	startTime = now();
+	lastCheckpoint = startTime;
+
+	// Un thread par coeur, pas plus que de partitions à traiter
+	if (workers == 0) {
+		long processors = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = processors > 0 ? (unsigned int) processors : 1;
+	}
+	if (workers > TELEINFO_REBUILD_WORKERS) {
+		workers = TELEINFO_REBUILD_WORKERS;
+	}
+	if (workers > remaining) {
+		workers = remaining > 0 ? (unsigned int) remaining : 1;
+	}
+	pthread_t threads[TELEINFO_REBUILD_WORKERS];
+	unsigned int started = 0;
+	while (started < workers && pthread_create(&threads[started], NULL, run, this) == 0) {
+		started++;
+	}
+	if (started == 0) {
+		work(); // Pas de thread disponible : traitement dans le thread appelant
+	}
+	for (unsigned int i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	pthread_mutex_lock(&mutex);
+	report();
+	if (progressPath != NULL && !failed && !saveProgress()) {
+		failed = true;
+	}
+	bool complete = !failed && progress.donePartitions == partitionsCount;
+	pthread_mutex_unlock(&mutex);
+	return complete;
+}
+
+void TeleinfoRebuild::stop() {
+	__atomic_store_n(&stopping, true, __ATOMIC_RELAXED);
+}
+
+void TeleinfoRebuild::getProgress(TeleinfoRebuildProgress* progress) {
+	pthread_mutex_lock(&mutex);
+	*progress = this->progress;
+	pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Numérote les compteurs dans l'ordre de leur première trame et découpe les captures en partitions
+ */
+bool TeleinfoRebuild::prepare() {
+	free(partitions);
+	free(done);
+	free(firstCapture);
+	free(firstFrame);
+	partitionsCount = 0;
+	unsigned long count = 0;
+	for (unsigned int capture = 0; capture < capturesCount; capture++) {
+		count += (captures[capture]->getFrameCount() + partitionFrames - 1) / partitionFrames;
+	}
+	unsigned int capacity = registry->getCapacity();
+	partitions = (Partition*) malloc((count > 0 ? count : 1) * sizeof(Partition));
+	done = (unsigned char*) calloc(count > 0 ? count : 1, 1);
+	firstCapture = (unsigned int*) malloc((capacity > 0 ? capacity : 1) * sizeof(unsigned int));
+	firstFrame = (uint64_t*) malloc((capacity > 0 ? capacity : 1) * sizeof(uint64_t));
+	if (partitions == NULL || done == NULL || firstCapture == NULL || firstFrame == NULL) {
+		return false;
+	}
+
+	unsigned int known = registry->getMeterCount();
+	for (unsigned int meter = 0; meter < known; meter++) {
+		firstCapture[meter] = 0; // Compteur enregistré avant la reconstruction : trame précédente cherchée jusqu'au début de l'archive
+		firstFrame[meter] = 0;
+	}
+	for (unsigned int capture = 0; capture < capturesCount; capture++) {
+		if (!captures[capture]->indexMeters()) {
+			return false; // Index des trames de chaque compteur (voir findPrevious(...)), construit ici et non par les threads
+		}
+		uint64_t frames = captures[capture]->getFrameCount();
+		for (uint64_t frame = 0; frame < frames; frame++) {
+			const TeleinfoCaptureEntry* entry = captures[capture]->getEntry(frame);
+			if (entry == NULL || entry->adco == 0) {
+				continue;
+			}
+			int meter = registry->add(entry->adco);
+			if (meter < 0) {
+				return false; // Registre plein
+			}
+			if ((unsigned int) meter >= known) {
+				firstCapture[meter] = capture;
+				firstFrame[meter] = frame;
+				known = meter + 1;
+			}
+		}
+		for (uint64_t first = 0; first < frames; first += partitionFrames) {
+			Partition* partition = &partitions[partitionsCount++];
+			partition->capture = capture;
+			partition->first = first;
+			partition->end = first + partitionFrames < frames ? first + partitionFrames : frames;
+		}
+	}
+	return registry->getMeterCount() <= rollup->getMeterCount();
+}
+
+/**
+ * Relit la progression d'une reconstruction interrompue et l'historique cumulé correspondant
+ * @return true s'il n'y a pas de progression enregistrée, false si elle ne correspond pas à l'archive ou est illisible
+ */
+bool TeleinfoRebuild::loadProgress() {
+	generation = 0;
+	FILE* file = fopen(progressPath, "rb");
+	if (file == NULL) {
+		return true;
+	}
+	TeleinfoRebuildHeader header;
+	bool read = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, TELEINFO_REBUILD_MAGIC, sizeof(header.magic)) == 0
+			&& header.version == TELEINFO_REBUILD_VERSION && header.captures == capturesCount && header.partitionFrames == partitionFrames
+			&& header.partitions == partitionsCount && header.meters == registry->getMeterCount() && header.tiers == rollup->getTiers();
+	for (unsigned int capture = 0; capture < capturesCount && read; capture++) {
+		uint64_t frames;
+		read = fread(&frames, sizeof(frames), 1, file) == 1 && frames == captures[capture]->getFrameCount();
+	}
+	if (read) {
+		read = fread(done, 1, partitionsCount, file) == partitionsCount;
+	}
+	fclose(file);
+	if (read) {
+		char* path = buildPath(progressPath, ".rollup.", header.generation);
+		read = path != NULL && rollup->load(path);
+		free(path);
+		generation = header.generation;
+	}
+	if (!read) {
+		memset(done, 0, partitionsCount);
+	}
+	return read;
+}
+
+/**
+ * Enregistre l'historique cumulé dans un nouveau fichier, puis la progression qui le désigne (par renommage : une
+ * interruption pendant l'enregistrement laisse la progression précédente intacte), puis supprime l'historique précédent
+ */
+bool TeleinfoRebuild::saveProgress() {
+	char* rollupPath = buildPath(progressPath, ".rollup.", generation + 1);
+	char* temporaryPath = buildPath(progressPath, ".tmp", generation + 1);
+	bool saved = rollupPath != NULL && temporaryPath != NULL && rollup->save(rollupPath);
+	if (saved) {
+		FILE* file = fopen(temporaryPath, "wb");
+		TeleinfoRebuildHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, TELEINFO_REBUILD_MAGIC, sizeof(header.magic));
+		header.version = TELEINFO_REBUILD_VERSION;
+		header.captures = capturesCount;
+		header.partitionFrames = partitionFrames;
+		header.partitions = partitionsCount;
+		header.generation = generation + 1;
+		header.meters = registry->getMeterCount();
+		header.tiers = rollup->getTiers();
+		saved = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1;
+		for (unsigned int capture = 0; capture < capturesCount && saved; capture++) {
+			uint64_t frames = captures[capture]->getFrameCount();
+			saved = fwrite(&frames, sizeof(frames), 1, file) == 1;
+		}
+		saved = saved && fwrite(done, 1, partitionsCount, file) == partitionsCount;
+		if (file != NULL && fclose(file) != 0) {
+			saved = false;
+		}
+		saved = saved && rename(temporaryPath, progressPath) == 0;
+	}
+	if (saved) {
+		if (generation > 0) {
+			char* previousPath = buildPath(progressPath, ".rollup.", generation);
+			if (previousPath != NULL) {
+				unlink(previousPath);
+			}
+			free(previousPath);
+		}
+		generation++;
+	} else if (rollupPath != NULL) {
+		unlink(rollupPath);
+	}
+	free(rollupPath);
+	free(temporaryPath);
+	lastCheckpoint = now();
+	return saved;
+}
+
+/**
+ * Boucle d'un thread de travail : décode et agrège une partition dans un historique partiel, puis la cumule dans
+ * l'historique final, jusqu'à la dernière partition
+ */
+void TeleinfoRebuild::work() {
+	TeleinfoDecoder teleinfoDecoder;
+	unsigned int meters = rollup->getMeterCount();
+	TeleinfoRollup partial(meters, rollup->getTiers());
+	unsigned int* touched = (unsigned int*) malloc((meters > 0 ? meters : 1) * sizeof(unsigned int));
+	unsigned char* seen = (unsigned char*) calloc(meters > 0 ? meters : 1, 1);
+	if (touched == NULL || seen == NULL || partial.getMeterCount() != meters) {
+		__atomic_store_n(&failed, true, __ATOMIC_RELAXED);
+		free(touched);
+		free(seen);
+		return;
+	}
+
+	while (!__atomic_load_n(&stopping, __ATOMIC_RELAXED) && !__atomic_load_n(&failed, __ATOMIC_RELAXED)) {
+		unsigned long next = __atomic_fetch_add(&nextPartition, 1, __ATOMIC_RELAXED);
+		if (next >= partitionsCount) {
+			break;
+		}
+		if (done[next]) {
+			continue; // Cumulée par une reconstruction précédente
+		}
+		Partition* partition = &partitions[next];
+		TeleinfoCaptureReader* reader = captures[partition->capture];
+		unsigned int touchedCount = 0;
+		uint64_t frames = 0;
+		uint64_t skipped = 0;
+		bool stored = true;
+		for (uint64_t frame = partition->first; frame < partition->end; frame++) {
+			const TeleinfoCaptureEntry* entry = reader->getEntry(frame);
+			int meter = entry != NULL ? registry->find(entry->adco) : TELEINFO_REGISTRY_NONE;
+			if (meter < 0) {
+				skipped++;
+				continue;
+			}
+			if (!seen[meter]) {
+				// Premier passage du compteur dans la partition : index de sa trame précédente
+				seen[meter] = 1;
+				touched[touchedCount++] = meter;
+				Teleinfo* previous = findPrevious(partition->capture, frame, meter, &teleinfoDecoder);
+				if (previous != NULL) {
+					partial.prime(meter, previous);
+				}
+			}
+			Teleinfo* teleinfo = reader->decodeFrame(frame, &teleinfoDecoder);
+			if (teleinfo == NULL) {
+				skipped++;
+				continue;
+			}
+			stored = partial.update(meter, teleinfo, entry->timestamp) && stored;
+			frames++;
+		}
+
+		// Cumul dans l'historique final
+		pthread_mutex_lock(&mutex);
+		for (unsigned int i = 0; i < touchedCount; i++) {
+			stored = rollup->merge(touched[i], &partial, touched[i]) && stored;
+		}
+		if (stored) {
+			done[next] = 1;
+			progress.donePartitions++;
+		} else {
+			__atomic_store_n(&failed, true, __ATOMIC_RELAXED);
+		}
+		progress.frames += frames;
+		progress.skippedFrames += skipped;
+		report();
+		if (progressPath != NULL && !failed && now() - lastCheckpoint >= checkpointInterval && !saveProgress()) {
+			__atomic_store_n(&failed, true, __ATOMIC_RELAXED);
+		}
+		pthread_mutex_unlock(&mutex);
+
+		for (unsigned int i = 0; i < touchedCount; i++) {
+			partial.clear(touched[i]);
+			seen[touched[i]] = 0;
+		}
+	}
+	free(touched);
+	free(seen);
+}
+
+/**
+ * Cherche la trame précédente d'un compteur, dans la capture puis dans les captures ajoutées avant,
+ * par l'index des trames de chaque compteur construit par prepare()
+ * @return la trame décodée, NULL si la trame est la première du compteur
+ */
+Teleinfo* TeleinfoRebuild::findPrevious(unsigned int capture, uint64_t frame, int meter, TeleinfoDecoder* teleinfoDecoder) {
+	uint64_t adco = registry->getMeter(meter)->adco;
+	while (true) {
+		if (capture == firstCapture[meter] && frame <= firstFrame[meter]) {
+			return NULL;
+		}
+		int64_t previous = captures[capture]->findPreviousFrame(frame, adco);
+		if (previous < 0) {
+			if (capture <= firstCapture[meter]) {
+				return NULL;
+			}
+			capture--;
+			frame = captures[capture]->getFrameCount();
+			continue;
+		}
+		Teleinfo* teleinfo = captures[capture]->decodeFrame(previous, teleinfoDecoder);
+		if (teleinfo != NULL) {
+			return teleinfo;
+		}
+		frame = previous; // Trame illisible : la précédente du compteur
+	}
+}
+
+/**
+ * Met à jour la durée et le débit, et appelle la fonction de suivi (sous le verrou)
+ */
+void TeleinfoRebuild::report() {
+	progress.seconds = now() - startTime;
+	progress.framesPerSecond = progress.seconds > 0 ? progress.frames / progress.seconds : 0;
+	if (callback != NULL) {
+		callback(&progress, callbackContext);
+	}
+}
+
+void* TeleinfoRebuild::run(void* rebuild) {
+	((TeleinfoRebuild*) rebuild)->work();
+	return NULL;
+}
+
+double TeleinfoRebuild::now() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
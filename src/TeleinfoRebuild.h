@@ -0,0 +1,171 @@
+/**
+ * Déclaration de la reconstruction parallèle d'un historique à partir d'archives de captures
+ *
+ * Après un changement des règles d'agrégation, l'historique (TeleinfoRollup) de tout un parc est reconstruit à partir
+ * des captures (TeleinfoCaptureReader). Les trames de chaque capture sont découpées en partitions de trames successives ;
+ * chaque partition est décodée et agrégée par un thread de travail dans un historique partiel, qui est ensuite cumulé
+ * dans l'historique final (TeleinfoRollup::merge(...)). Le cumul ne dépend pas de l'ordre : les partitions sont traitées
+ * dans n'importe quel ordre, par autant de threads que de coeurs.
+ *
+ * Les compteurs sont identifiés par l'adresse de chaque entrée d'index de capture (voir TeleinfoCaptureEntry::adco)
+ * et numérotés par un registre, dans l'ordre de leur première trame, avant le traitement des partitions. Les index
+ * de la trame qui précède une partition sont lus avant la partition : l'énergie entre deux partitions n'est pas perdue
+ * (si les deux trames sont du même compteur).
+ *
+ * La progression est enregistrée régulièrement (partitions terminées et historique cumulé) : une reconstruction
+ * interrompue reprend où elle en était, sans compter deux fois une partition.
+ *
+ * Dates des captures en millisecondes (voir TeleinfoRollup). Disponible sur les systèmes POSIX uniquement.
+ * @author LK
+ */
+
+#ifndef TELEINFO_REBUILD_H_
+#define TELEINFO_REBUILD_H_
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoCapture.h"
+#include "TeleinfoRegistry.h"
+#include "TeleinfoRollup.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+/**
+ * Identifiant d'un fichier de progression
+ */
+#define TELEINFO_REBUILD_MAGIC            "TIREBLD1"
+
+/**
+ * Nombre maximal de captures
+ */
+#ifndef TELEINFO_REBUILD_CAPTURES
+#define TELEINFO_REBUILD_CAPTURES         1024
+#endif
+
+/**
+ * Nombre maximal de threads de travail
+ */
+#define TELEINFO_REBUILD_WORKERS          256
+
+/**
+ * Nombre de trames d'une partition par défaut
+ */
+#define TELEINFO_REBUILD_PARTITION        65536
+
+/**
+ * Intervalle par défaut d'enregistrement de la progression (s)
+ */
+#define TELEINFO_REBUILD_CHECKPOINT       30
+
+/**
+ * Progression d'une reconstruction
+ */
+struct TeleinfoRebuildProgress {
+  unsigned long partitions;         // Nombre de partitions
+  unsigned long donePartitions;     // Partitions cumulées dans l'historique (y compris celles d'une reconstruction précédente)
+  uint64_t frames;                  // Trames décodées depuis le début de cette reconstruction
+  uint64_t skippedFrames;           // Trames sans compteur (pas d'ADCO) ou non décodées
+  double seconds;                   // Durée depuis le début de cette reconstruction
+  double framesPerSecond;           // Débit moyen
+};
+
+/**
+ * Fonction appelée après chaque partition cumulée (sous le verrou de la reconstruction, elle doit être brève)
+ */
+typedef void (*TeleinfoRebuildCallback)(const TeleinfoRebuildProgress* progress, void* context);
+
+/**
+ * Reconstruction parallèle d'un historique
+ */
+class TeleinfoRebuild {
+  private:
+    /**
+     * Une partition : trames [first, end[ d'une capture
+     */
+    struct Partition {
+      unsigned int capture;
+      uint64_t first;
+      uint64_t end;
+    };
+
+    TeleinfoRegistry* registry;
+    TeleinfoRollup* rollup;
+    uint64_t partitionFrames;
+    TeleinfoCaptureReader* captures[TELEINFO_REBUILD_CAPTURES];
+    unsigned int capturesCount;
+    Partition* partitions;
+    unsigned char* done;              // 1 par partition cumulée
+    unsigned long partitionsCount;
+    unsigned int* firstCapture;       // Première trame de chaque compteur : capture et numéro
+    uint64_t* firstFrame;
+    unsigned long nextPartition;      // Prochaine partition à traiter (accès atomique)
+    char* progressPath;
+    unsigned int checkpointInterval;
+    uint64_t generation;              // Numéro de l'enregistrement de la progression
+    TeleinfoRebuildCallback callback;
+    void* callbackContext;
+    bool stopping;                    // Accès atomiques
+    pthread_mutex_t mutex;
+    TeleinfoRebuildProgress progress;
+    double startTime;
+    double lastCheckpoint;
+    bool failed;                      // Accès atomiques
+
+    bool prepare();
+    bool loadProgress();
+    bool saveProgress();
+    void work();
+    Teleinfo* findPrevious(unsigned int capture, uint64_t frame, int meter, TeleinfoDecoder* teleinfoDecoder);
+    void report();
+    static void* run(void* rebuild);
+    static double now();
+
+  public:
+    /**
+     * Création d'une reconstruction
+     * @param registry le registre qui numérote les compteurs (les compteurs déjà enregistrés gardent leur numéro)
+     * @param rollup l'historique reconstruit, normalement vide, dont le nombre de compteurs est celui du registre
+     * @param partitionFrames le nombre de trames d'une partition
+     */
+    TeleinfoRebuild(TeleinfoRegistry* registry, TeleinfoRollup* rollup, uint64_t partitionFrames = TELEINFO_REBUILD_PARTITION);
+    ~TeleinfoRebuild();
+
+    /**
+     * Ajoute une capture à l'archive
+     * @return false si la capture ne peut être lue ou si le nombre maximal de captures est atteint
+     */
+    bool addCapture(const char* path);
+
+    /**
+     * Enregistre la progression dans un fichier, et reprend une reconstruction interrompue qui l'a enregistrée
+     * (mêmes captures, même découpage). L'historique cumulé est enregistré à côté (même nom suivi d'un numéro).
+     * @param interval l'intervalle d'enregistrement (s)
+     */
+    void setProgressPath(const char* path, unsigned int interval = TELEINFO_REBUILD_CHECKPOINT);
+
+    /**
+     * Fixe la fonction appelée après chaque partition (suivi du débit)
+     */
+    void setCallback(TeleinfoRebuildCallback callback, void* context);
+
+    /**
+     * Reconstruit l'historique
+     * @param workers le nombre de threads de travail, 0 pour un par coeur
+     * @return false en cas d'erreur (registre plein, mémoire, écriture de la progression) ou si la reconstruction a été
+     *         arrêtée par stop() : elle reprendra à partir de la progression enregistrée
+     */
+    bool rebuild(unsigned int workers = 0);
+
+    /**
+     * Arrête la reconstruction (par exemple depuis la fonction de suivi ou un gestionnaire de signal) : les partitions
+     * en cours sont terminées et la progression est enregistrée
+     */
+    void stop();
+
+    /**
+     * Donne la progression
+     */
+    void getProgress(TeleinfoRebuildProgress* progress);
+};
+
+#endif  // TELEINFO_REBUILD_H_
@@ -0,0 +1,219 @@
+/**
+ * Implémentation du registre des compteurs
+ *
+ * @author LK
+ */
+#include "TeleinfoRegistry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Longueur d'une adresse de compteur
+ */
+#define TELEINFO_ADCO_LENGTH   12
+
+TeleinfoRegistry::TeleinfoRegistry(unsigned int meters, unsigned int ports) {
+	// Table au plus à moitié pleine
+	unsigned int size = 2;
+	while (size < meters * 2) {
+		size *= 2;
+	}
+	this->keys = (uint64_t*) calloc(size, sizeof(uint64_t));
+	this->slots = (uint32_t*) malloc(size * sizeof(uint32_t));
+	this->meters = (TeleinfoMeter*) malloc(meters * sizeof(TeleinfoMeter));
+	this->portMeters = (int*) malloc(ports * sizeof(int));
+	this->portChanges = (unsigned long*) malloc(ports * sizeof(unsigned long));
+	bool allocated = keys != NULL && slots != NULL && this->meters != NULL && portMeters != NULL && portChanges != NULL;
+	this->mask = size - 1;
+	this->metersCapacity = allocated ? meters : 0;
+	this->portsCount = allocated ? ports : 0;
+	clear();
+}
+
+TeleinfoRegistry::~TeleinfoRegistry() {
+	free(keys);
+	free(slots);
+	free(meters);
+	free(portMeters);
+	free(portChanges);
+}
+
+int TeleinfoRegistry::route(unsigned int port, Teleinfo* teleinfo, uint64_t timestamp, int* previousMeter) {
+	if (previousMeter != NULL) {
+		*previousMeter = TELEINFO_REGISTRY_NONE;
+	}
+	if (port >= portsCount || teleinfo == NULL) {
+		return TELEINFO_REGISTRY_NONE;
+	}
+	int meter = add(packAdco(teleinfo->getAdco()));
+	if (meter == TELEINFO_REGISTRY_NONE) {
+		return TELEINFO_REGISTRY_NONE;
+	}
+
+	// Changement de compteur sur le port
+	int previous = portMeters[port];
+	if (previous != meter) {
+		if (previous != TELEINFO_REGISTRY_NONE) {
+			portChanges[port]++;
+			if (previousMeter != NULL) {
+				*previousMeter = previous;
+			}
+		}
+		portMeters[port] = meter;
+	}
+
+	TeleinfoMeter* current = &meters[meter];
+	unsigned long totalIndex = teleinfo->getTotalIndex() + teleinfo->getTotalOffset(); // Index total brut
+	if (current->frames == 0) {
+		current->totalOffset = totalIndex;
+	}
+	current->totalIndex = totalIndex;
+	current->lastSeen = timestamp;
+	current->frames++;
+	current->port = port;
+	return meter;
+}
+
+int TeleinfoRegistry::find(uint64_t adco) {
+	if (adco == 0 || metersCapacity == 0) {
+		return TELEINFO_REGISTRY_NONE;
+	}
+	unsigned int slot = slotOf(adco);
+	while (keys[slot] != 0) {
+		if (keys[slot] == adco) {
+			return slots[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+	return TELEINFO_REGISTRY_NONE;
+}
+
+int TeleinfoRegistry::add(uint64_t adco) {
+	if (adco == 0 || metersCapacity == 0) {
+		return TELEINFO_REGISTRY_NONE;
+	}
+	unsigned int slot = slotOf(adco);
+	while (keys[slot] != 0) {
+		if (keys[slot] == adco) {
+			return slots[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+	if (metersCount >= metersCapacity) {
+		return TELEINFO_REGISTRY_NONE;
+	}
+	unsigned int meter = metersCount++;
+	keys[slot] = adco;
+	slots[slot] = meter;
+	memset(&meters[meter], 0, sizeof(TeleinfoMeter));
+	meters[meter].adco = adco;
+	meters[meter].port = TELEINFO_REGISTRY_NONE;
+	return meter;
+}
+
+TeleinfoMeter* TeleinfoRegistry::getMeter(int meter) {
+	if (meter < 0 || (unsigned int) meter >= metersCount) {
+		return NULL;
+	}
+	return &meters[meter];
+}
+
+int TeleinfoRegistry::getPortMeter(unsigned int port) {
+	return port < portsCount ? portMeters[port] : TELEINFO_REGISTRY_NONE;
+}
+
+unsigned long TeleinfoRegistry::getPortChanges(unsigned int port) {
+	return port < portsCount ? portChanges[port] : 0;
+}
+
+unsigned int TeleinfoRegistry::getMeterCount() {
+	return metersCount;
+}
+
+unsigned int TeleinfoRegistry::getCapacity() {
+	return metersCapacity;
+}
+
+void TeleinfoRegistry::clear() {
+	metersCount = 0;
+	if (keys != NULL) {
+		memset(keys, 0, (mask + 1) * sizeof(uint64_t));
+	}
+	for (unsigned int port = 0; port < portsCount; port++) {
+		portMeters[port] = TELEINFO_REGISTRY_NONE;
+		portChanges[port] = 0;
+	}
+}
+
+/**
+ * Etat sauvegardé : nombre de compteurs (8 octets), compteurs (metersCapacity), changements puis compteur de chaque port
+ */
+unsigned long TeleinfoRegistry::getStateSize() {
+	return sizeof(uint64_t) + metersCapacity * sizeof(TeleinfoMeter) + portsCount * (sizeof(unsigned long) + sizeof(int));
+}
+
+void TeleinfoRegistry::saveState(void* buffer) {
+	unsigned char* state = (unsigned char*) buffer;
+	uint64_t count = metersCount;
+	memcpy(state, &count, sizeof(uint64_t));
+	state += sizeof(uint64_t);
+	memcpy(state, meters, metersCount * sizeof(TeleinfoMeter));
+	memset(state + metersCount * sizeof(TeleinfoMeter), 0, (metersCapacity - metersCount) * sizeof(TeleinfoMeter));
+	state += metersCapacity * sizeof(TeleinfoMeter);
+	memcpy(state, portChanges, portsCount * sizeof(unsigned long));
+	state += portsCount * sizeof(unsigned long);
+	memcpy(state, portMeters, portsCount * sizeof(int));
+}
+
+bool TeleinfoRegistry::restoreState(const void* buffer, unsigned long size) {
+	if (size != getStateSize()) {
+		return false;
+	}
+	const unsigned char* state = (const unsigned char*) buffer;
+	uint64_t count;
+	memcpy(&count, state, sizeof(uint64_t));
+	if (count > metersCapacity) {
+		return false;
+	}
+	clear();
+	state += sizeof(uint64_t);
+	memcpy(meters, state, count * sizeof(TeleinfoMeter));
+	state += metersCapacity * sizeof(TeleinfoMeter);
+	memcpy(portChanges, state, portsCount * sizeof(unsigned long));
+	state += portsCount * sizeof(unsigned long);
+	memcpy(portMeters, state, portsCount * sizeof(int));
+
+	// Reconstruction de la table d'adressage, les compteurs gardent leur numéro
+	metersCount = count;
+	for (unsigned int meter = 0; meter < metersCount; meter++) {
+		unsigned int slot = slotOf(meters[meter].adco);
+		while (keys[slot] != 0) {
+			slot = (slot + 1) & mask;
+		}
+		keys[slot] = meters[meter].adco;
+		slots[slot] = meter;
+	}
+	return true;
+}
+
+uint64_t TeleinfoRegistry::packAdco(const char* adco) {
+	if (adco == NULL) {
+		return 0;
+	}
+	uint64_t value = 0;
+	for (int i = 0; i < TELEINFO_ADCO_LENGTH; i++) {
+		if (adco[i] < '0' || adco[i] > '9') {
+			return 0;
+		}
+		value = value * 10 + (adco[i] - '0');
+	}
+	return adco[TELEINFO_ADCO_LENGTH] == '\0' ? value : 0;
+}
+
+/**
+ * Emplacement initial d'une adresse dans la table (hachage multiplicatif de Fibonacci)
+ */
+unsigned int TeleinfoRegistry::slotOf(uint64_t adco) {
+	return (unsigned int) ((adco * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
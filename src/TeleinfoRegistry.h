@@ -0,0 +1,147 @@
+/**
+ * Déclaration du registre des compteurs
+ *
+ * Sur une passerelle qui reçoit plusieurs flux Téléinfo (un par port), le registre identifie le compteur de chaque trame
+ * par son adresse (ADCO) et lui attribue un numéro, de 0 à meters - 1 dans l'ordre d'apparition : ce numéro est celui
+ * attendu par TeleinfoAggregator et TeleinfoTariff. Le registre tient aussi à jour l'état de chaque compteur
+ * (offset de l'index total, dernière trame) et signale le changement de compteur sur un port (câbles inversés...).
+ *
+ * L'ADCO (12 chiffres) est codé dans un entier de 64 bits, clé d'une table à adressage ouvert (sondage linéaire)
+ * au plus à moitié pleine : recherche et ajout coûtent un temps constant. Toute la mémoire est allouée à la création.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_REGISTRY_H_
+#define TELEINFO_REGISTRY_H_
+
+#include "TeleinfoDecoder.h"
+
+#include <stdint.h>
+
+/**
+ * Numéro de compteur invalide
+ */
+#define TELEINFO_REGISTRY_NONE   -1
+
+/**
+ * Etat d'un compteur
+ */
+struct TeleinfoMeter {
+  uint64_t adco;                // Adresse du compteur (voir TeleinfoRegistry::packAdco(...))
+  unsigned long totalOffset;    // Index total de la première trame (équivalent de TELEINFO_TOTAL_OFFSET_AUTO, par compteur)
+  unsigned long totalIndex;     // Index total de la dernière trame
+  uint64_t lastSeen;            // Date de la dernière trame
+  unsigned long frames;         // Nombre de trames reçues
+  int port;                     // Port de la dernière trame
+};
+
+/**
+ * Registre des compteurs d'une passerelle
+ */
+class TeleinfoRegistry {
+  private:
+    uint64_t* keys;               // Table à adressage ouvert : ADCO, 0 si l'emplacement est libre
+    uint32_t* slots;              // Table à adressage ouvert : numéro du compteur
+    unsigned int mask;            // Taille de la table - 1 (puissance de 2)
+    TeleinfoMeter* meters;
+    unsigned int metersCount;
+    unsigned int metersCapacity;
+    int* portMeters;              // Dernier compteur vu sur chaque port
+    unsigned long* portChanges;   // Nombre de changements de compteur sur chaque port
+    unsigned int portsCount;
+
+    unsigned int slotOf(uint64_t adco);
+
+  public:
+    /**
+     * Création du registre
+     * @param meters le nombre maximal de compteurs
+     * @param ports le nombre de ports (flux Téléinfo) de la passerelle, numérotés de 0 à ports - 1
+     */
+    TeleinfoRegistry(unsigned int meters, unsigned int ports);
+    ~TeleinfoRegistry();
+
+    /**
+     * Identifie le compteur d'une trame reçue sur un port, l'enregistre s'il est nouveau et met à jour son état
+     *
+     * @param port le port de réception
+     * @param teleinfo la trame décodée
+     * @param timestamp la date de réception de la trame (unité libre)
+     * @param previousMeter reçoit le compteur vu précédemment sur le port s'il a changé, TELEINFO_REGISTRY_NONE sinon
+     *        (facultatif, peut être NULL)
+     * @return le numéro du compteur, TELEINFO_REGISTRY_NONE si l'ADCO est invalide, le registre plein ou le port invalide
+     */
+    int route(unsigned int port, Teleinfo* teleinfo, uint64_t timestamp, int* previousMeter);
+
+    /**
+     * Donne le numéro d'un compteur
+     * @return TELEINFO_REGISTRY_NONE si le compteur n'est pas enregistré
+     */
+    int find(uint64_t adco);
+
+    /**
+     * Enregistre un compteur (sans effet s'il l'est déjà)
+     * @return le numéro du compteur, TELEINFO_REGISTRY_NONE si l'ADCO est invalide (0) ou le registre plein
+     */
+    int add(uint64_t adco);
+
+    /**
+     * Donne l'état d'un compteur
+     * @return NULL si le numéro est invalide
+     */
+    TeleinfoMeter* getMeter(int meter);
+
+    /**
+     * Donne le dernier compteur vu sur un port, TELEINFO_REGISTRY_NONE si aucun
+     */
+    int getPortMeter(unsigned int port);
+
+    /**
+     * Donne le nombre de changements de compteur sur un port
+     */
+    unsigned long getPortChanges(unsigned int port);
+
+    /**
+     * Donne le nombre de compteurs enregistrés
+     */
+    unsigned int getMeterCount();
+
+    /**
+     * Donne le nombre maximal de compteurs
+     */
+    unsigned int getCapacity();
+
+    /**
+     * Efface tous les compteurs et l'état des ports
+     */
+    void clear();
+
+    /**
+     * Donne la taille de l'état du registre (voir saveState(...))
+     */
+    unsigned long getStateSize();
+
+    /**
+     * Copie l'état des compteurs et des ports pour un point de reprise (la table d'adressage est reconstruite à la restauration)
+     * @param buffer reçoit l'état, getStateSize() octets
+     */
+    void saveState(void* buffer);
+
+    /**
+     * Restaure l'état copié par saveState(...)
+     * @return false si la taille ne correspond pas (autre capacité ou autre nombre de ports), l'état est alors inchangé
+     */
+    bool restoreState(const void* buffer, unsigned long size);
+
+    /**
+     * Code une adresse de compteur (12 chiffres) dans un entier de 64 bits.
+     * Contrairement à Teleinfo::getAdcoAsLong(), le résultat ne dépend pas de la taille d'un unsigned long
+     * et une adresse mal formée est refusée.
+     *
+     * @return l'adresse, 0 si elle ne compte pas exactement 12 chiffres
+     */
+    static uint64_t packAdco(const char* adco);
+};
+
+#endif  // TELEINFO_REGISTRY_H_
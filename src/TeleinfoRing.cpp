@@ -0,0 +1,54 @@
+/**
+ * Implémentation du tampon circulaire d'octets Téléinfo
+ *
+ * @author LK
+ */
+#include "TeleinfoRing.h"
+
+#include <stdlib.h>
+
+TeleinfoRing::TeleinfoRing() {
+	head = 0;
+	tail = 0;
+	overflows = 0;
+}
+
+unsigned int TeleinfoRing::pop(unsigned char* data, unsigned int size) {
+	unsigned int position = tail;
+	unsigned int length = __atomic_load_n(&head, __ATOMIC_ACQUIRE) - position;
+	if (length > size) {
+		length = size;
+	}
+	for (unsigned int i = 0; i < length; i++) {
+		data[i] = buffer[(position + i) & (TELEINFO_RING_SIZE - 1)];
+	}
+	__atomic_store_n(&tail, position + length, __ATOMIC_RELEASE); // Libère la place pour le producteur
+	return length;
+}
+
+Teleinfo* TeleinfoRing::drain(TeleinfoDecoder* teleinfoDecoder) {
+	Teleinfo* result = NULL;
+	unsigned int position = tail;
+	unsigned int end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+	while (position != end && result == NULL) {
+		// Lot contigu : jusqu'à la fin des octets disponibles ou jusqu'à la fin physique du tampon
+		unsigned int index = position & (TELEINFO_RING_SIZE - 1);
+		unsigned int length = end - position;
+		if (length > TELEINFO_RING_SIZE - index) {
+			length = TELEINFO_RING_SIZE - index;
+		}
+		unsigned int consumed = 0;
+		result = teleinfoDecoder->decode(buffer + index, length, &consumed);
+		position += consumed;
+		__atomic_store_n(&tail, position, __ATOMIC_RELEASE); // Libère la place pour le producteur
+	}
+	return result;
+}
+
+unsigned int TeleinfoRing::available() {
+	return __atomic_load_n(&head, __ATOMIC_ACQUIRE) - tail;
+}
+
+unsigned int TeleinfoRing::getOverflows() {
+	return __atomic_load_n(&overflows, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,90 @@
+/**
+ * Déclaration du tampon circulaire d'octets Téléinfo
+ * @author LK
+ */
+
+#ifndef TELEINFO_RING_H_
+#define TELEINFO_RING_H_
+
+#include "TeleinfoDecoder.h"
+
+/**
+ * Taille du tampon circulaire en octets, doit être une puissance de 2.
+ * 256 octets représentent plus de 2 secondes de flux Téléinfo à 1200 baud.
+ */
+#ifndef TELEINFO_RING_SIZE
+#define TELEINFO_RING_SIZE   256
+#endif
+
+#if (TELEINFO_RING_SIZE & (TELEINFO_RING_SIZE - 1)) != 0
+#error "TELEINFO_RING_SIZE doit être une puissance de 2"
+#endif
+
+/**
+ * Tampon circulaire d'octets à un seul producteur et un seul consommateur, sans verrou ni allocation.
+ *
+ * Le producteur (routine d'interruption de l'UART, gestionnaire de signal, thread de lecture...) ajoute les octets
+ * reçus par push(). Le consommateur (boucle principale) les décode par lots avec drain().
+ * Chaque index n'est écrit que par un seul côté et publié par une écriture atomique : aucun octet n'est perdu
+ * ni réordonné tant que le tampon n'est pas plein. Lorsqu'il est plein, les octets reçus sont comptés puis ignorés.
+ */
+class TeleinfoRing {
+  private:
+    unsigned char buffer[TELEINFO_RING_SIZE];
+    unsigned int head;      // Position d'écriture, modifiée par le producteur uniquement
+    unsigned int tail;      // Position de lecture, modifiée par le consommateur uniquement
+    unsigned int overflows; // Octets perdus faute de place, modifié par le producteur uniquement
+
+  public:
+    /**
+     * Création d'un tampon vide
+     */
+    TeleinfoRing();
+
+    /**
+     * Ajoute un octet au tampon (côté producteur, utilisable depuis une interruption)
+     * Comme pour TeleinfoDecoder::decode(int character), les caractères de valeur -1 sont ignorés.
+     *
+     * @return false si le tampon est plein et l'octet perdu, true sinon
+     */
+    bool push(int character) {
+      if (character == -1) {
+        return true;
+      }
+      unsigned int position = head;
+      if (position - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == TELEINFO_RING_SIZE) {
+        __atomic_store_n(&overflows, overflows + 1, __ATOMIC_RELAXED);
+        return false;
+      }
+      buffer[position & (TELEINFO_RING_SIZE - 1)] = (unsigned char) character;
+      __atomic_store_n(&head, position + 1, __ATOMIC_RELEASE);
+      return true;
+    }
+
+    /**
+     * Retire des octets du tampon (côté consommateur)
+     *
+     * @return le nombre d'octets copiés dans data, au plus size
+     */
+    unsigned int pop(unsigned char* data, unsigned int size);
+
+    /**
+     * Décode les octets du tampon par lots contigus (côté consommateur), sans copie intermédiaire.
+     * S'arrête à la fin de la première trame terminée : les octets suivants restent dans le tampon pour l'appel suivant.
+     *
+     * @return un objet Teleinfo si une trame a été terminée, NULL si le tampon a été vidé sans terminer de trame
+     */
+    Teleinfo* drain(TeleinfoDecoder* teleinfoDecoder);
+
+    /**
+     * Donne le nombre d'octets en attente dans le tampon (côté consommateur)
+     */
+    unsigned int available();
+
+    /**
+     * Donne le nombre d'octets perdus depuis la création du tampon, faute de place
+     */
+    unsigned int getOverflows();
+};
+
+#endif  // TELEINFO_RING_H_
@@ -0,0 +1,413 @@
+/**
+ * Implémentation de l'historique des trames Téléinfo par niveaux de cumul
+ *
+ * @author LK
+ */
+#include "TeleinfoRollup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************************************************************************************************************************************************************
+  CONSTANTES
+ *********************************************************************************************************************************************************************/
+
+/* Version du format de fichier */
+#define TELEINFO_ROLLUP_VERSION      1
+
+/* Nombre de lignes allouées pour un niveau vide */
+#define TELEINFO_ROLLUP_INITIAL      64
+
+/**
+ * En-tête d'un fichier d'historique
+ */
+struct TeleinfoRollupHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t meters;
+	uint32_t tiers;
+	uint32_t rowSize;
+};
+
+/**
+ * Durée d'une période de chaque niveau (ms)
+ */
+static const uint64_t TELEINFO_TIER_DURATIONS[TELEINFO_TIERS] = { 0, 60000ULL, 3600000ULL, 86400000ULL };
+
+/*********************************************************************************************************************************************************************
+  HISTORIQUE
+ *********************************************************************************************************************************************************************/
+
+TeleinfoRollup::TeleinfoRollup(unsigned int meters, unsigned int tiers) {
+	this->meters = (Meter*) calloc(meters, sizeof(Meter));
+	this->metersCount = this->meters != NULL ? meters : 0;
+	this->tiers = tiers & TELEINFO_TIERS_ALL;
+	lastTier = -1;
+	lastScanned = 0;
+}
+
+TeleinfoRollup::~TeleinfoRollup() {
+	for (unsigned int i = 0; i < metersCount; i++) {
+		freeMeter(&meters[i]);
+	}
+	free(meters);
+}
+
+bool TeleinfoRollup::update(unsigned int meter, Teleinfo* teleinfo, uint64_t timestamp) {
+	if (meter >= metersCount || teleinfo == NULL) {
+		return false;
+	}
+	Meter* current = &meters[meter];
+
+	// Ligne de la trame
+	TeleinfoRollupRow row;
+	memset(&row, 0, sizeof(row));
+	row.start = timestamp;
+	row.count = 1;
+	row.powerMin = teleinfo->getInstPower();
+	row.powerMax = row.powerMin;
+	row.powerSum = row.powerMin;
+	readIndexes(current, teleinfo, row.energy);
+	current->started = 1;
+	current->last = timestamp;
+
+	// Cumul dans la dernière ligne de chaque niveau si la trame appartient à sa période (ou la précède), sinon nouvelle ligne
+	bool stored = true;
+	for (int tier = 0; tier < TELEINFO_TIERS; tier++) {
+		if (!(tiers & (1 << tier))) {
+			continue;
+		}
+		Tier* lines = &current->tiers[tier];
+		uint64_t duration = TELEINFO_TIER_DURATIONS[tier];
+		row.start = duration > 0 ? timestamp - timestamp % duration : timestamp;
+		if (lines->count > 0 && row.start <= lines->rows[lines->count - 1].start) {
+			uint64_t start = lines->rows[lines->count - 1].start;
+			merge(&lines->rows[lines->count - 1], &row);
+			lines->rows[lines->count - 1].start = start;
+		} else if (!append(lines, &row)) {
+			stored = false;
+		}
+	}
+	return stored;
+}
+
+bool TeleinfoRollup::prime(unsigned int meter, Teleinfo* teleinfo) {
+	if (meter >= metersCount || teleinfo == NULL) {
+		return false;
+	}
+	uint32_t energy[TELEINFO_PERIODS];
+	readIndexes(&meters[meter], teleinfo, energy);
+	return true;
+}
+
+bool TeleinfoRollup::merge(unsigned int meter, TeleinfoRollup* other, unsigned int otherMeter) {
+	if (meter >= metersCount || other == NULL || otherMeter >= other->metersCount || other->tiers != tiers) {
+		return false;
+	}
+	Meter* current = &meters[meter];
+	Meter* source = &other->meters[otherMeter];
+	for (int tier = 0; tier < TELEINFO_TIERS; tier++) {
+		if (!mergeTier(&current->tiers[tier], &source->tiers[tier])) {
+			return false;
+		}
+	}
+	if (source->started && (!current->started || source->last >= current->last)) {
+		memcpy(current->index, source->index, sizeof(current->index));
+		current->known = source->known;
+		current->started = 1;
+		current->last = source->last;
+	}
+	return true;
+}
+
+int TeleinfoRollup::query(unsigned int meter, uint64_t from, uint64_t to, uint64_t resolution, TeleinfoRollupRow* results, unsigned int capacity) {
+	lastTier = -1;
+	lastScanned = 0;
+	if (meter >= metersCount || resolution == 0) {
+		return -1;
+	}
+
+	// Niveau le plus grossier dont la durée divise la résolution et les bornes
+	int tier = TELEINFO_TIERS - 1;
+	for (; tier >= 0; tier--) {
+		uint64_t duration = TELEINFO_TIER_DURATIONS[tier];
+		if ((tiers & (1 << tier)) && (duration == 0 || (resolution % duration == 0 && from % duration == 0 && to % duration == 0))) {
+			break;
+		}
+	}
+	if (tier < 0) {
+		return -1;
+	}
+	lastTier = tier;
+
+	// Première ligne de l'intervalle
+	Tier* lines = &meters[meter].tiers[tier];
+	uint32_t low = 0;
+	uint32_t high = lines->count;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (lines->rows[middle].start < from) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	unsigned int count = 0;
+	for (uint32_t i = low; i < lines->count && lines->rows[i].start < to; i++) {
+		const TeleinfoRollupRow* row = &lines->rows[i];
+		uint64_t start = row->start - row->start % resolution;
+		if (count > 0 && results[count - 1].start == start) {
+			merge(&results[count - 1], row);
+		} else if (count < capacity) {
+			results[count] = *row;
+			results[count].start = start;
+			count++;
+		} else {
+			break;
+		}
+		lastScanned++;
+	}
+	return count;
+}
+
+int TeleinfoRollup::getLastTier() {
+	return lastTier;
+}
+
+unsigned long TeleinfoRollup::getLastScanned() {
+	return lastScanned;
+}
+
+const TeleinfoRollupRow* TeleinfoRollup::getRows(unsigned int meter, int tier, unsigned int* count) {
+	*count = 0;
+	if (meter >= metersCount || tier < 0 || tier >= TELEINFO_TIERS || meters[meter].tiers[tier].count == 0) {
+		return NULL;
+	}
+	*count = meters[meter].tiers[tier].count;
+	return meters[meter].tiers[tier].rows;
+}
+
+void TeleinfoRollup::clear(unsigned int meter) {
+	if (meter < metersCount) {
+		freeMeter(&meters[meter]);
+		memset(&meters[meter], 0, sizeof(Meter));
+	}
+}
+
+unsigned int TeleinfoRollup::getMeterCount() {
+	return metersCount;
+}
+
+unsigned int TeleinfoRollup::getTiers() {
+	return tiers;
+}
+
+bool TeleinfoRollup::save(const char* path) {
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) {
+		return false;
+	}
+	TeleinfoRollupHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TELEINFO_ROLLUP_MAGIC, sizeof(header.magic));
+	header.version = TELEINFO_ROLLUP_VERSION;
+	header.meters = metersCount;
+	header.tiers = tiers;
+	header.rowSize = sizeof(TeleinfoRollupRow);
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	// Pour chaque compteur : derniers index, index reçus, date de la dernière trame, puis nombre de lignes et lignes de chaque niveau tenu
+	for (unsigned int i = 0; i < metersCount && written; i++) {
+		Meter* meter = &meters[i];
+		written = fwrite(meter->index, sizeof(meter->index), 1, file) == 1 && fwrite(&meter->known, sizeof(meter->known), 1, file) == 1
+				&& fwrite(&meter->started, sizeof(meter->started), 1, file) == 1 && fwrite(&meter->last, sizeof(meter->last), 1, file) == 1;
+		for (int tier = 0; tier < TELEINFO_TIERS && written; tier++) {
+			if (tiers & (1 << tier)) {
+				Tier* lines = &meter->tiers[tier];
+				written = fwrite(&lines->count, sizeof(lines->count), 1, file) == 1
+						&& fwrite(lines->rows, sizeof(TeleinfoRollupRow), lines->count, file) == lines->count;
+			}
+		}
+	}
+	if (fclose(file) != 0) {
+		written = false;
+	}
+	return written;
+}
+
+bool TeleinfoRollup::load(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		return false;
+	}
+	TeleinfoRollupHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, TELEINFO_ROLLUP_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != TELEINFO_ROLLUP_VERSION || header.meters != metersCount || header.tiers != tiers
+			|| header.rowSize != sizeof(TeleinfoRollupRow)) {
+		fclose(file);
+		return false;
+	}
+
+	// Lecture complète avant de remplacer l'historique en cours
+	Meter* loaded = (Meter*) calloc(metersCount, sizeof(Meter));
+	bool read = loaded != NULL || metersCount == 0;
+	for (unsigned int i = 0; i < metersCount && read; i++) {
+		Meter* meter = &loaded[i];
+		read = fread(meter->index, sizeof(meter->index), 1, file) == 1 && fread(&meter->known, sizeof(meter->known), 1, file) == 1
+				&& fread(&meter->started, sizeof(meter->started), 1, file) == 1 && fread(&meter->last, sizeof(meter->last), 1, file) == 1;
+		for (int tier = 0; tier < TELEINFO_TIERS && read; tier++) {
+			if (tiers & (1 << tier)) {
+				Tier* lines = &meter->tiers[tier];
+				uint32_t count;
+				read = fread(&count, sizeof(count), 1, file) == 1;
+				if (read && count > 0) {
+					lines->rows = (TeleinfoRollupRow*) malloc(count * sizeof(TeleinfoRollupRow));
+					read = lines->rows != NULL && fread(lines->rows, sizeof(TeleinfoRollupRow), count, file) == count;
+					lines->capacity = lines->rows != NULL ? count : 0;
+					lines->count = read ? count : 0;
+				}
+			}
+		}
+	}
+	fclose(file);
+
+	Meter* previous = read ? meters : loaded;
+	for (unsigned int i = 0; i < metersCount && previous != NULL; i++) {
+		freeMeter(&previous[i]);
+	}
+	free(previous);
+	if (read) {
+		meters = loaded;
+	}
+	return read;
+}
+
+void TeleinfoRollup::merge(TeleinfoRollupRow* row, const TeleinfoRollupRow* other) {
+	if (other->count == 0) {
+		return;
+	}
+	if (row->count == 0) {
+		*row = *other;
+		return;
+	}
+	row->start = other->start < row->start ? other->start : row->start;
+	row->count += other->count;
+	row->powerMin = other->powerMin < row->powerMin ? other->powerMin : row->powerMin;
+	row->powerMax = other->powerMax > row->powerMax ? other->powerMax : row->powerMax;
+	row->powerSum += other->powerSum;
+	for (int period = 0; period < TELEINFO_PERIODS; period++) {
+		row->energy[period] += other->energy[period];
+	}
+}
+
+uint64_t TeleinfoRollup::getTierDuration(int tier) {
+	return tier >= 0 && tier < TELEINFO_TIERS ? TELEINFO_TIER_DURATIONS[tier] : 0;
+}
+
+/**
+ * Ajoute une ligne à la fin d'un niveau, en doublant sa capacité si nécessaire
+ */
+bool TeleinfoRollup::append(Tier* tier, const TeleinfoRollupRow* row) {
+	if (tier->count == tier->capacity) {
+		uint32_t capacity = tier->capacity > 0 ? tier->capacity * 2 : TELEINFO_ROLLUP_INITIAL;
+		TeleinfoRollupRow* rows = (TeleinfoRollupRow*) realloc(tier->rows, capacity * sizeof(TeleinfoRollupRow));
+		if (rows == NULL) {
+			return false;
+		}
+		tier->rows = rows;
+		tier->capacity = capacity;
+	}
+	tier->rows[tier->count++] = *row;
+	return true;
+}
+
+/**
+ * Cumule les lignes d'un autre niveau.
+ * Seules les lignes à partir de la première période de l'autre niveau sont réécrites : cumuler des partitions successives
+ * dans le temps revient à ajouter leurs lignes à la fin.
+ */
+bool TeleinfoRollup::mergeTier(Tier* tier, const Tier* other) {
+	if (other->count == 0) {
+		return true;
+	}
+	uint32_t low = 0;
+	uint32_t high = tier->count;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (tier->rows[middle].start < other->rows[0].start) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	// Lignes suivantes du niveau mises de côté, puis fusion des deux suites ordonnées
+	uint32_t tailCount = tier->count - low;
+	TeleinfoRollupRow* tail = NULL;
+	if (tailCount > 0) {
+		tail = (TeleinfoRollupRow*) malloc(tailCount * sizeof(TeleinfoRollupRow));
+		if (tail == NULL) {
+			return false;
+		}
+		memcpy(tail, &tier->rows[low], tailCount * sizeof(TeleinfoRollupRow));
+	}
+	tier->count = low;
+	uint32_t i = 0;
+	uint32_t j = 0;
+	bool stored = true;
+	while ((i < tailCount || j < other->count) && stored) {
+		if (j == other->count || (i < tailCount && tail[i].start < other->rows[j].start)) {
+			stored = append(tier, &tail[i++]);
+		} else if (i == tailCount || other->rows[j].start < tail[i].start) {
+			stored = append(tier, &other->rows[j++]);
+		} else {
+			TeleinfoRollupRow row = tail[i++];
+			merge(&row, &other->rows[j++]);
+			stored = append(tier, &row);
+		}
+	}
+	free(tail);
+	return stored;
+}
+
+/**
+ * Lit les index d'une trame : écart de chaque index depuis la trame précédente, un index absent (nul) est ignoré
+ * @param energy reçoit l'écart de chaque index
+ */
+void TeleinfoRollup::readIndexes(Meter* meter, Teleinfo* teleinfo, uint32_t* energy) {
+	unsigned long values[TELEINFO_PERIODS] = {
+		teleinfo->getBase(), teleinfo->getHchc(), teleinfo->getHchp(), teleinfo->getEjphn(), teleinfo->getEjphpm(),
+		teleinfo->getBbrhcjb(), teleinfo->getBbrhpjb(), teleinfo->getBbrhcjw(), teleinfo->getBbrhpjw(), teleinfo->getBbrhcjr(), teleinfo->getBbrhpjr()
+	};
+	for (int period = 0; period < TELEINFO_PERIODS; period++) {
+		unsigned long value = values[period];
+		energy[period] = 0;
+		if (value == 0) {
+			continue;
+		}
+		if (meter->known & (1 << period)) {
+			unsigned long previous = meter->index[period];
+			if (value >= previous) {
+				energy[period] = value - previous;
+			} else if (previous - value > TELEINFO_INDEX_MODULO / 2) {
+				energy[period] = value + TELEINFO_INDEX_MODULO - previous;
+			} // Sinon index qui recule : l'écart est ignoré
+		}
+		meter->index[period] = value;
+		meter->known |= 1 << period;
+	}
+}
+
+/**
+ * Libère les lignes d'un compteur
+ */
+void TeleinfoRollup::freeMeter(Meter* meter) {
+	for (int tier = 0; tier < TELEINFO_TIERS; tier++) {
+		free(meter->tiers[tier].rows);
+		meter->tiers[tier].rows = NULL;
+		meter->tiers[tier].count = 0;
+		meter->tiers[tier].capacity = 0;
+	}
+}
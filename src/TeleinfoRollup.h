@@ -0,0 +1,201 @@
+/**
+ * Déclaration de l'historique des trames Téléinfo par niveaux de cumul (1 minute, 1 heure, 1 jour)
+ *
+ * Pour chaque compteur, chaque trame est ajoutée au niveau des trames (une ligne par trame) et cumulée dans la ligne
+ * en cours des niveaux 1 minute, 1 heure et 1 jour : nombre de trames, minimum, maximum et somme de la puissance
+ * instantanée (getInstPower()), énergie consommée sur chaque index (écarts successifs de BASE, HCHC, HCHP...).
+ * Une ligne n'existe que pour une période ayant reçu au moins une trame ; les lignes d'un niveau sont rangées par date
+ * de début et retrouvées par recherche dichotomique.
+ *
+ * Une requête (compteur, intervalle de dates, résolution) lit le niveau le plus grossier qui suffit : celui dont la durée
+ * divise la résolution et les bornes de l'intervalle. Une courbe de puissance d'un mois à 10 minutes lit ainsi quelques
+ * dizaines de milliers de lignes du niveau 1 minute au lieu du million de trames du mois ; l'énergie journalière lit
+ * une ligne par jour.
+ *
+ * Les cumuls de deux lignes se combinent dans n'importe quel ordre (voir merge(...)). L'historique est enregistré dans
+ * un fichier et relu par save(...) et load(...).
+ *
+ * Dates en millisecondes depuis l'époque Unix (les jours sont des jours UTC), croissantes pour un même compteur.
+ * @author LK
+ */
+
+#ifndef TELEINFO_ROLLUP_H_
+#define TELEINFO_ROLLUP_H_
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoTariff.h"
+
+#include <stdint.h>
+
+/**
+ * Identifiant d'un fichier d'historique
+ */
+#define TELEINFO_ROLLUP_MAGIC         "TIROLL01"
+
+/**
+ * Niveaux de cumul
+ */
+#define TELEINFO_TIER_FRAME           0   // Une ligne par trame
+#define TELEINFO_TIER_1MIN            1
+#define TELEINFO_TIER_1H              2
+#define TELEINFO_TIER_1DAY            3
+#define TELEINFO_TIERS                4
+
+/**
+ * Niveaux tenus par l'historique (masque de bits 1 << TELEINFO_TIER_*)
+ */
+#define TELEINFO_TIERS_ALL            0x0F
+#define TELEINFO_TIERS_ROLLUPS        0x0E  // Sans le niveau des trames : requêtes à la minute au plus fin
+
+/**
+ * Cumul des trames d'une période
+ */
+struct TeleinfoRollupRow {
+  uint64_t start;                     // Début de la période (ms), date de la trame au niveau TELEINFO_TIER_FRAME
+  uint64_t powerSum;                  // Somme des puissances : moyenne = powerSum / count
+  uint32_t count;                     // Nombre de trames
+  int32_t powerMin;                   // Puissance instantanée (W), voir Teleinfo::getInstPower()
+  int32_t powerMax;
+  uint32_t energy[TELEINFO_PERIODS];  // Energie consommée sur chaque index (Wh), dans l'ordre des périodes TELEINFO_PERIOD_*
+};
+
+/**
+ * Historique par niveaux de cumul d'un ensemble de compteurs
+ */
+class TeleinfoRollup {
+  private:
+    /**
+     * Lignes d'un niveau, par date de début croissante
+     */
+    struct Tier {
+      TeleinfoRollupRow* rows;
+      uint32_t count;
+      uint32_t capacity;
+    };
+
+    /**
+     * Un compteur
+     */
+    struct Meter {
+      Tier tiers[TELEINFO_TIERS];
+      uint32_t index[TELEINFO_PERIODS];   // Dernière valeur de chaque index
+      uint32_t known;                     // Index déjà reçus (un bit par période)
+      uint32_t started;                   // 1 si au moins une trame a été ajoutée
+      uint64_t last;                      // Date de la dernière trame ajoutée
+    };
+
+    Meter* meters;
+    unsigned int metersCount;
+    unsigned int tiers;
+    int lastTier;
+    unsigned long lastScanned;
+
+    bool append(Tier* tier, const TeleinfoRollupRow* row);
+    bool mergeTier(Tier* tier, const Tier* other);
+    void readIndexes(Meter* meter, Teleinfo* teleinfo, uint32_t* energy);
+    void freeMeter(Meter* meter);
+
+  public:
+    /**
+     * Création de l'historique
+     * @param meters le nombre de compteurs, numérotés de 0 à meters - 1 par l'appelant
+     * @param tiers les niveaux tenus, TELEINFO_TIERS_ALL par défaut
+     */
+    TeleinfoRollup(unsigned int meters, unsigned int tiers = TELEINFO_TIERS_ALL);
+    ~TeleinfoRollup();
+
+    /**
+     * Ajoute une trame à l'historique d'un compteur
+     *
+     * @param meter le numéro du compteur
+     * @param teleinfo la trame décodée
+     * @param timestamp la date de réception de la trame (ms) : une trame plus ancienne que la dernière ligne d'un niveau y est cumulée
+     * @return false si le numéro de compteur est invalide ou si la mémoire manque
+     */
+    bool update(unsigned int meter, Teleinfo* teleinfo, uint64_t timestamp);
+
+    /**
+     * Mémorise les index d'une trame sans l'ajouter à l'historique : l'énergie de la trame suivante est comptée à partir
+     * de ces index (reprise d'un historique découpé en partitions, voir TeleinfoRebuild)
+     * @return false si le numéro de compteur est invalide
+     */
+    bool prime(unsigned int meter, Teleinfo* teleinfo);
+
+    /**
+     * Cumule dans l'historique d'un compteur celui d'un compteur d'un autre historique tenant les mêmes niveaux.
+     * Les lignes d'une même période sont cumulées (voir merge(row, other)) : le résultat ne dépend pas de l'ordre des cumuls.
+     * Les derniers index retenus sont ceux de l'historique dont la dernière trame est la plus récente.
+     *
+     * @return false si un numéro de compteur est invalide, si les niveaux diffèrent ou si la mémoire manque
+     */
+    bool merge(unsigned int meter, TeleinfoRollup* other, unsigned int otherMeter);
+
+    /**
+     * Cumule l'historique d'un compteur par périodes de la résolution demandée, dans l'intervalle [from, to[
+     *
+     * @param meter le numéro du compteur
+     * @param resolution la durée d'une période (ms) ; les périodes commencent à un multiple de la résolution
+     * @param results reçoit une ligne par période ayant reçu au moins une trame, par date croissante
+     * @param capacity le nombre de lignes de results : si elles sont toutes utilisées, la suite est obtenue par une
+     *        nouvelle requête à partir de la fin de la dernière période
+     * @return le nombre de lignes écrites, -1 si le compteur ou la résolution sont invalides ou si aucun niveau tenu ne convient
+     */
+    int query(unsigned int meter, uint64_t from, uint64_t to, uint64_t resolution, TeleinfoRollupRow* results, unsigned int capacity);
+
+    /**
+     * Donne le niveau lu par la dernière requête (TELEINFO_TIER_*)
+     */
+    int getLastTier();
+
+    /**
+     * Donne le nombre de lignes lues par la dernière requête
+     */
+    unsigned long getLastScanned();
+
+    /**
+     * Donne les lignes d'un niveau d'un compteur
+     * @param count reçoit le nombre de lignes
+     * @return les lignes, NULL si le compteur ou le niveau sont invalides ou si aucune ligne n'existe
+     */
+    const TeleinfoRollupRow* getRows(unsigned int meter, int tier, unsigned int* count);
+
+    /**
+     * Efface l'historique d'un compteur
+     */
+    void clear(unsigned int meter);
+
+    /**
+     * Donne le nombre de compteurs
+     */
+    unsigned int getMeterCount();
+
+    /**
+     * Donne les niveaux tenus (masque de bits 1 << TELEINFO_TIER_*)
+     */
+    unsigned int getTiers();
+
+    /**
+     * Enregistre l'historique dans un fichier
+     * @return false en cas d'erreur d'écriture
+     */
+    bool save(const char* path);
+
+    /**
+     * Relit un historique enregistré par save(...)
+     * @return false si le fichier n'a pu être lu, n'est pas un historique ou ne correspond pas (autre nombre de compteurs,
+     *         autres niveaux) : l'historique est alors inchangé
+     */
+    bool load(const char* path);
+
+    /**
+     * Cumule une ligne dans une autre : nombres de trames, sommes et énergies additionnées, extrêmes retenus, début le plus ancien
+     */
+    static void merge(TeleinfoRollupRow* row, const TeleinfoRollupRow* other);
+
+    /**
+     * Donne la durée d'une période d'un niveau (ms), 0 pour le niveau des trames
+     */
+    static uint64_t getTierDuration(int tier);
+};
+
+#endif  // TELEINFO_ROLLUP_H_
@@ -0,0 +1,270 @@
+/**
+ * Implémentation de la sérialisation des trames Téléinfo
+ *
+ * @author LK
+ */
+#include "TeleinfoSerializer.h"
+
+#include <string.h>
+
+/*********************************************************************************************************************************************************************
+  CONSTANTES
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Paires de chiffres de 00 à 99
+ */
+static const char TELEINFO_SERIALIZER_DIGITS[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+/**
+ * Valeur d'un champ : texte ou nombre
+ */
+struct TeleinfoSerializerValue {
+	const char* text;   // NULL pour un nombre
+	long long number;
+	char character[2];  // Texte d'un champ d'un seul caractère (HHPHC)
+};
+
+/**
+ * Lecture d'un champ d'une trame, d'après son étiquette dans le schéma du décodeur
+ */
+static void getValue(Teleinfo* teleinfo, const TeleinfoLabel* label, TeleinfoSerializerValue* value) {
+	value->text = NULL;
+	switch (label->type) {
+		case TELEINFO_TYPE_TEXT :
+			value->text = teleinfo->getText(label);
+			break;
+		case TELEINFO_TYPE_CHAR :
+			value->character[0] = (char) teleinfo->getNumber(label);
+			value->character[1] = '\0';
+			value->text = value->character;
+			break;
+		default :
+			value->number = teleinfo->getNumber(label);
+			break;
+	}
+}
+
+/**
+ * Ecriture d'une chaîne sans caractère nul final
+ */
+static char* appendString(char* target, const char* text) {
+	while (*text != '\0') {
+		*target++ = *text++;
+	}
+	return target;
+}
+
+/**
+ * Ecriture d'un entier signé
+ */
+static char* appendNumber(char* target, long long number) {
+	if (number < 0) {
+		*target++ = '-';
+		return target + TeleinfoSerializer::formatUnsigned(target, (uint64_t) -number);
+	}
+	return target + TeleinfoSerializer::formatUnsigned(target, (uint64_t) number);
+}
+
+/**
+ * Ecriture d'un texte entre guillemets, '"' et '\' échappés (JSON, valeur d'un champ en line protocol)
+ */
+static char* appendQuoted(char* target, const char* text) {
+	*target++ = '"';
+	for (; *text != '\0'; text++) {
+		if (*text == '"' || *text == '\\') {
+			*target++ = '\\';
+		}
+		*target++ = *text;
+	}
+	*target++ = '"';
+	return target;
+}
+
+/**
+ * Ecriture d'une valeur CSV, entre guillemets si elle contient une virgule ou un guillemet
+ */
+static char* appendCsv(char* target, const char* text) {
+	if (strpbrk(text, ",\"") == NULL) {
+		return appendString(target, text);
+	}
+	*target++ = '"';
+	for (; *text != '\0'; text++) {
+		if (*text == '"') {
+			*target++ = '"';
+		}
+		*target++ = *text;
+	}
+	*target++ = '"';
+	return target;
+}
+
+/**
+ * Ecriture d'une valeur de tag en line protocol : espace, virgule et '=' échappés
+ */
+static char* appendTag(char* target, const char* text) {
+	for (; *text != '\0'; text++) {
+		if (*text == ' ' || *text == ',' || *text == '=') {
+			*target++ = '\\';
+		}
+		*target++ = *text;
+	}
+	return target;
+}
+
+/*********************************************************************************************************************************************************************
+  SERIALISATION
+ *********************************************************************************************************************************************************************/
+
+TeleinfoSerializer::TeleinfoSerializer(char* buffer, unsigned int size, int format) {
+	this->buffer = buffer;
+	this->size = size;
+	this->format = format;
+	clear();
+}
+
+bool TeleinfoSerializer::append(Teleinfo* teleinfo, uint64_t timestamp) {
+	if (size - length < TELEINFO_SERIALIZER_FRAME_SIZE) {
+		return false;
+	}
+	unsigned long long present = teleinfo->getValidFields() | teleinfo->getCarriedFields();
+	char* target = buffer + length;
+	TeleinfoSerializerValue value;
+	unsigned int count;
+	const TeleinfoLabel* schema = TeleinfoDecoder::getSchema(&count);
+
+	switch (format) {
+		case TELEINFO_FORMAT_LINE : {
+			if ((present & ~TELEINFO_FIELD_ADCO) == 0) {
+				return true; // Une ligne a au moins un champ : trame ignorée
+			}
+			target = appendString(target, TELEINFO_SERIALIZER_MEASUREMENT);
+			if (present & TELEINFO_FIELD_ADCO) {
+				target = appendString(target, ",ADCO=");
+				target = appendTag(target, teleinfo->getAdco());
+			}
+			char separator = ' ';
+			for (unsigned int i = 0; i < count; i++) {
+				if (schema[i].field != TELEINFO_FIELD_ADCO && (present & schema[i].field)) {
+					*target++ = separator;
+					separator = ',';
+					target = appendString(target, schema[i].etiquette);
+					*target++ = '=';
+					getValue(teleinfo, &schema[i], &value);
+					if (value.text != NULL) {
+						target = appendQuoted(target, value.text);
+					} else {
+						target = appendNumber(target, value.number);
+						*target++ = 'i';
+					}
+				}
+			}
+			*target++ = ' ';
+			target += formatUnsigned(target, timestamp);
+			break;
+		}
+
+		case TELEINFO_FORMAT_CSV :
+			target += formatUnsigned(target, timestamp);
+			for (unsigned int i = 0; i < count; i++) {
+				*target++ = ',';
+				if (present & schema[i].field) {
+					getValue(teleinfo, &schema[i], &value);
+					target = value.text != NULL ? appendCsv(target, value.text) : appendNumber(target, value.number);
+				}
+			}
+			break;
+
+		case TELEINFO_FORMAT_JSON :
+			target = appendString(target, "{\"timestamp\":");
+			target += formatUnsigned(target, timestamp);
+			for (unsigned int i = 0; i < count; i++) {
+				if (present & schema[i].field) {
+					*target++ = ',';
+					*target++ = '"';
+					target = appendString(target, schema[i].etiquette);
+					*target++ = '"';
+					*target++ = ':';
+					getValue(teleinfo, &schema[i], &value);
+					target = value.text != NULL ? appendQuoted(target, value.text) : appendNumber(target, value.number);
+				}
+			}
+			*target++ = '}';
+			break;
+
+		default :
+			return true;
+	}
+	*target++ = '\n';
+	length = target - buffer;
+	frames++;
+	return true;
+}
+
+bool TeleinfoSerializer::appendHeader() {
+	if (format != TELEINFO_FORMAT_CSV) {
+		return true;
+	}
+	if (size - length < TELEINFO_SERIALIZER_FRAME_SIZE) {
+		return false;
+	}
+	unsigned int count;
+	const TeleinfoLabel* schema = TeleinfoDecoder::getSchema(&count);
+	char* target = appendString(buffer + length, "timestamp");
+	for (unsigned int i = 0; i < count; i++) {
+		*target++ = ',';
+		target = appendString(target, schema[i].etiquette);
+	}
+	*target++ = '\n';
+	length = target - buffer;
+	return true;
+}
+
+const char* TeleinfoSerializer::getBuffer() {
+	return buffer;
+}
+
+unsigned int TeleinfoSerializer::getLength() {
+	return length;
+}
+
+unsigned int TeleinfoSerializer::getFrames() {
+	return frames;
+}
+
+void TeleinfoSerializer::clear() {
+	length = 0;
+	frames = 0;
+}
+
+unsigned int TeleinfoSerializer::formatUnsigned(char* target, uint64_t value) {
+	char digits[20];
+	char* position = digits + sizeof(digits);
+	while (value >= 100) {
+		unsigned int pair = (unsigned int) (value % 100) * 2;
+		value /= 100;
+		position -= 2;
+		position[0] = TELEINFO_SERIALIZER_DIGITS[pair];
+		position[1] = TELEINFO_SERIALIZER_DIGITS[pair + 1];
+	}
+	if (value >= 10) {
+		position -= 2;
+		position[0] = TELEINFO_SERIALIZER_DIGITS[value * 2];
+		position[1] = TELEINFO_SERIALIZER_DIGITS[value * 2 + 1];
+	} else {
+		*--position = (char) ('0' + value);
+	}
+	unsigned int count = digits + sizeof(digits) - position;
+	memcpy(target, position, count);
+	return count;
+}
@@ -0,0 +1,106 @@
+/**
+ * Déclaration de la sérialisation des trames Téléinfo (InfluxDB line protocol, CSV, JSON)
+ *
+ * Les trames sont écrites les unes à la suite des autres dans un tampon fourni par l'appelant, sans allocation
+ * ni appel à sprintf : les entiers sont formatés par paires de chiffres. Seuls les champs reçus dans la trame
+ * ou reportés d'une trame précédente (getValidFields() | getCarriedFields()) sont écrits.
+ *
+ * Formats (une trame par ligne, les noms des champs sont les étiquettes Téléinfo) :
+ *   - TELEINFO_FORMAT_LINE : teleinfo,ADCO=026489026467 HCHC=12345678i,PTEC="HC..",... 1700000000000
+ *   - TELEINFO_FORMAT_CSV  : timestamp,ADCO,OPTARIF,... (tous les champs du schéma du décodeur, vides si absents, voir appendHeader())
+ *   - TELEINFO_FORMAT_JSON : {"timestamp":1700000000000,"ADCO":"026489026467","HCHC":12345678,...}
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_SERIALIZER_H_
+#define TELEINFO_SERIALIZER_H_
+
+#include "TeleinfoDecoder.h"
+
+#include <stdint.h>
+
+/**
+ * Formats de sérialisation
+ */
+#define TELEINFO_FORMAT_LINE            0
+#define TELEINFO_FORMAT_CSV             1
+#define TELEINFO_FORMAT_JSON            2
+
+/**
+ * Nom de la mesure en InfluxDB line protocol
+ */
+#ifndef TELEINFO_SERIALIZER_MEASUREMENT
+#define TELEINFO_SERIALIZER_MEASUREMENT "teleinfo"
+#endif
+
+/**
+ * Place libre nécessaire dans le tampon pour y écrire une trame, quel que soit le format
+ */
+#define TELEINFO_SERIALIZER_FRAME_SIZE  1024
+
+/**
+ * Ecriture d'un lot de trames dans un tampon
+ */
+class TeleinfoSerializer {
+  private:
+    char* buffer;
+    unsigned int size;
+    unsigned int length;
+    unsigned int frames;
+    int format;
+
+  public:
+    /**
+     * Création du sérialiseur
+     * @param buffer le tampon
+     * @param size la taille du tampon
+     * @param format TELEINFO_FORMAT_LINE, TELEINFO_FORMAT_CSV ou TELEINFO_FORMAT_JSON
+     */
+    TeleinfoSerializer(char* buffer, unsigned int size, int format);
+
+    /**
+     * Ajoute une trame au lot
+     *
+     * @param teleinfo la trame décodée
+     * @param timestamp la date de la trame (unité libre, celle attendue par le destinataire)
+     * @return false si la place libre est inférieure à TELEINFO_SERIALIZER_FRAME_SIZE : le lot est à envoyer puis à vider par clear().
+     *         En line protocol, une trame sans autre champ que ADCO n'est pas écrite (true est renvoyé).
+     */
+    bool append(Teleinfo* teleinfo, uint64_t timestamp);
+
+    /**
+     * Ajoute la ligne d'en-tête (format CSV uniquement, sans effet pour les autres formats)
+     * @return false si la place libre est insuffisante
+     */
+    bool appendHeader();
+
+    /**
+     * Donne le tampon (le texte n'est pas terminé par un caractère nul)
+     */
+    const char* getBuffer();
+
+    /**
+     * Donne la longueur du texte écrit dans le tampon
+     */
+    unsigned int getLength();
+
+    /**
+     * Donne le nombre de trames écrites dans le tampon
+     */
+    unsigned int getFrames();
+
+    /**
+     * Vide le tampon
+     */
+    void clear();
+
+    /**
+     * Ecrit un entier en décimal
+     * @param target reçoit les chiffres, au plus 20, sans caractère nul final
+     * @return le nombre de chiffres écrits
+     */
+    static unsigned int formatUnsigned(char* target, uint64_t value);
+};
+
+#endif  // TELEINFO_SERIALIZER_H_
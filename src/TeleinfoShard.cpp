@@ -0,0 +1,102 @@
+/**
+ * Implémentation de la répartition des compteurs par hachage cohérent
+ *
+ * @author LK
+ */
+#include "TeleinfoShard.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Graine du hachage des points de l'anneau, distincte de celle des clés
+ */
+#define TELEINFO_SHARD_SEED   0x5DEECE66DULL
+
+TeleinfoShard::TeleinfoShard(unsigned int replicas) {
+	this->replicas = replicas > 0 ? replicas : 1;
+	this->points = (Point*) malloc(TELEINFO_SHARD_WORKERS * this->replicas * sizeof(Point));
+	this->pointsCount = 0;
+	memset(workers, 0, sizeof(workers));
+	this->workersCount = 0;
+}
+
+TeleinfoShard::~TeleinfoShard() {
+	free(points);
+}
+
+bool TeleinfoShard::addWorker(int worker) {
+	if (points == NULL || worker < 0 || worker >= TELEINFO_SHARD_WORKERS || workers[worker]) {
+		return false;
+	}
+	for (unsigned int replica = 0; replica < replicas; replica++) {
+		points[pointsCount].hash = hash((((uint64_t) worker << 32) | replica) ^ TELEINFO_SHARD_SEED);
+		points[pointsCount].worker = worker;
+		pointsCount++;
+	}
+	qsort(points, pointsCount, sizeof(Point), comparePoints);
+	workers[worker] = true;
+	workersCount++;
+	return true;
+}
+
+bool TeleinfoShard::removeWorker(int worker) {
+	if (!hasWorker(worker)) {
+		return false;
+	}
+	// Compactage en conservant l'ordre
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < pointsCount; i++) {
+		if (points[i].worker != worker) {
+			points[kept++] = points[i];
+		}
+	}
+	pointsCount = kept;
+	workers[worker] = false;
+	workersCount--;
+	return true;
+}
+
+bool TeleinfoShard::hasWorker(int worker) {
+	return worker >= 0 && worker < TELEINFO_SHARD_WORKERS && workers[worker];
+}
+
+unsigned int TeleinfoShard::getWorkerCount() {
+	return workersCount;
+}
+
+int TeleinfoShard::getOwner(uint64_t key) {
+	if (pointsCount == 0) {
+		return TELEINFO_SHARD_NONE;
+	}
+	// Premier point dont le hachage est supérieur ou égal à celui de la clé, le premier de l'anneau au-delà du dernier
+	uint64_t keyHash = hash(key);
+	unsigned int low = 0;
+	unsigned int high = pointsCount;
+	while (low < high) {
+		unsigned int middle = (low + high) / 2;
+		if (points[middle].hash < keyHash) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return points[low < pointsCount ? low : 0].worker;
+}
+
+uint64_t TeleinfoShard::hash(uint64_t key) {
+	// Finalisation de splitmix64
+	key += 0x9E3779B97F4A7C15ULL;
+	key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+	return key ^ (key >> 31);
+}
+
+int TeleinfoShard::comparePoints(const void* first, const void* second) {
+	const Point* firstPoint = (const Point*) first;
+	const Point* secondPoint = (const Point*) second;
+	if (firstPoint->hash != secondPoint->hash) {
+		return firstPoint->hash < secondPoint->hash ? -1 : 1;
+	}
+	return firstPoint->worker - secondPoint->worker; // Ordre indépendant de l'ordre d'ajout
+}
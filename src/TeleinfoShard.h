@@ -0,0 +1,99 @@
+/**
+ * Déclaration de la répartition des compteurs entre processus par hachage cohérent
+ *
+ * Une passerelle répartie confie chaque compteur à l'un de ses processus de travail selon son adresse (ADCO,
+ * voir Teleinfo::getAdcoAsLong()). Chaque processus occupe plusieurs points (noeuds virtuels) sur un anneau de hachage
+ * de 64 bits ; un compteur appartient au processus du premier point qui suit le hachage de son adresse. Quand un
+ * processus est ajouté, il ne reprend que les compteurs situés juste avant ses points (environ 1/K du parc) ; quand
+ * un processus est retiré, seuls ses compteurs changent de propriétaire. La répartition ne dépend que de l'ensemble
+ * des processus, pas de l'ordre de leur ajout.
+ *
+ * Toute la mémoire est allouée à la création ; une recherche est une dichotomie sur les points triés.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_SHARD_H_
+#define TELEINFO_SHARD_H_
+
+#include <stdint.h>
+
+/**
+ * Nombre maximal de processus, numérotés de 0 à TELEINFO_SHARD_WORKERS - 1
+ */
+#define TELEINFO_SHARD_WORKERS    64
+
+/**
+ * Nombre de points de chaque processus sur l'anneau par défaut (écart de charge de l'ordre de 10 %)
+ */
+#define TELEINFO_SHARD_REPLICAS   160
+
+/**
+ * Processus invalide
+ */
+#define TELEINFO_SHARD_NONE       -1
+
+/**
+ * Anneau de hachage cohérent
+ */
+class TeleinfoShard {
+  private:
+    /**
+     * Un point de l'anneau
+     */
+    struct Point {
+      uint64_t hash;
+      int worker;
+    };
+
+    Point* points;                // Points triés par hachage croissant
+    unsigned int pointsCount;
+    unsigned int replicas;
+    bool workers[TELEINFO_SHARD_WORKERS];
+    unsigned int workersCount;
+
+    static int comparePoints(const void* first, const void* second);
+
+  public:
+    /**
+     * Création d'un anneau sans processus
+     * @param replicas le nombre de points de chaque processus
+     */
+    TeleinfoShard(unsigned int replicas = TELEINFO_SHARD_REPLICAS);
+    ~TeleinfoShard();
+
+    /**
+     * Ajoute un processus
+     * @return false si le numéro est invalide, déjà présent ou si la mémoire n'a pu être allouée
+     */
+    bool addWorker(int worker);
+
+    /**
+     * Retire un processus : ses compteurs sont répartis entre les processus restants
+     * @return false si le processus n'est pas présent
+     */
+    bool removeWorker(int worker);
+
+    /**
+     * Indique si un processus est présent
+     */
+    bool hasWorker(int worker);
+
+    /**
+     * Donne le nombre de processus
+     */
+    unsigned int getWorkerCount();
+
+    /**
+     * Donne le processus propriétaire d'une clé (adresse de compteur)
+     * @return TELEINFO_SHARD_NONE si l'anneau est vide
+     */
+    int getOwner(uint64_t key);
+
+    /**
+     * Hachage de 64 bits d'une clé, bien réparti même pour des clés consécutives
+     */
+    static uint64_t hash(uint64_t key);
+};
+
+#endif  // TELEINFO_SHARD_H_
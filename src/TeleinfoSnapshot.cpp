@@ -0,0 +1,69 @@
+/**
+ * Implémentation de la copie d'une trame Téléinfo
+ *
+ * @author LK
+ */
+#include "TeleinfoSnapshot.h"
+
+#include <string.h>
+
+/**
+ * Copie d'une chaîne de taille fixe (la copie est toujours terminée par un caractère nul)
+ */
+static void copyString(char* target, const char* source, unsigned int size) {
+	strncpy(target, source, size - 1);
+	target[size - 1] = '\0';
+}
+
+TeleinfoSnapshot::TeleinfoSnapshot() {
+	memset(&record, 0, sizeof(record));
+	totalIndex = 0;
+	totalOffset = 0;
+	instPower = 0;
+	adcoAsLong = 0;
+	adcoChecksum8 = 0;
+	validFields = 0;
+	carriedFields = 0;
+	memset(&timestamps, 0, sizeof(timestamps));
+}
+
+void TeleinfoSnapshot::copy(Teleinfo* teleinfo) {
+	unsigned int count;
+	const TeleinfoLabel* schema = TeleinfoDecoder::getSchema(&count);
+	memset(&record, 0, sizeof(record));
+	for (unsigned int i = 0; i < count; i++) {
+		const TeleinfoLabel* label = &schema[i];
+		switch (label->type) {
+			case TELEINFO_TYPE_NUMBER : record.numbers[label->slot] = teleinfo->getNumber(label); break;
+			case TELEINFO_TYPE_SHORT : record.shorts[label->slot] = teleinfo->getNumber(label); break;
+			case TELEINFO_TYPE_CHAR : record.texts[label->slot] = (char) teleinfo->getNumber(label); break;
+			case TELEINFO_TYPE_TEXT : copyString(&record.texts[label->slot], teleinfo->getText(label), label->length + 1); break;
+		}
+	}
+	totalIndex = teleinfo->getTotalIndex();
+	totalOffset = teleinfo->getTotalOffset();
+	instPower = teleinfo->getInstPower();
+	adcoAsLong = teleinfo->getAdcoAsLong();
+	adcoChecksum8 = teleinfo->getAdcoChecksum8();
+	validFields = teleinfo->getValidFields();
+	carriedFields = teleinfo->getCarriedFields();
+	const TeleinfoTimestamps* source = teleinfo->getTimestamps();
+	if (source != NULL) {
+		timestamps = *source;
+	} else {
+		memset(&timestamps, 0, sizeof(timestamps));
+	}
+}
+
+unsigned long long TeleinfoSnapshot::compare(TeleinfoSnapshot* other) {
+	unsigned int count;
+	const TeleinfoLabel* schema = TeleinfoDecoder::getSchema(&count);
+	unsigned long long fields = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		const TeleinfoLabel* label = &schema[i];
+		bool differs = label->type == TELEINFO_TYPE_TEXT ? strcmp(record.getText(label), other->record.getText(label)) != 0
+			: record.getNumber(label) != other->record.getNumber(label);
+		fields |= differs ? label->field : 0;
+	}
+	return fields;
+}
@@ -0,0 +1,91 @@
+/**
+ * Déclaration de la copie d'une trame Téléinfo
+ *
+ * L'objet Teleinfo donné par le décodeur n'est valide que jusqu'au début de la trame suivante. Une copie (TeleinfoSnapshot)
+ * garde les valeurs d'une trame aussi longtemps que nécessaire, par exemple en attendant qu'un destinataire lent la prenne
+ * en compte (voir TeleinfoConflator). Elle ne fait aucune allocation.
+ * Les valeurs sont rangées comme dans une trame (TeleinfoRecord) et copiées d'après le schéma des étiquettes du décodeur.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_SNAPSHOT_H_
+#define TELEINFO_SNAPSHOT_H_
+
+#include "TeleinfoDecoder.h"
+
+/**
+ * Copie d'une trame Téléinfo
+ */
+class TeleinfoSnapshot : public Teleinfo {
+  private:
+    TeleinfoRecord record;
+    unsigned long totalIndex;
+    unsigned long totalOffset;
+    int instPower;
+    unsigned long adcoAsLong;
+    unsigned int adcoChecksum8;
+    unsigned long long validFields;
+    unsigned long long carriedFields;
+    TeleinfoTimestamps timestamps;
+
+  public:
+    /**
+     * Création d'une copie vide (tous les champs à 0)
+     */
+    TeleinfoSnapshot();
+
+    /**
+     * Copie les valeurs d'une trame
+     */
+    void copy(Teleinfo* teleinfo);
+
+    /**
+     * Compare les valeurs de deux copies
+     * @return les champs (TELEINFO_FIELD_*) dont la valeur diffère
+     */
+    unsigned long long compare(TeleinfoSnapshot* other);
+
+    char* getAdco() { return &record.texts[TELEINFO_SLOT_ADCO]; }
+    char* getOptarif() { return &record.texts[TELEINFO_SLOT_OPTARIF]; }
+    int getIsousc() { return record.shorts[TELEINFO_SLOT_ISOUSC]; }
+    unsigned long getBase() { return record.numbers[TELEINFO_SLOT_BASE]; }
+    unsigned long getHchc() { return record.numbers[TELEINFO_SLOT_HCHC]; }
+    unsigned long getHchp() { return record.numbers[TELEINFO_SLOT_HCHP]; }
+    unsigned long getEjphn() { return record.numbers[TELEINFO_SLOT_EJPHN]; }
+    unsigned long getEjphpm() { return record.numbers[TELEINFO_SLOT_EJPHPM]; }
+    unsigned long getBbrhcjb() { return record.numbers[TELEINFO_SLOT_BBRHCJB]; }
+    unsigned long getBbrhpjb() { return record.numbers[TELEINFO_SLOT_BBRHPJB]; }
+    unsigned long getBbrhcjw() { return record.numbers[TELEINFO_SLOT_BBRHCJW]; }
+    unsigned long getBbrhpjw() { return record.numbers[TELEINFO_SLOT_BBRHPJW]; }
+    unsigned long getBbrhcjr() { return record.numbers[TELEINFO_SLOT_BBRHCJR]; }
+    unsigned long getBbrhpjr() { return record.numbers[TELEINFO_SLOT_BBRHPJR]; }
+    int getPejp() { return record.shorts[TELEINFO_SLOT_PEJP]; }
+    char* getPtec() { return &record.texts[TELEINFO_SLOT_PTEC]; }
+    char* getDemain() { return &record.texts[TELEINFO_SLOT_DEMAIN]; }
+    int getIinst() { return record.shorts[TELEINFO_SLOT_IINST]; }
+    int getAdps() { return record.shorts[TELEINFO_SLOT_ADPS]; }
+    int getImax() { return record.shorts[TELEINFO_SLOT_IMAX]; }
+    int getPapp() { return record.numbers[TELEINFO_SLOT_PAPP]; }
+    char getHhphc() { return record.texts[TELEINFO_SLOT_HHPHC]; }
+    char* getMotdetat() { return &record.texts[TELEINFO_SLOT_MOTDETAT]; }
+#ifndef TELEINFO_DISABLE_THREE_PHASE
+    int getIinstPhase(int phase) { return phase >= 1 && phase <= 3 ? record.shorts[TELEINFO_SLOT_IINST1 + phase - 1] : 0; }
+    int getImaxPhase(int phase) { return phase >= 1 && phase <= 3 ? record.shorts[TELEINFO_SLOT_IMAX1 + phase - 1] : 0; }
+    int getAdirPhase(int phase) { return phase >= 1 && phase <= 3 ? record.shorts[TELEINFO_SLOT_ADIR1 + phase - 1] : 0; }
+    unsigned long getPmax() { return record.numbers[TELEINFO_SLOT_PMAX]; }
+    char* getPpot() { return &record.texts[TELEINFO_SLOT_PPOT]; }
+#endif
+    unsigned long getTotalIndex() { return totalIndex; }
+    unsigned long getTotalOffset() { return totalOffset; }
+    int getInstPower() { return instPower; }
+    unsigned long getAdcoAsLong() { return adcoAsLong; }
+    unsigned int getAdcoChecksum8() { return adcoChecksum8; }
+    unsigned long long getValidFields() { return validFields; }
+    unsigned long long getCarriedFields() { return carriedFields; }
+    const TeleinfoTimestamps* getTimestamps() { return &timestamps; }
+    unsigned long getNumber(const TeleinfoLabel* label) { return record.getNumber(label); }
+    const char* getText(const TeleinfoLabel* label) { return record.getText(label); }
+};
+
+#endif  // TELEINFO_SNAPSHOT_H_
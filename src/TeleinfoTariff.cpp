@@ -0,0 +1,170 @@
+/**
+ * Implémentation de la comptabilité de l'énergie par période tarifaire
+ *
+ * @author LK
+ */
+#include "TeleinfoTariff.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Valeurs de PTEC, dans l'ordre des périodes
+ */
+static const char* const PERIODS[TELEINFO_PERIODS] = { "TH..", "HC..", "HP..", "HN..", "PM..", "HCJB", "HPJB", "HCJW", "HPJW", "HCJR", "HPJR" };
+
+TeleinfoTariff::TeleinfoTariff(unsigned int meters) {
+	this->meters = (Meter*) malloc(meters * sizeof(Meter));
+	this->metersCount = this->meters != NULL ? meters : 0;
+	for (unsigned int i = 0; i < metersCount; i++) {
+		clear(i);
+	}
+}
+
+TeleinfoTariff::~TeleinfoTariff() {
+	free(meters);
+}
+
+int TeleinfoTariff::update(unsigned int meter, Teleinfo* teleinfo, uint64_t timestamp, TeleinfoTariffEvent* event) {
+	if (meter >= metersCount || teleinfo == NULL) {
+		return -1;
+	}
+	Meter* current = &meters[meter];
+	int events = 0;
+
+	// Ecart de chaque index depuis la trame précédente, un index absent (nul) est ignoré
+	unsigned long values[TELEINFO_PERIODS] = {
+		teleinfo->getBase(), teleinfo->getHchc(), teleinfo->getHchp(), teleinfo->getEjphn(), teleinfo->getEjphpm(),
+		teleinfo->getBbrhcjb(), teleinfo->getBbrhpjb(), teleinfo->getBbrhcjw(), teleinfo->getBbrhpjw(), teleinfo->getBbrhcjr(), teleinfo->getBbrhpjr()
+	};
+	unsigned long energy = 0;
+	for (int period = 0; period < TELEINFO_PERIODS; period++) {
+		unsigned long value = values[period];
+		if (value == 0) {
+			continue;
+		}
+		if (current->known & (1 << period)) {
+			unsigned long previous = current->index[period];
+			unsigned long delta = 0;
+			if (value >= previous) {
+				delta = value - previous;
+			} else if (previous - value > TELEINFO_INDEX_MODULO / 2) {
+				delta = value + TELEINFO_INDEX_MODULO - previous;
+				events |= TELEINFO_TARIFF_ROLLOVER;
+			} else {
+				events |= TELEINFO_TARIFF_ANOMALY;
+			}
+			current->energy[period] += delta;
+			energy += delta;
+		}
+		current->index[period] = value;
+		current->known |= 1 << period;
+	}
+
+	// L'énergie de la trame qui change de période a été consommée pendant la période précédente
+	int period = parsePeriod(teleinfo->getPtec());
+	int demain = teleinfo->getValidFields() & TELEINFO_FIELD_DEMAIN ? parseDemain(teleinfo->getDemain()) : TELEINFO_DEMAIN_UNKNOWN;
+	unsigned long periodEnergy = current->periodEnergy + energy;
+	if (period != TELEINFO_PERIOD_UNKNOWN && period != current->period) {
+		events |= TELEINFO_TARIFF_PERIOD;
+	}
+	// Un DEMAIN absent de la trame (groupe perdu, valeur reportée) ne fait pas oublier la couleur du lendemain ;
+	// le retour à "----" en fin de journée est un changement
+	if (demain != TELEINFO_DEMAIN_UNKNOWN && demain != current->demain) {
+		events |= TELEINFO_TARIFF_DEMAIN;
+	}
+	if (event != NULL && (events & (TELEINFO_TARIFF_PERIOD | TELEINFO_TARIFF_DEMAIN))) {
+		event->previousPeriod = current->period;
+		event->period = period != TELEINFO_PERIOD_UNKNOWN ? period : current->period;
+		event->start = current->periodStart;
+		event->end = timestamp;
+		event->energy = periodEnergy;
+		event->previousDemain = current->demain;
+		event->demain = demain != TELEINFO_DEMAIN_UNKNOWN ? demain : current->demain;
+	}
+	if (events & TELEINFO_TARIFF_PERIOD) {
+		current->period = period;
+		current->periodStart = timestamp;
+		current->periodEnergy = 0;
+	} else {
+		current->periodEnergy = periodEnergy;
+	}
+	if (demain != TELEINFO_DEMAIN_UNKNOWN) {
+		current->demain = demain;
+	}
+	return events;
+}
+
+uint64_t TeleinfoTariff::getEnergy(unsigned int meter, int period) {
+	if (meter >= metersCount || period < 0 || period >= TELEINFO_PERIODS) {
+		return 0;
+	}
+	return meters[meter].energy[period];
+}
+
+int TeleinfoTariff::getPeriod(unsigned int meter) {
+	return meter < metersCount ? meters[meter].period : TELEINFO_PERIOD_UNKNOWN;
+}
+
+unsigned long TeleinfoTariff::getPeriodEnergy(unsigned int meter) {
+	return meter < metersCount ? meters[meter].periodEnergy : 0;
+}
+
+int TeleinfoTariff::getDemain(unsigned int meter) {
+	return meter < metersCount ? meters[meter].demain : TELEINFO_DEMAIN_UNKNOWN;
+}
+
+void TeleinfoTariff::clear(unsigned int meter) {
+	if (meter < metersCount) {
+		memset(&meters[meter], 0, sizeof(Meter));
+		meters[meter].period = TELEINFO_PERIOD_UNKNOWN;
+		meters[meter].demain = TELEINFO_DEMAIN_UNKNOWN;
+	}
+}
+
+unsigned int TeleinfoTariff::getMeterCount() {
+	return metersCount;
+}
+
+unsigned long TeleinfoTariff::getStateSize() {
+	return metersCount * sizeof(Meter);
+}
+
+void TeleinfoTariff::saveState(void* buffer) {
+	memcpy(buffer, meters, metersCount * sizeof(Meter));
+}
+
+bool TeleinfoTariff::restoreState(const void* buffer, unsigned long size) {
+	if (size != getStateSize()) {
+		return false;
+	}
+	memcpy(meters, buffer, size);
+	return true;
+}
+
+int TeleinfoTariff::parsePeriod(const char* ptec) {
+	if (ptec == NULL || ptec[0] == '\0') {
+		return TELEINFO_PERIOD_UNKNOWN;
+	}
+	for (int period = 0; period < TELEINFO_PERIODS; period++) {
+		if (strcmp(ptec, PERIODS[period]) == 0) {
+			return period;
+		}
+	}
+	return TELEINFO_PERIOD_UNKNOWN;
+}
+
+int TeleinfoTariff::parseDemain(const char* demain) {
+	if (demain == NULL) {
+		return TELEINFO_DEMAIN_UNKNOWN;
+	} else if (strcmp(demain, "----") == 0) {
+		return TELEINFO_DEMAIN_NONE;
+	} else if (strcmp(demain, "BLEU") == 0) {
+		return TELEINFO_DEMAIN_BLEU;
+	} else if (strcmp(demain, "BLAN") == 0) {
+		return TELEINFO_DEMAIN_BLANC;
+	} else if (strcmp(demain, "ROUG") == 0) {
+		return TELEINFO_DEMAIN_ROUGE;
+	}
+	return TELEINFO_DEMAIN_UNKNOWN;
+}
@@ -0,0 +1,169 @@
+/**
+ * Déclaration de la comptabilité de l'énergie par période tarifaire
+ *
+ * Chaque index (BASE, HCHC, HCHP, EJPHN, EJPHPM, BBR*) correspond à une période tarifaire (PTEC) : l'énergie de chaque
+ * période est la somme des écarts de son index d'une trame à la suivante, le passage d'un index à zéro après
+ * 999 999 999 Wh étant pris en compte. Les changements de période tarifaire (PTEC) et de couleur du lendemain (DEMAIN)
+ * sont signalés par des événements donnant l'énergie de la période qui se termine.
+ *
+ * Chaque trame ne coûte qu'un temps constant, sans relecture des trames précédentes, et toute la mémoire est allouée
+ * à la création.
+ *
+ * @author LK
+ */
+
+#ifndef TELEINFO_TARIFF_H_
+#define TELEINFO_TARIFF_H_
+
+#include "TeleinfoDecoder.h"
+
+#include <stdint.h>
+
+/**
+ * Périodes tarifaires (valeurs de PTEC), dans l'ordre des index correspondants
+ */
+#define TELEINFO_PERIOD_TH         0   // Toutes les heures (BASE)
+#define TELEINFO_PERIOD_HC         1   // Heures creuses (HCHC)
+#define TELEINFO_PERIOD_HP         2   // Heures pleines (HCHP)
+#define TELEINFO_PERIOD_HN         3   // Heures normales (EJPHN)
+#define TELEINFO_PERIOD_PM         4   // Heures de pointe mobile (EJPHPM)
+#define TELEINFO_PERIOD_HCJB       5   // Heures creuses jours bleus (BBRHCJB)
+#define TELEINFO_PERIOD_HPJB       6   // Heures pleines jours bleus (BBRHPJB)
+#define TELEINFO_PERIOD_HCJW       7   // Heures creuses jours blancs (BBRHCJW)
+#define TELEINFO_PERIOD_HPJW       8   // Heures pleines jours blancs (BBRHPJW)
+#define TELEINFO_PERIOD_HCJR       9   // Heures creuses jours rouges (BBRHCJR)
+#define TELEINFO_PERIOD_HPJR       10  // Heures pleines jours rouges (BBRHPJR)
+#define TELEINFO_PERIODS           11
+#define TELEINFO_PERIOD_UNKNOWN    -1  // PTEC absent ou inconnu
+
+/**
+ * Couleurs du lendemain (valeurs de DEMAIN)
+ */
+#define TELEINFO_DEMAIN_UNKNOWN    -1  // DEMAIN absent de la trame ou valeur inconnue
+#define TELEINFO_DEMAIN_NONE       0   // "----" : couleur pas encore annoncée
+#define TELEINFO_DEMAIN_BLEU       1
+#define TELEINFO_DEMAIN_BLANC      2
+#define TELEINFO_DEMAIN_ROUGE      3
+
+/**
+ * Evénements signalés par TeleinfoTariff::update(...)
+ */
+#define TELEINFO_TARIFF_PERIOD     0x01  // Changement de période tarifaire
+#define TELEINFO_TARIFF_DEMAIN     0x02  // Changement de couleur du lendemain
+#define TELEINFO_TARIFF_ROLLOVER   0x04  // Passage d'un index à zéro
+#define TELEINFO_TARIFF_ANOMALY    0x08  // Index qui recule (changement de compteur...) : l'écart est ignoré
+
+/**
+ * Evénement de changement de période tarifaire ou de couleur du lendemain
+ */
+struct TeleinfoTariffEvent {
+  int previousPeriod;         // Période qui se termine, TELEINFO_PERIOD_UNKNOWN au démarrage
+  int period;                 // Période qui commence
+  uint64_t start;             // Date de la première trame de la période qui se termine
+  uint64_t end;               // Date de la trame qui commence la nouvelle période
+  unsigned long energy;       // Energie consommée pendant la période qui se termine (Wh, tous index confondus)
+  int previousDemain;         // Couleur du lendemain précédente
+  int demain;                 // Couleur du lendemain
+};
+
+/**
+ * Comptabilité de l'énergie par période tarifaire d'un ensemble de compteurs
+ */
+class TeleinfoTariff {
+  private:
+    /**
+     * Un compteur
+     */
+    struct Meter {
+      uint32_t index[TELEINFO_PERIODS];     // Dernière valeur de chaque index
+      uint64_t energy[TELEINFO_PERIODS];    // Energie comptée pour chaque période (Wh)
+      uint16_t known;                       // Index déjà reçus (un bit par période)
+      int8_t period;
+      int8_t demain;
+      uint64_t periodStart;
+      unsigned long periodEnergy;           // Energie de la période en cours
+    };
+
+    Meter* meters;
+    unsigned int metersCount;
+
+  public:
+    /**
+     * Création de la comptabilité
+     * @param meters le nombre de compteurs, numérotés de 0 à meters - 1 par l'appelant
+     */
+    TeleinfoTariff(unsigned int meters);
+    ~TeleinfoTariff();
+
+    /**
+     * Comptabilise une trame
+     *
+     * @param meter le numéro du compteur
+     * @param teleinfo la trame décodée
+     * @param timestamp la date de réception de la trame (unité libre)
+     * @param event reçoit l'événement de changement de période ou de couleur du lendemain (facultatif, peut être NULL)
+     * @return les événements (TELEINFO_TARIFF_*) survenus, 0 si aucun, -1 si le numéro de compteur est invalide
+     */
+    int update(unsigned int meter, Teleinfo* teleinfo, uint64_t timestamp, TeleinfoTariffEvent* event);
+
+    /**
+     * Donne l'énergie comptée pour une période tarifaire (Wh)
+     */
+    uint64_t getEnergy(unsigned int meter, int period);
+
+    /**
+     * Donne la période tarifaire en cours, TELEINFO_PERIOD_UNKNOWN si elle est inconnue
+     */
+    int getPeriod(unsigned int meter);
+
+    /**
+     * Donne l'énergie consommée depuis le début de la période tarifaire en cours (Wh)
+     */
+    unsigned long getPeriodEnergy(unsigned int meter);
+
+    /**
+     * Donne la couleur du lendemain (TELEINFO_DEMAIN_*)
+     */
+    int getDemain(unsigned int meter);
+
+    /**
+     * Efface la comptabilité d'un compteur
+     */
+    void clear(unsigned int meter);
+
+    /**
+     * Donne le nombre de compteurs
+     */
+    unsigned int getMeterCount();
+
+    /**
+     * Donne la taille de l'état de la comptabilité (voir saveState(...))
+     */
+    unsigned long getStateSize();
+
+    /**
+     * Copie l'état de la comptabilité de tous les compteurs pour un point de reprise
+     * @param buffer reçoit l'état, getStateSize() octets
+     */
+    void saveState(void* buffer);
+
+    /**
+     * Restaure l'état copié par saveState(...)
+     * @return false si la taille ne correspond pas (autre nombre de compteurs), l'état est alors inchangé
+     */
+    bool restoreState(const void* buffer, unsigned long size);
+
+    /**
+     * Donne la période tarifaire d'une valeur de PTEC
+     * @return TELEINFO_PERIOD_UNKNOWN si la valeur est inconnue
+     */
+    static int parsePeriod(const char* ptec);
+
+    /**
+     * Donne la couleur d'une valeur de DEMAIN
+     * @return TELEINFO_DEMAIN_NONE pour "----", TELEINFO_DEMAIN_UNKNOWN si la valeur est inconnue
+     */
+    static int parseDemain(const char* demain);
+};
+
+#endif  // TELEINFO_TARIFF_H_
@@ -0,0 +1,245 @@
+/**
+ * Test unitaire de l'agrégation sur fenêtres glissantes
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoAggregator.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+class TeleinfoAggregatorTest : public CppUnit::TestFixture {
+
+private:
+	/**
+	 * Une trame agrégée, pour le calcul de référence
+	 */
+	struct Sample {
+		uint64_t timestamp;
+		int power;
+		int iinst;
+		unsigned long energy;
+	};
+
+	TeleinfoDecoder* teleinfoDecoder;
+
+public:
+
+	void setUp() {
+		teleinfoDecoder = new TeleinfoDecoder();
+	}
+
+	/**
+	 * Test des valeurs agrégées, comparées à un recalcul complet des trames de chaque fenêtre
+	 */
+	void testFenetres() {
+		TeleinfoAggregator aggregator(1);
+		vector<Sample> samples;
+		unsigned long base = 1000000;
+		uint64_t timestamp = 1500000000000ULL;
+		unsigned int seed = 42;
+		for (int i = 0; i < 4000; i++) {
+			seed = seed * 1103515245 + 12345;
+			int iinst = (seed >> 16) % 40;
+			int papp = iinst * 230 + (seed >> 8) % 100;
+			unsigned long previous = base;
+			base += (seed >> 4) % 20;
+			timestamp += 500 + (seed >> 12) % 2000;
+			if (i % 500 == 499) {
+				timestamp += 20 * 60 * 1000; // Interruption du flux
+			}
+
+			Teleinfo* teleinfo = decodeFrame(base, iinst, papp);
+			CPPUNIT_ASSERT(teleinfo != NULL);
+			CPPUNIT_ASSERT(aggregator.update(0, teleinfo, timestamp));
+			Sample sample = { timestamp, papp, iinst, i > 0 ? base - previous : 0 };
+			samples.push_back(sample);
+
+			if (i % 37 == 0) {
+				for (int window = 0; window < TELEINFO_WINDOWS; window++) {
+					checkWindow(&aggregator, samples, window, timestamp);
+				}
+			}
+		}
+		for (int window = 0; window < TELEINFO_WINDOWS; window++) {
+			checkWindow(&aggregator, samples, window, timestamp + TeleinfoAggregator::getWindowDuration(window) / 3);
+		}
+	}
+
+	/**
+	 * Test de l'expiration de la fenêtre en l'absence de trames
+	 */
+	void testExpiration() {
+		TeleinfoAggregator aggregator(1);
+		TeleinfoWindow result;
+		uint64_t timestamp = 1000000;
+		CPPUNIT_ASSERT(aggregator.update(0, decodeFrame(100, 10, 2300), timestamp));
+		CPPUNIT_ASSERT(aggregator.update(0, decodeFrame(150, 20, 4600), timestamp + 1000));
+		CPPUNIT_ASSERT(aggregator.getWindow(0, TELEINFO_WINDOW_1MIN, timestamp + 1000, &result));
+		CPPUNIT_ASSERT(result.count == 2);
+		CPPUNIT_ASSERT(result.powerMin == 2300);
+		CPPUNIT_ASSERT(result.powerMax == 4600);
+		CPPUNIT_ASSERT(result.powerMean == 3450);
+		CPPUNIT_ASSERT(result.iinstMean == 15);
+		CPPUNIT_ASSERT(result.energy == 50);
+
+		CPPUNIT_ASSERT(aggregator.getWindow(0, TELEINFO_WINDOW_1MIN, timestamp + 2 * 60000, &result));
+		CPPUNIT_ASSERT(result.count == 0);
+		CPPUNIT_ASSERT(result.energy == 0);
+		CPPUNIT_ASSERT(aggregator.getWindow(0, TELEINFO_WINDOW_1H, timestamp + 2 * 60000, &result));
+		CPPUNIT_ASSERT(result.count == 2);
+
+		// Un index qui recule (changement de compteur) ne compte pas d'énergie
+		CPPUNIT_ASSERT(aggregator.update(0, decodeFrame(10, 1, 230), timestamp + 3 * 60000));
+		CPPUNIT_ASSERT(aggregator.getWindow(0, TELEINFO_WINDOW_1H, timestamp + 3 * 60000, &result));
+		CPPUNIT_ASSERT(result.count == 3);
+		CPPUNIT_ASSERT(result.energy == 50);
+		CPPUNIT_ASSERT(result.powerMin == 230);
+	}
+
+	/**
+	 * Test de l'indépendance des compteurs
+	 */
+	void testCompteurs() {
+		TeleinfoAggregator aggregator(10000);
+		TeleinfoWindow result;
+		CPPUNIT_ASSERT(aggregator.getMeterCount() == 10000);
+		Teleinfo* teleinfo = decodeFrame(100, 5, 1150);
+		for (unsigned int meter = 0; meter < 10000; meter += 3) {
+			CPPUNIT_ASSERT(aggregator.update(meter, teleinfo, 5000));
+		}
+		CPPUNIT_ASSERT(!aggregator.update(10000, teleinfo, 5000));
+		CPPUNIT_ASSERT(!aggregator.getWindow(10000, TELEINFO_WINDOW_1MIN, 5000, &result));
+		CPPUNIT_ASSERT(!aggregator.getWindow(0, TELEINFO_WINDOWS, 5000, &result));
+
+		CPPUNIT_ASSERT(aggregator.getWindow(9999, TELEINFO_WINDOW_15MIN, 5000, &result));
+		CPPUNIT_ASSERT(result.count == 1);
+		CPPUNIT_ASSERT(aggregator.getWindow(9998, TELEINFO_WINDOW_15MIN, 5000, &result));
+		CPPUNIT_ASSERT(result.count == 0);
+
+		aggregator.clear(9999);
+		CPPUNIT_ASSERT(aggregator.getWindow(9999, TELEINFO_WINDOW_15MIN, 5000, &result));
+		CPPUNIT_ASSERT(result.count == 0);
+	}
+
+private:
+	/**
+	 * Compare les valeurs agrégées d'une fenêtre au recalcul complet de ses trames
+	 */
+	void checkWindow(TeleinfoAggregator* aggregator, const vector<Sample>& samples, int window, uint64_t timestamp) {
+		uint64_t width = TeleinfoAggregator::getWindowDuration(window) / TELEINFO_AGGREGATOR_BUCKETS;
+		uint64_t start = (timestamp / width + 1 - TELEINFO_AGGREGATOR_BUCKETS) * width;
+		TeleinfoWindow expected = { 0, 0, 0, 0, 0, 0, 0, 0 };
+		long long power = 0;
+		long long iinst = 0;
+		for (unsigned int i = 0; i < samples.size(); i++) {
+			if (samples[i].timestamp < start) {
+				continue;
+			}
+			if (expected.count == 0 || samples[i].power < expected.powerMin) expected.powerMin = samples[i].power;
+			if (expected.count == 0 || samples[i].power > expected.powerMax) expected.powerMax = samples[i].power;
+			if (expected.count == 0 || samples[i].iinst < expected.iinstMin) expected.iinstMin = samples[i].iinst;
+			if (expected.count == 0 || samples[i].iinst > expected.iinstMax) expected.iinstMax = samples[i].iinst;
+			power += samples[i].power;
+			iinst += samples[i].iinst;
+			expected.energy += samples[i].energy;
+			expected.count++;
+		}
+
+		TeleinfoWindow result;
+		CPPUNIT_ASSERT(aggregator->getWindow(0, window, timestamp, &result));
+		CPPUNIT_ASSERT(result.count == expected.count);
+		CPPUNIT_ASSERT(result.energy == expected.energy);
+		if (expected.count > 0) {
+			CPPUNIT_ASSERT(result.powerMin == expected.powerMin);
+			CPPUNIT_ASSERT(result.powerMax == expected.powerMax);
+			CPPUNIT_ASSERT(result.powerMean == power / expected.count);
+			CPPUNIT_ASSERT(result.iinstMin == expected.iinstMin);
+			CPPUNIT_ASSERT(result.iinstMax == expected.iinstMax);
+			CPPUNIT_ASSERT(result.iinstMean == iinst / expected.count);
+		}
+	}
+
+	/**
+	 * Test d'une trame récupérée dont un index est écarté : pas d'énergie fantôme au retour de l'index
+	 */
+	void testIndexEcarte() {
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_SALVAGE);
+		TeleinfoAggregator aggregator(1);
+		uint64_t timestamp = 1500000000000ULL;
+		unsigned long hchp = 7000000;
+		for (int i = 0; i < 6; i++) {
+			Teleinfo* teleinfo = decodeHcFrame(5000000, hchp, i == 2);
+			CPPUNIT_ASSERT(teleinfo != NULL);
+			CPPUNIT_ASSERT(teleinfo->getTotalIndex() == 5000000 + hchp - (i == 2 ? 10 : 0));
+			CPPUNIT_ASSERT(aggregator.update(0, teleinfo, timestamp));
+			timestamp += 1000;
+			hchp += 10;
+		}
+		TeleinfoWindow result;
+		CPPUNIT_ASSERT(aggregator.getWindow(0, 0, timestamp, &result));
+		CPPUNIT_ASSERT(result.count == 6);
+		CPPUNIT_ASSERT(result.energy == 50);
+
+		// Offset automatique : il n'est pas appris d'une première trame récupérée
+		TeleinfoDecoder* automatic = teleinfoDecoder;
+		teleinfoDecoder = new TeleinfoDecoder(TELEINFO_TOTAL_OFFSET_AUTO);
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_SALVAGE);
+		CPPUNIT_ASSERT(decodeHcFrame(5000000, 7000000, true)->getTotalIndex() == 0);
+		CPPUNIT_ASSERT(decodeHcFrame(5000000, 7000000, false)->getTotalIndex() == 0);
+		Teleinfo* teleinfo = decodeHcFrame(5000000, 7000100, true);
+		CPPUNIT_ASSERT(teleinfo->getTotalOffset() == 12000000);
+		CPPUNIT_ASSERT(teleinfo->getTotalIndex() == 0);
+		CPPUNIT_ASSERT(decodeHcFrame(5000000, 7000100, false)->getTotalIndex() == 100);
+		delete teleinfoDecoder;
+		teleinfoDecoder = automatic;
+	}
+
+	/**
+	 * Décode une trame en option Base
+	 */
+	Teleinfo* decodeFrame(unsigned long base, int iinst, int papp) {
+		char value[16];
+		string frame = "\x02" + buildGroupe("ADCO", "026489026467");
+		snprintf(value, sizeof(value), "%09lu", base);
+		frame += buildGroupe("BASE", value);
+		snprintf(value, sizeof(value), "%03d", iinst);
+		frame += buildGroupe("IINST", value);
+		snprintf(value, sizeof(value), "%05d", papp);
+		frame += buildGroupe("PAPP", value) + "\x03";
+
+		return decodeText(teleinfoDecoder, frame);
+	}
+
+	/**
+	 * Décode une trame en option heures creuses, le groupe HCHP altéré si demandé
+	 */
+	Teleinfo* decodeHcFrame(unsigned long hchc, unsigned long hchp, bool corrupted) {
+		char value[16];
+		string frame = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "HC..");
+		snprintf(value, sizeof(value), "%09lu", hchc);
+		frame += buildGroupe("HCHC", value);
+		snprintf(value, sizeof(value), "%09lu", hchp);
+		string groupe = buildGroupe("HCHP", value);
+		if (corrupted) {
+			groupe[groupe.length() - 2] ^= 0x01; // Checksum invalide
+		}
+		frame += groupe + buildGroupe("PTEC", "HP..") + "\x03";
+
+		return decodeText(teleinfoDecoder, frame);
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoAggregatorTest);
+	CPPUNIT_TEST(testFenetres);
+	CPPUNIT_TEST(testExpiration);
+	CPPUNIT_TEST(testCompteurs);
+	CPPUNIT_TEST(testIndexEcarte);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoAggregatorTest);
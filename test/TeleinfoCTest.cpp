@@ -0,0 +1,127 @@
+/**
+ * Test unitaire de l'interface C du décodeur Téléinfo
+ * @author LK
+ */
+
+#include "TeleinfoC.h"
+#include "TeleinfoDecoder.h"
+#include "TeleinfoEncoder.h"
+#include <string.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class TeleinfoCTest : public CppUnit::TestFixture {
+
+private:
+	unsigned char stream[3 * TELEINFO_ENCODER_FRAME_SIZE];
+	unsigned int ends[3];
+
+	/**
+	 * Trois trames d'un compteur en option HC, la puissance change d'une trame à l'autre
+	 */
+	unsigned int encode() {
+		TeleinfoEncoder encoder("026489026467", TELEINFO_OPTARIF_HC, 45);
+		encoder.setIndex(TELEINFO_PERIOD_HC, 12345678);
+		encoder.setIndex(TELEINFO_PERIOD_HP, 23456789);
+		encoder.setPeriod(TELEINFO_PERIOD_HP);
+		unsigned int length = 0;
+		for (int frame = 0; frame < 3; frame++) {
+			encoder.setPower(1000 * (frame + 1));
+			length += encoder.encode(&stream[length], false);
+			ends[frame] = length;
+		}
+		return length;
+	}
+
+public:
+
+	/**
+	 * Test du décodage d'un tampon : toutes les trames terminées sont copiées à plat
+	 */
+	void testDecodage() {
+		CPPUNIT_ASSERT(teleinfoVersion() == TELEINFO_C_VERSION);
+		CPPUNIT_ASSERT(teleinfoFrameSize() == sizeof(TeleinfoFlatFrame));
+		unsigned int length = encode();
+		TeleinfoHandle* handle = teleinfoCreate(0);
+		CPPUNIT_ASSERT(handle != NULL);
+
+		TeleinfoFlatFrame frames[4];
+		unsigned int consumed;
+		CPPUNIT_ASSERT(teleinfoDecode(handle, stream, length, frames, 4, &consumed) == 3);
+		CPPUNIT_ASSERT(consumed == length);
+		CPPUNIT_ASSERT(frames[0].adco == 26489026467ULL);
+		CPPUNIT_ASSERT(strcmp(frames[0].adcoText, "026489026467") == 0);
+		CPPUNIT_ASSERT(strcmp(frames[0].optarif, "HC..") == 0);
+		CPPUNIT_ASSERT(strcmp(frames[0].ptec, "HP..") == 0);
+		CPPUNIT_ASSERT(strcmp(frames[0].motdetat, "000000") == 0);
+		CPPUNIT_ASSERT(frames[0].demain[0] == '\0');
+		CPPUNIT_ASSERT(frames[0].hhphc == 'A');
+		CPPUNIT_ASSERT(frames[0].isousc == 45);
+		CPPUNIT_ASSERT(frames[0].indexes[TELEINFO_C_INDEX_HCHC] == 12345678);
+		CPPUNIT_ASSERT(frames[0].indexes[TELEINFO_C_INDEX_HCHP] == 23456789);
+		CPPUNIT_ASSERT(frames[0].indexes[TELEINFO_C_INDEX_BASE] == 0);
+		CPPUNIT_ASSERT(frames[0].totalIndex == 12345678 + 23456789);
+		CPPUNIT_ASSERT(frames[0].validFields & TELEINFO_C_FIELD_PAPP);
+		CPPUNIT_ASSERT(!(frames[0].validFields & TELEINFO_C_FIELD_BASE));
+		for (int frame = 0; frame < 3; frame++) {
+			CPPUNIT_ASSERT(frames[frame].papp == 1000 * (frame + 1));
+			CPPUNIT_ASSERT(frames[frame].end == ends[frame]);
+		}
+		CPPUNIT_ASSERT(frames[2].iinst == 14);
+
+		TeleinfoFlatStats stats;
+		CPPUNIT_ASSERT(teleinfoGetStats(handle, &stats) == 0);
+		CPPUNIT_ASSERT(stats.frames == 3);
+		CPPUNIT_ASSERT(stats.lostFrames == 0);
+		teleinfoDestroy(handle);
+	}
+
+	/**
+	 * Test d'un tableau trop petit et d'une trame coupée entre deux tampons
+	 */
+	void testTampons() {
+		unsigned int length = encode();
+		TeleinfoHandle* handle = teleinfoCreate(TELEINFO_C_OPTION_SALVAGE);
+		TeleinfoFlatFrame frames[2];
+		unsigned int consumed;
+
+		// Tableau plein : le décodage s'arrête après la deuxième trame
+		CPPUNIT_ASSERT(teleinfoDecode(handle, stream, length, frames, 2, &consumed) == 2);
+		CPPUNIT_ASSERT(consumed == ends[1]);
+
+		// La troisième trame en deux tampons
+		unsigned int middle = consumed + 20;
+		CPPUNIT_ASSERT(teleinfoDecode(handle, stream + consumed, middle - consumed, frames, 2, NULL) == 0);
+		CPPUNIT_ASSERT(teleinfoDecode(handle, stream + middle, length - middle, frames, 2, &consumed) == 1);
+		CPPUNIT_ASSERT(consumed == length - middle);
+		CPPUNIT_ASSERT(frames[0].end == length - middle);
+		CPPUNIT_ASSERT(frames[0].papp == 3000);
+
+		// Octet par octet
+		teleinfoReset(handle);
+		int count = 0;
+		for (unsigned int i = 0; i < length; i++) {
+			int result = teleinfoDecodeByte(handle, stream[i], &frames[0]);
+			if (result == 1) {
+				count++;
+				CPPUNIT_ASSERT(i + 1 == ends[count - 1]);
+			}
+		}
+		CPPUNIT_ASSERT(count == 3);
+		CPPUNIT_ASSERT(frames[0].papp == 3000);
+
+		// Arguments invalides
+		CPPUNIT_ASSERT(teleinfoDecode(NULL, stream, length, frames, 2, NULL) == -1);
+		CPPUNIT_ASSERT(teleinfoDecode(handle, stream, length, NULL, 2, NULL) == -1);
+		CPPUNIT_ASSERT(teleinfoDecodeByte(handle, 0x02, NULL) == -1);
+		CPPUNIT_ASSERT(teleinfoGetStats(NULL, NULL) == -1);
+		teleinfoDestroy(handle);
+		teleinfoDestroy(NULL);
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoCTest);
+	CPPUNIT_TEST(testDecodage);
+	CPPUNIT_TEST(testTampons);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoCTest);
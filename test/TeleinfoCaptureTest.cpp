@@ -0,0 +1,197 @@
+/**
+ * Test unitaire de la capture indexée du flux Téléinfo
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoCapture.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+#define CAPTURE_FRAMES   300
+
+class TeleinfoCaptureTest : public CppUnit::TestFixture {
+
+private:
+	char path[64];
+
+public:
+
+	void setUp() {
+		strcpy(path, "/tmp/teleinfo-capture-XXXXXX");
+		close(mkstemp(path));
+	}
+
+	void tearDown() {
+		unlink(path);
+	}
+
+	/**
+	 * Test de l'écriture puis de la relecture de la trame N, en accès direct
+	 */
+	void testTrameN() {
+		string stream = writeCapture(1024);
+		TeleinfoCaptureReader reader;
+		CPPUNIT_ASSERT(reader.open(path));
+		CPPUNIT_ASSERT(reader.getFrameCount() == CAPTURE_FRAMES);
+		CPPUNIT_ASSERT(reader.getRawLength() == stream.length());
+
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		int frames[] = { 0, 1, 137, 138, CAPTURE_FRAMES - 1, 42 };
+		for (unsigned int i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+			const TeleinfoCaptureEntry* entry = reader.getEntry(frames[i]);
+			CPPUNIT_ASSERT(entry != NULL);
+			CPPUNIT_ASSERT(stream[entry->offset] == '\x02');
+			CPPUNIT_ASSERT(entry->timestamp == timestampOf(frames[i]));
+			CPPUNIT_ASSERT(entry->adco == adcoOf(frames[i]));
+			Teleinfo* teleinfo = reader.decodeFrame(frames[i], teleinfoDecoder);
+			CPPUNIT_ASSERT(teleinfo != NULL);
+			CPPUNIT_ASSERT(teleinfo->getBase() == (unsigned long) frames[i] * 10);
+			CPPUNIT_ASSERT(teleinfo->getAdcoAsLong() == adcoOf(frames[i]));
+		}
+		CPPUNIT_ASSERT(reader.getEntry(CAPTURE_FRAMES) == NULL);
+		CPPUNIT_ASSERT(reader.decodeFrame(CAPTURE_FRAMES, teleinfoDecoder) == NULL);
+	}
+
+	/**
+	 * Test de la recherche par date, avec et sans adresse de compteur
+	 */
+	void testRechercheDate() {
+		writeCapture(TELEINFO_CAPTURE_BLOCK_SIZE);
+		TeleinfoCaptureReader reader;
+		CPPUNIT_ASSERT(reader.open(path));
+
+		CPPUNIT_ASSERT(reader.findFrame(timestampOf(0) - 1) == -1);
+		CPPUNIT_ASSERT(reader.findFrame(timestampOf(0)) == 0);
+		CPPUNIT_ASSERT(reader.findFrame(timestampOf(100)) == 100);
+		CPPUNIT_ASSERT(reader.findFrame(timestampOf(100) + 1) == 100);
+		CPPUNIT_ASSERT(reader.findFrame(timestampOf(CAPTURE_FRAMES) + 5000) == CAPTURE_FRAMES - 1);
+
+		// Les trames de rang 3k+1 proviennent du second compteur
+		CPPUNIT_ASSERT(reader.findFrame(timestampOf(100), adcoOf(0)) == 99);
+		CPPUNIT_ASSERT(reader.findFrame(timestampOf(100), adcoOf(1)) == 100);
+		CPPUNIT_ASSERT(reader.findFrame(timestampOf(0), adcoOf(1)) == -1);
+		CPPUNIT_ASSERT(reader.findFrame(timestampOf(CAPTURE_FRAMES), 123456789012ULL) == -1);
+
+		// Comparaison avec un parcours à rebours de toutes les trames
+		for (int frame = 0; frame < CAPTURE_FRAMES; frame += 13) {
+			for (int meter = 0; meter < 2; meter++) {
+				int64_t expected = frame;
+				while (expected >= 0 && reader.getEntry(expected)->adco != adcoOf(meter)) {
+					expected--;
+				}
+				CPPUNIT_ASSERT(reader.findFrame(timestampOf(frame), adcoOf(meter)) == expected);
+				CPPUNIT_ASSERT(reader.findFrame(timestampOf(frame) + 1, adcoOf(meter)) == expected);
+				expected = frame - 1;
+				while (expected >= 0 && reader.getEntry(expected)->adco != adcoOf(meter)) {
+					expected--;
+				}
+				CPPUNIT_ASSERT(reader.findPreviousFrame(frame, adcoOf(meter)) == expected);
+			}
+		}
+		CPPUNIT_ASSERT(reader.findPreviousFrame(CAPTURE_FRAMES + 10, adcoOf(1)) == reader.findFrame(timestampOf(CAPTURE_FRAMES), adcoOf(1)));
+		CPPUNIT_ASSERT(reader.findPreviousFrame(CAPTURE_FRAMES, 123456789012ULL) == -1);
+	}
+
+	/**
+	 * Test d'une capture interrompue : les blocs complets restent lisibles
+	 */
+	void testCaptureInterrompue() {
+		writeCapture(1024);
+		FILE* file = fopen(path, "rb+");
+		fseek(file, 0, SEEK_END);
+		long length = ftell(file);
+		fclose(file);
+		CPPUNIT_ASSERT(truncate(path, length * 2 / 3) == 0);
+
+		TeleinfoCaptureReader reader;
+		CPPUNIT_ASSERT(reader.open(path));
+		CPPUNIT_ASSERT(reader.getFrameCount() > 0);
+		CPPUNIT_ASSERT(reader.getFrameCount() < CAPTURE_FRAMES);
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		uint64_t last = reader.getFrameCount() - 1;
+		Teleinfo* teleinfo = reader.decodeFrame(last, teleinfoDecoder);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getBase() == last * 10);
+	}
+
+	/**
+	 * Test d'un fichier qui n'est pas une capture
+	 */
+	void testFichierInvalide() {
+		FILE* file = fopen(path, "wb");
+		fputs("ceci n'est pas une capture Teleinfo", file);
+		fclose(file);
+		TeleinfoCaptureReader reader;
+		CPPUNIT_ASSERT(!reader.open(path));
+		CPPUNIT_ASSERT(!reader.open("/tmp/teleinfo-capture-inexistante"));
+	}
+
+private:
+	/**
+	 * Ecrit une capture de CAPTURE_FRAMES trames, reçues par blocs de tailles variables et entrecoupées de parasites
+	 * @return le flux brut capturé
+	 */
+	string writeCapture(unsigned int blockSize) {
+		string stream;
+		for (int i = 0; i < CAPTURE_FRAMES; i++) {
+			char adco[16];
+			char base[16];
+			snprintf(adco, sizeof(adco), "%012llu", (unsigned long long) adcoOf(i));
+			snprintf(base, sizeof(base), "%09d", i * 10);
+			if (i % 7 == 0) {
+				stream += "\x0A" "PAPP 0"; // Parasite entre deux trames
+			}
+			stream += "\x02" + buildGroupe("ADCO", adco) + buildGroupe("BASE", base) + buildGroupe("PTEC", "TH..") + "\x03";
+		}
+
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		TeleinfoCaptureWriter writer(teleinfoDecoder);
+		CPPUNIT_ASSERT(writer.open(path, blockSize));
+		const unsigned char* buffer = (const unsigned char*) stream.data();
+		unsigned int index = 0;
+		int frames = 0;
+		while (index < stream.length()) {
+			// Date de réception : celle de la trame en cours de réception
+			unsigned int length = 1 + index % 37;
+			if (length > stream.length() - index) {
+				length = stream.length() - index;
+			}
+			unsigned int consumed = 0;
+			Teleinfo* teleinfo = writer.capture(buffer + index, length, &consumed, timestampOf(frames));
+			index += consumed;
+			if (teleinfo != NULL) {
+				CPPUNIT_ASSERT(teleinfo->getBase() == (unsigned long) frames * 10);
+				frames++;
+			}
+		}
+		CPPUNIT_ASSERT(frames == CAPTURE_FRAMES);
+		CPPUNIT_ASSERT(writer.getFrameCount() == CAPTURE_FRAMES);
+		CPPUNIT_ASSERT(writer.close());
+		return stream;
+	}
+
+	static uint64_t timestampOf(int frame) {
+		return 1500000000000ULL + frame * 1500;
+	}
+
+	static uint64_t adcoOf(int frame) {
+		return frame % 3 == 1 ? 200638824480ULL : 26489026467ULL;
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoCaptureTest);
+	CPPUNIT_TEST(testTrameN);
+	CPPUNIT_TEST(testRechercheDate);
+	CPPUNIT_TEST(testCaptureInterrompue);
+	CPPUNIT_TEST(testFichierInvalide);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoCaptureTest);
@@ -0,0 +1,215 @@
+/**
+ * Test unitaire des points de reprise
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoCheckpoint.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+#define CHECKPOINT_METERS   3
+
+class TeleinfoCheckpointTest : public CppUnit::TestFixture {
+
+private:
+	char path[64];
+
+	/**
+	 * Etat d'une passerelle
+	 */
+	struct Gateway {
+		TeleinfoDecoder* decoders[CHECKPOINT_METERS];
+		TeleinfoAggregator* aggregator;
+		TeleinfoTariff* tariff;
+		TeleinfoRegistry* registry;
+		TeleinfoCheckpoint* checkpoint;
+		int meters;
+	};
+
+public:
+
+	void setUp() {
+		strcpy(path, "/tmp/teleinfo-checkpoint-XXXXXX");
+		close(mkstemp(path));
+	}
+
+	void tearDown() {
+		unlink(path);
+	}
+
+	/**
+	 * Test de la reprise d'une passerelle : dernière trame, offset de l'index total, agrégats, comptabilité, registre
+	 */
+	void testReprise() {
+		Gateway gateway;
+		start(&gateway, CHECKPOINT_METERS);
+		CPPUNIT_ASSERT(!gateway.checkpoint->restore()); // Fichier vide
+		for (int i = 0; i < CHECKPOINT_METERS; i++) {
+			receive(&gateway, i, 1000 * (i + 1), 10);
+			receive(&gateway, i, 1000 * (i + 1) + 25, 20);
+		}
+		CPPUNIT_ASSERT(gateway.checkpoint->save());
+		CPPUNIT_ASSERT(gateway.checkpoint->getSequence() == 1);
+		stop(&gateway);
+
+		// Redémarrage
+		start(&gateway, CHECKPOINT_METERS);
+		CPPUNIT_ASSERT(gateway.decoders[1]->getLastFrame() == NULL);
+		CPPUNIT_ASSERT(gateway.checkpoint->restore());
+		CPPUNIT_ASSERT(gateway.checkpoint->getSequence() == 1);
+
+		Teleinfo* teleinfo = gateway.decoders[1]->getLastFrame();
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getAdco(), "026489026461") == 0);
+		CPPUNIT_ASSERT(teleinfo->getHchc() == 2025);
+		CPPUNIT_ASSERT(teleinfo->getTotalOffset() == 2000);
+		CPPUNIT_ASSERT(teleinfo->getTotalIndex() == 25);
+		TeleinfoStats stats;
+		gateway.decoders[1]->getStats(&stats);
+		CPPUNIT_ASSERT(stats.frames == 2);
+
+		CPPUNIT_ASSERT(gateway.registry->getMeterCount() == CHECKPOINT_METERS);
+		CPPUNIT_ASSERT(gateway.registry->find(TeleinfoRegistry::packAdco("026489026462")) == 2);
+		CPPUNIT_ASSERT(gateway.registry->getMeter(2)->totalIndex == 3025);
+		CPPUNIT_ASSERT(gateway.tariff->getEnergy(1, TELEINFO_PERIOD_HC) == 25);
+		TeleinfoWindow window;
+		CPPUNIT_ASSERT(gateway.aggregator->getWindow(1, TELEINFO_WINDOW_1MIN, 20, &window));
+		CPPUNIT_ASSERT(window.count == 2);
+		CPPUNIT_ASSERT(window.energy == 25);
+
+		// Le décodage et les agrégats continuent : l'offset n'est pas recalculé sur la première trame après la reprise
+		teleinfo = receive(&gateway, 1, 2040, 30);
+		CPPUNIT_ASSERT(teleinfo->getTotalIndex() == 40);
+		CPPUNIT_ASSERT(gateway.tariff->getEnergy(1, TELEINFO_PERIOD_HC) == 40);
+		CPPUNIT_ASSERT(gateway.registry->getMeter(1)->frames == 3);
+		stop(&gateway);
+	}
+
+	/**
+	 * Test d'un point de reprise interrompu : le point de reprise précédent est restauré
+	 */
+	void testEmplacementCorrompu() {
+		Gateway gateway;
+		start(&gateway, CHECKPOINT_METERS);
+		receive(&gateway, 0, 1000, 10);
+		CPPUNIT_ASSERT(gateway.checkpoint->save()); // Emplacement 1
+		receive(&gateway, 0, 1010, 20);
+		CPPUNIT_ASSERT(gateway.checkpoint->save()); // Emplacement 0
+		CPPUNIT_ASSERT(gateway.checkpoint->getSequence() == 2);
+		stop(&gateway);
+
+		// Un octet de l'emplacement 0 modifié
+		int fd = open(path, O_RDWR);
+		unsigned char byte;
+		CPPUNIT_ASSERT(pread(fd, &byte, 1, 4096 + 100) == 1);
+		byte ^= 0x01;
+		CPPUNIT_ASSERT(pwrite(fd, &byte, 1, 4096 + 100) == 1);
+		close(fd);
+
+		start(&gateway, CHECKPOINT_METERS);
+		CPPUNIT_ASSERT(gateway.checkpoint->restore());
+		CPPUNIT_ASSERT(gateway.checkpoint->getSequence() == 1);
+		CPPUNIT_ASSERT(gateway.decoders[0]->getLastFrame()->getHchc() == 1000);
+
+		// Le point de reprise suivant remplace l'emplacement corrompu
+		CPPUNIT_ASSERT(gateway.checkpoint->save());
+		CPPUNIT_ASSERT(gateway.checkpoint->getSequence() == 2);
+		stop(&gateway);
+		start(&gateway, CHECKPOINT_METERS);
+		CPPUNIT_ASSERT(gateway.checkpoint->restore());
+		CPPUNIT_ASSERT(gateway.checkpoint->getSequence() == 2);
+		stop(&gateway);
+	}
+
+	/**
+	 * Test d'un fichier qui ne correspond pas aux objets déclarés, et de l'écriture périodique
+	 */
+	void testIncompatible() {
+		Gateway gateway;
+		start(&gateway, CHECKPOINT_METERS);
+		receive(&gateway, 0, 1000, 10);
+		CPPUNIT_ASSERT(!gateway.checkpoint->tick(9));
+		CPPUNIT_ASSERT(gateway.checkpoint->tick(10));
+		CPPUNIT_ASSERT(!gateway.checkpoint->tick(19));
+		CPPUNIT_ASSERT(gateway.checkpoint->tick(20));
+		CPPUNIT_ASSERT(gateway.checkpoint->getSequence() == 2);
+		stop(&gateway);
+
+		// Un compteur de moins : rien n'est restauré
+		start(&gateway, CHECKPOINT_METERS - 1);
+		CPPUNIT_ASSERT(!gateway.checkpoint->restore());
+		CPPUNIT_ASSERT(gateway.decoders[0]->getLastFrame() == NULL);
+		CPPUNIT_ASSERT(gateway.registry->getMeterCount() == 0);
+
+		// Le point de reprise suivant est écrit avec les nouvelles sections
+		CPPUNIT_ASSERT(gateway.checkpoint->save());
+		CPPUNIT_ASSERT(gateway.checkpoint->getSequence() == 3);
+		stop(&gateway);
+		start(&gateway, CHECKPOINT_METERS - 1);
+		CPPUNIT_ASSERT(gateway.checkpoint->restore());
+		stop(&gateway);
+
+		TeleinfoCheckpoint checkpoint("/tmp/teleinfo-checkpoint-inexistant", 10);
+		CPPUNIT_ASSERT(!checkpoint.restore());
+	}
+
+private:
+	void start(Gateway* gateway, int meters) {
+		gateway->meters = meters;
+		for (int i = 0; i < meters; i++) {
+			gateway->decoders[i] = new TeleinfoDecoder(TELEINFO_TOTAL_OFFSET_AUTO);
+		}
+		gateway->aggregator = new TeleinfoAggregator(meters);
+		gateway->tariff = new TeleinfoTariff(meters);
+		gateway->registry = new TeleinfoRegistry(meters, meters);
+		gateway->checkpoint = new TeleinfoCheckpoint(path, 10);
+		gateway->checkpoint->addDecoders(gateway->decoders, meters);
+		gateway->checkpoint->addAggregator(gateway->aggregator);
+		gateway->checkpoint->addTariff(gateway->tariff);
+		gateway->checkpoint->addRegistry(gateway->registry);
+	}
+
+	void stop(Gateway* gateway) {
+		delete gateway->checkpoint;
+		delete gateway->registry;
+		delete gateway->tariff;
+		delete gateway->aggregator;
+		for (int i = 0; i < gateway->meters; i++) {
+			delete gateway->decoders[i];
+		}
+	}
+
+	/**
+	 * Reçoit une trame en option Heures Creuses sur le port du compteur
+	 */
+	Teleinfo* receive(Gateway* gateway, int meter, unsigned long hchc, uint64_t timestamp) {
+		char adco[16];
+		char value[16];
+		snprintf(adco, sizeof(adco), "02648902646%d", meter);
+		snprintf(value, sizeof(value), "%09lu", hchc);
+		string frame = "\x02" + buildGroupe("ADCO", adco) + buildGroupe("OPTARIF", "HC..") + buildGroupe("HCHC", value)
+				+ buildGroupe("HCHP", "000000000") + buildGroupe("PTEC", "HC..") + buildGroupe("PAPP", "00500") + "\x03";
+		Teleinfo* teleinfo = decodeText(gateway->decoders[meter], frame);
+		gateway->registry->route(meter, teleinfo, timestamp, NULL);
+		gateway->aggregator->update(meter, teleinfo, timestamp);
+		gateway->tariff->update(meter, teleinfo, timestamp, NULL);
+		return teleinfo;
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoCheckpointTest);
+	CPPUNIT_TEST(testReprise);
+	CPPUNIT_TEST(testEmplacementCorrompu);
+	CPPUNIT_TEST(testIncompatible);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoCheckpointTest);
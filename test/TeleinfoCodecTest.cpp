@@ -0,0 +1,224 @@
+/**
+ * Test unitaire du codec de compression du flux Téléinfo brut
+ * @author LK
+ */
+
+#include "TeleinfoCodec.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+#define CODEC_FRAMES   500
+
+class TeleinfoCodecTest : public CppUnit::TestFixture {
+
+public:
+
+	/**
+	 * Test de la compression d'un flux 7 bits régulier, quel que soit le découpage des blocs
+	 */
+	void testFluxRegulier() {
+		string stream = buildStream(false);
+		unsigned int chunks[] = { 1, 7, 64, 4096, (unsigned int) stream.length() };
+		for (unsigned int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+			string compressed = compress(stream, chunks[i]);
+			CPPUNIT_ASSERT(decompress(compressed, chunks[i]) == stream);
+			CPPUNIT_ASSERT(compressed.length() * 40 < stream.length());
+		}
+	}
+
+	/**
+	 * Test de la sortie immédiate de chaque bloc fourni (flush) : les blocs compressés sont plus nombreux mais restent décodables
+	 */
+	void testFlush() {
+		string stream = buildStream(false);
+		string compressed = compress(stream, 170, true);
+		CPPUNIT_ASSERT(decompress(compressed, 31) == stream);
+		CPPUNIT_ASSERT(compressed.length() > compress(stream, 170).length());
+	}
+
+	/**
+	 * Test d'un flux dont le bit de parité (paire) n'a pas été retiré
+	 */
+	void testFluxParite() {
+		string stream = buildStream(true);
+		string compressed = compress(stream, 13);
+		CPPUNIT_ASSERT(decompress(compressed, 5) == stream);
+		CPPUNIT_ASSERT(compressed.length() * 40 < stream.length());
+
+		// Bascules entre les deux modes de parité
+		string mixed = buildStream(false).substr(0, 2000) + stream.substr(0, 2000) + buildStream(false).substr(3000, 1000);
+		CPPUNIT_ASSERT(decompress(compress(mixed, 29), 11) == mixed);
+	}
+
+	/**
+	 * Test d'un flux altéré : groupes erronés, trames tronquées, parasites
+	 */
+	void testFluxAltere() {
+		string stream = buildStream(false);
+		unsigned int seed = 12345;
+		for (unsigned int i = 0; i < stream.length(); i += 1 + seed % 97) {
+			seed = seed * 1103515245 + 12345;
+			stream[i] = (char) (seed >> 16);
+		}
+		stream += "\x0A" "HCHC 0123"; // Groupe incomplet en fin de flux
+		CPPUNIT_ASSERT(decompress(compress(stream, 17), 3) == stream);
+
+		string garbage;
+		for (unsigned int i = 0; i < 5000; i++) {
+			seed = seed * 1103515245 + 12345;
+			garbage += (char) (seed >> 16);
+		}
+		CPPUNIT_ASSERT(decompress(compress(garbage, 100), 100) == garbage);
+	}
+
+	/**
+	 * Test d'un flux qui s'achève sur un groupe tronqué, quelle que soit la coupure et le découpage des blocs
+	 */
+	void testGroupeFinalTronque() {
+		string stream = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "HC..");
+		string groupe = buildGroupe("HCHC", "001234567");
+		for (unsigned int cut = 1; cut < groupe.length(); cut++) {
+			string truncated = stream + groupe.substr(0, cut);
+			for (unsigned int chunk = 1; chunk <= truncated.length(); chunk += 7) {
+				CPPUNIT_ASSERT(decompress(compress(truncated, chunk), 5) == truncated);
+				CPPUNIT_ASSERT(decompress(compress(truncated, chunk, true), 5) == truncated);
+			}
+		}
+	}
+
+	/**
+	 * Test d'un flux comportant plus d'étiquettes que le codec ne peut en mémoriser
+	 */
+	void testEtiquettesNombreuses() {
+		string stream;
+		for (int frame = 0; frame < 10; frame++) {
+			stream += "\x02";
+			for (int i = 0; i < TELEINFO_CODEC_LABELS + 20; i++) {
+				char etiquette[16];
+				char donnee[16];
+				snprintf(etiquette, sizeof(etiquette), "ET%d", i);
+				snprintf(donnee, sizeof(donnee), "%06d", frame * 3 + i);
+				stream += buildGroupe(etiquette, donnee);
+			}
+			stream += "\x03";
+		}
+		CPPUNIT_ASSERT(decompress(compress(stream, 50), 50) == stream);
+	}
+
+	/**
+	 * Test d'un flux compressé invalide
+	 */
+	void testFluxCompresseInvalide() {
+		TeleinfoDecompressor decompressor;
+		unsigned char output[256];
+		unsigned int consumed;
+		const unsigned char empty[] = { 0x00, 0x00, 0x05, 0x00 };
+		CPPUNIT_ASSERT(decompressor.decompress(empty, sizeof(empty), &consumed, output, sizeof(output)) == -1);
+		const unsigned char tooLarge[] = { 0x01, 0x20, 0x05, 0x00 };
+		CPPUNIT_ASSERT(decompressor.decompress(tooLarge, sizeof(tooLarge), &consumed, output, sizeof(output)) == -1);
+
+		// Bloc incomplet : rien n'est consommé
+		string compressed = compress(buildStream(false), 1000);
+		CPPUNIT_ASSERT(decompressor.decompress((const unsigned char*) compressed.data(), 10, &consumed, output, sizeof(output)) == 0);
+		CPPUNIT_ASSERT(consumed == 0);
+	}
+
+private:
+	/**
+	 * Compresse le flux, fourni par blocs de la taille donnée, éventuellement sortis au fur et à mesure
+	 */
+	string compress(const string& stream, unsigned int chunk, bool flushChunks = false) {
+		TeleinfoCompressor compressor;
+		string compressed;
+		string pending;
+		unsigned char output[100];
+		for (unsigned int index = 0; index < stream.length(); index += chunk) {
+			pending += stream.substr(index, chunk);
+			bool end = flushChunks || index + chunk >= stream.length();
+			while (true) {
+				unsigned int consumed = 0;
+				unsigned int written = compressor.compress((const unsigned char*) pending.data(), pending.length(), &consumed, output, sizeof(output), end);
+				compressed.append((const char*) output, written);
+				pending.erase(0, consumed);
+				if (consumed == 0 && written == 0) {
+					break;
+				}
+			}
+		}
+		CPPUNIT_ASSERT(pending.length() == 0);
+		return compressed;
+	}
+
+	/**
+	 * Décompresse le flux, fourni par blocs de la taille donnée
+	 */
+	string decompress(const string& compressed, unsigned int chunk) {
+		TeleinfoDecompressor decompressor;
+		string stream;
+		string pending;
+		unsigned char output[TELEINFO_CODEC_OPERATION_MAX];
+		for (unsigned int index = 0; index < compressed.length(); index += chunk) {
+			pending += compressed.substr(index, chunk);
+			while (true) {
+				unsigned int consumed = 0;
+				int written = decompressor.decompress((const unsigned char*) pending.data(), pending.length(), &consumed, output, sizeof(output));
+				CPPUNIT_ASSERT(written >= 0);
+				stream.append((const char*) output, written);
+				pending.erase(0, consumed);
+				if (consumed == 0 && written == 0) {
+					break;
+				}
+			}
+		}
+		CPPUNIT_ASSERT(pending.length() == 0);
+		return stream;
+	}
+
+	/**
+	 * Construit un flux de trames en option Heures Creuses, avec ou sans bit de parité paire
+	 */
+	string buildStream(bool parity) {
+		string stream;
+		unsigned long hchc = 1234567;
+		for (int frame = 0; frame < CODEC_FRAMES; frame++) {
+			char value[16];
+			hchc += frame % 3;
+			stream += "\x02";
+			stream += buildGroupe("ADCO", "026489026467");
+			stream += buildGroupe("OPTARIF", "HC..");
+			snprintf(value, sizeof(value), "%09lu", hchc);
+			stream += buildGroupe("HCHC", value);
+			stream += buildGroupe("HCHP", "001234567");
+			stream += buildGroupe("PTEC", "HC..");
+			snprintf(value, sizeof(value), "%03d", 3 + frame % 5);
+			stream += buildGroupe("IINST", value);
+			stream += buildGroupe("MOTDETAT", "000000");
+			stream += "\x03";
+		}
+		if (parity) {
+			for (unsigned int i = 0; i < stream.length(); i++) {
+				unsigned char character = stream[i];
+				if (__builtin_parity(character)) {
+					stream[i] = character | 0x80;
+				}
+			}
+		}
+		return stream;
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoCodecTest);
+	CPPUNIT_TEST(testFluxRegulier);
+	CPPUNIT_TEST(testFlush);
+	CPPUNIT_TEST(testFluxParite);
+	CPPUNIT_TEST(testFluxAltere);
+	CPPUNIT_TEST(testGroupeFinalTronque);
+	CPPUNIT_TEST(testEtiquettesNombreuses);
+	CPPUNIT_TEST(testFluxCompresseInvalide);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoCodecTest);
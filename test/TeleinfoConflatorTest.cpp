@@ -0,0 +1,152 @@
+/**
+ * Test unitaire de la fusion des trames
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoConflator.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+class TeleinfoConflatorTest : public CppUnit::TestFixture {
+
+private:
+	TeleinfoDecoder* teleinfoDecoder;
+
+public:
+
+	void setUp() {
+		teleinfoDecoder = new TeleinfoDecoder();
+	}
+
+	/**
+	 * Test de la fusion des trames d'un compteur pour un destinataire en retard
+	 */
+	void testFusion() {
+		TeleinfoConflator conflator(2, 2);
+		TeleinfoSnapshot snapshot;
+		unsigned long long changes;
+		CPPUNIT_ASSERT(conflator.getLatest(0) == NULL);
+		CPPUNIT_ASSERT(conflator.pull(0, &snapshot, &changes) == TELEINFO_CONFLATOR_NONE);
+
+		CPPUNIT_ASSERT(conflator.publish(0, decode("026489026467", 1000, 5, 500)));
+		CPPUNIT_ASSERT(conflator.publish(1, decode("200638824480", 2000, 3, 300)));
+		CPPUNIT_ASSERT(conflator.publish(0, decode("026489026467", 1001, 6, 600)));
+		CPPUNIT_ASSERT(conflator.publish(0, decode("026489026467", 1002, 6, 610)));
+		CPPUNIT_ASSERT(!conflator.publish(2, decode("026489026467", 1002, 6, 610)));
+		CPPUNIT_ASSERT(conflator.getPublished() == 4);
+		CPPUNIT_ASSERT(conflator.getPending(0) == 2);
+		CPPUNIT_ASSERT(conflator.getConflated(0) == 2);
+
+		// Dernière trame du compteur en attente depuis le plus longtemps
+		CPPUNIT_ASSERT(conflator.pull(0, &snapshot, &changes) == 0);
+		CPPUNIT_ASSERT(strcmp(snapshot.getAdco(), "026489026467") == 0);
+		CPPUNIT_ASSERT(snapshot.getBase() == 1002);
+		CPPUNIT_ASSERT(snapshot.getPapp() == 610);
+		CPPUNIT_ASSERT(changes == (TELEINFO_FIELD_ADCO | TELEINFO_FIELD_BASE | TELEINFO_FIELD_IINST | TELEINFO_FIELD_PAPP));
+		CPPUNIT_ASSERT(conflator.pull(0, &snapshot, NULL) == 1);
+		CPPUNIT_ASSERT(snapshot.getBase() == 2000);
+		CPPUNIT_ASSERT(conflator.pull(0, &snapshot, &changes) == TELEINFO_CONFLATOR_NONE);
+		CPPUNIT_ASSERT(conflator.getDelivered(0) == 2);
+
+		// L'autre destinataire n'a encore rien pris
+		CPPUNIT_ASSERT(conflator.getPending(1) == 2);
+		CPPUNIT_ASSERT(conflator.getDelivered(1) == 0);
+		CPPUNIT_ASSERT(conflator.getLatest(1)->getPapp() == 300);
+		CPPUNIT_ASSERT(conflator.pull(2, &snapshot, &changes) == TELEINFO_CONFLATOR_NONE);
+	}
+
+	/**
+	 * Test des champs modifiés signalés au destinataire, fusionnés d'une trame à l'autre
+	 */
+	void testModifications() {
+		TeleinfoConflator conflator(1, 1);
+		TeleinfoSnapshot snapshot;
+		unsigned long long changes;
+		conflator.publish(0, decode("026489026467", 1000, 5, 500));
+		conflator.pull(0, &snapshot, &changes);
+
+		// Trame identique
+		conflator.publish(0, decode("026489026467", 1000, 5, 500));
+		CPPUNIT_ASSERT(conflator.pull(0, &snapshot, &changes) == 0);
+		CPPUNIT_ASSERT(changes == 0);
+
+		// Deux trames fusionnées : la seconde revient sur la puissance, mais l'intensité et la puissance ont changé entre-temps
+		conflator.publish(0, decode("026489026467", 1000, 6, 600));
+		conflator.publish(0, decode("026489026467", 1001, 6, 500));
+		CPPUNIT_ASSERT(conflator.pull(0, &snapshot, &changes) == 0);
+		CPPUNIT_ASSERT(changes == (TELEINFO_FIELD_BASE | TELEINFO_FIELD_IINST | TELEINFO_FIELD_PAPP));
+		CPPUNIT_ASSERT(conflator.getConflated(0) == 1);
+	}
+
+	/**
+	 * Test de la mémoire bornée : un destinataire qui ne prend rien n'a jamais plus d'une trame par compteur en attente
+	 */
+	void testRetard() {
+		TeleinfoConflator conflator(10, 2);
+		TeleinfoSnapshot snapshot;
+		for (int i = 0; i < 1000; i++) {
+			conflator.publish(i % 10, decode("026489026467", 1000 + i, 5, 500));
+			CPPUNIT_ASSERT(conflator.pull(1, &snapshot, NULL) == i % 10);
+			CPPUNIT_ASSERT(conflator.getPending(0) <= 10);
+		}
+		CPPUNIT_ASSERT(conflator.getPending(0) == 10);
+		CPPUNIT_ASSERT(conflator.getConflated(0) == 990);
+		CPPUNIT_ASSERT(conflator.getConflated(1) == 0);
+		CPPUNIT_ASSERT(conflator.getDelivered(1) == 1000);
+		for (int meter = 0; meter < 10; meter++) {
+			CPPUNIT_ASSERT(conflator.pull(0, &snapshot, NULL) == meter);
+			CPPUNIT_ASSERT(snapshot.getBase() == (unsigned long) (1990 + meter));
+		}
+	}
+
+	/**
+	 * Test de la copie d'une trame, indépendante du décodeur
+	 */
+	void testCopie() {
+		TeleinfoSnapshot snapshot;
+		CPPUNIT_ASSERT(snapshot.getValidFields() == 0);
+		Teleinfo* teleinfo = decode("026489026467", 1000, 5, 500);
+		snapshot.copy(teleinfo);
+		CPPUNIT_ASSERT(snapshot.getTotalIndex() == teleinfo->getTotalIndex());
+		CPPUNIT_ASSERT(snapshot.getInstPower() == 500);
+		CPPUNIT_ASSERT(snapshot.getAdcoAsLong() == teleinfo->getAdcoAsLong());
+		CPPUNIT_ASSERT(snapshot.getValidFields() == (TELEINFO_FIELD_ADCO | TELEINFO_FIELD_BASE | TELEINFO_FIELD_IINST | TELEINFO_FIELD_PAPP));
+
+		decode("200638824480", 2000, 3, 300);
+		CPPUNIT_ASSERT(strcmp(snapshot.getAdco(), "026489026467") == 0);
+		CPPUNIT_ASSERT(snapshot.getBase() == 1000);
+		TeleinfoSnapshot empty;
+		CPPUNIT_ASSERT(snapshot.compare(&empty) == (TELEINFO_FIELD_ADCO | TELEINFO_FIELD_BASE | TELEINFO_FIELD_IINST | TELEINFO_FIELD_PAPP));
+	}
+
+private:
+	/**
+	 * Décode une trame en option BASE
+	 */
+	Teleinfo* decode(string adco, unsigned long base, int iinst, int papp) {
+		char value[16];
+		char current[16];
+		char power[16];
+		snprintf(value, sizeof(value), "%09lu", base);
+		snprintf(current, sizeof(current), "%03d", iinst);
+		snprintf(power, sizeof(power), "%05d", papp);
+		string frame = "\x02" + buildGroupe("ADCO", adco) + buildGroupe("BASE", value) + buildGroupe("IINST", current)
+				+ buildGroupe("PAPP", power) + "\x03";
+		return decodeText(teleinfoDecoder, frame);
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoConflatorTest);
+	CPPUNIT_TEST(testFusion);
+	CPPUNIT_TEST(testModifications);
+	CPPUNIT_TEST(testRetard);
+	CPPUNIT_TEST(testCopie);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoConflatorTest);
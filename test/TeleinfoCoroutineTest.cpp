@@ -0,0 +1,239 @@
+/**
+ * Test unitaire de l'interface coroutine du décodeur Téléinfo
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoCoroutine.h"
+#include "TeleinfoTestUtils.h"
+#include <string.h>
+#include <string>
+#include <vector>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+/**
+ * Source synchrone : le flux est en mémoire et lu par blocs de taille fixe
+ */
+class MemorySource {
+public:
+	struct ReadAwaiter {
+		unsigned int length;
+		bool await_ready() noexcept {
+			return true;
+		}
+		void await_suspend(coroutine_handle<>) noexcept {
+		}
+		unsigned int await_resume() noexcept {
+			return length;
+		}
+	};
+
+	string stream;
+	unsigned int position;
+	unsigned int chunkSize;
+	int reads;
+
+	MemorySource(string stream, unsigned int chunkSize) {
+		this->stream = stream;
+		this->position = 0;
+		this->chunkSize = chunkSize;
+		this->reads = 0;
+	}
+
+	ReadAwaiter read(unsigned char* buffer, unsigned int size) {
+		unsigned int length = stream.size() - position;
+		if (length > size) {
+			length = size;
+		}
+		if (length > chunkSize) {
+			length = chunkSize;
+		}
+		memcpy(buffer, stream.data() + position, length);
+		position += length;
+		reads++;
+		return ReadAwaiter{length};
+	}
+};
+
+/**
+ * Source asynchrone : chaque lecture suspend la coroutine jusqu'à l'arrivée d'un bloc par feed() ou close()
+ */
+class ManualSource {
+public:
+	struct ReadAwaiter {
+		ManualSource* source;
+		bool await_ready() noexcept {
+			return false;
+		}
+		void await_suspend(coroutine_handle<> handle) noexcept {
+			source->waiting = handle;
+		}
+		unsigned int await_resume() noexcept {
+			return source->length;
+		}
+	};
+
+	coroutine_handle<> waiting;
+	unsigned char* buffer;
+	unsigned int size;
+	unsigned int length;
+	int reads;
+
+	ManualSource() {
+		buffer = NULL;
+		size = 0;
+		length = 0;
+		reads = 0;
+	}
+
+	ReadAwaiter read(unsigned char* buffer, unsigned int size) {
+		this->buffer = buffer;
+		this->size = size;
+		reads++;
+		return ReadAwaiter{this};
+	}
+
+	void feed(string chunk) {
+		length = chunk.size() < size ? chunk.size() : size;
+		memcpy(buffer, chunk.data(), length);
+		resume();
+	}
+
+	void close() {
+		length = 0;
+		resume();
+	}
+
+private:
+	void resume() {
+		coroutine_handle<> handle = waiting;
+		waiting = coroutine_handle<>();
+		handle.resume();
+	}
+};
+
+/**
+ * Coroutine consommatrice : relève l'adresse de chaque compteur reçu
+ */
+struct ConsumerTask {
+	struct promise_type {
+		ConsumerTask get_return_object() {
+			return ConsumerTask();
+		}
+		suspend_never initial_suspend() noexcept {
+			return {};
+		}
+		suspend_never final_suspend() noexcept {
+			return {};
+		}
+		void return_void() {
+		}
+		void unhandled_exception() {
+			terminate();
+		}
+	};
+};
+
+ConsumerTask consume(TeleinfoAsyncFrames* frames, vector<string>* adcos, bool* finished) {
+	while (Teleinfo* teleinfo = co_await frames->next()) {
+		adcos->push_back(teleinfo->getAdco());
+	}
+	*finished = true;
+}
+
+class TeleinfoCoroutineTest : public CppUnit::TestFixture {
+
+public:
+
+	/**
+	 * Test de la consommation synchrone de plusieurs trames lues par petits blocs
+	 */
+	void testPullSourceSynchrone() {
+		string stream = "GR" + buildTrame("026489026467", "000056990") + buildTrame("200638824480", "000059000") + "\x02\x0A" "AD";
+		MemorySource source(stream, 7);
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		TeleinfoAsyncFrames frames = asyncFrames(teleinfoDecoder, source);
+
+		Teleinfo* teleinfo = frames.pull();
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getAdco(), "026489026467") == 0);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 56990);
+
+		teleinfo = frames.pull();
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getAdco(), "200638824480") == 0);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 59000);
+
+		CPPUNIT_ASSERT(frames.pull() == NULL); // Trame incomplète en fin de flux
+		CPPUNIT_ASSERT(frames.isDone());
+		CPPUNIT_ASSERT(frames.pull() == NULL);
+		CPPUNIT_ASSERT(source.reads == (int) (stream.size() + 6) / 7 + 1); // Une lecture par bloc, plus celle de la fin du flux
+	}
+
+	/**
+	 * Test avec une source asynchrone : la coroutine n'est reprise qu'à l'arrivée d'un bloc
+	 */
+	void testSourceAsynchrone() {
+		string trame1 = buildTrame("026489026467", "000056990");
+		string trame2 = buildTrame("200638824480", "000059000");
+		ManualSource source;
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		TeleinfoAsyncFrames frames = asyncFrames(teleinfoDecoder, source);
+		vector<string> adcos;
+		bool finished = false;
+		consume(&frames, &adcos, &finished);
+
+		CPPUNIT_ASSERT(source.reads == 1);
+		source.feed(trame1.substr(0, 10));
+		CPPUNIT_ASSERT(adcos.size() == 0);
+		source.feed(trame1.substr(10) + trame2.substr(0, 3));
+		CPPUNIT_ASSERT(adcos.size() == 1);
+		CPPUNIT_ASSERT(adcos[0] == "026489026467");
+		source.feed(trame2.substr(3));
+		CPPUNIT_ASSERT(adcos.size() == 2);
+		CPPUNIT_ASSERT(adcos[1] == "200638824480");
+		CPPUNIT_ASSERT(!finished);
+		CPPUNIT_ASSERT(source.reads == 4);
+
+		source.close();
+		CPPUNIT_ASSERT(finished);
+		CPPUNIT_ASSERT(frames.isDone());
+	}
+
+	/**
+	 * Test de plusieurs trames dans un même bloc : chacune est produite
+	 */
+	void testPlusieursTramesParBloc() {
+		string stream;
+		for (int i = 0; i < 5; i++) {
+			stream += buildTrame("026489026467", "00005699" + to_string(i));
+		}
+		MemorySource source(stream, TELEINFO_ASYNC_CHUNK_SIZE);
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		TeleinfoAsyncFrames frames = asyncFrames(teleinfoDecoder, source);
+		for (int i = 0; i < 5; i++) {
+			Teleinfo* teleinfo = frames.pull();
+			CPPUNIT_ASSERT(teleinfo != NULL);
+			CPPUNIT_ASSERT(teleinfo->getBase() == 56990 + i);
+		}
+		CPPUNIT_ASSERT(frames.pull() == NULL);
+	}
+
+private:
+	/**
+	 * Construit une trame avec les groupes ADCO et BASE
+	 */
+	string buildTrame(string adco, string base) {
+		return "\x02" + buildGroupe("ADCO", adco) + buildGroupe("BASE", base) + "\x03";
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoCoroutineTest);
+	CPPUNIT_TEST(testPullSourceSynchrone);
+	CPPUNIT_TEST(testSourceAsynchrone);
+	CPPUNIT_TEST(testPlusieursTramesParBloc);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoCoroutineTest);
@@ -364,6 +364,407 @@ public:
 		CPPUNIT_ASSERT(teleinfo->getTotalOffset() == 0);
 	}
 
+	/**
+	 * Test de la trame concrète TeleinfoFrame : mêmes valeurs que par l'interface Teleinfo, index total calculé à la fin de la trame
+	 */
+	void testTrameConcrete() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder(1000);
+		string stream = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "HC..") + buildGroupe("HCHC", "000056990")
+				+ buildGroupe("HCHP", "000012010") + buildGroupe("IINST", "004") + "\x03";
+
+		TeleinfoFrame* frame = teleinfoDecoder->decode((const unsigned char*) stream.data(), stream.length(), NULL);
+		CPPUNIT_ASSERT(frame != NULL);
+		Teleinfo* teleinfo = frame;
+		CPPUNIT_ASSERT(frame->getTotalIndex() == 56990 + 12010 - 1000);
+		CPPUNIT_ASSERT(teleinfo->getTotalIndex() == frame->getTotalIndex());
+		CPPUNIT_ASSERT(frame->getTotalOffset() == 1000);
+		CPPUNIT_ASSERT(frame->getHchp() == 12010);
+		CPPUNIT_ASSERT(frame->getInstPower() == 4 * 230);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getOptarif(), "HC..") == 0);
+		CPPUNIT_ASSERT(frame->getAdcoAsLong() == 26489026467);
+		CPPUNIT_ASSERT(frame->getValidFields() == (TELEINFO_FIELD_ADCO | TELEINFO_FIELD_OPTARIF | TELEINFO_FIELD_HCHC | TELEINFO_FIELD_HCHP | TELEINFO_FIELD_IINST));
+
+		// Index total recalculé pour la trame restaurée d'un point de reprise
+		char* state = (char*) malloc(teleinfoDecoder->getStateSize());
+		teleinfoDecoder->saveState(state);
+		TeleinfoDecoder* restoredDecoder = new TeleinfoDecoder();
+		CPPUNIT_ASSERT(restoredDecoder->restoreState(state, teleinfoDecoder->getStateSize()));
+		TeleinfoFrame* lastFrame = restoredDecoder->getLastFrame();
+		CPPUNIT_ASSERT(lastFrame != NULL);
+		CPPUNIT_ASSERT(lastFrame->getTotalIndex() == 56990 + 12010 - 1000);
+		CPPUNIT_ASSERT(lastFrame->getIinst() == 4);
+		free(state);
+		delete restoredDecoder;
+		delete teleinfoDecoder;
+	}
+
+	/**
+	 * Test de la copie de la dernière trame : tenue à partir du premier appel, ou dès la création avec TELEINFO_OPTION_KEEP_LAST_FRAME
+	 */
+	void testDerniereTrame() {
+		string first = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000056990") + "\x03";
+		string second = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000057000") + "\x03";
+		string started = "\x02" + buildGroupe("ADCO", "026489026467");
+
+		// Premier appel entre deux trames : la trame terminée est retrouvée
+		TeleinfoDecoder lazy;
+		CPPUNIT_ASSERT(lazy.decode((const unsigned char*) first.data(), first.length(), NULL) != NULL);
+		CPPUNIT_ASSERT(lazy.getLastFrame() != NULL && lazy.getLastFrame()->getBase() == 56990);
+		lazy.decode((const unsigned char*) started.data(), started.length(), NULL);
+		CPPUNIT_ASSERT(lazy.getLastFrame()->getBase() == 56990);
+
+		// Premier appel pendant une trame : la trame précédente est déjà effacée
+		TeleinfoDecoder late;
+		late.decode((const unsigned char*) first.data(), first.length(), NULL);
+		late.decode((const unsigned char*) started.data(), started.length(), NULL);
+		CPPUNIT_ASSERT(late.getLastFrame() == NULL);
+		late.reset();
+		CPPUNIT_ASSERT(late.decode((const unsigned char*) second.data(), second.length(), NULL) != NULL);
+		CPPUNIT_ASSERT(late.getLastFrame()->getBase() == 57000);
+
+		// Option : copie à chaque ETX
+		TeleinfoDecoder kept;
+		kept.setOptions(TELEINFO_OPTION_KEEP_LAST_FRAME);
+		kept.decode((const unsigned char*) first.data(), first.length(), NULL);
+		kept.decode((const unsigned char*) started.data(), started.length(), NULL);
+		CPPUNIT_ASSERT(kept.getLastFrame() != NULL && kept.getLastFrame()->getBase() == 56990);
+	}
+
+	/**
+	 * Test d'une trame de compteur triphasé : étiquettes par phase, puis trame courte de dépassement (ADIR, ponctuelle)
+	 */
+	void testTriphase() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_CARRY_FORWARD);
+		string stream = "\x02" + buildGroupe("ADCO", "031428097115") + buildGroupe("OPTARIF", "BASE") + buildGroupe("ISOUSC", "20")
+				+ buildGroupe("BASE", "006157184") + buildGroupe("PTEC", "TH..") + buildGroupe("IINST1", "001") + buildGroupe("IINST2", "012")
+				+ buildGroupe("IINST3", "003") + buildGroupe("IMAX1", "029") + buildGroupe("IMAX2", "030") + buildGroupe("IMAX3", "027")
+				+ buildGroupe("PMAX", "09680") + buildGroupe("PAPP", "03560") + buildGroupe("HHPHC", "A") + buildGroupe("MOTDETAT", "000000")
+				+ buildGroupe("PPOT", "00") + "\x03";
+
+		TeleinfoFrame* frame = teleinfoDecoder->decode((const unsigned char*) stream.data(), stream.length(), NULL);
+		CPPUNIT_ASSERT(frame != NULL);
+		CPPUNIT_ASSERT(strcmp(frame->getAdco(), "031428097115") == 0);
+		CPPUNIT_ASSERT(frame->getBase() == 6157184);
+		CPPUNIT_ASSERT(frame->getPapp() == 3560);
+		CPPUNIT_ASSERT(frame->getIinstPhase(1) == 1);
+		CPPUNIT_ASSERT(frame->getIinstPhase(2) == 12);
+		CPPUNIT_ASSERT(frame->getIinstPhase(3) == 3);
+		CPPUNIT_ASSERT(frame->getIinstPhase(4) == 0);
+		CPPUNIT_ASSERT(frame->getImaxPhase(2) == 30);
+		CPPUNIT_ASSERT(frame->getPmax() == 9680);
+		CPPUNIT_ASSERT(strcmp(frame->getPpot(), "00") == 0);
+		CPPUNIT_ASSERT(frame->getHhphc() == 'A');
+		CPPUNIT_ASSERT(frame->getIinst() == 0);
+		CPPUNIT_ASSERT(frame->getValidFields() & TELEINFO_FIELD_IINST2);
+		CPPUNIT_ASSERT(frame->getValidFields() & TELEINFO_FIELD_PMAX);
+		CPPUNIT_ASSERT((frame->getValidFields() & TELEINFO_FIELD_IINST) == 0);
+
+		// Trame courte de dépassement : ADIR n'est pas reporté à la trame suivante
+		stream = "\x02" + buildGroupe("ADIR2", "032") + buildGroupe("ADCO", "031428097115") + buildGroupe("IINST1", "001")
+				+ buildGroupe("IINST2", "032") + buildGroupe("IINST3", "003") + "\x03";
+		frame = teleinfoDecoder->decode((const unsigned char*) stream.data(), stream.length(), NULL);
+		CPPUNIT_ASSERT(frame != NULL);
+		CPPUNIT_ASSERT(frame->getAdirPhase(2) == 32);
+		CPPUNIT_ASSERT(frame->getIinstPhase(2) == 32);
+		CPPUNIT_ASSERT(frame->getPmax() == 9680);
+		CPPUNIT_ASSERT(frame->getCarriedFields() & TELEINFO_FIELD_PMAX);
+
+		stream = "\x02" + buildGroupe("ADCO", "031428097115") + buildGroupe("IINST2", "012") + "\x03";
+		frame = teleinfoDecoder->decode((const unsigned char*) stream.data(), stream.length(), NULL);
+		CPPUNIT_ASSERT(frame->getAdirPhase(2) == 0);
+		CPPUNIT_ASSERT(((frame->getValidFields() | frame->getCarriedFields()) & TELEINFO_FIELD_ADIR2) == 0);
+		delete teleinfoDecoder;
+	}
+
+	/**
+	 * Test du schéma des étiquettes : étiquette inconnue ignorée, donnée trop longue tronquée à la taille de son emplacement
+	 */
+	void testSchema() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		string stream = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("INCONNU", "12345") + buildGroupe("PTEC", "HC..XXXXXXXX")
+				+ buildGroupe("IINST", "005") + "\x03";
+		TeleinfoFrame* frame = teleinfoDecoder->decode((const unsigned char*) stream.data(), stream.length(), NULL);
+		CPPUNIT_ASSERT(frame != NULL);
+		CPPUNIT_ASSERT(strcmp(frame->getPtec(), "HC..") == 0);
+		CPPUNIT_ASSERT(strcmp(frame->getAdco(), "026489026467") == 0);
+		CPPUNIT_ASSERT(frame->getIinst() == 5);
+		CPPUNIT_ASSERT(frame->getValidFields() == (TELEINFO_FIELD_ADCO | TELEINFO_FIELD_PTEC | TELEINFO_FIELD_IINST));
+		CPPUNIT_ASSERT(frame->getRecord()->shorts[TELEINFO_SLOT_IINST] == 5);
+		delete teleinfoDecoder;
+	}
+
+	/**
+	 * Test du décodage par blocs : arrêt à la fin de chaque trame, reprise avec les octets restants
+	 */
+	void testDecodeBuffer() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		string stream = "\x0A" "BASE 0" "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000056990") + "\x03"
+				+ "\x02" + buildGroupe("ADCO", "200638824480") + buildGroupe("BASE", "000059000") + "\x03" + "\x02";
+		const unsigned char* buffer = (const unsigned char*) stream.data();
+		unsigned int length = stream.length();
+		unsigned int consumed = 0;
+
+		Teleinfo* teleinfo = teleinfoDecoder->decode(buffer, length, &consumed);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getAdco(), "026489026467") == 0);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 56990);
+		CPPUNIT_ASSERT(buffer[consumed - 1] == 0x03);
+
+		unsigned int index = consumed;
+		teleinfo = teleinfoDecoder->decode(buffer + index, length - index, &consumed);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getAdco(), "200638824480") == 0);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 59000);
+
+		index += consumed;
+		CPPUNIT_ASSERT(teleinfoDecoder->decode(buffer + index, length - index, &consumed) == NULL);
+		CPPUNIT_ASSERT(index + consumed == length);
+		CPPUNIT_ASSERT(teleinfoDecoder->decode(buffer, 0, NULL) == NULL);
+	}
+
+	/**
+	 * Test du décodage par blocs d'une trame découpée au milieu des étiquettes et données
+	 */
+	void testDecodeBufferDecoupe() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		string stream = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "BASE") + buildGroupe("BASE", "000056990") + "\x03";
+		const unsigned char* buffer = (const unsigned char*) stream.data();
+		Teleinfo* teleinfo = NULL;
+		unsigned int consumed = 0;
+		for (unsigned int index = 0; index < stream.length(); index += 3) {
+			unsigned int length = stream.length() - index < 3 ? stream.length() - index : 3;
+			teleinfo = teleinfoDecoder->decode(buffer + index, length, &consumed);
+			CPPUNIT_ASSERT(consumed == length);
+		}
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getAdco(), "026489026467") == 0);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getOptarif(), "BASE") == 0);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 56990);
+	}
+
+	/**
+	 * Test du mode récupération : seuls les groupes invalides sont écartés
+	 */
+	void testModeRecuperation() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		string stream = "\x02" + buildGroupe("ADCO", "026489026467") + "\x0A" "BASE 000056990 X\x0D" + buildGroupe("IINST", "005")
+				+ "\x0A" "PAPP 01" + buildGroupe("HHPHC", "A") + "\x03";
+
+		// Par défaut, la trame est perdue
+		CPPUNIT_ASSERT(injectText(teleinfoDecoder, stream) == NULL);
+		TeleinfoStats stats;
+		teleinfoDecoder->getStats(&stats);
+		CPPUNIT_ASSERT(stats.frames == 0);
+		CPPUNIT_ASSERT(stats.lostFrames == 1);
+
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_SALVAGE);
+		CPPUNIT_ASSERT(teleinfoDecoder->getOptions() == TELEINFO_OPTION_SALVAGE);
+		Teleinfo* teleinfo = injectText(teleinfoDecoder, stream);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getAdco(), "026489026467") == 0);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 0);
+		CPPUNIT_ASSERT(teleinfo->getIinst() == 5);
+		CPPUNIT_ASSERT(teleinfo->getPapp() == 0);
+		CPPUNIT_ASSERT(teleinfo->getHhphc() == 'A');
+		CPPUNIT_ASSERT(teleinfo->getValidFields() == (TELEINFO_FIELD_ADCO | TELEINFO_FIELD_IINST | TELEINFO_FIELD_HHPHC));
+		CPPUNIT_ASSERT(teleinfo->getCarriedFields() == 0);
+
+		// Groupe interrompu par la fin de la trame, puis STX inattendu
+		CPPUNIT_ASSERT(injectText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "026489026467") + "\x0A" "BASE 0000\x03") != NULL);
+		CPPUNIT_ASSERT(injectText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "026489026467") + "\x0A" "BA") == NULL);
+		teleinfo = injectText(teleinfoDecoder, "\x02" + buildGroupe("BASE", "000056990") + "\x03");
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getValidFields() == TELEINFO_FIELD_BASE);
+
+		teleinfoDecoder->getStats(&stats);
+		CPPUNIT_ASSERT(stats.frames == 3);
+		CPPUNIT_ASSERT(stats.lostFrames == 2);
+		CPPUNIT_ASSERT(stats.salvagedFrames == 2);
+		CPPUNIT_ASSERT(stats.droppedGroupes == 3);
+		teleinfoDecoder->resetStats();
+		teleinfoDecoder->getStats(&stats);
+		CPPUNIT_ASSERT(stats.frames == 0);
+	}
+
+	/**
+	 * Test du mode récupération sans aucun groupe accepté : aucune trame n'est publiée
+	 */
+	void testRecuperationTrameVide() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_SALVAGE);
+		CPPUNIT_ASSERT(injectText(teleinfoDecoder, "\x02\x03") == NULL);
+		CPPUNIT_ASSERT(injectText(teleinfoDecoder, "\x02" "\x0A" "BASE 000056990 X\x0D" "\x03") == NULL);
+		CPPUNIT_ASSERT(injectText(teleinfoDecoder, "\x02" "\x0A" "BASE 0000\x03") == NULL);
+		TeleinfoStats stats;
+		teleinfoDecoder->getStats(&stats);
+		CPPUNIT_ASSERT(stats.frames == 0);
+		CPPUNIT_ASSERT(stats.lostFrames == 3);
+
+		// Un seul groupe accepté suffit
+		Teleinfo* teleinfo = injectText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "026489026467") + "\x0A" "BASE 0000\x03");
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getValidFields() == TELEINFO_FIELD_ADCO);
+		delete teleinfoDecoder;
+	}
+
+	/**
+	 * Test du report des dernières valeurs valides
+	 */
+	void testReportValeurs() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_SALVAGE | TELEINFO_OPTION_CARRY_FORWARD);
+		Teleinfo* teleinfo = injectText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000056990")
+				+ buildGroupe("PAPP", "01110") + buildGroupe("ADPS", "031") + "\x03");
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getCarriedFields() == 0);
+
+		teleinfo = injectText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "026489026467") + "\x0A" "BASE 000057000 X\x0D" + buildGroupe("PAPP", "00990") + "\x03");
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 56990);
+		CPPUNIT_ASSERT(teleinfo->getPapp() == 990);
+		CPPUNIT_ASSERT(teleinfo->getAdps() == 0); // Champ ponctuel : jamais reporté
+		CPPUNIT_ASSERT(teleinfo->getValidFields() == (TELEINFO_FIELD_ADCO | TELEINFO_FIELD_PAPP));
+		CPPUNIT_ASSERT(teleinfo->getCarriedFields() == TELEINFO_FIELD_BASE);
+
+		// Sans report, les champs absents sont remis à zéro
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_SALVAGE);
+		teleinfo = injectText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "026489026467") + "\x03");
+		CPPUNIT_ASSERT(teleinfo->getBase() == 0);
+		CPPUNIT_ASSERT(teleinfo->getPapp() == 0);
+		CPPUNIT_ASSERT(teleinfo->getCarriedFields() == 0);
+	}
+
+	/**
+	 * Test de la réparation d'un caractère erroné, localisé par la parité
+	 */
+	void testReparation() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_REPAIR);
+		Teleinfo* teleinfo = injectText(teleinfoDecoder, withParity("\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000056990") + "\x03"));
+		CPPUNIT_ASSERT(teleinfo != NULL);
+
+		// Chiffre d'un index altéré (bit 1) : réparé grâce au checksum
+		string text = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000056991") + buildGroupe("PAPP", "01110") + "\x03";
+		string stream = withParity(text);
+		stream[text.find("56991") + 4] ^= 0x02;
+		// Chiffre de PAPP altéré (bit 6) : checksum inchangé, réparé grâce à la grammaire
+		stream[text.find("01110") + 1] ^= 0x40;
+		teleinfo = injectText(teleinfoDecoder, stream);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 56991);
+		CPPUNIT_ASSERT(teleinfo->getPapp() == 1110);
+
+		// Bit de parité seul altéré : rien à réparer
+		text = "\x02" + buildGroupe("BASE", "000056992") + "\x03";
+		stream = withParity(text);
+		stream[text.find("56992")] ^= 0x80;
+		const unsigned char* buffer = (const unsigned char*) stream.data();
+		teleinfo = teleinfoDecoder->decode(buffer, stream.length(), NULL);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 56992);
+
+		TeleinfoStats stats;
+		teleinfoDecoder->getStats(&stats);
+		CPPUNIT_ASSERT(stats.parityErrors == 3);
+		CPPUNIT_ASSERT(stats.repairs == 2);
+		CPPUNIT_ASSERT(stats.rejectedRepairs == 0);
+	}
+
+	/**
+	 * Test des réparations refusées : ambiguës ou non plausibles
+	 */
+	void testReparationRefusee() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_REPAIR | TELEINFO_OPTION_SALVAGE);
+		CPPUNIT_ASSERT(injectText(teleinfoDecoder, withParity("\x02" + buildGroupe("BASE", "000056990") + "\x03")) != NULL);
+
+		// Chaque trame porte un groupe valide (ADCO) : sans aucun groupe accepté, elle serait perdue
+		// "BBR(" ou "BBRh" : les deux conviennent
+		string text = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "BBR(") + "\x03";
+		string stream = withParity(text);
+		stream[text.find("BBR(") + 3] ^= 0x80;
+		Teleinfo* teleinfo = injectText(teleinfoDecoder, stream);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getValidFields() == TELEINFO_FIELD_ADCO);
+
+		// Index trop éloigné du précédent
+		text = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000099990") + "\x03";
+		stream = withParity(text);
+		stream[text.find("99990")] ^= 0x01;
+		teleinfo = injectText(teleinfoDecoder, stream);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getValidFields() == TELEINFO_FIELD_ADCO);
+
+		// Deux caractères altérés qui se compensent dans le checksum : donnée non plausible
+		text = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000056991") + "\x03";
+		stream = withParity(text);
+		stream[text.find("56991")] ^= 0x01;
+		stream[text.find("6991")] ^= 0x01;
+		teleinfo = injectText(teleinfoDecoder, stream);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getValidFields() == TELEINFO_FIELD_ADCO);
+
+		TeleinfoStats stats;
+		teleinfoDecoder->getStats(&stats);
+		CPPUNIT_ASSERT(stats.repairs == 0);
+		CPPUNIT_ASSERT(stats.rejectedRepairs == 3);
+		CPPUNIT_ASSERT(stats.droppedGroupes == 3);
+	}
+
+	/**
+	 * Test de la règle commune à un ou plusieurs caractères reçus avec une erreur de parité :
+	 * un groupe au checksum valide n'est accepté que si sa donnée est plausible
+	 */
+	void testReparationPlusieursErreurs() {
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_REPAIR | TELEINFO_OPTION_SALVAGE);
+		CPPUNIT_ASSERT(injectText(teleinfoDecoder, withParity("\x02" + buildGroupe("BASE", "000056990") + "\x03")) != NULL);
+
+		for (int suspects = 1; suspects <= 2; suspects++) {
+			// Bits de parité seuls altérés, donnée plausible : groupe accepté tel que reçu
+			string text = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000056991") + "\x03";
+			string stream = withParity(text);
+			for (int i = 0; i < suspects; i++) {
+				stream[text.find("56991") + i] ^= 0x80;
+			}
+			Teleinfo* teleinfo = injectText(teleinfoDecoder, stream);
+			CPPUNIT_ASSERT(teleinfo != NULL);
+			CPPUNIT_ASSERT(teleinfo->getValidFields() == (TELEINFO_FIELD_ADCO | TELEINFO_FIELD_BASE));
+			CPPUNIT_ASSERT(teleinfo->getBase() == 56991);
+
+			// Bits de parité seuls altérés, index trop éloigné du précédent : groupe écarté malgré son checksum valide
+			text = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("BASE", "000099991") + "\x03";
+			stream = withParity(text);
+			for (int i = 0; i < suspects; i++) {
+				stream[text.find("99991") + i] ^= 0x80;
+			}
+			teleinfo = injectText(teleinfoDecoder, stream);
+			CPPUNIT_ASSERT(teleinfo != NULL);
+			CPPUNIT_ASSERT(teleinfo->getValidFields() == TELEINFO_FIELD_ADCO);
+		}
+
+		TeleinfoStats stats;
+		teleinfoDecoder->getStats(&stats);
+		CPPUNIT_ASSERT(stats.parityErrors == 6);
+		CPPUNIT_ASSERT(stats.repairs == 0);
+		CPPUNIT_ASSERT(stats.rejectedRepairs == 2);
+		CPPUNIT_ASSERT(stats.droppedGroupes == 2);
+		delete teleinfoDecoder;
+	}
+
+	/**
+	 * Test de l'identifiant du décodeur (sondes USDT)
+	 */
+	void testIdentifiant() {
+		TeleinfoDecoder first;
+		TeleinfoDecoder second;
+		CPPUNIT_ASSERT(second.getId() == first.getId() + 1);
+		first.setId(42);
+		CPPUNIT_ASSERT(first.getId() == 42);
+		CPPUNIT_ASSERT(second.getId() != 42);
+	}
+
 	/**
 	 * Test des constantes
 	 */
@@ -447,6 +848,25 @@ private:
 		return teleinfoDecoder->decode(character);
 	}
 
+	/**
+	 * Construit un groupe étiquette/donnée complet avec son checksum
+	 */
+	string buildGroupe(string etiquette, string donnee) {
+		return "\x0A" + etiquette + " " + donnee + " " + (char) computeChecksum(etiquette, donnee) + "\x0D";
+	}
+
+	/**
+	 * Ajoute le bit de parité (parité paire, bit de poids fort) à chaque caractère
+	 */
+	string withParity(string text) {
+		for (unsigned int i = 0; i < text.length(); i++) {
+			if (__builtin_parity((unsigned char) text[i])) {
+				text[i] ^= 0x80;
+			}
+		}
+		return text;
+	}
+
 	/**
 	 * Calcul le chacksum d'un groupe étiquette/donnée
 	 *
@@ -480,6 +900,19 @@ private:
 	CPPUNIT_TEST(testTotalOffset);
 	CPPUNIT_TEST(testTotalOffsetAuto);
 	CPPUNIT_TEST(testTotalOffsetDefault);
+	CPPUNIT_TEST(testTrameConcrete);
+	CPPUNIT_TEST(testDerniereTrame);
+	CPPUNIT_TEST(testTriphase);
+	CPPUNIT_TEST(testSchema);
+	CPPUNIT_TEST(testDecodeBuffer);
+	CPPUNIT_TEST(testDecodeBufferDecoupe);
+	CPPUNIT_TEST(testModeRecuperation);
+	CPPUNIT_TEST(testRecuperationTrameVide);
+	CPPUNIT_TEST(testReportValeurs);
+	CPPUNIT_TEST(testReparation);
+	CPPUNIT_TEST(testReparationRefusee);
+	CPPUNIT_TEST(testReparationPlusieursErreurs);
+	CPPUNIT_TEST(testIdentifiant);
 	CPPUNIT_TEST(testConstantes);
 	CPPUNIT_TEST_SUITE_END();
 
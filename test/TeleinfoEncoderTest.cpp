@@ -0,0 +1,148 @@
+/**
+ * Test unitaire de l'encodage de trames Téléinfo
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoEncoder.h"
+#include <string.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class TeleinfoEncoderTest : public CppUnit::TestFixture {
+
+private:
+	TeleinfoDecoder* teleinfoDecoder;
+	unsigned char frame[TELEINFO_ENCODER_FRAME_SIZE];
+
+public:
+
+	void setUp() {
+		teleinfoDecoder = new TeleinfoDecoder();
+	}
+
+	void tearDown() {
+		delete teleinfoDecoder;
+	}
+
+	/**
+	 * Test du checksum et de la parité : groupes de la spécification Téléinfo
+	 */
+	void testChecksum() {
+		CPPUNIT_ASSERT(TeleinfoEncoder::checksum("MOTDETAT", "000000") == 'B');
+		CPPUNIT_ASSERT(TeleinfoEncoder::checksum("OPTARIF", "HC..") == '<');
+		CPPUNIT_ASSERT(TeleinfoEncoder::checksum("PTEC", "HP..") == ' ');
+		CPPUNIT_ASSERT(TeleinfoEncoder::withParity('A') == 'A');
+		CPPUNIT_ASSERT(TeleinfoEncoder::withParity('C') == 0xC3);
+		CPPUNIT_ASSERT(TeleinfoEncoder::withParity(0x02) == 0x82);
+	}
+
+	/**
+	 * Test de la forme des trames de chaque option tarifaire, relues par le décodeur
+	 */
+	void testOptions() {
+		TeleinfoEncoder base("021428097115", TELEINFO_OPTARIF_BASE);
+		base.setIndex(TELEINFO_PERIOD_TH, 6157184);
+		base.setPower(3560);
+		Teleinfo* teleinfo = decode(&base, false);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getAdco(), "021428097115") == 0);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getOptarif(), "BASE") == 0);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 6157184);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getPtec(), "TH..") == 0);
+		CPPUNIT_ASSERT(teleinfo->getIinst() == 16);
+		CPPUNIT_ASSERT(teleinfo->getPapp() == 3560);
+		CPPUNIT_ASSERT(teleinfo->getAdps() == 0);
+		CPPUNIT_ASSERT(!base.setPeriod(TELEINFO_PERIOD_HC));
+
+		TeleinfoEncoder hc("026489026467", TELEINFO_OPTARIF_HC);
+		hc.setIndex(TELEINFO_PERIOD_HC, 56990);
+		hc.setIndex(TELEINFO_PERIOD_HP, 12010);
+		CPPUNIT_ASSERT(hc.setPeriod(TELEINFO_PERIOD_HP));
+		teleinfo = decode(&hc, false);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getOptarif(), "HC..") == 0);
+		CPPUNIT_ASSERT(teleinfo->getHchc() == 56990);
+		CPPUNIT_ASSERT(teleinfo->getHchp() == 12010);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getPtec(), "HP..") == 0);
+
+		TeleinfoEncoder ejp("200638824480", TELEINFO_OPTARIF_EJP);
+		ejp.setPreavis(true);
+		CPPUNIT_ASSERT(ejp.setPeriod(TELEINFO_PERIOD_PM));
+		teleinfo = decode(&ejp, false);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getOptarif(), "EJP.") == 0);
+		CPPUNIT_ASSERT(teleinfo->getPejp() == 30);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getPtec(), "PM..") == 0);
+
+		TeleinfoEncoder tempo("031428097115", TELEINFO_OPTARIF_TEMPO, 45);
+		tempo.setIndex(TELEINFO_PERIOD_HPJR, 123456);
+		tempo.setDemain(TELEINFO_DEMAIN_ROUGE);
+		CPPUNIT_ASSERT(tempo.setPeriod(TeleinfoEncoder::parsePeriod("HPJR")));
+		CPPUNIT_ASSERT(!tempo.setPeriod(TELEINFO_PERIOD_HN));
+		teleinfo = decode(&tempo, false);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getOptarif(), "BBR(") == 0);
+		CPPUNIT_ASSERT(teleinfo->getIsousc() == 45);
+		CPPUNIT_ASSERT(teleinfo->getBbrhpjr() == 123456);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getPtec(), "HPJR") == 0);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getDemain(), "ROUG") == 0);
+		CPPUNIT_ASSERT(TeleinfoEncoder::parseOptarif("TEMPO") == TELEINFO_OPTARIF_TEMPO);
+		CPPUNIT_ASSERT(TeleinfoEncoder::parseOptarif("BBR") == -1);
+	}
+
+	/**
+	 * Test de l'énergie comptée dans l'index de la période et du dépassement de puissance souscrite
+	 */
+	void testEnergie() {
+		TeleinfoEncoder hc("026489026467", TELEINFO_OPTARIF_HC, 30);
+		hc.setIndex(TELEINFO_PERIOD_HC, 1000);
+		hc.setPower(3600);
+		hc.advance(3600000); // 1 heure à 3600 VA
+		CPPUNIT_ASSERT(hc.getIndex(TELEINFO_PERIOD_HC) == 4600);
+		hc.setPeriod(TELEINFO_PERIOD_HP);
+		hc.advance(500);
+		hc.advance(500);
+		CPPUNIT_ASSERT(hc.getIndex(TELEINFO_PERIOD_HP) == 1);
+
+		hc.setPower(7400);
+		Teleinfo* teleinfo = decode(&hc, false);
+		CPPUNIT_ASSERT(teleinfo->getIinst() == 33);
+		CPPUNIT_ASSERT(teleinfo->getAdps() == 33);
+		CPPUNIT_ASSERT(teleinfo->getImax() == 33);
+		CPPUNIT_ASSERT(teleinfo->getHchc() == 4600);
+	}
+
+	/**
+	 * Test des trames avec le bit de parité paire (7E1)
+	 */
+	void testParite() {
+		TeleinfoEncoder tempo("031428097115", TELEINFO_OPTARIF_TEMPO);
+		tempo.setPower(1200);
+		unsigned int length = tempo.encode(frame, true);
+		for (unsigned int i = 0; i < length; i++) {
+			CPPUNIT_ASSERT(!__builtin_parity(frame[i]));
+		}
+		teleinfoDecoder->setOptions(TELEINFO_OPTION_REPAIR);
+		Teleinfo* teleinfo = decode(&tempo, true);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getPtec(), "HCJB") == 0);
+		TeleinfoStats stats;
+		teleinfoDecoder->getStats(&stats);
+		CPPUNIT_ASSERT(stats.parityErrors == 0);
+	}
+
+private:
+	Teleinfo* decode(TeleinfoEncoder* encoder, bool parity) {
+		unsigned int length = encoder->encode(frame, parity);
+		CPPUNIT_ASSERT(length < TELEINFO_ENCODER_FRAME_SIZE);
+		unsigned int consumed = 0;
+		Teleinfo* teleinfo = teleinfoDecoder->decode(frame, length, &consumed);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(consumed == length);
+		return teleinfo;
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoEncoderTest);
+	CPPUNIT_TEST(testChecksum);
+	CPPUNIT_TEST(testOptions);
+	CPPUNIT_TEST(testEnergie);
+	CPPUNIT_TEST(testParite);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoEncoderTest);
@@ -0,0 +1,165 @@
+/**
+ * Test unitaire de la table des dernières valeurs d'un parc
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoEncoder.h"
+#include "TeleinfoFleet.h"
+#include <stdio.h>
+#include <vector>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+class TeleinfoFleetTest : public CppUnit::TestFixture {
+
+private:
+	/**
+	 * Nombre de compteurs, pas un multiple de TELEINFO_FLEET_LANES
+	 */
+	static const unsigned int METERS = 1000;
+
+	TeleinfoDecoder* teleinfoDecoder;
+
+	/**
+	 * Décode une trame d'un compteur en option de base
+	 */
+	Teleinfo* decodeFrame(int isousc, int power) {
+		unsigned char buffer[TELEINFO_ENCODER_FRAME_SIZE];
+		TeleinfoEncoder encoder("026489026467", TELEINFO_OPTARIF_BASE, isousc);
+		encoder.setPower(power);
+		unsigned int length = encoder.encode(buffer, false);
+		unsigned int consumed;
+		return teleinfoDecoder->decode(buffer, length, &consumed);
+	}
+
+public:
+
+	void setUp() {
+		teleinfoDecoder = new TeleinfoDecoder();
+	}
+
+	void tearDown() {
+		delete teleinfoDecoder;
+	}
+
+	/**
+	 * Test des recherches sur un parc, comparées à un parcours des valeurs de chaque compteur
+	 */
+	void testRecherches() {
+		TeleinfoFleet fleet(METERS);
+		CPPUNIT_ASSERT(fleet.getMeterCount() == METERS);
+		vector<int> powers(METERS, -1);
+		vector<bool> overloads(METERS, false);
+		unsigned int seed = 42;
+		for (unsigned int round = 0; round < 3; round++) {
+			for (unsigned int meter = 0; meter < METERS; meter++) {
+				seed = seed * 1103515245 + 12345;
+				if ((seed >> 16) % 10 == 0) {
+					continue; // Pas de trame pour ce compteur à ce tour
+				}
+				int isousc = (seed >> 8) % 2 == 0 ? 30 : 45;
+				int power = (seed >> 12) % 12000;
+				Teleinfo* teleinfo = decodeFrame(isousc, power);
+				CPPUNIT_ASSERT(teleinfo != NULL);
+				CPPUNIT_ASSERT(fleet.update(meter, teleinfo, 1000 * round + 1));
+				powers[meter] = teleinfo->getInstPower();
+				overloads[meter] = teleinfo->getIinst() > isousc;
+				CPPUNIT_ASSERT(overloads[meter] == (teleinfo->getAdps() > 0));
+			}
+		}
+		CPPUNIT_ASSERT(fleet.update(METERS, decodeFrame(30, 1000), 1) == false);
+		CPPUNIT_ASSERT(fleet.getPower(METERS) == 0);
+
+		// Dépassements et avertissements : l'encodeur émet ADPS dès que IINST dépasse ISOUSC
+		vector<uint32_t> expected;
+		for (unsigned int meter = 0; meter < METERS; meter++) {
+			if (overloads[meter]) {
+				expected.push_back(meter);
+			}
+		}
+		CPPUNIT_ASSERT(expected.size() > 10);
+		uint32_t found[METERS];
+		CPPUNIT_ASSERT(fleet.findOverloads(found, METERS) == expected.size());
+		for (unsigned int i = 0; i < expected.size(); i++) {
+			CPPUNIT_ASSERT(found[i] == expected[i]);
+		}
+		CPPUNIT_ASSERT(fleet.findAdps(found, 5) == expected.size());
+		for (unsigned int i = 0; i < 5; i++) {
+			CPPUNIT_ASSERT(found[i] == expected[i]);
+		}
+
+		// Plus fortes puissances : référence par sélection naïve
+		uint32_t top[100];
+		int32_t topPowers[100];
+		CPPUNIT_ASSERT(fleet.findTopPower(100, top, topPowers) == 100);
+		vector<bool> taken(METERS, false);
+		for (unsigned int i = 0; i < 100; i++) {
+			int best = -1;
+			for (unsigned int meter = 0; meter < METERS; meter++) {
+				if (!taken[meter] && powers[meter] >= 0 && (best < 0 || powers[meter] > powers[best])) {
+					best = meter;
+				}
+			}
+			taken[best] = true;
+			CPPUNIT_ASSERT(top[i] == (uint32_t) best);
+			CPPUNIT_ASSERT(topPowers[i] == powers[best]);
+			CPPUNIT_ASSERT(fleet.getPower(best) == powers[best]);
+		}
+
+		// Un compteur effacé n'est plus retenu
+		uint32_t second = top[1];
+		fleet.clear(top[0]);
+		CPPUNIT_ASSERT(fleet.getPower(top[0]) == 0);
+		CPPUNIT_ASSERT(fleet.getTimestamp(top[0]) == 0);
+		CPPUNIT_ASSERT(fleet.findTopPower(1, top, NULL) == 1);
+		CPPUNIT_ASSERT(top[0] == second);
+	}
+
+	/**
+	 * Test d'un parc de moins de compteurs que demandés et des puissances égales
+	 */
+	void testPetitParc() {
+		TeleinfoFleet fleet(20);
+		uint32_t top[10];
+		int32_t powers[10];
+		CPPUNIT_ASSERT(fleet.findTopPower(10, top, powers) == 0);
+		CPPUNIT_ASSERT(fleet.findOverloads(top, 10) == 0);
+		CPPUNIT_ASSERT(fleet.findAdps(top, 10) == 0);
+
+		unsigned int meters[] = { 17, 3, 9, 12, 0 };
+		int papps[] = { 2000, 5000, 2000, 0, 2000 };
+		for (int i = 0; i < 5; i++) {
+			CPPUNIT_ASSERT(fleet.update(meters[i], decodeFrame(30, papps[i]), 1));
+		}
+		CPPUNIT_ASSERT(fleet.findTopPower(10, top, powers) == 5);
+		uint32_t expected[] = { 3, 0, 9, 17, 12 };
+		for (int i = 0; i < 5; i++) {
+			CPPUNIT_ASSERT(top[i] == expected[i]);
+		}
+		CPPUNIT_ASSERT(powers[0] == 5000 && powers[4] == 0);
+		CPPUNIT_ASSERT(fleet.findTopPower(2, top, powers) == 2);
+		CPPUNIT_ASSERT(top[0] == 3 && top[1] == 0);
+
+		// Dépassement au dernier compteur du tableau, puis retour sous l'intensité souscrite
+		CPPUNIT_ASSERT(fleet.update(19, decodeFrame(30, 9000), 2));
+		CPPUNIT_ASSERT(fleet.getIsousc(19) == 30);
+		CPPUNIT_ASSERT(fleet.getIinst(19) == 40);
+		CPPUNIT_ASSERT(fleet.getAdps(19) == 40);
+		CPPUNIT_ASSERT(fleet.findOverloads(top, 10) == 1 && top[0] == 19);
+		CPPUNIT_ASSERT(fleet.findAdps(top, 10) == 1 && top[0] == 19);
+		CPPUNIT_ASSERT(fleet.update(19, decodeFrame(30, 1000), 3));
+		CPPUNIT_ASSERT(fleet.getAdps(19) == 0);
+		CPPUNIT_ASSERT(fleet.findOverloads(top, 10) == 0);
+		CPPUNIT_ASSERT(fleet.findAdps(top, 10) == 0);
+		CPPUNIT_ASSERT(fleet.getTimestamp(19) == 3);
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoFleetTest);
+	CPPUNIT_TEST(testRecherches);
+	CPPUNIT_TEST(testPetitParc);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoFleetTest);
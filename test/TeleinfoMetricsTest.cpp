@@ -0,0 +1,279 @@
+/**
+ * Test unitaire du point d'accès OpenMetrics
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoConflator.h"
+#include "TeleinfoMetrics.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+class TeleinfoMetricsTest : public CppUnit::TestFixture {
+
+private:
+	TeleinfoDecoder* teleinfoDecoder;
+	TeleinfoConflator* conflator;
+	TeleinfoMetrics* metrics;
+
+public:
+
+	void setUp() {
+		teleinfoDecoder = new TeleinfoDecoder();
+		conflator = new TeleinfoConflator(3, 1);
+		metrics = new TeleinfoMetrics(conflator, TELEINFO_METRICS_BASE_SIZE + 4 * TELEINFO_METRICS_METER_SIZE);
+		conflator->publish(0, decodeText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "HC..")
+				+ buildGroupe("ISOUSC", "30") + buildGroupe("HCHC", "001234567") + buildGroupe("HCHP", "007654321")
+				+ buildGroupe("PTEC", "HC..") + buildGroupe("IINST", "005") + buildGroupe("PAPP", "01150") + "\x03"));
+		conflator->publish(2, decodeText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "200638824480") + buildGroupe("BASE", "000001000")
+				+ buildGroupe("IINST", "002") + "\x03"));
+		metrics->addDecoder(teleinfoDecoder, "ttyS0");
+	}
+
+	void tearDown() {
+		delete metrics;
+		delete conflator;
+		delete teleinfoDecoder;
+	}
+
+	/**
+	 * Test du texte OpenMetrics
+	 */
+	void testRendu() {
+		CPPUNIT_ASSERT(metrics->render());
+		string text(metrics->getBuffer(), metrics->getLength());
+		CPPUNIT_ASSERT(text.find("# TYPE teleinfo_index_watt_hours counter\n# UNIT teleinfo_index_watt_hours watt_hours\n") == 0);
+		CPPUNIT_ASSERT(contains(text, "teleinfo_index_watt_hours_total{meter=\"0\",adco=\"026489026467\",register=\"HCHC\"} 1234567\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_index_watt_hours_total{meter=\"0\",adco=\"026489026467\",register=\"HCHP\"} 7654321\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_index_watt_hours_total{meter=\"2\",adco=\"200638824480\",register=\"BASE\"} 1000\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_subscribed_current_amperes{meter=\"0\",adco=\"026489026467\"} 30\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_current_amperes{meter=\"2\",adco=\"200638824480\"} 2\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_apparent_power_voltamperes{meter=\"0\",adco=\"026489026467\"} 1150\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_tariff_period{meter=\"0\",adco=\"026489026467\",period=\"HC..\"} 1\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_decoder_frames_total{decoder=\"ttyS0\"} 2\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_decoder_lost_frames_total{decoder=\"ttyS0\"} 0\n"));
+		CPPUNIT_ASSERT(!contains(text, "meter=\"1\""));
+		CPPUNIT_ASSERT(!contains(text, "teleinfo_max_current_amperes{"));
+		CPPUNIT_ASSERT(text.rfind("# EOF\n") == text.length() - 6);
+
+		// Les valeurs suivent les trames publiées, l'étiquette suit l'ADCO
+		conflator->publish(2, decodeText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "200638824481") + buildGroupe("BASE", "000001001") + "\x03"));
+		CPPUNIT_ASSERT(metrics->render());
+		text = string(metrics->getBuffer(), metrics->getLength());
+		CPPUNIT_ASSERT(contains(text, "teleinfo_index_watt_hours_total{meter=\"2\",adco=\"200638824481\",register=\"BASE\"} 1001\n"));
+		CPPUNIT_ASSERT(!contains(text, "200638824480"));
+	}
+
+	/**
+	 * Test des grandeurs d'un compteur triphasé, une série par phase
+	 */
+	void testTriphase() {
+		conflator->publish(1, decodeText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "031428097115") + buildGroupe("BASE", "006157184")
+				+ buildGroupe("IINST1", "001") + buildGroupe("IINST2", "012") + buildGroupe("IINST3", "003") + buildGroupe("IMAX1", "029")
+				+ buildGroupe("IMAX2", "030") + buildGroupe("IMAX3", "027") + buildGroupe("PMAX", "09680") + buildGroupe("PPOT", "0E")
+				+ buildGroupe("ADIR3", "031") + "\x03"));
+		CPPUNIT_ASSERT(metrics->render());
+		string text(metrics->getBuffer(), metrics->getLength());
+		CPPUNIT_ASSERT(contains(text, "# TYPE teleinfo_phase_current_amperes gauge\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_phase_current_amperes{meter=\"1\",adco=\"031428097115\",phase=\"1\"} 1\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_phase_current_amperes{meter=\"1\",adco=\"031428097115\",phase=\"2\"} 12\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_phase_max_current_amperes{meter=\"1\",adco=\"031428097115\",phase=\"3\"} 27\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_phase_overload_current_amperes{meter=\"1\",adco=\"031428097115\",phase=\"3\"} 31\n"));
+		CPPUNIT_ASSERT(!contains(text, "phase=\"1\"} 0\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_max_power_watts{meter=\"1\",adco=\"031428097115\"} 9680\n"));
+		CPPUNIT_ASSERT(contains(text, "teleinfo_potentials{meter=\"1\",adco=\"031428097115\"} 14\n"));
+		CPPUNIT_ASSERT(!contains(text, "teleinfo_phase_current_amperes{meter=\"0\""));
+	}
+
+	/**
+	 * Test des noms de décodeur les plus longs, dont chaque caractère est échappé
+	 */
+	void testNomsDecodeurs() {
+		TeleinfoMetrics full(conflator, TELEINFO_METRICS_BASE_SIZE + (3 + TELEINFO_METRICS_DECODERS) * TELEINFO_METRICS_METER_SIZE);
+		string name(TELEINFO_METRICS_DECODER_NAME + 6, '"');
+		for (unsigned int i = 0; i < TELEINFO_METRICS_DECODERS; i++) {
+			CPPUNIT_ASSERT(full.addDecoder(teleinfoDecoder, name.c_str()));
+		}
+		CPPUNIT_ASSERT(!full.addDecoder(teleinfoDecoder, "ttyS1"));
+		CPPUNIT_ASSERT(full.render());
+		string text(full.getBuffer(), full.getLength());
+		string escaped;
+		for (unsigned int i = 0; i < TELEINFO_METRICS_DECODER_NAME; i++) {
+			escaped += "\\\"";
+		}
+		string line = "teleinfo_decoder_frames_total{decoder=\"" + escaped + "\"} 2\n";
+		size_t count = 0;
+		for (size_t position = text.find(line); position != string::npos; position = text.find(line, position + 1)) {
+			count++;
+		}
+		CPPUNIT_ASSERT(count == TELEINFO_METRICS_DECODERS);
+	}
+
+	/**
+	 * Test d'une collecte en HTTP sur l'interface locale
+	 */
+	void testTcp() {
+		CPPUNIT_ASSERT(metrics->poll(0) == -1);
+		CPPUNIT_ASSERT(metrics->listenTcp(0));
+		unsigned short port = metrics->getPort();
+		CPPUNIT_ASSERT(port != 0);
+		CPPUNIT_ASSERT(metrics->poll(0) == 0);
+
+		struct sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+
+		int client = socket(AF_INET, SOCK_STREAM, 0);
+		CPPUNIT_ASSERT(connect(client, (struct sockaddr*) &address, sizeof(address)) == 0);
+		string response = get(client, "GET /metrics HTTP/1.1\r\nHost: localhost\r\nAccept: application/openmetrics-text\r\n\r\n");
+		CPPUNIT_ASSERT(response.find("HTTP/1.1 200 OK\r\n") == 0);
+		CPPUNIT_ASSERT(contains(response, "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"));
+		size_t body = response.find("\r\n\r\n") + 4;
+		char length[32];
+		snprintf(length, sizeof(length), "Content-Length: %u\r\n", metrics->getLength());
+		CPPUNIT_ASSERT(contains(response, length));
+		CPPUNIT_ASSERT(response.substr(body) == string(metrics->getBuffer(), metrics->getLength()));
+
+		client = socket(AF_INET, SOCK_STREAM, 0);
+		CPPUNIT_ASSERT(connect(client, (struct sockaddr*) &address, sizeof(address)) == 0);
+		CPPUNIT_ASSERT(get(client, "GET / HTTP/1.1\r\n\r\n").find("HTTP/1.1 404 Not Found\r\n") == 0);
+		client = socket(AF_INET, SOCK_STREAM, 0);
+		CPPUNIT_ASSERT(connect(client, (struct sockaddr*) &address, sizeof(address)) == 0);
+		CPPUNIT_ASSERT(get(client, "POST /metrics HTTP/1.1\r\n\r\n").find("HTTP/1.1 405 Method Not Allowed\r\n") == 0);
+
+		metrics->close();
+		CPPUNIT_ASSERT(metrics->getPort() == 0);
+	}
+
+	/**
+	 * Test d'un client lent, qui envoie sa requête un octet à la fois : la connexion est abandonnée à l'échéance
+	 */
+	void testClientLent() {
+		CPPUNIT_ASSERT(metrics->listenTcp(0));
+		struct sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(metrics->getPort());
+		int client = socket(AF_INET, SOCK_STREAM, 0);
+		CPPUNIT_ASSERT(connect(client, (struct sockaddr*) &address, sizeof(address)) == 0);
+
+		// Un octet toutes les 100 ms : chaque lecture tient dans le délai, la requête entière jamais
+		pid_t child = fork();
+		CPPUNIT_ASSERT(child >= 0);
+		if (child == 0) {
+			const char* request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\nUser-Agent: lent\r\n\r\n";
+			for (const char* position = request; *position != '\0'; position++) {
+				if (send(client, position, 1, MSG_NOSIGNAL) != 1) {
+					break;
+				}
+				usleep(100000);
+			}
+			_exit(0);
+		}
+		struct timespec start;
+		struct timespec end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		CPPUNIT_ASSERT(metrics->poll(1000) == 0);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		long elapsed = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+		CPPUNIT_ASSERT(elapsed >= TELEINFO_METRICS_TIMEOUT - 10);
+		CPPUNIT_ASSERT(elapsed < TELEINFO_METRICS_TIMEOUT + 500);
+		kill(child, SIGKILL);
+		waitpid(child, NULL, 0);
+		close(client);
+
+		// Le point d'accès sert toujours les clients suivants
+		client = socket(AF_INET, SOCK_STREAM, 0);
+		CPPUNIT_ASSERT(connect(client, (struct sockaddr*) &address, sizeof(address)) == 0);
+		CPPUNIT_ASSERT(get(client, "GET /metrics HTTP/1.1\r\n\r\n").find("HTTP/1.1 200 OK\r\n") == 0);
+		metrics->close();
+	}
+
+	/**
+	 * Test d'une collecte en HTTP sur une socket Unix, et d'un tampon trop petit
+	 */
+	void testUnix() {
+		char path[64];
+		snprintf(path, sizeof(path), "/tmp/teleinfo-metrics-%d.sock", (int) getpid());
+		CPPUNIT_ASSERT(metrics->listenUnix(path));
+		CPPUNIT_ASSERT(metrics->getPort() == 0);
+
+		struct sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strcpy(address.sun_path, path);
+		int client = socket(AF_UNIX, SOCK_STREAM, 0);
+		CPPUNIT_ASSERT(connect(client, (struct sockaddr*) &address, sizeof(address)) == 0);
+		string response = get(client, "GET /metrics HTTP/1.0\r\n\r\n");
+		CPPUNIT_ASSERT(response.find("HTTP/1.1 200 OK\r\n") == 0);
+		CPPUNIT_ASSERT(contains(response, "teleinfo_current_amperes{meter=\"0\",adco=\"026489026467\"} 5\n"));
+
+		TeleinfoMetrics small(conflator, 512);
+		CPPUNIT_ASSERT(!small.render());
+		CPPUNIT_ASSERT(small.getLength() <= 512);
+		CPPUNIT_ASSERT(small.listenUnix(path));
+		client = socket(AF_UNIX, SOCK_STREAM, 0);
+		CPPUNIT_ASSERT(connect(client, (struct sockaddr*) &address, sizeof(address)) == 0);
+		send(client, "GET /metrics HTTP/1.0\r\n\r\n", 25, 0);
+		CPPUNIT_ASSERT(small.poll(1000) == 1);
+		CPPUNIT_ASSERT(receive(client).find("HTTP/1.1 503 Service Unavailable\r\n") == 0);
+		small.close();
+		CPPUNIT_ASSERT(access(path, F_OK) != 0);
+	}
+
+private:
+	/**
+	 * Envoie une requête, la fait servir puis lit la réponse jusqu'à la fermeture de la connexion
+	 */
+	string get(int client, string request) {
+		CPPUNIT_ASSERT(send(client, request.c_str(), request.length(), 0) == (ssize_t) request.length());
+		CPPUNIT_ASSERT(metrics->poll(1000) == 1);
+		return receive(client);
+	}
+
+	/**
+	 * Lit une réponse jusqu'à la fermeture de la connexion
+	 */
+	string receive(int client) {
+		string response;
+		char data[4096];
+		ssize_t count;
+		while ((count = recv(client, data, sizeof(data), 0)) > 0) {
+			response.append(data, count);
+		}
+		close(client);
+		return response;
+	}
+
+	bool contains(string text, string part) {
+		return text.find(part) != string::npos;
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoMetricsTest);
+	CPPUNIT_TEST(testRendu);
+	CPPUNIT_TEST(testTriphase);
+	CPPUNIT_TEST(testNomsDecodeurs);
+	CPPUNIT_TEST(testTcp);
+	CPPUNIT_TEST(testClientLent);
+	CPPUNIT_TEST(testUnix);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoMetricsTest);
@@ -0,0 +1,203 @@
+/**
+ * Test unitaire de la reconstruction parallèle d'un historique
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoCapture.h"
+#include "TeleinfoRebuild.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+#define REBUILD_METERS      8
+#define REBUILD_FRAMES      2400    // Trames par capture
+#define REBUILD_PARTITION   100
+#define REBUILD_PERIOD      5000    // Une trame toutes les 5 secondes (ms)
+
+static const char* const ADCOS[] = { "026489026467", "200638824480", "031428097115" };
+
+class TeleinfoRebuildTest : public CppUnit::TestFixture {
+
+private:
+	char paths[2][64];
+	char progressPath[64];
+
+public:
+
+	void setUp() {
+		for (int i = 0; i < 2; i++) {
+			snprintf(paths[i], sizeof(paths[i]), "/tmp/teleinfo-rebuild-%d-%d.cap", (int) getpid(), i);
+			writeCapture(paths[i], i);
+		}
+		snprintf(progressPath, sizeof(progressPath), "/tmp/teleinfo-rebuild-%d.progress", (int) getpid());
+	}
+
+	void tearDown() {
+		for (int i = 0; i < 2; i++) {
+			unlink(paths[i]);
+		}
+		unlink(progressPath);
+		for (int generation = 1; generation <= 1000; generation++) {
+			char path[96];
+			snprintf(path, sizeof(path), "%s.rollup.%d", progressPath, generation);
+			unlink(path);
+		}
+	}
+
+	/**
+	 * Test de la reconstruction sur 4 threads : historique identique à celui des trames ajoutées une à une
+	 */
+	void testReconstruction() {
+		TeleinfoRegistry registry(REBUILD_METERS, 1);
+		TeleinfoRollup rollup(REBUILD_METERS);
+		TeleinfoRebuild rebuild(&registry, &rollup, REBUILD_PARTITION);
+		CPPUNIT_ASSERT(rebuild.addCapture(paths[0]));
+		CPPUNIT_ASSERT(rebuild.addCapture(paths[1]));
+		CPPUNIT_ASSERT(!rebuild.addCapture("/tmp/teleinfo-rebuild-inexistante"));
+		CPPUNIT_ASSERT(rebuild.rebuild(4));
+
+		// Compteurs numérotés dans l'ordre de leur première trame
+		CPPUNIT_ASSERT(registry.getMeterCount() == 3);
+		CPPUNIT_ASSERT(registry.find(TeleinfoRegistry::packAdco(ADCOS[0])) == 0);
+		CPPUNIT_ASSERT(registry.find(TeleinfoRegistry::packAdco(ADCOS[2])) == 2);
+
+		TeleinfoRebuildProgress progress;
+		rebuild.getProgress(&progress);
+		CPPUNIT_ASSERT(progress.partitions == 2 * REBUILD_FRAMES / REBUILD_PARTITION);
+		CPPUNIT_ASSERT(progress.donePartitions == progress.partitions);
+		CPPUNIT_ASSERT(progress.frames + progress.skippedFrames == 2 * REBUILD_FRAMES);
+		CPPUNIT_ASSERT(progress.skippedFrames == 2 * REBUILD_FRAMES / 50); // Trames sans ADCO
+
+		TeleinfoRollup reference(REBUILD_METERS);
+		buildReference(&registry, &reference);
+		assertSame(&reference, &rollup);
+	}
+
+	/**
+	 * Test d'une reconstruction interrompue puis reprise : chaque partition est cumulée une seule fois
+	 */
+	void testReprise() {
+		TeleinfoRebuildProgress progress;
+		{
+			TeleinfoRegistry registry(REBUILD_METERS, 1);
+			TeleinfoRollup rollup(REBUILD_METERS, TELEINFO_TIERS_ROLLUPS);
+			TeleinfoRebuild rebuild(&registry, &rollup, REBUILD_PARTITION);
+			CPPUNIT_ASSERT(rebuild.addCapture(paths[0]));
+			CPPUNIT_ASSERT(rebuild.addCapture(paths[1]));
+			rebuild.setProgressPath(progressPath, 0);
+			rebuild.setCallback(stopAfter, &rebuild);
+			CPPUNIT_ASSERT(!rebuild.rebuild(3));
+			rebuild.getProgress(&progress);
+			CPPUNIT_ASSERT(progress.donePartitions >= 10);
+			CPPUNIT_ASSERT(progress.donePartitions < progress.partitions);
+		}
+
+		TeleinfoRegistry registry(REBUILD_METERS, 1);
+		TeleinfoRollup rollup(REBUILD_METERS, TELEINFO_TIERS_ROLLUPS);
+		TeleinfoRebuild rebuild(&registry, &rollup, REBUILD_PARTITION);
+		CPPUNIT_ASSERT(rebuild.addCapture(paths[0]));
+		CPPUNIT_ASSERT(rebuild.addCapture(paths[1]));
+		rebuild.setProgressPath(progressPath, 0);
+		CPPUNIT_ASSERT(rebuild.rebuild(0));
+		TeleinfoRebuildProgress resumed;
+		rebuild.getProgress(&resumed);
+		CPPUNIT_ASSERT(resumed.donePartitions == resumed.partitions);
+		CPPUNIT_ASSERT(resumed.frames + resumed.skippedFrames == 2 * REBUILD_FRAMES - progress.donePartitions * REBUILD_PARTITION);
+
+		TeleinfoRollup reference(REBUILD_METERS, TELEINFO_TIERS_ROLLUPS);
+		buildReference(&registry, &reference);
+		assertSame(&reference, &rollup);
+
+		// Progression d'une autre archive : refusée
+		TeleinfoRegistry otherRegistry(REBUILD_METERS, 1);
+		TeleinfoRollup other(REBUILD_METERS, TELEINFO_TIERS_ROLLUPS);
+		TeleinfoRebuild otherRebuild(&otherRegistry, &other, REBUILD_PARTITION);
+		CPPUNIT_ASSERT(otherRebuild.addCapture(paths[0]));
+		otherRebuild.setProgressPath(progressPath, 0);
+		CPPUNIT_ASSERT(!otherRebuild.rebuild(2));
+	}
+
+private:
+	static void stopAfter(const TeleinfoRebuildProgress* progress, void* rebuild) {
+		if (progress->donePartitions == 10) {
+			((TeleinfoRebuild*) rebuild)->stop();
+		}
+	}
+
+	/**
+	 * Historique de référence : trames des captures ajoutées une à une, dans l'ordre
+	 */
+	void buildReference(TeleinfoRegistry* registry, TeleinfoRollup* reference) {
+		TeleinfoDecoder teleinfoDecoder;
+		for (int i = 0; i < 2; i++) {
+			TeleinfoCaptureReader reader;
+			CPPUNIT_ASSERT(reader.open(paths[i]));
+			for (uint64_t frame = 0; frame < reader.getFrameCount(); frame++) {
+				const TeleinfoCaptureEntry* entry = reader.getEntry(frame);
+				int meter = registry->find(entry->adco);
+				if (meter >= 0) {
+					CPPUNIT_ASSERT(reference->update(meter, reader.decodeFrame(frame, &teleinfoDecoder), entry->timestamp));
+				}
+			}
+		}
+	}
+
+	void assertSame(TeleinfoRollup* expected, TeleinfoRollup* actual) {
+		for (unsigned int meter = 0; meter < REBUILD_METERS; meter++) {
+			for (int tier = 0; tier < TELEINFO_TIERS; tier++) {
+				unsigned int expectedCount;
+				unsigned int actualCount;
+				const TeleinfoRollupRow* expectedRows = expected->getRows(meter, tier, &expectedCount);
+				const TeleinfoRollupRow* actualRows = actual->getRows(meter, tier, &actualCount);
+				CPPUNIT_ASSERT(expectedCount == actualCount);
+				CPPUNIT_ASSERT(expectedCount == 0 || memcmp(expectedRows, actualRows, expectedCount * sizeof(TeleinfoRollupRow)) == 0);
+			}
+		}
+	}
+
+	/**
+	 * Ecrit une capture : trois compteurs en Heures Creuses entrelacés (le troisième à partir de la seconde capture),
+	 * une trame sans ADCO toutes les 50 trames
+	 */
+	void writeCapture(const char* path, int capture) {
+		TeleinfoDecoder teleinfoDecoder;
+		TeleinfoCaptureWriter writer(&teleinfoDecoder);
+		CPPUNIT_ASSERT(writer.open(path, 4096));
+		for (int i = 0; i < REBUILD_FRAMES; i++) {
+			int frame = capture * REBUILD_FRAMES + i;
+			int meter = frame % (capture == 0 ? 2 : 3);
+			unsigned long hchc = 1000 + frame / 7;
+			unsigned long hchp = 5000 + frame / 3;
+			char value[16];
+			string stream = "\x02";
+			if (i % 50 != 49) {
+				stream += buildGroupe("ADCO", ADCOS[meter]);
+			}
+			stream += buildGroupe("OPTARIF", "HC..");
+			snprintf(value, sizeof(value), "%09lu", hchc + meter * 100000);
+			stream += buildGroupe("HCHC", value);
+			snprintf(value, sizeof(value), "%09lu", hchp + meter * 100000);
+			stream += buildGroupe("HCHP", value);
+			snprintf(value, sizeof(value), "%05d", 300 + (frame * 37) % 5000);
+			stream += buildGroupe("PTEC", frame % 500 < 150 ? "HC.." : "HP..") + buildGroupe("PAPP", value) + "\x03";
+			unsigned int consumed = 0;
+			Teleinfo* teleinfo = writer.capture((const unsigned char*) stream.data(), stream.length(), &consumed,
+					1500000000000ULL + (uint64_t) frame * REBUILD_PERIOD);
+			CPPUNIT_ASSERT(teleinfo != NULL);
+		}
+		CPPUNIT_ASSERT(writer.close());
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoRebuildTest);
+	CPPUNIT_TEST(testReconstruction);
+	CPPUNIT_TEST(testReprise);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoRebuildTest);
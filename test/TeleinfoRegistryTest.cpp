@@ -0,0 +1,131 @@
+/**
+ * Test unitaire du registre des compteurs
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoRegistry.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+class TeleinfoRegistryTest : public CppUnit::TestFixture {
+
+private:
+	TeleinfoDecoder* teleinfoDecoder;
+
+public:
+
+	void setUp() {
+		teleinfoDecoder = new TeleinfoDecoder();
+	}
+
+	/**
+	 * Test de l'identification des compteurs et de leur état
+	 */
+	void testRoutage() {
+		TeleinfoRegistry registry(10, 2);
+		int previous;
+		CPPUNIT_ASSERT(registry.route(0, decode("026489026467", 1000), 10, &previous) == 0);
+		CPPUNIT_ASSERT(previous == TELEINFO_REGISTRY_NONE);
+		CPPUNIT_ASSERT(registry.route(1, decode("200638824480", 5000), 11, &previous) == 1);
+		CPPUNIT_ASSERT(registry.route(0, decode("026489026467", 1012), 20, &previous) == 0);
+		CPPUNIT_ASSERT(previous == TELEINFO_REGISTRY_NONE);
+		CPPUNIT_ASSERT(registry.getMeterCount() == 2);
+
+		TeleinfoMeter* meter = registry.getMeter(0);
+		CPPUNIT_ASSERT(meter->adco == 26489026467ULL);
+		CPPUNIT_ASSERT(meter->totalOffset == 1000);
+		CPPUNIT_ASSERT(meter->totalIndex == 1012);
+		CPPUNIT_ASSERT(meter->lastSeen == 20);
+		CPPUNIT_ASSERT(meter->frames == 2);
+		CPPUNIT_ASSERT(meter->port == 0);
+		CPPUNIT_ASSERT(registry.getMeter(2) == NULL);
+		CPPUNIT_ASSERT(registry.getMeter(TELEINFO_REGISTRY_NONE) == NULL);
+
+		// ADCO invalide, port invalide
+		CPPUNIT_ASSERT(registry.route(0, decode("02648902646", 1000), 30, NULL) == TELEINFO_REGISTRY_NONE);
+		CPPUNIT_ASSERT(registry.route(2, decode("026489026467", 1000), 30, NULL) == TELEINFO_REGISTRY_NONE);
+		CPPUNIT_ASSERT(registry.getMeterCount() == 2);
+	}
+
+	/**
+	 * Test de la détection d'un changement de compteur sur un port
+	 */
+	void testChangementDeCompteur() {
+		TeleinfoRegistry registry(10, 2);
+		int previous;
+		registry.route(0, decode("026489026467", 1000), 0, &previous);
+		registry.route(1, decode("200638824480", 5000), 0, &previous);
+
+		// Câbles inversés
+		CPPUNIT_ASSERT(registry.route(0, decode("200638824480", 5001), 1, &previous) == 1);
+		CPPUNIT_ASSERT(previous == 0);
+		CPPUNIT_ASSERT(registry.route(1, decode("026489026467", 1001), 1, &previous) == 0);
+		CPPUNIT_ASSERT(previous == 1);
+		CPPUNIT_ASSERT(registry.getPortMeter(0) == 1);
+		CPPUNIT_ASSERT(registry.getPortChanges(0) == 1);
+		CPPUNIT_ASSERT(registry.getPortChanges(1) == 1);
+		CPPUNIT_ASSERT(registry.getMeter(1)->port == 0);
+		CPPUNIT_ASSERT(registry.getPortMeter(2) == TELEINFO_REGISTRY_NONE);
+
+		registry.clear();
+		CPPUNIT_ASSERT(registry.getMeterCount() == 0);
+		CPPUNIT_ASSERT(registry.getPortMeter(0) == TELEINFO_REGISTRY_NONE);
+		CPPUNIT_ASSERT(registry.find(26489026467ULL) == TELEINFO_REGISTRY_NONE);
+	}
+
+	/**
+	 * Test de la table sur un grand nombre de compteurs, jusqu'à saturation
+	 */
+	void testCapacite() {
+		TeleinfoRegistry registry(100000, 1);
+		for (uint64_t i = 0; i < 100000; i++) {
+			CPPUNIT_ASSERT(registry.add(10000000000ULL + i * 7919) == (int) i);
+		}
+		CPPUNIT_ASSERT(registry.add(999999999999ULL) == TELEINFO_REGISTRY_NONE);
+		for (uint64_t i = 0; i < 100000; i++) {
+			CPPUNIT_ASSERT(registry.find(10000000000ULL + i * 7919) == (int) i);
+		}
+		CPPUNIT_ASSERT(registry.add(10000000000ULL) == 0);
+		CPPUNIT_ASSERT(registry.find(999999999999ULL) == TELEINFO_REGISTRY_NONE);
+		CPPUNIT_ASSERT(registry.add(0) == TELEINFO_REGISTRY_NONE);
+		CPPUNIT_ASSERT(registry.getCapacity() == 100000);
+	}
+
+	/**
+	 * Test du codage des adresses
+	 */
+	void testPackAdco() {
+		CPPUNIT_ASSERT(TeleinfoRegistry::packAdco("026489026467") == 26489026467ULL);
+		CPPUNIT_ASSERT(TeleinfoRegistry::packAdco("999999999999") == 999999999999ULL);
+		CPPUNIT_ASSERT(TeleinfoRegistry::packAdco("02648902646") == 0);
+		CPPUNIT_ASSERT(TeleinfoRegistry::packAdco("0264890264670") == 0);
+		CPPUNIT_ASSERT(TeleinfoRegistry::packAdco("02648902646A") == 0);
+		CPPUNIT_ASSERT(TeleinfoRegistry::packAdco("") == 0);
+		CPPUNIT_ASSERT(TeleinfoRegistry::packAdco(NULL) == 0);
+	}
+
+private:
+	/**
+	 * Décode une trame en option BASE
+	 */
+	Teleinfo* decode(string adco, unsigned long base) {
+		char value[16];
+		snprintf(value, sizeof(value), "%09lu", base);
+		string frame = "\x02" + buildGroupe("ADCO", adco) + buildGroupe("BASE", value) + "\x03";
+		return decodeText(teleinfoDecoder, frame);
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoRegistryTest);
+	CPPUNIT_TEST(testRoutage);
+	CPPUNIT_TEST(testChangementDeCompteur);
+	CPPUNIT_TEST(testCapacite);
+	CPPUNIT_TEST(testPackAdco);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoRegistryTest);
@@ -0,0 +1,221 @@
+/**
+ * Test unitaire du tampon circulaire d'octets Téléinfo
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoRing.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+#define STRESS_BYTES    2000000
+#define STRESS_FRAMES   3000
+
+class TeleinfoRingTest : public CppUnit::TestFixture {
+
+public:
+
+	/**
+	 * Test de l'ajout et du retrait d'octets, y compris au passage de la fin physique du tampon
+	 */
+	void testPushPop() {
+		TeleinfoRing* ring = new TeleinfoRing();
+		unsigned char data[TELEINFO_RING_SIZE];
+		CPPUNIT_ASSERT(ring->available() == 0);
+		CPPUNIT_ASSERT(ring->pop(data, sizeof(data)) == 0);
+
+		for (int turn = 0; turn < 5; turn++) {
+			for (int i = 0; i < 100; i++) {
+				CPPUNIT_ASSERT(ring->push(turn + i));
+			}
+			CPPUNIT_ASSERT(ring->push(-1)); // Ignoré
+			CPPUNIT_ASSERT(ring->available() == 100);
+			CPPUNIT_ASSERT(ring->pop(data, 30) == 30);
+			CPPUNIT_ASSERT(ring->pop(data + 30, sizeof(data)) == 70);
+			for (int i = 0; i < 100; i++) {
+				CPPUNIT_ASSERT(data[i] == turn + i);
+			}
+		}
+		CPPUNIT_ASSERT(ring->getOverflows() == 0);
+	}
+
+	/**
+	 * Test du tampon plein : les octets en trop sont comptés et ignorés, les autres sont intacts
+	 */
+	void testOverflow() {
+		TeleinfoRing* ring = new TeleinfoRing();
+		unsigned char data[TELEINFO_RING_SIZE];
+		for (int i = 0; i < TELEINFO_RING_SIZE; i++) {
+			CPPUNIT_ASSERT(ring->push(i & 0xFF));
+		}
+		CPPUNIT_ASSERT(!ring->push('X'));
+		CPPUNIT_ASSERT(!ring->push('Y'));
+		CPPUNIT_ASSERT(ring->getOverflows() == 2);
+		CPPUNIT_ASSERT(ring->available() == TELEINFO_RING_SIZE);
+		CPPUNIT_ASSERT(ring->pop(data, sizeof(data)) == TELEINFO_RING_SIZE);
+		for (int i = 0; i < TELEINFO_RING_SIZE; i++) {
+			CPPUNIT_ASSERT(data[i] == (i & 0xFF));
+		}
+		CPPUNIT_ASSERT(ring->push('Z'));
+	}
+
+	/**
+	 * Test du décodage par lots : une trame à cheval sur la fin physique du tampon, deux trames dans un même lot
+	 */
+	void testDrain() {
+		TeleinfoRing* ring = new TeleinfoRing();
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		unsigned char data[TELEINFO_RING_SIZE];
+
+		// Décalage des positions pour que la première trame passe la fin physique du tampon
+		for (int i = 0; i < TELEINFO_RING_SIZE - 20; i++) {
+			ring->push('-');
+		}
+		ring->pop(data, sizeof(data));
+
+		pushText(ring, buildTrame("026489026467", "000056990") + buildTrame("200638824480", "000059000"));
+		Teleinfo* teleinfo = ring->drain(teleinfoDecoder);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getAdco(), "026489026467") == 0);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 56990);
+		teleinfo = ring->drain(teleinfoDecoder);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(strcmp(teleinfo->getAdco(), "200638824480") == 0);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 59000);
+		CPPUNIT_ASSERT(ring->drain(teleinfoDecoder) == NULL);
+		CPPUNIT_ASSERT(ring->available() == 0);
+
+		// Trame reçue en plusieurs fois
+		string trame = buildTrame("026489026467", "000061000");
+		pushText(ring, trame.substr(0, 15));
+		CPPUNIT_ASSERT(ring->drain(teleinfoDecoder) == NULL);
+		pushText(ring, trame.substr(15));
+		teleinfo = ring->drain(teleinfoDecoder);
+		CPPUNIT_ASSERT(teleinfo != NULL);
+		CPPUNIT_ASSERT(teleinfo->getBase() == 61000);
+	}
+
+	/**
+	 * Test de charge : un thread producteur à débit variable, aucun octet ne doit être perdu ni réordonné
+	 */
+	void testStressOrdre() {
+		TeleinfoRing* ring = new TeleinfoRing();
+		thread producer([ring]() {
+			for (unsigned int i = 0; i < STRESS_BYTES; i++) {
+				while (!ring->push(sequence(i))) {
+					this_thread::yield(); // Tampon plein : le producteur de test attend au lieu de perdre l'octet
+				}
+				pace(i);
+			}
+		});
+
+		unsigned char data[64];
+		unsigned int expected = 0;
+		bool ordered = true;
+		while (expected < STRESS_BYTES) {
+			unsigned int length = ring->pop(data, 1 + expected % sizeof(data));
+			for (unsigned int i = 0; i < length; i++) {
+				ordered = ordered && data[i] == sequence(expected++);
+			}
+			if (length == 0) {
+				this_thread::yield();
+			}
+		}
+		producer.join();
+
+		CPPUNIT_ASSERT(ordered);
+		CPPUNIT_ASSERT(expected == STRESS_BYTES);
+		CPPUNIT_ASSERT(ring->available() == 0);
+	}
+
+	/**
+	 * Test de charge : un flux de trames produit par un thread et décodé par lots, toutes les trames sont retrouvées
+	 */
+	void testStressDecodage() {
+		TeleinfoRing* ring = new TeleinfoRing();
+		TeleinfoDecoder* teleinfoDecoder = new TeleinfoDecoder();
+		string stream;
+		for (int i = 0; i < STRESS_FRAMES; i++) {
+			char base[16];
+			snprintf(base, sizeof(base), "%09d", i);
+			stream += buildTrame("026489026467", base);
+		}
+
+		thread producer([ring, &stream]() {
+			for (unsigned int i = 0; i < stream.length(); i++) {
+				while (!ring->push((unsigned char) stream[i])) {
+					this_thread::yield();
+				}
+				pace(i);
+			}
+		});
+
+		int frames = 0;
+		bool ordered = true;
+		while (frames < STRESS_FRAMES) {
+			Teleinfo* teleinfo = ring->drain(teleinfoDecoder);
+			if (teleinfo != NULL) {
+				ordered = ordered && teleinfo->getBase() == (unsigned long) frames;
+				frames++;
+			} else {
+				this_thread::yield();
+			}
+		}
+		producer.join();
+
+		CPPUNIT_ASSERT(ordered);
+		CPPUNIT_ASSERT(ring->available() == 0);
+	}
+
+private:
+	/**
+	 * Octet attendu à la position i du test de charge
+	 */
+	static unsigned char sequence(unsigned int i) {
+		return (unsigned char) ((i * 7) ^ (i >> 8));
+	}
+
+	/**
+	 * Fait varier le débit du producteur : rafales, pauses courtes et pauses longues
+	 */
+	static void pace(unsigned int i) {
+		if (i % 50000 == 0) {
+			this_thread::sleep_for(chrono::milliseconds(2));
+		} else if (i % 997 == 0) {
+			this_thread::yield();
+		}
+	}
+
+	/**
+	 * Ajoute une chaîne de caractères au tampon
+	 */
+	void pushText(TeleinfoRing* ring, string text) {
+		for (unsigned int i = 0; i < text.length(); i++) {
+			CPPUNIT_ASSERT(ring->push((unsigned char) text[i]));
+		}
+	}
+
+	/**
+	 * Construit une trame avec les groupes ADCO et BASE
+	 */
+	string buildTrame(string adco, string base) {
+		return "\x02" + buildGroupe("ADCO", adco) + buildGroupe("BASE", base) + "\x03";
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoRingTest);
+	CPPUNIT_TEST(testPushPop);
+	CPPUNIT_TEST(testOverflow);
+	CPPUNIT_TEST(testDrain);
+	CPPUNIT_TEST(testStressOrdre);
+	CPPUNIT_TEST(testStressDecodage);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoRingTest);
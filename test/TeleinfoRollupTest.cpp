@@ -0,0 +1,221 @@
+/**
+ * Test unitaire de l'historique par niveaux de cumul
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoRollup.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+#define MINUTE   60000ULL
+#define HOUR     3600000ULL
+#define DAY      86400000ULL
+
+class TeleinfoRollupTest : public CppUnit::TestFixture {
+
+private:
+	TeleinfoDecoder* teleinfoDecoder;
+
+public:
+
+	void setUp() {
+		teleinfoDecoder = new TeleinfoDecoder();
+	}
+
+	void tearDown() {
+		delete teleinfoDecoder;
+	}
+
+	/**
+	 * Test des lignes de chaque niveau : une trame toutes les 20 secondes pendant 2 jours
+	 */
+	void testNiveaux() {
+		TeleinfoRollup rollup(2);
+		fill(&rollup, 1, 2 * DAY, 20000);
+		unsigned int count;
+		CPPUNIT_ASSERT(rollup.getRows(1, TELEINFO_TIER_FRAME, &count) != NULL);
+		CPPUNIT_ASSERT(count == 2 * 24 * 180);
+		CPPUNIT_ASSERT(rollup.getRows(1, TELEINFO_TIER_1MIN, &count) != NULL);
+		CPPUNIT_ASSERT(count == 2 * 24 * 60);
+		CPPUNIT_ASSERT(rollup.getRows(1, TELEINFO_TIER_1H, &count) != NULL);
+		CPPUNIT_ASSERT(count == 2 * 24);
+		const TeleinfoRollupRow* days = rollup.getRows(1, TELEINFO_TIER_1DAY, &count);
+		CPPUNIT_ASSERT(count == 2);
+		CPPUNIT_ASSERT(days[1].start == DAY);
+		CPPUNIT_ASSERT(days[1].count == 24 * 180);
+		CPPUNIT_ASSERT(rollup.getRows(0, TELEINFO_TIER_1DAY, &count) == NULL);
+		CPPUNIT_ASSERT(count == 0);
+		CPPUNIT_ASSERT(rollup.getRows(2, TELEINFO_TIER_1DAY, &count) == NULL);
+
+		// Energie par index : heures creuses la nuit (de 0 h à 6 h), 1 Wh par trame sur l'index de la période
+		CPPUNIT_ASSERT(days[1].energy[TELEINFO_PERIOD_HC] == 6 * 180);
+		CPPUNIT_ASSERT(days[1].energy[TELEINFO_PERIOD_HP] == 18 * 180);
+		CPPUNIT_ASSERT(days[0].energy[TELEINFO_PERIOD_HC] + days[0].energy[TELEINFO_PERIOD_HP] == 24 * 180 - 1);
+		CPPUNIT_ASSERT(days[1].energy[TELEINFO_PERIOD_TH] == 0);
+
+		// Niveaux non tenus
+		TeleinfoRollup rollups(1, TELEINFO_TIERS_ROLLUPS);
+		fill(&rollups, 0, HOUR, 20000);
+		CPPUNIT_ASSERT(rollups.getRows(0, TELEINFO_TIER_FRAME, &count) == NULL);
+		CPPUNIT_ASSERT(rollups.getRows(0, TELEINFO_TIER_1MIN, &count) != NULL);
+		CPPUNIT_ASSERT(count == 60);
+	}
+
+	/**
+	 * Test du choix du niveau et des valeurs d'une requête
+	 */
+	void testRequete() {
+		TeleinfoRollup rollup(1);
+		fill(&rollup, 0, 2 * DAY, 20000);
+		TeleinfoRollupRow results[500];
+
+		// Courbe à 10 minutes : niveau 1 minute
+		int count = rollup.query(0, DAY, 2 * DAY, 10 * MINUTE, results, 500);
+		CPPUNIT_ASSERT(count == 144);
+		CPPUNIT_ASSERT(rollup.getLastTier() == TELEINFO_TIER_1MIN);
+		CPPUNIT_ASSERT(rollup.getLastScanned() == 1440);
+		CPPUNIT_ASSERT(results[0].start == DAY);
+		CPPUNIT_ASSERT(results[143].start == 2 * DAY - 10 * MINUTE);
+		CPPUNIT_ASSERT(results[0].count == 30);
+		// Puissance de 1000 W, 1460 W ou 1920 W selon la seconde de la minute (0, 20, 40)
+		CPPUNIT_ASSERT(results[0].powerMin == 1000);
+		CPPUNIT_ASSERT(results[0].powerMax == 1920);
+		CPPUNIT_ASSERT(results[0].powerSum / results[0].count == 1460);
+
+		// Energie journalière : niveau 1 jour
+		CPPUNIT_ASSERT(rollup.query(0, 0, 2 * DAY, DAY, results, 500) == 2);
+		CPPUNIT_ASSERT(rollup.getLastTier() == TELEINFO_TIER_1DAY);
+		CPPUNIT_ASSERT(rollup.getLastScanned() == 2);
+		CPPUNIT_ASSERT(results[1].energy[TELEINFO_PERIOD_HC] == 6 * 180);
+
+		// Bornes non alignées sur la minute : niveau des trames
+		CPPUNIT_ASSERT(rollup.query(0, DAY + 30000, DAY + 10 * MINUTE, 10 * MINUTE, results, 500) == 1);
+		CPPUNIT_ASSERT(rollup.getLastTier() == TELEINFO_TIER_FRAME);
+		CPPUNIT_ASSERT(rollup.getLastScanned() == 28);
+		CPPUNIT_ASSERT(results[0].start == DAY);
+		CPPUNIT_ASSERT(results[0].count == 28);
+
+		// Résultat plus long que le tableau : la suite est obtenue par une nouvelle requête
+		CPPUNIT_ASSERT(rollup.query(0, 0, 2 * DAY, HOUR, results, 10) == 10);
+		CPPUNIT_ASSERT(rollup.getLastTier() == TELEINFO_TIER_1H);
+		CPPUNIT_ASSERT(rollup.query(0, results[9].start + HOUR, 2 * DAY, HOUR, results, 500) == 38);
+
+		// Aucun niveau ne convient, requêtes invalides
+		TeleinfoRollup rollups(1, TELEINFO_TIERS_ROLLUPS);
+		fill(&rollups, 0, HOUR, 20000);
+		CPPUNIT_ASSERT(rollups.query(0, 0, HOUR, 30000, results, 500) == -1);
+		CPPUNIT_ASSERT(rollups.query(0, 0, HOUR, 5 * MINUTE, results, 500) == 12);
+		CPPUNIT_ASSERT(rollups.query(1, 0, HOUR, MINUTE, results, 500) == -1);
+		CPPUNIT_ASSERT(rollups.query(0, 0, HOUR, 0, results, 500) == -1);
+		CPPUNIT_ASSERT(rollups.query(0, 2 * HOUR, 3 * HOUR, MINUTE, results, 500) == 0);
+	}
+
+	/**
+	 * Test du cumul de deux lignes, dans n'importe quel ordre
+	 */
+	void testCumul() {
+		TeleinfoRollup rollup(1);
+		fill(&rollup, 0, 2 * HOUR, 20000);
+		unsigned int count;
+		const TeleinfoRollupRow* hours = rollup.getRows(0, TELEINFO_TIER_1H, &count);
+		const TeleinfoRollupRow* minutes = rollup.getRows(0, TELEINFO_TIER_1MIN, &count);
+		TeleinfoRollupRow row;
+		memset(&row, 0, sizeof(row));
+		for (int i = 119; i >= 60; i--) {
+			TeleinfoRollup::merge(&row, &minutes[i]);
+		}
+		CPPUNIT_ASSERT(memcmp(&row, &hours[1], sizeof(row)) == 0);
+	}
+
+	/**
+	 * Test de l'enregistrement et de la relecture de l'historique
+	 */
+	void testEnregistrement() {
+		char path[64];
+		snprintf(path, sizeof(path), "/tmp/teleinfo-rollup-%d.dat", (int) getpid());
+		TeleinfoRollup rollup(2);
+		fill(&rollup, 1, 3 * HOUR, 20000);
+		CPPUNIT_ASSERT(rollup.save(path));
+
+		TeleinfoRollup loaded(2);
+		CPPUNIT_ASSERT(loaded.load(path));
+		for (int tier = 0; tier < TELEINFO_TIERS; tier++) {
+			unsigned int expected;
+			unsigned int count;
+			const TeleinfoRollupRow* rows = rollup.getRows(1, tier, &expected);
+			const TeleinfoRollupRow* loadedRows = loaded.getRows(1, tier, &count);
+			CPPUNIT_ASSERT(count == expected);
+			CPPUNIT_ASSERT(memcmp(rows, loadedRows, count * sizeof(TeleinfoRollupRow)) == 0);
+		}
+
+		// L'historique relu se poursuit : l'énergie de la trame suivante part du dernier index relu
+		CPPUNIT_ASSERT(loaded.update(1, decodeHc(1000 + 3 * 180 - 1 + 5, 2000, "HC..", 1000), 3 * HOUR));
+		unsigned int count;
+		const TeleinfoRollupRow* hours = loaded.getRows(1, TELEINFO_TIER_1H, &count);
+		CPPUNIT_ASSERT(count == 4);
+		CPPUNIT_ASSERT(hours[3].energy[TELEINFO_PERIOD_HC] == 5);
+
+		// Historique différent : refusé, inchangé
+		TeleinfoRollup other(3);
+		CPPUNIT_ASSERT(!other.load(path));
+		TeleinfoRollup rollups(2, TELEINFO_TIERS_ROLLUPS);
+		CPPUNIT_ASSERT(!rollups.load(path));
+		CPPUNIT_ASSERT(!loaded.load("/tmp/teleinfo-rollup-absent.dat"));
+		CPPUNIT_ASSERT(loaded.getRows(1, TELEINFO_TIER_1H, &count) != NULL);
+		CPPUNIT_ASSERT(count == 4);
+		unlink(path);
+	}
+
+private:
+	/**
+	 * Ajoute une trame par période jusqu'à la date de fin : 1 Wh par trame, en heures creuses de 0 h à 6 h,
+	 * puissance de 1000 W augmentée de 23 W par seconde de la minute
+	 */
+	void fill(TeleinfoRollup* rollup, unsigned int meter, uint64_t end, uint64_t period) {
+		unsigned long hchc = 1000;
+		unsigned long hchp = 2000;
+		for (uint64_t timestamp = 0; timestamp < end; timestamp += period) {
+			bool heuresCreuses = (timestamp % DAY) < 6 * HOUR;
+			if (timestamp > 0) {
+				if (heuresCreuses) {
+					hchc++;
+				} else {
+					hchp++;
+				}
+			}
+			int papp = 1000 + (int) (timestamp % MINUTE / 1000) * 23;
+			CPPUNIT_ASSERT(rollup->update(meter, decodeHc(hchc, hchp, heuresCreuses ? "HC.." : "HP..", papp), timestamp));
+		}
+	}
+
+	/**
+	 * Décode une trame en option Heures Creuses
+	 */
+	Teleinfo* decodeHc(unsigned long hchc, unsigned long hchp, string ptec, int papp) {
+		char value[16];
+		string frame = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "HC..");
+		snprintf(value, sizeof(value), "%09lu", hchc);
+		frame += buildGroupe("HCHC", value);
+		snprintf(value, sizeof(value), "%09lu", hchp);
+		frame += buildGroupe("HCHP", value);
+		snprintf(value, sizeof(value), "%05d", papp);
+		frame += buildGroupe("PTEC", ptec) + buildGroupe("PAPP", value) + "\x03";
+		return decodeText(teleinfoDecoder, frame);
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoRollupTest);
+	CPPUNIT_TEST(testNiveaux);
+	CPPUNIT_TEST(testRequete);
+	CPPUNIT_TEST(testCumul);
+	CPPUNIT_TEST(testEnregistrement);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoRollupTest);
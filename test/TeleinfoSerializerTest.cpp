@@ -0,0 +1,154 @@
+/**
+ * Test unitaire de la sérialisation des trames
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoSerializer.h"
+#include "TeleinfoSnapshot.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+class TeleinfoSerializerTest : public CppUnit::TestFixture {
+
+private:
+	TeleinfoDecoder* teleinfoDecoder;
+	char buffer[4096];
+
+public:
+
+	void setUp() {
+		teleinfoDecoder = new TeleinfoDecoder();
+	}
+
+	/**
+	 * Test du format InfluxDB line protocol
+	 */
+	void testLineProtocol() {
+		TeleinfoSerializer serializer(buffer, sizeof(buffer), TELEINFO_FORMAT_LINE);
+		CPPUNIT_ASSERT(serializer.append(decode(), 1700000000000ULL));
+		CPPUNIT_ASSERT(serializer.appendHeader());
+		CPPUNIT_ASSERT(text(&serializer) == "teleinfo,ADCO=026489026467 OPTARIF=\"BASE\",BASE=1000i,PTEC=\"TH..\",IINST=5i,PAPP=1150i,HHPHC=\"A\" 1700000000000\n");
+		CPPUNIT_ASSERT(serializer.getFrames() == 1);
+
+		// Trame sans autre champ que l'adresse
+		string frame = "\x02" + buildGroupe("ADCO", "026489026467") + "\x03";
+		CPPUNIT_ASSERT(serializer.append(decodeText(teleinfoDecoder, frame), 0));
+		CPPUNIT_ASSERT(serializer.getFrames() == 1);
+	}
+
+	/**
+	 * Test du format CSV : tous les champs, vides s'ils sont absents
+	 */
+	void testCsv() {
+		TeleinfoSerializer serializer(buffer, sizeof(buffer), TELEINFO_FORMAT_CSV);
+		CPPUNIT_ASSERT(serializer.appendHeader());
+		CPPUNIT_ASSERT(serializer.append(decode(), 42));
+		CPPUNIT_ASSERT(text(&serializer) ==
+				"timestamp,ADCO,OPTARIF,ISOUSC,BASE,HCHC,HCHP,EJPHN,EJPHPM,BBRHCJB,BBRHPJB,BBRHCJW,BBRHPJW,BBRHCJR,BBRHPJR,PEJP,PTEC,DEMAIN,IINST,ADPS,IMAX,PAPP,HHPHC,MOTDETAT,"
+				"IINST1,IINST2,IINST3,IMAX1,IMAX2,IMAX3,PMAX,PPOT,ADIR1,ADIR2,ADIR3\n"
+				"42,026489026467,BASE,,1000,,,,,,,,,,,,TH..,,5,,,1150,A,,,,,,,,,,,,\n");
+	}
+
+	/**
+	 * Test du format JSON, avec échappement
+	 */
+	void testJson() {
+		TeleinfoSerializer serializer(buffer, sizeof(buffer), TELEINFO_FORMAT_JSON);
+		CPPUNIT_ASSERT(serializer.append(decode(), 7));
+		string frame = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("PTEC", "H\"\\.") + "\x03";
+		CPPUNIT_ASSERT(serializer.append(decodeText(teleinfoDecoder, frame), 8));
+		CPPUNIT_ASSERT(text(&serializer) ==
+				"{\"timestamp\":7,\"ADCO\":\"026489026467\",\"OPTARIF\":\"BASE\",\"BASE\":1000,\"PTEC\":\"TH..\",\"IINST\":5,\"PAPP\":1150,\"HHPHC\":\"A\"}\n"
+				"{\"timestamp\":8,\"ADCO\":\"026489026467\",\"PTEC\":\"H\\\"\\\\.\"}\n");
+	}
+
+	/**
+	 * Test d'une trame de compteur triphasé : ses étiquettes sont écrites, et une copie (TeleinfoSnapshot) donne la même ligne
+	 */
+	void testTriphase() {
+		string frame = "\x02" + buildGroupe("ADCO", "031428097115") + buildGroupe("BASE", "006157184") + buildGroupe("IINST1", "001")
+				+ buildGroupe("IINST2", "012") + buildGroupe("IINST3", "003") + buildGroupe("IMAX1", "029") + buildGroupe("IMAX2", "030")
+				+ buildGroupe("IMAX3", "027") + buildGroupe("PMAX", "09680") + buildGroupe("PPOT", "00") + buildGroupe("ADIR2", "032") + "\x03";
+		Teleinfo* teleinfo = decodeText(teleinfoDecoder, frame);
+		TeleinfoSerializer serializer(buffer, sizeof(buffer), TELEINFO_FORMAT_LINE);
+		CPPUNIT_ASSERT(serializer.append(teleinfo, 1));
+		string line = "teleinfo,ADCO=031428097115 BASE=6157184i,IINST1=1i,IINST2=12i,IINST3=3i,IMAX1=29i,IMAX2=30i,IMAX3=27i,"
+				"PMAX=9680i,PPOT=\"00\",ADIR2=32i 1\n";
+		CPPUNIT_ASSERT(text(&serializer) == line);
+
+		TeleinfoSnapshot snapshot;
+		snapshot.copy(teleinfo);
+		CPPUNIT_ASSERT(snapshot.getIinstPhase(2) == 12);
+		CPPUNIT_ASSERT(snapshot.getAdirPhase(2) == 32);
+		CPPUNIT_ASSERT(snapshot.getPmax() == 9680);
+		serializer.clear();
+		CPPUNIT_ASSERT(serializer.append(&snapshot, 1));
+		CPPUNIT_ASSERT(text(&serializer) == line);
+
+		TeleinfoSnapshot empty;
+		unsigned long long threePhase = TELEINFO_FIELD_IINST1 | TELEINFO_FIELD_IINST2 | TELEINFO_FIELD_IINST3 | TELEINFO_FIELD_IMAX1
+				| TELEINFO_FIELD_IMAX2 | TELEINFO_FIELD_IMAX3 | TELEINFO_FIELD_PMAX | TELEINFO_FIELD_PPOT | TELEINFO_FIELD_ADIR2;
+		CPPUNIT_ASSERT(snapshot.compare(&empty) == (TELEINFO_FIELD_ADCO | TELEINFO_FIELD_BASE | threePhase));
+	}
+
+	/**
+	 * Test du remplissage d'un lot
+	 */
+	void testLot() {
+		TeleinfoSerializer serializer(buffer, 2048, TELEINFO_FORMAT_JSON);
+		Teleinfo* teleinfo = decode();
+		unsigned int frames = 0;
+		while (serializer.append(teleinfo, frames)) {
+			frames++;
+		}
+		CPPUNIT_ASSERT(frames == serializer.getFrames());
+		CPPUNIT_ASSERT(serializer.getLength() > 1024);
+		CPPUNIT_ASSERT(serializer.getLength() <= 2048);
+		serializer.clear();
+		CPPUNIT_ASSERT(serializer.getLength() == 0);
+		CPPUNIT_ASSERT(serializer.append(teleinfo, 0));
+	}
+
+	/**
+	 * Test de l'écriture des entiers
+	 */
+	void testEntiers() {
+		uint64_t values[] = { 0, 9, 10, 99, 100, 12345, 1000000000ULL, UINT64_MAX };
+		for (unsigned int i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+			char expected[32];
+			snprintf(expected, sizeof(expected), "%llu", (unsigned long long) values[i]);
+			unsigned int length = TeleinfoSerializer::formatUnsigned(buffer, values[i]);
+			CPPUNIT_ASSERT(string(buffer, length) == expected);
+		}
+	}
+
+private:
+	string text(TeleinfoSerializer* serializer) {
+		return string(serializer->getBuffer(), serializer->getLength());
+	}
+
+	/**
+	 * Décode une trame en option BASE
+	 */
+	Teleinfo* decode() {
+		return decodeText(teleinfoDecoder, "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "BASE") + buildGroupe("BASE", "000001000")
+				+ buildGroupe("PTEC", "TH..") + buildGroupe("IINST", "005") + buildGroupe("PAPP", "01150") + buildGroupe("HHPHC", "A") + "\x03");
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoSerializerTest);
+	CPPUNIT_TEST(testLineProtocol);
+	CPPUNIT_TEST(testCsv);
+	CPPUNIT_TEST(testJson);
+	CPPUNIT_TEST(testTriphase);
+	CPPUNIT_TEST(testLot);
+	CPPUNIT_TEST(testEntiers);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoSerializerTest);
@@ -0,0 +1,120 @@
+/**
+ * Test unitaire de la répartition des compteurs par hachage cohérent
+ * @author LK
+ */
+
+#include "TeleinfoShard.h"
+#include <cppunit/extensions/HelperMacros.h>
+
+#define METERS   10000
+
+class TeleinfoShardTest : public CppUnit::TestFixture {
+
+private:
+	int owners[METERS];
+
+	/**
+	 * Adresse du compteur n : adresses voisines, comme celles d'un même lot de compteurs
+	 */
+	static uint64_t adco(unsigned int meter) {
+		return 26489026467ULL + meter;
+	}
+
+	void assign(TeleinfoShard* shard) {
+		for (unsigned int meter = 0; meter < METERS; meter++) {
+			owners[meter] = shard->getOwner(adco(meter));
+		}
+	}
+
+public:
+
+	/**
+	 * Test de la répartition : tous les processus reçoivent une part proche de 1/K, quel que soit l'ordre d'ajout
+	 */
+	void testRepartition() {
+		TeleinfoShard shard;
+		CPPUNIT_ASSERT(shard.getOwner(adco(0)) == TELEINFO_SHARD_NONE);
+		for (int worker = 0; worker < 4; worker++) {
+			CPPUNIT_ASSERT(shard.addWorker(worker));
+		}
+		CPPUNIT_ASSERT(!shard.addWorker(2));
+		CPPUNIT_ASSERT(!shard.addWorker(TELEINFO_SHARD_WORKERS));
+		CPPUNIT_ASSERT(!shard.addWorker(-1));
+		CPPUNIT_ASSERT(shard.getWorkerCount() == 4);
+
+		assign(&shard);
+		unsigned int counts[4] = { 0, 0, 0, 0 };
+		for (unsigned int meter = 0; meter < METERS; meter++) {
+			CPPUNIT_ASSERT(owners[meter] >= 0 && owners[meter] < 4);
+			counts[owners[meter]]++;
+		}
+		for (int worker = 0; worker < 4; worker++) {
+			CPPUNIT_ASSERT(counts[worker] > METERS / 4 * 3 / 4);
+			CPPUNIT_ASSERT(counts[worker] < METERS / 4 * 5 / 4);
+		}
+
+		TeleinfoShard reversed;
+		for (int worker = 3; worker >= 0; worker--) {
+			reversed.addWorker(worker);
+		}
+		for (unsigned int meter = 0; meter < METERS; meter++) {
+			CPPUNIT_ASSERT(reversed.getOwner(adco(meter)) == owners[meter]);
+		}
+	}
+
+	/**
+	 * Test de l'ajout d'un processus : seuls les compteurs repris par le nouveau processus changent de propriétaire
+	 */
+	void testAjout() {
+		TeleinfoShard shard;
+		for (int worker = 0; worker < 4; worker++) {
+			shard.addWorker(worker);
+		}
+		assign(&shard);
+		shard.addWorker(4);
+		unsigned int moved = 0;
+		for (unsigned int meter = 0; meter < METERS; meter++) {
+			int owner = shard.getOwner(adco(meter));
+			if (owner != owners[meter]) {
+				CPPUNIT_ASSERT(owner == 4);
+				moved++;
+			}
+		}
+		CPPUNIT_ASSERT(moved > METERS / 5 * 3 / 4);
+		CPPUNIT_ASSERT(moved < METERS / 5 * 5 / 4);
+	}
+
+	/**
+	 * Test du retrait d'un processus : seuls ses compteurs changent de propriétaire, l'anneau revient à son état initial
+	 */
+	void testRetrait() {
+		TeleinfoShard shard;
+		for (int worker = 0; worker < 5; worker++) {
+			shard.addWorker(worker);
+		}
+		assign(&shard);
+		CPPUNIT_ASSERT(shard.removeWorker(1));
+		CPPUNIT_ASSERT(!shard.removeWorker(1));
+		CPPUNIT_ASSERT(!shard.hasWorker(1));
+		CPPUNIT_ASSERT(shard.getWorkerCount() == 4);
+		for (unsigned int meter = 0; meter < METERS; meter++) {
+			int owner = shard.getOwner(adco(meter));
+			CPPUNIT_ASSERT(owner != 1);
+			if (owners[meter] != 1) {
+				CPPUNIT_ASSERT(owner == owners[meter]);
+			}
+		}
+		shard.addWorker(1);
+		for (unsigned int meter = 0; meter < METERS; meter++) {
+			CPPUNIT_ASSERT(shard.getOwner(adco(meter)) == owners[meter]);
+		}
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoShardTest);
+	CPPUNIT_TEST(testRepartition);
+	CPPUNIT_TEST(testAjout);
+	CPPUNIT_TEST(testRetrait);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoShardTest);
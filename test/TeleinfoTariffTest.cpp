@@ -0,0 +1,203 @@
+/**
+ * Test unitaire de la comptabilité de l'énergie par période tarifaire
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoTariff.h"
+#include "TeleinfoTestUtils.h"
+#include <stdio.h>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+class TeleinfoTariffTest : public CppUnit::TestFixture {
+
+private:
+	TeleinfoDecoder* teleinfoDecoder;
+
+public:
+
+	void setUp() {
+		teleinfoDecoder = new TeleinfoDecoder();
+	}
+
+	/**
+	 * Test de l'option Heures Creuses : énergie par période et événements de changement de période
+	 */
+	void testHeuresCreuses() {
+		TeleinfoTariff tariff(2);
+		TeleinfoTariffEvent event;
+		CPPUNIT_ASSERT(tariff.getPeriod(1) == TELEINFO_PERIOD_UNKNOWN);
+
+		// Démarrage : la période devient connue
+		CPPUNIT_ASSERT(tariff.update(1, decodeHc(1000, 2000, "HC.."), 0, &event) == TELEINFO_TARIFF_PERIOD);
+		CPPUNIT_ASSERT(event.previousPeriod == TELEINFO_PERIOD_UNKNOWN);
+		CPPUNIT_ASSERT(event.period == TELEINFO_PERIOD_HC);
+
+		CPPUNIT_ASSERT(tariff.update(1, decodeHc(1010, 2000, "HC.."), 10, &event) == 0);
+		CPPUNIT_ASSERT(tariff.update(1, decodeHc(1025, 2000, "HC.."), 20, &event) == 0);
+		CPPUNIT_ASSERT(tariff.getPeriodEnergy(1) == 25);
+
+		// Passage en heures pleines : l'énergie de la trame de transition revient aux heures creuses
+		CPPUNIT_ASSERT(tariff.update(1, decodeHc(1030, 2000, "HP.."), 30, &event) == TELEINFO_TARIFF_PERIOD);
+		CPPUNIT_ASSERT(event.previousPeriod == TELEINFO_PERIOD_HC);
+		CPPUNIT_ASSERT(event.period == TELEINFO_PERIOD_HP);
+		CPPUNIT_ASSERT(event.start == 0);
+		CPPUNIT_ASSERT(event.end == 30);
+		CPPUNIT_ASSERT(event.energy == 30);
+		CPPUNIT_ASSERT(tariff.getPeriod(1) == TELEINFO_PERIOD_HP);
+		CPPUNIT_ASSERT(tariff.getPeriodEnergy(1) == 0);
+
+		CPPUNIT_ASSERT(tariff.update(1, decodeHc(1030, 2040, "HP.."), 40, &event) == 0);
+		CPPUNIT_ASSERT(tariff.update(1, decodeHc(1032, 2050, "HC.."), 50, &event) == TELEINFO_TARIFF_PERIOD);
+		CPPUNIT_ASSERT(event.start == 30);
+		CPPUNIT_ASSERT(event.energy == 52);
+
+		CPPUNIT_ASSERT(tariff.getEnergy(1, TELEINFO_PERIOD_HC) == 32);
+		CPPUNIT_ASSERT(tariff.getEnergy(1, TELEINFO_PERIOD_HP) == 50);
+		CPPUNIT_ASSERT(tariff.getEnergy(1, TELEINFO_PERIOD_TH) == 0);
+		CPPUNIT_ASSERT(tariff.getEnergy(0, TELEINFO_PERIOD_HC) == 0);
+	}
+
+	/**
+	 * Test du passage d'un index à zéro et d'un index qui recule
+	 */
+	void testRetourAZero() {
+		TeleinfoTariff tariff(1);
+		CPPUNIT_ASSERT(tariff.update(0, decodeHc(999999990, 500, "HC.."), 0, NULL) == TELEINFO_TARIFF_PERIOD);
+		CPPUNIT_ASSERT(tariff.update(0, decodeHc(5, 500, "HC.."), 1, NULL) == TELEINFO_TARIFF_ROLLOVER);
+		CPPUNIT_ASSERT(tariff.getEnergy(0, TELEINFO_PERIOD_HC) == 15);
+
+		CPPUNIT_ASSERT(tariff.update(0, decodeHc(5, 400, "HC.."), 2, NULL) == TELEINFO_TARIFF_ANOMALY);
+		CPPUNIT_ASSERT(tariff.update(0, decodeHc(5, 410, "HC.."), 3, NULL) == 0);
+		CPPUNIT_ASSERT(tariff.getEnergy(0, TELEINFO_PERIOD_HP) == 10);
+		CPPUNIT_ASSERT(tariff.getPeriodEnergy(0) == 25);
+	}
+
+	/**
+	 * Test de l'option Tempo : couleur du lendemain
+	 */
+	void testTempo() {
+		TeleinfoTariff tariff(1);
+		TeleinfoTariffEvent event;
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(100, 200, "HPJB", "----"), 0, &event) == (TELEINFO_TARIFF_PERIOD | TELEINFO_TARIFF_DEMAIN));
+		CPPUNIT_ASSERT(event.previousDemain == TELEINFO_DEMAIN_UNKNOWN);
+		CPPUNIT_ASSERT(event.demain == TELEINFO_DEMAIN_NONE);
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(100, 210, "HPJB", "ROUG"), 1, &event) == TELEINFO_TARIFF_DEMAIN);
+		CPPUNIT_ASSERT(event.previousDemain == TELEINFO_DEMAIN_NONE);
+		CPPUNIT_ASSERT(event.demain == TELEINFO_DEMAIN_ROUGE);
+		CPPUNIT_ASSERT(event.period == TELEINFO_PERIOD_HPJB);
+		CPPUNIT_ASSERT(tariff.getDemain(0) == TELEINFO_DEMAIN_ROUGE);
+		CPPUNIT_ASSERT(tariff.getPeriodEnergy(0) == 10);
+
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(120, 210, "HCJB", "ROUG"), 2, &event) == TELEINFO_TARIFF_PERIOD);
+		CPPUNIT_ASSERT(event.energy == 30);
+		CPPUNIT_ASSERT(tariff.getEnergy(0, TELEINFO_PERIOD_HCJB) == 20);
+		CPPUNIT_ASSERT(tariff.getEnergy(0, TELEINFO_PERIOD_HPJB) == 10);
+	}
+
+	/**
+	 * Test d'une trame Tempo sans DEMAIN : la couleur du lendemain est conservée
+	 */
+	void testDemainAbsent() {
+		TeleinfoTariff tariff(1);
+		TeleinfoTariffEvent event;
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(100, 200, "HPJB", "BLAN"), 0, &event) == (TELEINFO_TARIFF_PERIOD | TELEINFO_TARIFF_DEMAIN));
+		CPPUNIT_ASSERT(tariff.getDemain(0) == TELEINFO_DEMAIN_BLANC);
+
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(100, 210, "HPJB", ""), 1, &event) == 0);
+		CPPUNIT_ASSERT(tariff.getDemain(0) == TELEINFO_DEMAIN_BLANC);
+
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(100, 220, "HPJB", "BLAN"), 2, &event) == 0);
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(105, 220, "HCJB", ""), 3, &event) == TELEINFO_TARIFF_PERIOD);
+		CPPUNIT_ASSERT(event.previousDemain == TELEINFO_DEMAIN_BLANC);
+		CPPUNIT_ASSERT(event.demain == TELEINFO_DEMAIN_BLANC);
+		CPPUNIT_ASSERT(tariff.getDemain(0) == TELEINFO_DEMAIN_BLANC);
+	}
+
+	/**
+	 * Test du retour à "----" après l'annonce d'une couleur : la couleur annoncée la veille est oubliée
+	 */
+	void testDemainNonAnnonce() {
+		TeleinfoTariff tariff(1);
+		TeleinfoTariffEvent event;
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(100, 200, "HPJB", "BLEU"), 0, &event) == (TELEINFO_TARIFF_PERIOD | TELEINFO_TARIFF_DEMAIN));
+		CPPUNIT_ASSERT(tariff.getDemain(0) == TELEINFO_DEMAIN_BLEU);
+
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(100, 210, "HPJB", "----"), 1, &event) == TELEINFO_TARIFF_DEMAIN);
+		CPPUNIT_ASSERT(event.previousDemain == TELEINFO_DEMAIN_BLEU);
+		CPPUNIT_ASSERT(event.demain == TELEINFO_DEMAIN_NONE);
+		CPPUNIT_ASSERT(tariff.getDemain(0) == TELEINFO_DEMAIN_NONE);
+
+		// Groupe perdu puis "----" répété : pas de nouvel événement
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(100, 220, "HPJB", ""), 2, &event) == 0);
+		CPPUNIT_ASSERT(tariff.update(0, decodeTempo(100, 230, "HPJB", "----"), 3, &event) == 0);
+		CPPUNIT_ASSERT(tariff.getDemain(0) == TELEINFO_DEMAIN_NONE);
+	}
+
+	/**
+	 * Test de la lecture des valeurs de PTEC et DEMAIN
+	 */
+	void testValeurs() {
+		CPPUNIT_ASSERT(TeleinfoTariff::parsePeriod("TH..") == TELEINFO_PERIOD_TH);
+		CPPUNIT_ASSERT(TeleinfoTariff::parsePeriod("PM..") == TELEINFO_PERIOD_PM);
+		CPPUNIT_ASSERT(TeleinfoTariff::parsePeriod("HPJR") == TELEINFO_PERIOD_HPJR);
+		CPPUNIT_ASSERT(TeleinfoTariff::parsePeriod("") == TELEINFO_PERIOD_UNKNOWN);
+		CPPUNIT_ASSERT(TeleinfoTariff::parsePeriod("XX..") == TELEINFO_PERIOD_UNKNOWN);
+		CPPUNIT_ASSERT(TeleinfoTariff::parseDemain("BLAN") == TELEINFO_DEMAIN_BLANC);
+		CPPUNIT_ASSERT(TeleinfoTariff::parseDemain("----") == TELEINFO_DEMAIN_NONE);
+		CPPUNIT_ASSERT(TeleinfoTariff::parseDemain("VERT") == TELEINFO_DEMAIN_UNKNOWN);
+
+		TeleinfoTariff tariff(1);
+		CPPUNIT_ASSERT(tariff.update(1, decodeHc(1, 1, "HC.."), 0, NULL) == -1);
+		CPPUNIT_ASSERT(tariff.getEnergy(1, TELEINFO_PERIOD_HC) == 0);
+		CPPUNIT_ASSERT(tariff.getEnergy(0, TELEINFO_PERIODS) == 0);
+	}
+
+private:
+	/**
+	 * Décode une trame en option Heures Creuses
+	 */
+	Teleinfo* decodeHc(unsigned long hchc, unsigned long hchp, string ptec) {
+		char value[16];
+		string frame = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "HC..");
+		snprintf(value, sizeof(value), "%09lu", hchc);
+		frame += buildGroupe("HCHC", value);
+		snprintf(value, sizeof(value), "%09lu", hchp);
+		frame += buildGroupe("HCHP", value);
+		frame += buildGroupe("PTEC", ptec) + "\x03";
+		return decodeText(teleinfoDecoder, frame);
+	}
+
+	/**
+	 * Décode une trame en option Tempo (jours bleus), sans groupe DEMAIN si demain est vide
+	 */
+	Teleinfo* decodeTempo(unsigned long bbrhcjb, unsigned long bbrhpjb, string ptec, string demain) {
+		char value[16];
+		string frame = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("OPTARIF", "BBR(");
+		snprintf(value, sizeof(value), "%09lu", bbrhcjb);
+		frame += buildGroupe("BBRHCJB", value);
+		snprintf(value, sizeof(value), "%09lu", bbrhpjb);
+		frame += buildGroupe("BBRHPJB", value);
+		frame += buildGroupe("BBRHCJW", "000000000");
+		frame += buildGroupe("PTEC", ptec);
+		if (!demain.empty()) {
+			frame += buildGroupe("DEMAIN", demain);
+		}
+		frame += "\x03";
+		return decodeText(teleinfoDecoder, frame);
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoTariffTest);
+	CPPUNIT_TEST(testHeuresCreuses);
+	CPPUNIT_TEST(testRetourAZero);
+	CPPUNIT_TEST(testTempo);
+	CPPUNIT_TEST(testDemainAbsent);
+	CPPUNIT_TEST(testDemainNonAnnonce);
+	CPPUNIT_TEST(testValeurs);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoTariffTest);
@@ -0,0 +1,39 @@
+/**
+ * Outils communs aux tests unitaires
+ * @author LK
+ */
+
+#ifndef TELEINFO_TEST_UTILS_H_
+#define TELEINFO_TEST_UTILS_H_
+
+#include "TeleinfoDecoder.h"
+
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+/**
+ * Construit un groupe étiquette/donnée avec son checksum
+ */
+static inline std::string buildGroupe(std::string etiquette, std::string donnee) {
+  int checksum = 0;
+  std::string text = etiquette + " " + donnee;
+  for (unsigned int i = 0; i < text.length(); i++) {
+    checksum += text[i];
+  }
+  checksum = (checksum & 0x3F) + 0x20;
+  return "\x0A" + text + " " + (char) checksum + "\x0D";
+}
+
+/**
+ * Décode une trame caractère par caractère : la trame doit être terminée par son dernier caractère
+ */
+static inline Teleinfo* decodeText(TeleinfoDecoder* teleinfoDecoder, std::string frame) {
+  Teleinfo* teleinfo = NULL;
+  for (unsigned int i = 0; i < frame.length(); i++) {
+    teleinfo = teleinfoDecoder->decode(frame[i]);
+  }
+  CPPUNIT_ASSERT(teleinfo != NULL);
+  return teleinfo;
+}
+
+#endif  // TELEINFO_TEST_UTILS_H_
@@ -0,0 +1,117 @@
+/**
+ * Test unitaire de l'horodatage des trames et des histogrammes de durées
+ * (compilé avec TELEINFO_ENABLE_TIMESTAMPS)
+ * @author LK
+ */
+
+#include "TeleinfoDecoder.h"
+#include "TeleinfoHistogram.h"
+#include "TeleinfoTestUtils.h"
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+using namespace std;
+
+/**
+ * Horloge de test : avance d'une microseconde à chaque lecture
+ */
+static uint64_t fakeNow = 0;
+static uint64_t fakeClock() {
+	fakeNow += 1000;
+	return fakeNow;
+}
+
+class TeleinfoTimestampsTest : public CppUnit::TestFixture {
+
+private:
+	TeleinfoDecoder* teleinfoDecoder;
+
+public:
+
+	void setUp() {
+		teleinfoDecoder = new TeleinfoDecoder();
+		teleinfoDecoder->setClock(fakeClock);
+		fakeNow = 0;
+	}
+
+	/**
+	 * Test des dates attachées à une trame
+	 */
+	void testHorodatage() {
+		string frame = "\x02" + buildGroupe("ADCO", "026489026467") + buildGroupe("IINST", "005") + buildGroupe("PTEC", "HC..") + "\x03";
+		Teleinfo* teleinfo = decodeText(teleinfoDecoder, frame);
+		const TeleinfoTimestamps* timestamps = teleinfo->getTimestamps();
+		CPPUNIT_ASSERT(timestamps->stx == 1000);
+		CPPUNIT_ASSERT(timestamps->groupesCount == 3);
+		CPPUNIT_ASSERT(timestamps->groupes[0] == 2000);
+		CPPUNIT_ASSERT(timestamps->groupes[1] == 3000);
+		CPPUNIT_ASSERT(timestamps->groupes[2] == 4000);
+		CPPUNIT_ASSERT(timestamps->etx == 5000);
+
+		TeleinfoHistogram* assembly = teleinfoDecoder->getHistogram(TELEINFO_HISTOGRAM_ASSEMBLY);
+		CPPUNIT_ASSERT(assembly->getCount() == 1);
+		CPPUNIT_ASSERT(assembly->getMin() == 4000);
+		CPPUNIT_ASSERT(teleinfoDecoder->getHistogram(TELEINFO_HISTOGRAM_GAP)->getCount() == 0);
+		CPPUNIT_ASSERT(teleinfoDecoder->getHistogram(TELEINFO_HISTOGRAMS) == NULL);
+	}
+
+	/**
+	 * Test des histogrammes de silence entre trames et de délai de prise en compte
+	 */
+	void testLatences() {
+		string frame = "\x02" + buildGroupe("ADCO", "026489026467") + "\x03";
+		for (int i = 0; i < 10; i++) {
+			Teleinfo* teleinfo = decodeText(teleinfoDecoder, frame);
+			fakeNow += 100000; // Attente de 100 us avant la prise en compte
+			teleinfoDecoder->acknowledge(teleinfo);
+			fakeNow += 1000000; // Silence de 1 ms avant la trame suivante
+		}
+		TeleinfoHistogram* consumer = teleinfoDecoder->getHistogram(TELEINFO_HISTOGRAM_CONSUMER);
+		CPPUNIT_ASSERT(consumer->getCount() == 10);
+		CPPUNIT_ASSERT(consumer->getMin() == 101000);
+		CPPUNIT_ASSERT(consumer->getMax() == 101000);
+
+		TeleinfoHistogram* gap = teleinfoDecoder->getHistogram(TELEINFO_HISTOGRAM_GAP);
+		CPPUNIT_ASSERT(gap->getCount() == 9);
+		CPPUNIT_ASSERT(gap->getMean() == 1102000);
+		CPPUNIT_ASSERT(teleinfoDecoder->getHistogram(TELEINFO_HISTOGRAM_ASSEMBLY)->getMax() == 2000);
+	}
+
+	/**
+	 * Test de la précision de l'histogramme
+	 */
+	void testHistogramme() {
+		TeleinfoHistogram histogram;
+		CPPUNIT_ASSERT(histogram.getPercentile(50) == 0);
+		CPPUNIT_ASSERT(histogram.getMin() == 0);
+		for (uint64_t value = 1; value <= 100000; value++) {
+			histogram.record(value);
+		}
+		CPPUNIT_ASSERT(histogram.getCount() == 100000);
+		CPPUNIT_ASSERT(histogram.getMin() == 1);
+		CPPUNIT_ASSERT(histogram.getMax() == 100000);
+		CPPUNIT_ASSERT(histogram.getMean() == 50000);
+		CPPUNIT_ASSERT(histogram.getPercentile(100) == 100000);
+		double percentiles[] = { 1, 10, 50, 90, 99, 99.9 };
+		for (unsigned int i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+			double expected = percentiles[i] * 1000;
+			double value = histogram.getPercentile(percentiles[i]);
+			CPPUNIT_ASSERT(value >= expected);
+			CPPUNIT_ASSERT(value <= expected * 1.125);
+		}
+
+		histogram.record(UINT64_MAX);
+		CPPUNIT_ASSERT(histogram.getPercentile(100) == UINT64_MAX);
+		histogram.reset();
+		CPPUNIT_ASSERT(histogram.getCount() == 0);
+		CPPUNIT_ASSERT(histogram.getMax() == 0);
+	}
+
+	CPPUNIT_TEST_SUITE(TeleinfoTimestampsTest);
+	CPPUNIT_TEST(testHorodatage);
+	CPPUNIT_TEST(testLatences);
+	CPPUNIT_TEST(testHistogramme);
+	CPPUNIT_TEST_SUITE_END();
+
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TeleinfoTimestampsTest);
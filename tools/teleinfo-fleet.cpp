@@ -0,0 +1,616 @@
+/**
+ * Simulateur d'un parc de compteurs Téléinfo sur des pseudo-terminaux
+ *
+ * Usage : teleinfo-fleet [-n <compteurs>] [-x <vitesse>] [-d <durée>] [-o <option>] [-s <scénario>] [-l <répertoire>] [-t <ms>] [-p] [-c]
+ *   -n <compteurs>   : nombre de compteurs simulés, un pseudo-terminal chacun (100 par défaut)
+ *   -x <vitesse>     : multiple de la vitesse réelle de 1200 bauds (1 par défaut, 120 octets/s par compteur)
+ *   -d <durée>       : durée de la simulation en secondes simulées (illimitée par défaut, Ctrl-C pour arrêter)
+ *   -o <option>      : option tarifaire de tous les compteurs (BASE, HC, EJP ou TEMPO), sinon les quatre en alternance
+ *   -s <scénario>    : fichier de scénario (voir plus bas)
+ *   -l <répertoire>  : crée un lien <répertoire>/ttyTIC<n> vers le pseudo-terminal de chaque compteur
+ *   -t <ms>          : intervalle entre deux émissions sur chaque pseudo-terminal (16 ms par défaut)
+ *   -p               : octets émis avec leur bit de parité paire (7E1), sinon sur 7 bits
+ *   -c               : décode aussi les pseudo-terminaux (TeleinfoDecoder) et mesure débit, latence et pertes de bout en bout
+ *
+ * Les trames sont produites par TeleinfoEncoder et émises octet par octet au rythme de la liaison : le temps simulé
+ * avance <vitesse> fois plus vite que le temps réel. Sans -c, les pseudo-terminaux sont lus par la chaîne à tester
+ * (le chemin de chaque compteur est affiché au démarrage) ; un compteur dont le pseudo-terminal n'est pas lu prend
+ * du retard, signalé dans les statistiques.
+ *
+ * Scénario : une action par ligne, "<seconde simulée> <compteurs> <action> [valeur]", compteurs "*", "<n>" ou "<n>-<m>" :
+ *   tarif <PTEC>          : change de période tarifaire (HC.., HP.., HN.., PM.., HCJB ... HPJR), ignoré si l'option ne l'a pas
+ *   demain <couleur>      : couleur du lendemain (----, BLEU, BLAN, ROUG), option TEMPO
+ *   preavis <0|1>         : préavis de pointe mobile, option EJP
+ *   puissance <VA>        : puissance apparente ; au-delà de ISOUSC x 230 VA, les trames portent ADPS
+ *   bruit <probabilité>   : probabilité d'altération de chaque octet (un bit inversé), 0 pour une ligne propre
+ *   debranche <secondes>  : ligne coupée, la trame en cours est interrompue
+ *
+ * @author LK
+ */
+#include "TeleinfoDecoder.h"
+#include "TeleinfoEncoder.h"
+#include "TeleinfoHistogram.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Octets par seconde d'une liaison à 1200 bauds (10 bits par caractère 7E1) */
+#define FLEET_BYTES_PER_SECOND   120
+
+/* Intervalle par défaut entre deux émissions (ms de temps réel), de l'ordre du délai de latence d'un adaptateur USB-série */
+#define FLEET_TICK               16
+
+/* Trames émises en attente de décodage, par compteur (mode -c) */
+#define FLEET_PENDING            64
+
+/* Nombre maximal d'actions d'un scénario */
+#define FLEET_EVENTS             4096
+
+/* Actions d'un scénario */
+#define ACTION_TARIF             0
+#define ACTION_DEMAIN            1
+#define ACTION_PREAVIS           2
+#define ACTION_PUISSANCE         3
+#define ACTION_BRUIT             4
+#define ACTION_DEBRANCHE         5
+
+static const char* const ACTIONS[] = { "tarif", "demain", "preavis", "puissance", "bruit", "debranche" };
+static const char* const DEMAINS[] = { "----", "BLEU", "BLAN", "ROUG" };
+
+/**
+ * Un compteur simulé
+ */
+struct Meter {
+	TeleinfoEncoder* encoder;
+	int master;                   // Côté simulateur du pseudo-terminal
+	int slave;                    // Côté lecteur, gardé ouvert pour conserver les réglages de la ligne
+	char path[64];
+	unsigned char frame[TELEINFO_ENCODER_FRAME_SIZE];
+	unsigned int length;          // Longueur de la trame en cours, 0 si aucune
+	unsigned int position;        // Octets de la trame en cours déjà émis
+	bool altered;                 // Trame en cours altérée par le bruit
+	double credit;                // Octets pouvant être émis
+	double lastFrame;             // Début de la trame précédente (ms simulées)
+	double unplugged;             // Fin de la coupure de la ligne (ms simulées)
+	double noise;
+	int power;                    // Puissance apparente autour de laquelle varie la puissance émise
+	unsigned long frames;         // Trames émises complètes
+	unsigned long alteredFrames;  // Trames émises altérées ou interrompues
+	uint64_t bytes;
+	uint64_t blocked;             // Emissions refusées (pseudo-terminal non lu)
+
+	// Mode -c
+	TeleinfoDecoder* decoder;
+	uint64_t pending[FLEET_PENDING]; // Date d'émission de l'ETX de chaque trame émise pas encore décodée (ns)
+	bool pendingIntact[FLEET_PENDING];
+	unsigned int pendingHead;
+	unsigned int pendingCount;
+	uint32_t pendingHash[FLEET_PENDING]; // Empreinte des octets émis de chaque trame
+	uint32_t sentHash;               // Empreinte des octets émis de la trame en cours
+	uint32_t readHash;               // Empreinte des octets reçus depuis le dernier STX
+	uint64_t read;
+	unsigned long decoded;
+	unsigned long decodedAltered;    // Trames altérées décodées quand même
+	unsigned long lost;              // Trames intactes non décodées
+};
+
+/**
+ * Une action d'un scénario
+ */
+struct Event {
+	double millisecond;
+	unsigned int first;
+	unsigned int last;
+	int action;
+	double value;
+	char text[8];
+};
+
+static Meter* meters = NULL;
+static unsigned int metersCount = 100;
+static Event events[FLEET_EVENTS];
+static unsigned int eventsCount = 0;
+static TeleinfoHistogram latencies;
+static volatile bool stopping = false;
+static uint32_t seed = 0x9E3779B9u;
+
+static void interrupt(int number) {
+	stopping = true;
+}
+
+static uint32_t random32() {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static uint64_t nowNanoseconds() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * 1000000000ULL + time.tv_nsec;
+}
+
+/*********************************************************************************************************************************************************************
+  SCENARIO
+ *********************************************************************************************************************************************************************/
+
+static int compareEvents(const void* first, const void* second) {
+	double difference = ((const Event*) first)->millisecond - ((const Event*) second)->millisecond;
+	return difference < 0 ? -1 : (difference > 0 ? 1 : 0);
+}
+
+/**
+ * Lit un scénario
+ */
+static bool readScenario(const char* path) {
+	FILE* file = fopen(path, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Scénario illisible : %s\n", path);
+		return false;
+	}
+	char line[256];
+	unsigned int number = 0;
+	bool read = true;
+	while (read && fgets(line, sizeof(line), file) != NULL) {
+		number++;
+		double second;
+		char range[32];
+		char action[16];
+		char value[16] = "";
+		char* comment = strchr(line, '#');
+		if (comment != NULL) {
+			*comment = '\0';
+		}
+		int fields = sscanf(line, "%lf %31s %15s %15s", &second, range, action, value);
+		if (fields <= 0) {
+			continue;
+		}
+		if (eventsCount >= FLEET_EVENTS) {
+			fprintf(stderr, "%s:%u : trop d'actions\n", path, number);
+			read = false;
+			continue;
+		}
+		Event* event = &events[eventsCount];
+		event->action = -1;
+		for (unsigned int i = 0; fields >= 3 && i < sizeof(ACTIONS) / sizeof(ACTIONS[0]); i++) {
+			if (strcmp(action, ACTIONS[i]) == 0) {
+				event->action = i;
+			}
+		}
+		unsigned int first = 0;
+		unsigned int last = metersCount - 1;
+		if (strcmp(range, "*") != 0 && sscanf(range, "%u-%u", &first, &last) < 2) {
+			last = first;
+		}
+		if (event->action < 0 || fields < 4 || first > last) {
+			fprintf(stderr, "%s:%u : action invalide\n", path, number);
+			read = false;
+			continue;
+		}
+		event->millisecond = second * 1000;
+		event->first = first;
+		event->last = last < metersCount ? last : metersCount - 1;
+		event->value = strtod(value, NULL);
+		snprintf(event->text, sizeof(event->text), "%s", value);
+		eventsCount++;
+	}
+	fclose(file);
+	qsort(events, eventsCount, sizeof(Event), compareEvents);
+	return read;
+}
+
+/**
+ * Applique une action à un compteur
+ */
+static void apply(Event* event, Meter* meter, double now) {
+	switch (event->action) {
+		case ACTION_TARIF :
+			meter->encoder->setPeriod(TeleinfoEncoder::parsePeriod(event->text));
+			break;
+		case ACTION_DEMAIN :
+			for (int demain = 0; demain < 4; demain++) {
+				if (strcmp(event->text, DEMAINS[demain]) == 0) {
+					meter->encoder->setDemain(demain);
+				}
+			}
+			break;
+		case ACTION_PREAVIS :
+			meter->encoder->setPreavis(event->value != 0);
+			break;
+		case ACTION_PUISSANCE :
+			meter->power = (int) event->value;
+			break;
+		case ACTION_BRUIT :
+			meter->noise = event->value;
+			break;
+		case ACTION_DEBRANCHE :
+			meter->unplugged = now + event->value * 1000;
+			if (meter->length > 0 && meter->position > 0) {
+				meter->alteredFrames++; // Trame interrompue
+			}
+			meter->length = 0;
+			meter->credit = 0;
+			break;
+	}
+}
+
+/*********************************************************************************************************************************************************************
+  EMISSION
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Ouvre le pseudo-terminal d'un compteur, en mode brut
+ */
+static bool openMeter(Meter* meter, unsigned int number, int optarif, const char* links) {
+	meter->master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (meter->master < 0 || grantpt(meter->master) != 0 || unlockpt(meter->master) != 0) {
+		return false;
+	}
+	snprintf(meter->path, sizeof(meter->path), "%s", ptsname(meter->master));
+	meter->slave = open(meter->path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (meter->slave < 0) {
+		return false;
+	}
+	struct termios settings;
+	tcgetattr(meter->slave, &settings);
+	cfmakeraw(&settings);
+	cfsetspeed(&settings, B1200);
+	tcsetattr(meter->slave, TCSANOW, &settings);
+	fcntl(meter->master, F_SETFL, fcntl(meter->master, F_GETFL) | O_NONBLOCK);
+	if (links != NULL) {
+		char link[512];
+		snprintf(link, sizeof(link), "%s/ttyTIC%u", links, number);
+		unlink(link);
+		if (symlink(meter->path, link) != 0) {
+			fprintf(stderr, "Impossible de créer %s\n", link);
+		}
+	}
+
+	char adco[16];
+	snprintf(adco, sizeof(adco), "0214%08u", number);
+	meter->encoder = new TeleinfoEncoder(adco, optarif >= 0 ? optarif : number % TELEINFO_OPTARIFS, 30 + (number % 4) * 15);
+	for (int period = 0; period < TELEINFO_PERIODS; period++) {
+		meter->encoder->setIndex(period, 1000000 + random32() % 50000000);
+	}
+	meter->power = 300 + random32() % 3000;
+	// Compteurs déphasés : chacun commence au milieu d'une trame
+	meter->credit = -(double) (random32() % 300);
+	return true;
+}
+
+/**
+ * Retire la plus ancienne trame en attente de décodage : une trame intacte est perdue
+ */
+static void dropPending(Meter* meter) {
+	if (meter->pendingIntact[meter->pendingHead]) {
+		meter->lost++;
+	}
+	meter->pendingHead = (meter->pendingHead + 1) % FLEET_PENDING;
+	meter->pendingCount--;
+}
+
+/**
+ * Empreinte des octets d'une trame (sans le bit de parité), recommencée à chaque STX
+ */
+static uint32_t hashOf(uint32_t hash, unsigned char character) {
+	character &= 0x7F;
+	return character == 0x02 ? character : hash * 31 + character;
+}
+
+/**
+ * Emet les octets dus d'un compteur
+ */
+static void emit(Meter* meter, double now, double elapsed, bool parity) {
+	if (now < meter->unplugged) {
+		return;
+	}
+	double due = elapsed * FLEET_BYTES_PER_SECOND / 1000;
+	meter->credit += due;
+	if (meter->credit > TELEINFO_ENCODER_FRAME_SIZE + due) {
+		meter->credit = TELEINFO_ENCODER_FRAME_SIZE + due; // Pseudo-terminal non lu : le retard n'est pas rattrapé au-delà d'une trame
+	}
+	while (meter->credit >= 1) {
+		if (meter->length == 0) {
+			// Nouvelle trame : énergie consommée depuis la précédente, puissance variant de +/- 5 %
+			meter->encoder->advance((uint64_t) (now - meter->lastFrame));
+			meter->lastFrame = now;
+			int variation = meter->power / 20;
+			meter->encoder->setPower(meter->power - variation + (variation > 0 ? (int) (random32() % (2 * variation + 1)) : 0));
+			meter->length = meter->encoder->encode(meter->frame, parity);
+			meter->position = 0;
+			meter->altered = false;
+		}
+		// Emission jusqu'à la fin de la trame au plus : la date d'émission de l'ETX est celle de l'appel qui l'écrit
+		unsigned int count = meter->length - meter->position;
+		if (count > (unsigned int) meter->credit) {
+			count = (unsigned int) meter->credit;
+		}
+		for (unsigned int i = meter->position; i < meter->position + count && meter->noise > 0; i++) {
+			if (random32() < meter->noise * 4294967296.0) {
+				meter->frame[i] ^= 1 << (random32() % 7);
+				meter->altered = true;
+			}
+		}
+		uint64_t sent = nowNanoseconds();
+		ssize_t written = write(meter->master, &meter->frame[meter->position], count);
+		if (written <= 0) {
+			if (written < 0 && errno == EAGAIN) {
+				meter->blocked++;
+			}
+			return;
+		}
+		for (ssize_t i = 0; i < written; i++) {
+			meter->sentHash = hashOf(meter->sentHash, meter->frame[meter->position + i]);
+		}
+		meter->position += written;
+		meter->credit -= written;
+		meter->bytes += written;
+		if (meter->position == meter->length) {
+			if (meter->altered) {
+				meter->alteredFrames++;
+			} else {
+				meter->frames++;
+			}
+			if (meter->decoder != NULL) {
+				if (meter->pendingCount == FLEET_PENDING) {
+					dropPending(meter); // Trame la plus ancienne jamais décodée
+				}
+				unsigned int slot = (meter->pendingHead + meter->pendingCount++) % FLEET_PENDING;
+				meter->pending[slot] = sent;
+				meter->pendingIntact[slot] = !meter->altered;
+				meter->pendingHash[slot] = meter->sentHash;
+			}
+			meter->length = 0;
+		}
+	}
+}
+
+/*********************************************************************************************************************************************************************
+  DECODAGE (MODE -c)
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Lit et décode le pseudo-terminal d'un compteur
+ */
+static void receive(Meter* meter) {
+	unsigned char buffer[4096];
+	ssize_t length;
+	while ((length = read(meter->slave, buffer, sizeof(buffer))) > 0) {
+		uint64_t received = nowNanoseconds();
+		meter->read += length;
+		unsigned int index = 0;
+		while (index < (unsigned int) length) {
+			unsigned int consumed = 0;
+			Teleinfo* teleinfo = meter->decoder->decode(buffer + index, length - index, &consumed);
+			for (unsigned int i = index; i < index + consumed; i++) {
+				meter->readHash = hashOf(meter->readHash, buffer[i]);
+			}
+			index += consumed;
+			if (teleinfo == NULL) {
+				continue;
+			}
+			// Trame émise correspondant aux octets reçus : les trames précédentes en attente n'ont pas été décodées
+			unsigned int found = 0;
+			while (found < meter->pendingCount && meter->pendingHash[(meter->pendingHead + found) % FLEET_PENDING] != meter->readHash) {
+				found++;
+			}
+			if (found == meter->pendingCount) {
+				meter->decodedAltered++; // Octets altérés formant une trame valide, sans correspondance
+				continue;
+			}
+			for (unsigned int i = 0; i < found; i++) {
+				dropPending(meter);
+			}
+			if (meter->pendingIntact[meter->pendingHead]) {
+				uint64_t sent = meter->pending[meter->pendingHead];
+				meter->decoded++;
+				latencies.record(received > sent ? received - sent : 0);
+			} else {
+				meter->decodedAltered++; // Trame altérée décodée quand même
+			}
+			meter->pendingHead = (meter->pendingHead + 1) % FLEET_PENDING;
+			meter->pendingCount--;
+		}
+	}
+}
+
+/**
+ * Attend la fin de l'intervalle en décodant les octets reçus
+ */
+static void receiveUntil(uint64_t deadline, struct pollfd* descriptors, unsigned int* indexes) {
+	uint64_t now = nowNanoseconds();
+	do { // Au moins une lecture, même en retard sur l'intervalle
+		unsigned int count = 0;
+		for (unsigned int i = 0; i < metersCount; i++) {
+			if (meters[i].read < meters[i].bytes) {
+				descriptors[count].fd = meters[i].slave;
+				descriptors[count].events = POLLIN;
+				indexes[count++] = i;
+			}
+		}
+		struct timespec timeout;
+		timeout.tv_sec = now < deadline ? (deadline - now) / 1000000000ULL : 0;
+		timeout.tv_nsec = now < deadline ? (deadline - now) % 1000000000ULL : 0;
+		if (ppoll(descriptors, count, &timeout, NULL) > 0) {
+			for (unsigned int i = 0; i < count; i++) {
+				if (descriptors[i].revents & POLLIN) {
+					receive(&meters[indexes[i]]);
+				}
+			}
+		}
+		now = nowNanoseconds();
+	} while (now < deadline);
+}
+
+/*********************************************************************************************************************************************************************
+  STATISTIQUES
+ *********************************************************************************************************************************************************************/
+
+static void report(double simulated, double real, bool check, bool last) {
+	unsigned long frames = 0;
+	unsigned long altered = 0;
+	unsigned long decoded = 0;
+	unsigned long decodedAltered = 0;
+	unsigned long lost = 0;
+	uint64_t bytes = 0;
+	uint64_t blocked = 0;
+	for (unsigned int i = 0; i < metersCount; i++) {
+		frames += meters[i].frames;
+		altered += meters[i].alteredFrames;
+		decoded += meters[i].decoded;
+		decodedAltered += meters[i].decodedAltered;
+		lost += meters[i].lost;
+		for (unsigned int j = 0; last && j < meters[i].pendingCount; j++) {
+			lost += meters[i].pendingIntact[(meters[i].pendingHead + j) % FLEET_PENDING] ? 1 : 0;
+		}
+		bytes += meters[i].bytes;
+		blocked += meters[i].blocked;
+	}
+	fprintf(stderr, "%s%.0f s simulées (%.1f s) : %lu trames émises (%lu altérées), %.0f trames/s, %.0f octets/s", last ? "\n" : "\r",
+			simulated / 1000, real, frames, altered, real > 0 ? (frames + altered) / real : 0, real > 0 ? bytes / real : 0);
+	if (blocked > 0) {
+		fprintf(stderr, ", %llu émissions en retard", (unsigned long long) blocked);
+	}
+	if (check) {
+		fprintf(stderr, " | %lu décodées, %lu perdues, latence p50 %.3f ms p99 %.3f ms max %.3f ms", decoded, lost,
+				latencies.getPercentile(50) / 1e6, latencies.getPercentile(99) / 1e6, latencies.getMax() / 1e6);
+		if (decodedAltered > 0) {
+			fprintf(stderr, ", %lu altérées décodées", decodedAltered);
+		}
+	}
+	fprintf(stderr, last ? "\n" : "   ");
+}
+
+/*********************************************************************************************************************************************************************
+  PROGRAMME
+ *********************************************************************************************************************************************************************/
+
+int main(int argc, char** argv) {
+	double speed = 1;
+	double duration = 0;
+	unsigned int tick = FLEET_TICK;
+	int optarif = -1;
+	const char* scenario = NULL;
+	const char* links = NULL;
+	bool parity = false;
+	bool check = false;
+	int option;
+	bool valid = true;
+	while ((option = getopt(argc, argv, "n:x:d:o:s:l:t:pc")) != -1) {
+		switch (option) {
+			case 'n' : metersCount = strtoul(optarg, NULL, 10); break;
+			case 'x' : speed = strtod(optarg, NULL); break;
+			case 'd' : duration = strtod(optarg, NULL) * 1000; break;
+			case 'o' : optarif = TeleinfoEncoder::parseOptarif(optarg); valid = valid && optarif >= 0; break;
+			case 's' : scenario = optarg; break;
+			case 'l' : links = optarg; break;
+			case 't' : tick = strtoul(optarg, NULL, 10); break;
+			case 'p' : parity = true; break;
+			case 'c' : check = true; break;
+			default : valid = false; break;
+		}
+	}
+	if (!valid || metersCount == 0 || speed <= 0 || tick == 0) {
+		fprintf(stderr, "Usage : %s [-n <compteurs>] [-x <vitesse>] [-d <durée>] [-o BASE|HC|EJP|TEMPO] [-s <scénario>] [-l <répertoire>] [-t <ms>] [-p] [-c]\n", argv[0]);
+		return 1;
+	}
+	if (scenario != NULL && !readScenario(scenario)) {
+		return 1;
+	}
+
+	// Deux descripteurs par compteur
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+	meters = (Meter*) calloc(metersCount, sizeof(Meter));
+	struct pollfd* descriptors = (struct pollfd*) malloc(metersCount * sizeof(struct pollfd));
+	unsigned int* indexes = (unsigned int*) malloc(metersCount * sizeof(unsigned int));
+	if (meters == NULL || descriptors == NULL || indexes == NULL) {
+		fprintf(stderr, "Mémoire insuffisante\n");
+		return 1;
+	}
+	for (unsigned int i = 0; i < metersCount; i++) {
+		if (!openMeter(&meters[i], i, optarif, links)) {
+			fprintf(stderr, "Impossible d'ouvrir le pseudo-terminal du compteur %u : %s\n", i, strerror(errno));
+			return 1;
+		}
+		if (check) {
+			meters[i].decoder = new TeleinfoDecoder();
+		} else {
+			printf("%u %s\n", i, meters[i].path);
+		}
+	}
+	fflush(stdout);
+	signal(SIGINT, interrupt);
+	signal(SIGTERM, interrupt);
+
+	// Boucle d'émission : toutes les <tick> ms, le temps simulé avance de <tick> x vitesse
+	uint64_t start = nowNanoseconds();
+	uint64_t deadline = start;
+	double simulated = 0;
+	double previous = 0;
+	double reported = 0;
+	unsigned int nextEvent = 0;
+	while (!stopping && (duration <= 0 || simulated < duration)) {
+		for (; nextEvent < eventsCount && events[nextEvent].millisecond <= simulated; nextEvent++) {
+			for (unsigned int i = events[nextEvent].first; i <= events[nextEvent].last; i++) {
+				apply(&events[nextEvent], &meters[i], simulated);
+			}
+		}
+		for (unsigned int i = 0; i < metersCount; i++) {
+			emit(&meters[i], simulated, simulated - previous, parity);
+		}
+		deadline += tick * 1000000ULL;
+		if (check) {
+			receiveUntil(deadline, descriptors, indexes);
+		} else {
+			struct timespec until;
+			until.tv_sec = deadline / 1000000000ULL;
+			until.tv_nsec = deadline % 1000000000ULL;
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+		}
+		uint64_t now = nowNanoseconds();
+		if (now > deadline + 100 * tick * 1000000ULL) {
+			deadline = now; // Machine saturée : le temps simulé ralentit plutôt que de rattraper par à-coups
+		}
+		previous = simulated;
+		simulated += tick * speed;
+		double real = (now - start) / 1e9;
+		if (real - reported >= 1) {
+			reported = real;
+			report(simulated, real, check, false);
+		}
+	}
+	if (check) {
+		receiveUntil(nowNanoseconds() + 200000000ULL, descriptors, indexes); // Derniers octets en transit
+	}
+	report(simulated, (nowNanoseconds() - start) / 1e9, check, true);
+
+	for (unsigned int i = 0; i < metersCount; i++) {
+		if (links != NULL) {
+			char link[512];
+			snprintf(link, sizeof(link), "%s/ttyTIC%u", links, i);
+			unlink(link);
+		}
+		close(meters[i].slave);
+		close(meters[i].master);
+		delete meters[i].encoder;
+		delete meters[i].decoder;
+	}
+	free(meters);
+	free(descriptors);
+	free(indexes);
+	return 0;
+}
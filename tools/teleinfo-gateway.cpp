@@ -0,0 +1,874 @@
+/**
+ * Passerelle Téléinfo répartie sur plusieurs processus
+ *
+ * Usage : teleinfo-gateway [-w <processus>] [-f line|csv|json] [-i <secondes>] [-u <socket>] <port>...
+ *   -w <processus>   : nombre initial de processus de travail (2 par défaut, au plus 64)
+ *   -f <format>      : format du flux fusionné (line protocol par défaut, voir TeleinfoSerializer)
+ *   -i <secondes>    : intervalle des points de reprise de chaque décodeur (1 s par défaut)
+ *   -u <socket>      : diffuse aussi le flux fusionné sur une socket Unix locale (un consommateur trop lent est déconnecté)
+ *   <port>           : port série, pseudo-terminal (voir teleinfo-fleet -l), tube ou fichier d'un flux Téléinfo
+ *
+ * Le superviseur ouvre les ports et répartit leur lecture entre des processus de travail par hachage cohérent de
+ * l'adresse du compteur (TeleinfoShard, clé Teleinfo::getAdcoAsLong()) ; un port dont aucune trame n'a encore été
+ * décodée est réparti selon son numéro, puis confié au propriétaire de son compteur dès la première trame.
+ * Chaque processus décode ses ports (un TeleinfoDecoder par port) et envoie les trames sérialisées au superviseur,
+ * qui les fusionne, trame par trame, en un seul flux sur la sortie standard.
+ *
+ * Signaux reçus par le superviseur :
+ *   SIGUSR1          : ajoute un processus de travail, qui reprend environ 1/K des ports
+ *   SIGUSR2          : retire le dernier processus ajouté, ses ports sont répartis entre les autres
+ *   SIGINT, SIGTERM  : arrête la passerelle
+ *
+ * Transfert d'un port : l'ancien propriétaire cesse de lire le port et renvoie l'état de son décodeur
+ * (TeleinfoDecoder::saveState(...)) avec les octets déjà lus de la trame en cours ; le superviseur passe le descripteur
+ * du port (SCM_RIGHTS), l'état et ces octets au nouveau propriétaire, qui restaure le décodeur, réinjecte les octets
+ * puis lit la suite du port : aucune trame n'est perdue. Les processus envoient aussi un point de reprise de chaque
+ * décodeur toutes les <secondes> : si un processus s'arrête brutalement, ses ports sont repris à partir du dernier point
+ * (seule la trame en cours est perdue).
+ *
+ * Disponible sur les systèmes POSIX uniquement.
+ * @author LK
+ */
+#include "TeleinfoDecoder.h"
+#include "TeleinfoSerializer.h"
+#include "TeleinfoShard.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Octets conservés de la trame en cours de décodage d'un port, transmis avec l'état du décodeur */
+#define GATEWAY_PARTIAL          1024
+
+/* Taille maximale d'un message entre le superviseur et un processus de travail (en-tête compris) */
+#define GATEWAY_MESSAGE          65536
+
+/* Nombre maximal de consommateurs de la socket Unix */
+#define GATEWAY_CONSUMERS        16
+
+/* Caractère de début de trame */
+#define GATEWAY_STX              0x02
+
+/* Messages entre le superviseur et les processus de travail */
+#define MESSAGE_ADOPT            0    // Superviseur -> processus : prend un port (descripteur, état, octets de la trame en cours)
+#define MESSAGE_RELEASE          1    // Superviseur -> processus : rend un port
+#define MESSAGE_RELEASED         2    // Processus -> superviseur : port rendu (état, octets de la trame en cours)
+#define MESSAGE_STATE            3    // Processus -> superviseur : point de reprise d'un port
+#define MESSAGE_ADCO             4    // Processus -> superviseur : compteur d'un port (première trame ou changement)
+#define MESSAGE_FRAMES           5    // Processus -> superviseur : trames sérialisées
+
+/**
+ * En-tête d'un message, suivi de l'état du décodeur puis des données (octets de la trame en cours ou trames sérialisées)
+ */
+struct Message {
+	uint32_t type;
+	uint32_t port;
+	uint64_t adco;
+	uint32_t stateSize;
+	uint32_t dataSize;
+};
+
+/**
+ * Un port, vu du superviseur
+ */
+struct Port {
+	const char* path;
+	int fd;
+	uint64_t adco;                // Compteur du port, 0 tant qu'aucune trame n'a été décodée
+	int owner;                    // Processus qui lit le port, -1 si aucun
+	bool releasing;               // En attente de MESSAGE_RELEASED
+	unsigned char* state;         // Dernier état connu du décodeur
+	bool hasState;
+	unsigned char partial[GATEWAY_PARTIAL];
+	unsigned int partialLength;
+};
+
+/**
+ * Un processus de travail, vu du superviseur
+ */
+struct Worker {
+	pid_t pid;
+	int socket;                   // -1 si le processus n'existe pas
+	bool retiring;                // Retiré de l'anneau, s'arrête après avoir rendu ses ports
+	unsigned long long bytes;     // Octets de trames sérialisées reçus
+};
+
+/**
+ * Un port, vu du processus de travail qui le lit
+ */
+struct Stream {
+	int fd;                       // -1 si le port n'est pas confié à ce processus
+	bool ended;                   // Fin du flux (fichier lu, pseudo-terminal fermé) : le port n'est plus lu
+	TeleinfoDecoder* decoder;
+	uint64_t adco;
+	unsigned char partial[GATEWAY_PARTIAL];
+	unsigned int partialLength;
+};
+
+static Port* ports = NULL;
+static unsigned int portsCount = 0;
+static Worker workers[TELEINFO_SHARD_WORKERS];
+static TeleinfoShard shard;
+static unsigned long stateSize = 0;
+static int format = TELEINFO_FORMAT_LINE;
+static unsigned int checkpointInterval = 1;
+static int listener = -1;
+static int consumers[GATEWAY_CONSUMERS];
+static unsigned char message[GATEWAY_MESSAGE];
+static bool unbalanced = false;             // Un envoi du superviseur a échoué, la répartition est à refaire
+static volatile sig_atomic_t stopping = 0;
+static volatile sig_atomic_t additions = 0;
+static volatile sig_atomic_t removals = 0;
+
+static void interrupt(int number) {
+	stopping = 1;
+}
+
+static void addition(int number) {
+	additions++;
+}
+
+static void removal(int number) {
+	removals++;
+}
+
+static uint64_t nowMilliseconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/*********************************************************************************************************************************************************************
+  MESSAGES
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Envoie un message, avec un descripteur de fichier si fd >= 0.
+ * Le superviseur n'attend jamais un processus de travail (qui peut lui-même attendre de pouvoir envoyer ses trames) :
+ * ses envois échouent si la socket est pleine et sont refaits plus tard.
+ */
+static bool sendMessage(int socket, uint32_t type, uint32_t port, uint64_t adco, const void* state, uint32_t stateLength,
+		const void* data, uint32_t dataLength, int fd, int flags) {
+	Message header;
+	header.type = type;
+	header.port = port;
+	header.adco = adco;
+	header.stateSize = stateLength;
+	header.dataSize = dataLength;
+	struct iovec parts[3];
+	parts[0].iov_base = &header;
+	parts[0].iov_len = sizeof(header);
+	parts[1].iov_base = (void*) state;
+	parts[1].iov_len = stateLength;
+	parts[2].iov_base = (void*) data;
+	parts[2].iov_len = dataLength;
+	struct msghdr packet;
+	memset(&packet, 0, sizeof(packet));
+	packet.msg_iov = parts;
+	packet.msg_iovlen = 3;
+	char control[CMSG_SPACE(sizeof(int))];
+	if (fd >= 0) {
+		memset(control, 0, sizeof(control));
+		packet.msg_control = control;
+		packet.msg_controllen = sizeof(control);
+		struct cmsghdr* rights = CMSG_FIRSTHDR(&packet);
+		rights->cmsg_level = SOL_SOCKET;
+		rights->cmsg_type = SCM_RIGHTS;
+		rights->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(rights), &fd, sizeof(int));
+	}
+	ssize_t sent;
+	do {
+		sent = sendmsg(socket, &packet, MSG_NOSIGNAL | flags);
+	} while (sent < 0 && errno == EINTR);
+	return sent == (ssize_t) (sizeof(header) + stateLength + dataLength);
+}
+
+/**
+ * Reçoit un message dans message[]
+ * @param fd reçoit le descripteur de fichier joint, -1 si aucun (facultatif, peut être NULL)
+ * @return false si la socket est fermée ou si le message est invalide
+ */
+static bool receiveMessage(int socket, int* fd) {
+	struct iovec part;
+	part.iov_base = message;
+	part.iov_len = sizeof(message);
+	struct msghdr packet;
+	memset(&packet, 0, sizeof(packet));
+	packet.msg_iov = &part;
+	packet.msg_iovlen = 1;
+	char control[CMSG_SPACE(sizeof(int))];
+	packet.msg_control = control;
+	packet.msg_controllen = sizeof(control);
+	ssize_t received;
+	do {
+		received = recvmsg(socket, &packet, 0);
+	} while (received < 0 && errno == EINTR);
+	int attached = -1;
+	struct cmsghdr* rights = CMSG_FIRSTHDR(&packet);
+	if (received > 0 && rights != NULL && rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS) {
+		memcpy(&attached, CMSG_DATA(rights), sizeof(int));
+	}
+	if (fd != NULL) {
+		*fd = attached;
+	} else if (attached >= 0) {
+		close(attached);
+	}
+	Message* header = (Message*) message;
+	return received >= (ssize_t) sizeof(Message) && (packet.msg_flags & MSG_TRUNC) == 0
+			&& received == (ssize_t) (sizeof(Message) + header->stateSize + header->dataSize);
+}
+
+/*********************************************************************************************************************************************************************
+  PROCESSUS DE TRAVAIL
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Conserve les octets décodés de la trame en cours (à partir du dernier STX)
+ */
+static void keep(Stream* stream, const unsigned char* buffer, unsigned int length) {
+	for (unsigned int i = 0; i < length; i++) {
+		if ((buffer[i] & 0x7F) == GATEWAY_STX || stream->partialLength >= GATEWAY_PARTIAL) {
+			stream->partialLength = 0; // Trame trop longue : ce n'est pas une trame, le décodeur l'abandonnera aussi
+		}
+		stream->partial[stream->partialLength++] = buffer[i];
+	}
+}
+
+/**
+ * Envoie les trames sérialisées au superviseur
+ */
+static bool flush(int socket, TeleinfoSerializer* serializer) {
+	if (serializer->getLength() == 0) {
+		return true;
+	}
+	bool sent = sendMessage(socket, MESSAGE_FRAMES, 0, 0, NULL, 0, serializer->getBuffer(), serializer->getLength(), -1, 0);
+	serializer->clear();
+	return sent;
+}
+
+/**
+ * Décode des octets d'un port
+ */
+static bool feed(int socket, unsigned int port, Stream* stream, const unsigned char* buffer, unsigned int length, TeleinfoSerializer* serializer) {
+	unsigned int index = 0;
+	while (index < length) {
+		unsigned int consumed = 0;
+		Teleinfo* teleinfo = stream->decoder->decode(buffer + index, length - index, &consumed);
+		keep(stream, buffer + index, consumed);
+		index += consumed;
+		if (teleinfo == NULL) {
+			continue;
+		}
+		stream->partialLength = 0;
+		uint64_t adco = teleinfo->getAdcoAsLong();
+		if (adco != 0 && adco != stream->adco) {
+			stream->adco = adco;
+			if (!sendMessage(socket, MESSAGE_ADCO, port, adco, NULL, 0, NULL, 0, -1, 0)) {
+				return false;
+			}
+		}
+		uint64_t timestamp = nowMilliseconds();
+		if (!serializer->append(teleinfo, timestamp)) {
+			if (!flush(socket, serializer)) {
+				return false;
+			}
+			serializer->append(teleinfo, timestamp);
+		}
+	}
+	return true;
+}
+
+/**
+ * Envoie l'état du décodeur d'un port et les octets de la trame en cours
+ */
+static bool sendState(int socket, uint32_t type, unsigned int port, Stream* stream, unsigned char* state) {
+	stream->decoder->saveState(state);
+	return sendMessage(socket, type, port, stream->adco, state, stateSize, stream->partial, stream->partialLength, -1, 0);
+}
+
+/**
+ * Boucle d'un processus de travail : lit les ports qui lui sont confiés jusqu'à la fermeture de sa socket
+ */
+static int work(int socket) {
+	Stream* streams = (Stream*) calloc(portsCount, sizeof(Stream));
+	struct pollfd* descriptors = (struct pollfd*) malloc((portsCount + 1) * sizeof(struct pollfd));
+	unsigned int* indexes = (unsigned int*) malloc((portsCount + 1) * sizeof(unsigned int));
+	unsigned char* state = (unsigned char*) malloc(stateSize);
+	char* frames = (char*) malloc(GATEWAY_MESSAGE - sizeof(Message));
+	if (streams == NULL || descriptors == NULL || indexes == NULL || state == NULL || frames == NULL) {
+		return 1;
+	}
+	for (unsigned int i = 0; i < portsCount; i++) {
+		streams[i].fd = -1;
+	}
+	TeleinfoSerializer serializer(frames, GATEWAY_MESSAGE - sizeof(Message), format);
+	unsigned char buffer[4096];
+	uint64_t nextCheckpoint = nowMilliseconds() + checkpointInterval * 1000;
+	bool running = true;
+	while (running) {
+		unsigned int count = 0;
+		descriptors[count].fd = socket;
+		descriptors[count].events = POLLIN;
+		count++;
+		for (unsigned int i = 0; i < portsCount; i++) {
+			if (streams[i].fd >= 0 && !streams[i].ended) {
+				descriptors[count].fd = streams[i].fd;
+				descriptors[count].events = POLLIN;
+				indexes[count] = i;
+				count++;
+			}
+		}
+		uint64_t now = nowMilliseconds();
+		int timeout = nextCheckpoint > now ? (int) (nextCheckpoint - now) : 0;
+		if (poll(descriptors, count, timeout) < 0 && errno != EINTR) {
+			break;
+		}
+
+		// Ports
+		for (unsigned int d = 1; d < count && running; d++) {
+			if (descriptors[d].revents == 0) {
+				continue;
+			}
+			Stream* stream = &streams[indexes[d]];
+			ssize_t length = read(stream->fd, buffer, sizeof(buffer));
+			if (length > 0) {
+				running = feed(socket, indexes[d], stream, buffer, length, &serializer);
+			} else if (length == 0 || (errno != EAGAIN && errno != EINTR)) {
+				stream->ended = true;
+			}
+		}
+		running = running && flush(socket, &serializer);
+
+		// Ordres du superviseur, après les ports : les octets lus avant un transfert sont décodés et envoyés
+		if (running && descriptors[0].revents != 0) {
+			int fd;
+			if (!receiveMessage(socket, &fd)) {
+				break; // Superviseur arrêté, ou processus retiré
+			}
+			Message* header = (Message*) message;
+			if (header->port >= portsCount) {
+				if (fd >= 0) {
+					close(fd);
+				}
+				continue;
+			}
+			Stream* stream = &streams[header->port];
+			if (header->type == MESSAGE_ADOPT && stream->fd < 0 && fd >= 0) {
+				stream->fd = fd;
+				stream->ended = false;
+				stream->decoder = new TeleinfoDecoder();
+				stream->decoder->setId(header->port);
+				stream->decoder->setOptions(TELEINFO_OPTION_KEEP_LAST_FRAME); // L'état est rendu pendant une trame
+				if (header->stateSize > 0) {
+					stream->decoder->restoreState(message + sizeof(Message), header->stateSize);
+				}
+				stream->adco = header->adco;
+				stream->partialLength = 0;
+				running = feed(socket, header->port, stream, message + sizeof(Message) + header->stateSize, header->dataSize, &serializer)
+						&& flush(socket, &serializer);
+			} else if (header->type == MESSAGE_RELEASE && stream->fd >= 0) {
+				running = sendState(socket, MESSAGE_RELEASED, header->port, stream, state);
+				close(stream->fd);
+				stream->fd = -1;
+				delete stream->decoder;
+				stream->decoder = NULL;
+			} else if (fd >= 0) {
+				close(fd);
+			}
+		}
+
+		// Points de reprise
+		if (running && nowMilliseconds() >= nextCheckpoint) {
+			for (unsigned int i = 0; i < portsCount && running; i++) {
+				if (streams[i].fd >= 0) {
+					running = sendState(socket, MESSAGE_STATE, i, &streams[i], state);
+				}
+			}
+			nextCheckpoint = nowMilliseconds() + checkpointInterval * 1000;
+		}
+	}
+	for (unsigned int i = 0; i < portsCount; i++) {
+		if (streams[i].fd >= 0) {
+			close(streams[i].fd);
+			delete streams[i].decoder;
+		}
+	}
+	free(streams);
+	free(descriptors);
+	free(indexes);
+	free(state);
+	free(frames);
+	return 0;
+}
+
+/*********************************************************************************************************************************************************************
+  SUPERVISEUR
+ *********************************************************************************************************************************************************************/
+
+/**
+ * Clé de répartition d'un port : l'adresse de son compteur, sinon son numéro (hors de la plage des adresses)
+ */
+static uint64_t keyOf(unsigned int port) {
+	return ports[port].adco != 0 ? ports[port].adco : (1ULL << 63) | port;
+}
+
+/**
+ * Règle un port série en 1200 bauds 7E1, sans effet sur un tube ou un fichier
+ */
+static void configure(int fd) {
+	struct termios settings;
+	if (tcgetattr(fd, &settings) != 0) {
+		return;
+	}
+	cfmakeraw(&settings);
+	settings.c_cflag &= ~CSIZE;
+	settings.c_cflag |= CS7 | PARENB | CREAD | CLOCAL;
+	cfsetispeed(&settings, B1200);
+	cfsetospeed(&settings, B1200);
+	tcsetattr(fd, TCSANOW, &settings);
+}
+
+/**
+ * Démarre un processus de travail et l'ajoute à l'anneau
+ * @return le numéro du processus, -1 en cas d'erreur
+ */
+static int startWorker() {
+	int number = 0;
+	while (number < TELEINFO_SHARD_WORKERS && (workers[number].socket >= 0 || workers[number].pid > 0)) {
+		number++;
+	}
+	int pair[2];
+	if (number >= TELEINFO_SHARD_WORKERS || socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair) != 0) {
+		return -1;
+	}
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid < 0) {
+		close(pair[0]);
+		close(pair[1]);
+		return -1;
+	}
+	if (pid == 0) {
+		// Le processus de travail ne garde que sa socket : les ports lui sont transmis par le superviseur
+		signal(SIGINT, SIG_IGN);
+		signal(SIGUSR1, SIG_IGN);
+		signal(SIGUSR2, SIG_IGN);
+		signal(SIGTERM, SIG_DFL);
+		close(pair[0]);
+		for (unsigned int i = 0; i < portsCount; i++) {
+			close(ports[i].fd);
+		}
+		for (int i = 0; i < TELEINFO_SHARD_WORKERS; i++) {
+			if (workers[i].socket >= 0) {
+				close(workers[i].socket);
+			}
+		}
+		if (listener >= 0) {
+			close(listener);
+		}
+		for (int i = 0; i < GATEWAY_CONSUMERS; i++) {
+			if (consumers[i] >= 0) {
+				close(consumers[i]);
+			}
+		}
+		_exit(work(pair[1]));
+	}
+	close(pair[1]);
+	workers[number].pid = pid;
+	workers[number].socket = pair[0];
+	workers[number].retiring = false;
+	workers[number].bytes = 0;
+	shard.addWorker(number);
+	return number;
+}
+
+/**
+ * Confie un port à un processus
+ */
+static void adopt(unsigned int port, int worker) {
+	Port* current = &ports[port];
+	if (sendMessage(workers[worker].socket, MESSAGE_ADOPT, port, current->adco, current->state, current->hasState ? stateSize : 0,
+			current->partial, current->partialLength, current->fd, MSG_DONTWAIT)) {
+		current->owner = worker;
+	} else {
+		unbalanced = true;
+	}
+}
+
+/**
+ * Confie chaque port au propriétaire de sa clé : un port confié à un autre processus lui est d'abord repris
+ * (MESSAGE_RELEASE, le transfert se termine à la réception de MESSAGE_RELEASED)
+ * @return le nombre de ports déplacés
+ */
+static unsigned int rebalance() {
+	unsigned int moved = 0;
+	unbalanced = false;
+	for (unsigned int i = 0; i < portsCount; i++) {
+		if (ports[i].releasing) {
+			continue;
+		}
+		int target = shard.getOwner(keyOf(i));
+		if (target == ports[i].owner || target == TELEINFO_SHARD_NONE) {
+			continue;
+		}
+		if (ports[i].owner >= 0) {
+			if (sendMessage(workers[ports[i].owner].socket, MESSAGE_RELEASE, i, 0, NULL, 0, NULL, 0, -1, MSG_DONTWAIT)) {
+				ports[i].releasing = true;
+				moved++;
+			} else {
+				unbalanced = true;
+			}
+		} else {
+			adopt(i, target);
+		}
+	}
+
+	// Un processus retiré s'arrête quand il n'a plus de port
+	for (int w = 0; w < TELEINFO_SHARD_WORKERS; w++) {
+		if (workers[w].socket < 0 || !workers[w].retiring) {
+			continue;
+		}
+		bool idle = true;
+		for (unsigned int i = 0; i < portsCount && idle; i++) {
+			idle = ports[i].owner != w;
+		}
+		if (idle) {
+			close(workers[w].socket);
+			workers[w].socket = -1;
+		}
+	}
+	return moved;
+}
+
+/**
+ * Prend en compte l'arrêt d'un processus : ses ports sont repris à partir de leur dernier point de reprise
+ */
+static void lose(int worker) {
+	close(workers[worker].socket);
+	workers[worker].socket = -1;
+	shard.removeWorker(worker);
+	unsigned int orphans = 0;
+	for (unsigned int i = 0; i < portsCount; i++) {
+		if (ports[i].owner == worker) {
+			ports[i].owner = -1;
+			ports[i].releasing = false;
+			ports[i].partialLength = 0; // Les octets suivants ont peut-être déjà été lus : la trame en cours est perdue
+			orphans++;
+		}
+	}
+	if (!workers[worker].retiring || orphans > 0) {
+		fprintf(stderr, "Processus %d arrêté, %u ports repris\n", worker, orphans);
+	}
+	rebalance();
+}
+
+/**
+ * Enregistre l'état d'un port reçu d'un processus
+ */
+static void store(Port* port, Message* header) {
+	if (header->stateSize == stateSize) {
+		memcpy(port->state, message + sizeof(Message), stateSize);
+		port->hasState = true;
+	}
+	unsigned int length = header->dataSize <= GATEWAY_PARTIAL ? header->dataSize : 0;
+	memcpy(port->partial, message + sizeof(Message) + header->stateSize, length);
+	port->partialLength = length;
+	if (header->adco != 0) {
+		port->adco = header->adco;
+	}
+}
+
+/**
+ * Ecrit des trames sérialisées sur la sortie standard et vers les consommateurs
+ */
+static void publish(const unsigned char* text, unsigned int length) {
+	unsigned int written = 0;
+	while (written < length) {
+		ssize_t count = write(STDOUT_FILENO, text + written, length - written);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			break;
+		}
+		written += count;
+	}
+	for (int i = 0; i < GATEWAY_CONSUMERS; i++) {
+		if (consumers[i] >= 0 && send(consumers[i], text, length, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t) length) {
+			close(consumers[i]); // Consommateur trop lent ou parti : une trame tronquée ne doit pas être suivie d'une autre
+			consumers[i] = -1;
+		}
+	}
+}
+
+/**
+ * Traite un message d'un processus
+ */
+static void handle(int worker) {
+	if (!receiveMessage(workers[worker].socket, NULL)) {
+		lose(worker);
+		return;
+	}
+	Message* header = (Message*) message;
+	if (header->type == MESSAGE_FRAMES) {
+		workers[worker].bytes += header->dataSize;
+		publish(message + sizeof(Message) + header->stateSize, header->dataSize);
+		return;
+	}
+	if (header->port >= portsCount || ports[header->port].owner != worker) {
+		return;
+	}
+	Port* port = &ports[header->port];
+	if (header->type == MESSAGE_STATE) {
+		store(port, header);
+	} else if (header->type == MESSAGE_RELEASED) {
+		store(port, header);
+		port->owner = -1;
+		port->releasing = false;
+		rebalance();
+	} else if (header->type == MESSAGE_ADCO) {
+		port->adco = header->adco;
+		rebalance();
+	}
+}
+
+/**
+ * Affiche la répartition des ports
+ */
+static void show(const char* event, unsigned int moved) {
+	fprintf(stderr, "%s, %u ports déplacés :", event, moved);
+	for (int w = 0; w < TELEINFO_SHARD_WORKERS; w++) {
+		if (shard.hasWorker(w)) {
+			unsigned int owned = 0;
+			for (unsigned int i = 0; i < portsCount; i++) {
+				owned += shard.getOwner(keyOf(i)) == w ? 1 : 0;
+			}
+			fprintf(stderr, " [%d] %u", w, owned);
+		}
+	}
+	fprintf(stderr, "\n");
+}
+
+/**
+ * Ouvre la socket Unix des consommateurs
+ */
+static bool openListener(const char* path) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		return false;
+	}
+	strcpy(address.sun_path, path);
+	unlink(path);
+	listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	return listener >= 0 && bind(listener, (struct sockaddr*) &address, sizeof(address)) == 0 && listen(listener, GATEWAY_CONSUMERS) == 0;
+}
+
+/*********************************************************************************************************************************************************************
+  PROGRAMME
+ *********************************************************************************************************************************************************************/
+
+int main(int argc, char** argv) {
+	unsigned int initialWorkers = 2;
+	const char* socketPath = NULL;
+	int option;
+	bool valid = true;
+	while ((option = getopt(argc, argv, "w:f:i:u:")) != -1) {
+		switch (option) {
+			case 'w' : initialWorkers = strtoul(optarg, NULL, 10); break;
+			case 'f' :
+				format = strcmp(optarg, "line") == 0 ? TELEINFO_FORMAT_LINE : strcmp(optarg, "csv") == 0 ? TELEINFO_FORMAT_CSV
+						: strcmp(optarg, "json") == 0 ? TELEINFO_FORMAT_JSON : -1;
+				valid = valid && format >= 0;
+				break;
+			case 'i' : checkpointInterval = strtoul(optarg, NULL, 10); break;
+			case 'u' : socketPath = optarg; break;
+			default : valid = false; break;
+		}
+	}
+	portsCount = optind < argc ? argc - optind : 0;
+	if (!valid || portsCount == 0 || initialWorkers == 0 || initialWorkers > TELEINFO_SHARD_WORKERS || checkpointInterval == 0) {
+		fprintf(stderr, "Usage : %s [-w <processus>] [-f line|csv|json] [-i <secondes>] [-u <socket>] <port>...\n", argv[0]);
+		return 1;
+	}
+	TeleinfoDecoder reference;
+	stateSize = reference.getStateSize();
+	if (sizeof(Message) + stateSize + GATEWAY_PARTIAL > GATEWAY_MESSAGE) {
+		fprintf(stderr, "Etat du décodeur trop grand (%lu octets)\n", stateSize);
+		return 1;
+	}
+
+	for (int i = 0; i < TELEINFO_SHARD_WORKERS; i++) {
+		workers[i].pid = 0;
+		workers[i].socket = -1;
+	}
+	for (int i = 0; i < GATEWAY_CONSUMERS; i++) {
+		consumers[i] = -1;
+	}
+	if (socketPath != NULL && !openListener(socketPath)) {
+		fprintf(stderr, "Impossible d'ouvrir la socket %s : %s\n", socketPath, strerror(errno));
+		return 1;
+	}
+	ports = (Port*) calloc(portsCount, sizeof(Port));
+	if (ports == NULL) {
+		fprintf(stderr, "Mémoire insuffisante\n");
+		return 1;
+	}
+	for (unsigned int i = 0; i < portsCount; i++) {
+		ports[i].path = argv[optind + i];
+		ports[i].fd = open(ports[i].path, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+		ports[i].owner = -1;
+		ports[i].state = (unsigned char*) malloc(stateSize);
+		if (ports[i].fd < 0 || ports[i].state == NULL) {
+			fprintf(stderr, "Impossible d'ouvrir le port %s : %s\n", ports[i].path, strerror(errno));
+			return 1;
+		}
+		configure(ports[i].fd);
+	}
+	if (format == TELEINFO_FORMAT_CSV) {
+		char header[TELEINFO_SERIALIZER_FRAME_SIZE];
+		TeleinfoSerializer serializer(header, sizeof(header), format);
+		serializer.appendHeader();
+		publish((const unsigned char*) serializer.getBuffer(), serializer.getLength());
+	}
+
+	signal(SIGINT, interrupt);
+	signal(SIGTERM, interrupt);
+	signal(SIGUSR1, addition);
+	signal(SIGUSR2, removal);
+	signal(SIGPIPE, SIG_IGN);
+	for (unsigned int i = 0; i < initialWorkers; i++) {
+		if (startWorker() < 0) {
+			fprintf(stderr, "Impossible de démarrer un processus de travail : %s\n", strerror(errno));
+			return 1;
+		}
+	}
+	show("Démarrage", rebalance());
+
+	struct pollfd descriptors[TELEINFO_SHARD_WORKERS + 1];
+	int numbers[TELEINFO_SHARD_WORKERS + 1];
+	while (!stopping) {
+		for (; additions > 0; additions--) {
+			int worker = startWorker();
+			if (worker < 0) {
+				fprintf(stderr, "Impossible de démarrer un processus de travail : %s\n", strerror(errno));
+				continue;
+			}
+			char event[64];
+			snprintf(event, sizeof(event), "Processus %d ajouté", worker);
+			show(event, rebalance());
+		}
+		for (; removals > 0; removals--) {
+			int worker = TELEINFO_SHARD_WORKERS - 1;
+			while (worker >= 0 && !shard.hasWorker(worker)) {
+				worker--;
+			}
+			if (shard.getWorkerCount() <= 1) {
+				fprintf(stderr, "Le dernier processus de travail ne peut être retiré\n");
+				continue;
+			}
+			shard.removeWorker(worker);
+			workers[worker].retiring = true;
+			char event[64];
+			snprintf(event, sizeof(event), "Processus %d retiré", worker);
+			show(event, rebalance());
+		}
+
+		// Processus terminés
+		int status;
+		pid_t pid;
+		while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+			for (int w = 0; w < TELEINFO_SHARD_WORKERS; w++) {
+				if (workers[w].pid == pid) {
+					workers[w].pid = 0;
+					if (workers[w].socket >= 0) {
+						lose(w);
+					}
+				}
+			}
+		}
+
+		unsigned int count = 0;
+		for (int w = 0; w < TELEINFO_SHARD_WORKERS; w++) {
+			if (workers[w].socket >= 0) {
+				descriptors[count].fd = workers[w].socket;
+				descriptors[count].events = POLLIN;
+				numbers[count] = w;
+				count++;
+			}
+		}
+		if (listener >= 0) {
+			descriptors[count].fd = listener;
+			descriptors[count].events = POLLIN;
+			numbers[count] = -1;
+			count++;
+		}
+		if (unbalanced) {
+			rebalance();
+		}
+		if (poll(descriptors, count, unbalanced ? 10 : 1000) <= 0) {
+			continue;
+		}
+		for (unsigned int d = 0; d < count; d++) {
+			if (descriptors[d].revents == 0) {
+				continue;
+			}
+			if (numbers[d] < 0) {
+				int consumer = accept(listener, NULL, NULL);
+				int slot = 0;
+				while (slot < GATEWAY_CONSUMERS && consumers[slot] >= 0) {
+					slot++;
+				}
+				if (consumer >= 0 && slot < GATEWAY_CONSUMERS) {
+					consumers[slot] = consumer;
+				} else if (consumer >= 0) {
+					close(consumer);
+				}
+			} else if (workers[numbers[d]].socket >= 0) {
+				handle(numbers[d]);
+			}
+		}
+	}
+
+	// Arrêt : la fermeture de leur socket arrête les processus de travail
+	for (int w = 0; w < TELEINFO_SHARD_WORKERS; w++) {
+		if (workers[w].socket >= 0) {
+			close(workers[w].socket);
+		}
+	}
+	unsigned long long bytes = 0;
+	for (int w = 0; w < TELEINFO_SHARD_WORKERS; w++) {
+		if (workers[w].pid > 0) {
+			waitpid(workers[w].pid, NULL, 0);
+		}
+		bytes += workers[w].bytes;
+	}
+	fprintf(stderr, "%llu octets de trames fusionnés\n", bytes);
+	for (unsigned int i = 0; i < portsCount; i++) {
+		close(ports[i].fd);
+		free(ports[i].state);
+	}
+	free(ports);
+	for (int i = 0; i < GATEWAY_CONSUMERS; i++) {
+		if (consumers[i] >= 0) {
+			close(consumers[i]);
+		}
+	}
+	if (listener >= 0) {
+		close(listener);
+		unlink(socketPath);
+	}
+	return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * Reconstruction de l'historique d'un parc de compteurs à partir d'archives de captures
+ *
+ * Usage : teleinfo-rebuild [-j <threads>] [-m <compteurs>] [-s <trames>] [-p <progression>] [-f] -o <historique> <captures>...
+ *   -j <threads>     : nombre de threads de travail, un par coeur par défaut
+ *   -m <compteurs>   : nombre maximal de compteurs (10000 par défaut)
+ *   -s <trames>      : nombre de trames d'une partition (65536 par défaut)
+ *   -p <progression> : fichier de progression : une reconstruction interrompue (Ctrl-C) reprend où elle en était
+ *   -f               : tient aussi le niveau des trames (sinon niveaux 1 minute, 1 heure et 1 jour)
+ *   -o <historique>  : fichier de l'historique reconstruit, relu par TeleinfoRollup::load(...)
+ *
+ * Le débit est affiché sur la sortie d'erreur pendant la reconstruction.
+ *
+ * @author LK
+ */
+#include "TeleinfoRebuild.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static TeleinfoRebuild* rebuild = NULL;
+
+static void interrupt(int number) {
+	if (rebuild != NULL) {
+		rebuild->stop();
+	}
+}
+
+/**
+ * Affiche la progression, au plus une fois par seconde
+ */
+static void show(const TeleinfoRebuildProgress* progress, void* context) {
+	double* shown = (double*) context;
+	if (progress->seconds - *shown < 1 && progress->donePartitions < progress->partitions) {
+		return;
+	}
+	*shown = progress->seconds;
+	fprintf(stderr, "\r%lu/%lu partitions, %llu trames en %.1f s : %.0f trames/s   ", progress->donePartitions, progress->partitions,
+			(unsigned long long) progress->frames, progress->seconds, progress->framesPerSecond);
+}
+
+int main(int argc, char** argv) {
+	unsigned int workers = 0;
+	unsigned int meters = 10000;
+	uint64_t partitionFrames = TELEINFO_REBUILD_PARTITION;
+	const char* progressPath = NULL;
+	const char* outputPath = NULL;
+	unsigned int tiers = TELEINFO_TIERS_ROLLUPS;
+	int option;
+	while ((option = getopt(argc, argv, "j:m:s:p:fo:")) != -1) {
+		switch (option) {
+			case 'j' : workers = strtoul(optarg, NULL, 10); break;
+			case 'm' : meters = strtoul(optarg, NULL, 10); break;
+			case 's' : partitionFrames = strtoull(optarg, NULL, 10); break;
+			case 'p' : progressPath = optarg; break;
+			case 'f' : tiers = TELEINFO_TIERS_ALL; break;
+			case 'o' : outputPath = optarg; break;
+			default : outputPath = NULL; optind = argc; break;
+		}
+	}
+	if (outputPath == NULL || optind >= argc || meters == 0) {
+		fprintf(stderr, "Usage : %s [-j <threads>] [-m <compteurs>] [-s <trames>] [-p <progression>] [-f] -o <historique> <captures>...\n", argv[0]);
+		return 1;
+	}
+
+	TeleinfoRegistry registry(meters, 1);
+	TeleinfoRollup rollup(meters, tiers);
+	rebuild = new TeleinfoRebuild(&registry, &rollup, partitionFrames);
+	for (int i = optind; i < argc; i++) {
+		if (!rebuild->addCapture(argv[i])) {
+			fprintf(stderr, "Capture illisible : %s\n", argv[i]);
+			delete rebuild;
+			return 1;
+		}
+	}
+	double shown = -1;
+	rebuild->setCallback(show, &shown);
+	if (progressPath != NULL) {
+		rebuild->setProgressPath(progressPath);
+	}
+	signal(SIGINT, interrupt);
+	signal(SIGTERM, interrupt);
+
+	bool complete = rebuild->rebuild(workers);
+	TeleinfoRebuildProgress progress;
+	rebuild->getProgress(&progress);
+	fprintf(stderr, "\n%u compteurs, %llu trames ignorées\n", registry.getMeterCount(), (unsigned long long) progress.skippedFrames);
+	int status = 0;
+	if (!complete) {
+		fprintf(stderr, progress.donePartitions < progress.partitions && progressPath != NULL
+				? "Reconstruction interrompue : relancer la même commande pour la reprendre\n" : "Echec de la reconstruction\n");
+		status = 2;
+	} else if (!rollup.save(outputPath)) {
+		fprintf(stderr, "Impossible d'écrire %s\n", outputPath);
+		status = 1;
+	}
+	TeleinfoRebuild* finished = rebuild;
+	rebuild = NULL;
+	delete finished;
+	return status;
+}